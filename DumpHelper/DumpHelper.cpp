@@ -0,0 +1,141 @@
+// Out-of-process crash dump writer for the proxy (-enableminidumps -dumphelper).
+// The proxy starts it as bink2w64_dumphelper.exe <game process ID>, it then waits until the game
+// asks for a dump (see src/utils/dumpipc.h) or exits. Writing from here keeps working when the
+// game's heap is corrupted, and the game only has to signal instead of walking its own memory.
+
+#include <Windows.h>
+#include <Dbghelp.h>
+
+#include <cstdio>
+#include <cwchar>
+#include <vector>
+
+#include "../src/utils/dumpcompress.h"
+#include "../src/utils/dumpipc.h"
+#include "../src/utils/flightrec.h"
+
+#pragma comment(lib, "Dbghelp.lib")
+
+
+static DWORD writeDump(HANDLE process, DWORD processId, Utils::DumpIpcBlock* block)
+{
+    // The snapshot lives in the game, copy it over for the user stream and the sidecar.
+    std::vector<BYTE> flightSnapshot(block->FlightSnapshotSize);
+    SIZE_T read = 0;
+    if (!flightSnapshot.empty()
+        && !ReadProcessMemory(process, reinterpret_cast<LPCVOID>(block->FlightSnapshot), flightSnapshot.data(), flightSnapshot.size(), &read))
+    {
+        flightSnapshot.clear();
+    }
+
+    wchar_t dumpPath[Utils::DUMP_IPC_PATH_CHARS];
+    memcpy(dumpPath, block->DumpPath, sizeof(dumpPath));
+    dumpPath[Utils::DUMP_IPC_PATH_CHARS - 1] = L'\0';
+
+    auto dumpFile = CreateFileW(dumpPath, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if (dumpFile == INVALID_HANDLE_VALUE)
+    {
+        return GetLastError();
+    }
+
+    MINIDUMP_EXCEPTION_INFORMATION exInfo;
+    exInfo.ThreadId = block->ClientThreadId;
+    exInfo.ExceptionPointers = reinterpret_cast<PEXCEPTION_POINTERS>(block->ExceptionPointers);
+    exInfo.ClientPointers = TRUE;  // The pointers are the game's.
+
+    MINIDUMP_USER_STREAM flightStream;
+    flightStream.Type = Utils::FLIGHT_STREAM_TYPE;
+    flightStream.BufferSize = static_cast<ULONG>(flightSnapshot.size());
+    flightStream.Buffer = flightSnapshot.data();
+
+    MINIDUMP_USER_STREAM_INFORMATION userStreams;
+    userStreams.UserStreamCount = flightSnapshot.empty() ? 0 : 1;
+    userStreams.UserStreamArray = &flightStream;
+
+    auto dumped = MiniDumpWriteDump(process, processId, dumpFile, static_cast<MINIDUMP_TYPE>(block->DumpType),
+        block->ExceptionPointers ? &exInfo : nullptr, &userStreams, nullptr);
+    DWORD result = dumped ? 0 : GetLastError();
+    CloseHandle(dumpFile);
+
+    // Same sidecar as the in-process writer: <dump name>.flight.
+    auto length = wcslen(dumpPath);
+    if (!flightSnapshot.empty() && length > 4 && length + 4 < Utils::DUMP_IPC_PATH_CHARS)
+    {
+        wcscpy(dumpPath + length - 4, L".flight");
+        auto flightFile = CreateFileW(dumpPath, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+        if (flightFile != INVALID_HANDLE_VALUE)
+        {
+            DWORD written = 0;
+            WriteFile(flightFile, flightSnapshot.data(), static_cast<DWORD>(flightSnapshot.size()), &written, nullptr);
+            CloseHandle(flightFile);
+        }
+    }
+
+    return result;
+}
+
+int wmain(int argc, wchar_t** argv)
+{
+    if (argc < 2)
+    {
+        fwprintf(stderr, L"Usage: %s <game process ID>\n", argv[0]);
+        return 1;
+    }
+    auto processId = static_cast<DWORD>(wcstoul(argv[1], nullptr, 10));
+
+    auto process = OpenProcess(PROCESS_ALL_ACCESS, FALSE, processId);
+    if (!process)
+    {
+        return 2;
+    }
+
+    wchar_t name[64];
+    Utils::DumpIpc::Name(name, 64, L"Block", processId);
+    auto mapping = OpenFileMappingW(FILE_MAP_WRITE, FALSE, name);
+    Utils::DumpIpc::Name(name, 64, L"Request", processId);
+    auto requestEvent = OpenEventW(SYNCHRONIZE | EVENT_MODIFY_STATE, FALSE, name);
+    Utils::DumpIpc::Name(name, 64, L"Done", processId);
+    auto doneEvent = OpenEventW(EVENT_MODIFY_STATE, FALSE, name);
+
+    auto block = mapping ? reinterpret_cast<Utils::DumpIpcBlock*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, sizeof(Utils::DumpIpcBlock))) : nullptr;
+    if (!block || !requestEvent || !doneEvent
+        || 0 != memcmp(block->Magic, "LEBPDIPC", 8) || block->Version != Utils::DUMP_IPC_VERSION)
+    {
+        return 3;
+    }
+
+    block->HelperProcessId = GetCurrentProcessId();
+    if (!Utils::DumpIpc::TryTransition(block->State, Utils::DHS_STARTING, Utils::DHS_READY))
+    {
+        return 4;
+    }
+
+    // Serve requests until the game exits.
+    HANDLE waits[2] = { requestEvent, process };
+    while (WAIT_OBJECT_0 == WaitForMultipleObjects(2, waits, FALSE, INFINITE))
+    {
+        if (!Utils::DumpIpc::TryTransition(block->State, Utils::DHS_REQUESTED, Utils::DHS_WRITING))
+        {
+            continue;
+        }
+
+        wchar_t dumpPath[Utils::DUMP_IPC_PATH_CHARS];
+        memcpy(dumpPath, block->DumpPath, sizeof(dumpPath));
+        dumpPath[Utils::DUMP_IPC_PATH_CHARS - 1] = L'\0';
+        bool compress = 0 != (block->Flags & Utils::DUMP_IPC_FLAG_COMPRESS);
+
+        block->Result = writeDump(process, processId, block);
+        Utils::DumpIpc::TryTransition(block->State, Utils::DHS_WRITING, block->Result == 0 ? Utils::DHS_DONE : Utils::DHS_FAILED);
+        SetEvent(doneEvent);
+
+        // The game is free to go, compress on our own time.
+        if (compress && block->Result == 0)
+        {
+            wchar_t packedPath[Utils::DUMP_IPC_PATH_CHARS + 1];
+            swprintf(packedPath, Utils::DUMP_IPC_PATH_CHARS + 1, L"%sz", dumpPath);
+            Utils::CompressDumpFile(dumpPath, packedPath);
+        }
+    }
+
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "../src/spi/interface.h"
+#include "../src/ue_containers.h"
 #include "Common.h"
 
 
@@ -18,24 +19,19 @@ SPI_PLUGINSIDE_ASYNCATTACH;
 // Custom plugin logic.
 #pragma region Custom plugin logic.
 
-#pragma pack(4)
-struct FString
-{
-    wchar_t* Data;
-    int Count;
-    int Max;
-};
-
 // Pattern for the function to hook.
 #define P_STRINGBYREF "48 89 54 24 10 56 57 41 56 48 83 EC 30 48 C7 44 24 28 FE FF FF FF 48 89 5C 24 50 48 89 6C 24 60 45 8B F1 41 8B E8 48 8B DA 48 8B F1 33 C0 89 44 24 20 48 89 02"
 
 // Prototype, pointer to store the original function, and the hook.
-typedef FString* (*StringByRefT)(void* something, FString* outString, DWORD strRef, DWORD bParse);
+typedef UE::FString* (*StringByRefT)(void* something, UE::FString* outString, DWORD strRef, DWORD bParse);
 StringByRefT StringByRef_orig = nullptr;
-void* StringByRef_hook(void* something, FString* outString, DWORD strRef, DWORD bParse)
+void* StringByRef_hook(void* something, UE::FString* outString, DWORD strRef, DWORD bParse)
 {
     auto result = StringByRef_orig(something, outString, strRef, bParse);
-    writeln(L"StringByRef - %d => %s", strRef, result->Data);
+
+    // A view reads the game's string where it is, no copy.
+    UE::FStringView text{ *result };
+    writeln(L"StringByRef - %d => %.*s", strRef, static_cast<int>(text.size()), text.data());
     return result;
 }
 
@@ -59,7 +55,16 @@ SPI_IMPLEMENT_ATTACH
     SPIReturn rc;
     void* targetOffset = nullptr;
 
-    rc = InterfacePtr->FindPattern(&targetOffset, P_STRINGBYREF);
+    // Newer hosts (SPI 4+) provide a function table with faster paths, older ones return NULL here.
+    auto tableV4 = SPI_QueryV4(InterfacePtr);
+    if (tableV4 && (tableV4->Capabilities & SPI_CAP_CACHED_OFFSETS))
+    {
+        rc = tableV4->FindPatternCached(&targetOffset, P_STRINGBYREF);
+    }
+    else
+    {
+        rc = InterfacePtr->FindPattern(&targetOffset, P_STRINGBYREF);
+    }
     if (rc != SPIReturn::Success)
     {
         writeln(L"OnAttach - FindPattern failed with %d / %s", rc, SPIReturnToString(rc));
@@ -0,0 +1,282 @@
+// Turns a binary proxy log (bink2w64_proxy.log.bin, written with -binarylog) back into text,
+// lists the sessions kept in a rolling log (bink2w64_proxy.log.ring, written with -rollinglog),
+// or prints the flight record of a crash (from a .flight sidecar or straight from the .dmp).
+// Compressed dumps (.dmpz, written with -compressdumps) are unpacked to the output file when one
+// is given, otherwise their flight record is printed.
+// Portable on purpose, builds with the solution or with any C++17 compiler:
+//   g++ -std=c++17 -O2 -o LogDecoder LogDecoder.cpp
+// Usage: LogDecoder <bink2w64_proxy.log.bin | bink2w64_proxy.log.ring | *.flight | *.dmp> [output.txt]
+//        LogDecoder <*.dmpz> [output.dmp]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "../src/utils/binlog.h"
+#include "../src/utils/dumpcompress.h"
+#include "../src/utils/flightrec.h"
+#include "../src/utils/rollinglog.h"
+
+
+static std::string formatFileTime(uint64_t fileTime)
+{
+    // FILETIME is in 100 ns units.
+    auto msOfDay = (fileTime / 10000) % (24ull * 3600 * 1000);
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%02u:%02u:%02u.%03u",
+        static_cast<unsigned>(msOfDay / 3600000), static_cast<unsigned>(msOfDay / 60000 % 60),
+        static_cast<unsigned>(msOfDay / 1000 % 60), static_cast<unsigned>(msOfDay % 1000));
+    return buffer;
+}
+
+static std::string formatTime(const Utils::BinLogHeader& header, uint64_t tick)
+{
+    auto elapsed = static_cast<long double>(static_cast<int64_t>(tick - header.OriginTick)) / header.TicksPerSecond;
+    return formatFileTime(header.OriginFileTime + static_cast<int64_t>(elapsed * 10000000.0L));
+}
+
+static std::string formatDate(uint64_t fileTime)
+{
+    // Days since 1601-01-01 to a civil date (proleptic Gregorian).
+    auto days = static_cast<int64_t>(fileTime / (24ull * 3600 * 10000000)) - 134774;  // -> days since 1970-01-01
+    days += 719468;
+    auto era = days / 146097;
+    auto dayOfEra = days - era * 146097;
+    auto yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    auto dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    auto monthIndex = (5 * dayOfYear + 2) / 153;
+    auto day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    auto month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    auto year = yearOfEra + era * 400 + (month <= 2);
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", static_cast<int>(year), static_cast<int>(month), static_cast<int>(day));
+    return buffer;
+}
+
+static int decodeRollingLog(const std::vector<uint8_t>& data, const char* inputName, FILE* output)
+{
+    std::vector<Utils::RollingLogSessionText> sessions;
+    if (!Utils::RollingLog::Read(data.data(), data.size(), sessions))
+    {
+        fprintf(stderr, "%s has a broken header\n", inputName);
+        return 1;
+    }
+
+    for (const auto& session : sessions)
+    {
+        fprintf(output, "==== session %llu, process %u, started %s %s, %s ====\n",
+            static_cast<unsigned long long>(session.Session.Id), session.Session.ProcessId,
+            formatDate(session.Session.StartFileTime).c_str(), formatFileTime(session.Session.StartFileTime).c_str(),
+            session.Session.Closed ? "closed cleanly" : "did not close (crashed or still running)");
+        if (session.Wrapped)
+        {
+            fprintf(output, "<older lines of this session were overwritten>\n");
+        }
+        fwrite(session.Text.data(), 1, session.Text.size(), output);
+        if (!session.Text.empty() && session.Text.back() != '\n')
+        {
+            fputc('\n', output);
+        }
+    }
+    return 0;
+}
+
+static int decodeFlightRecord(const uint8_t* data, size_t size, const char* inputName, FILE* output)
+{
+    Utils::FlightSnapshotHeader header;
+    if (size < sizeof(header) || 0 != memcmp(data, "LEBPFLT1", 8))
+    {
+        fprintf(stderr, "%s has no flight record\n", inputName);
+        return 1;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.TicksPerSecond == 0 || header.EntrySize < sizeof(Utils::FlightEntry)
+        || (size - sizeof(header)) / header.EntrySize < header.EntryCount)
+    {
+        fprintf(stderr, "%s has a broken flight record\n", inputName);
+        return 1;
+    }
+
+    fprintf(output, "==== flight record of process %u, crashed on thread %u at %s %s, %u event(s) ====\n",
+        header.ProcessId, header.CrashThreadId, formatDate(header.SnapshotFileTime).c_str(),
+        formatFileTime(header.SnapshotFileTime).c_str(), header.EntryCount);
+
+    for (uint32_t i = 0; i < header.EntryCount; i++)
+    {
+        Utils::FlightEntry entry;
+        memcpy(&entry, data + sizeof(header) + static_cast<size_t>(i) * header.EntrySize, sizeof(entry));
+
+        auto secondsBefore = static_cast<double>(static_cast<int64_t>(header.SnapshotTick - entry.Tick)) / header.TicksPerSecond;
+        auto fileTime = header.SnapshotFileTime - static_cast<int64_t>(secondsBefore * 10000000.0);
+        std::string text(entry.Text, strnlen(entry.Text, Utils::FLIGHT_TEXT_CHARS));
+
+        fprintf(output, "%s  -%10.3f ms  tid %-6u %-17s A=%016llX B=%016llX  %s\n",
+            formatFileTime(fileTime).c_str(), secondsBefore * 1000.0, entry.ThreadId, Utils::FlightEventName(entry.Kind),
+            static_cast<unsigned long long>(entry.A), static_cast<unsigned long long>(entry.B), text.c_str());
+    }
+    return 0;
+}
+
+// Find the flight record user stream in a minidump.
+static int decodeMinidump(const std::vector<uint8_t>& data, const char* inputName, FILE* output)
+{
+    uint32_t streamCount = 0, directoryRva = 0;
+    if (data.size() < 16)
+    {
+        fprintf(stderr, "%s is not a minidump\n", inputName);
+        return 1;
+    }
+    memcpy(&streamCount, data.data() + 8, 4);
+    memcpy(&directoryRva, data.data() + 12, 4);
+
+    for (uint32_t i = 0; i < streamCount; i++)
+    {
+        uint32_t entry[3];  // stream type, data size, RVA
+        auto offset = static_cast<size_t>(directoryRva) + i * sizeof(entry);
+        if (offset + sizeof(entry) > data.size())
+        {
+            break;
+        }
+        memcpy(entry, data.data() + offset, sizeof(entry));
+        if (entry[0] == Utils::FLIGHT_STREAM_TYPE && static_cast<size_t>(entry[2]) + entry[1] <= data.size())
+        {
+            return decodeFlightRecord(data.data() + entry[2], entry[1], inputName, output);
+        }
+    }
+
+    fprintf(stderr, "%s has no flight record, was it written by an older proxy?\n", inputName);
+    return 1;
+}
+
+// Unpack a .dmpz, to a file if there is one, else print the flight record from memory.
+static int decodeCompressedDump(const std::vector<uint8_t>& data, const char* inputName, const char* outputName)
+{
+    Utils::DumpzTrailer trailer{};
+    std::vector<Utils::DumpzChunk> index;
+    if (!Utils::DumpCompressor::ReadIndex(data.data(), data.size(), trailer, index))
+    {
+        fprintf(stderr, "%s is truncated or damaged\n", inputName);
+        return 1;
+    }
+
+    std::vector<uint8_t> raw(static_cast<size_t>(trailer.RawSize));
+    for (const auto& chunk : index)
+    {
+        if (!Utils::DumpCompressor::ReadChunk(data.data(), chunk, raw.data() + chunk.RawOffset))
+        {
+            fprintf(stderr, "%s: chunk at %llu is damaged\n", inputName, static_cast<unsigned long long>(chunk.RawOffset));
+            return 1;
+        }
+    }
+
+    if (!outputName)
+    {
+        return decodeMinidump(raw, inputName, stdout);
+    }
+
+    FILE* output = fopen(outputName, "wb");
+    if (!output)
+    {
+        fprintf(stderr, "Failed to open %s\n", outputName);
+        return 1;
+    }
+    auto written = fwrite(raw.data(), 1, raw.size(), output);
+    fclose(output);
+    if (written != raw.size())
+    {
+        fprintf(stderr, "Failed to write %s\n", outputName);
+        return 1;
+    }
+    fprintf(stderr, "%s: %zu chunks, %llu bytes unpacked\n", inputName, index.size(), static_cast<unsigned long long>(raw.size()));
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <bink2w64_proxy.log.bin | bink2w64_proxy.log.ring | *.flight | *.dmp> [output.txt]\n", argv[0]);
+        fprintf(stderr, "       %s <*.dmpz> [output.dmp]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* input = fopen(argv[1], "rb");
+    if (!input)
+    {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[64 * 1024];
+    size_t chunkSize;
+    while ((chunkSize = fread(chunk, 1, sizeof(chunk), input)) > 0)
+    {
+        data.insert(data.end(), chunk, chunk + chunkSize);
+    }
+    fclose(input);
+
+    if (data.size() >= 8 && 0 == memcmp(data.data(), "LEBPDMPZ", 8))
+    {
+        return decodeCompressedDump(data, argv[1], argc >= 3 ? argv[2] : nullptr);
+    }
+
+    bool isRollingLog = data.size() >= 8 && 0 == memcmp(data.data(), "LEBPRLG1", 8);
+    bool isFlightRecord = data.size() >= 8 && 0 == memcmp(data.data(), "LEBPFLT1", 8);
+    bool isMinidump = data.size() >= 4 && 0 == memcmp(data.data(), "MDMP", 4);
+    if (isRollingLog || isFlightRecord || isMinidump)
+    {
+        FILE* output = argc >= 3 ? fopen(argv[2], "w") : stdout;
+        if (!output)
+        {
+            fprintf(stderr, "Failed to open %s\n", argv[2]);
+            return 1;
+        }
+        auto rc = isRollingLog ? decodeRollingLog(data, argv[1], output)
+            : isFlightRecord ? decodeFlightRecord(data.data(), data.size(), argv[1], output)
+            : decodeMinidump(data, argv[1], output);
+        if (output != stdout)
+        {
+            fclose(output);
+        }
+        return rc;
+    }
+
+    Utils::BinLogContents log;
+    if (!Utils::BinLogReader::Read(data.data(), data.size(), log))
+    {
+        fprintf(stderr, "%s is not a binary proxy log, or its header is broken\n", argv[1]);
+        return 1;
+    }
+
+    FILE* output = argc >= 3 ? fopen(argv[2], "w") : stdout;
+    if (!output)
+    {
+        fprintf(stderr, "Failed to open %s\n", argv[2]);
+        return 1;
+    }
+
+    for (const auto& event : log.Events)
+    {
+        fprintf(output, "%s  %s\n", formatTime(log.Header, event.Tick).c_str(), Utils::BinLogReader::FormatLine(log, event).c_str());
+    }
+    for (auto id : log.Collisions)
+    {
+        fprintf(output, "<ID %08X has several formats, its events can't be decoded>\n", id);
+    }
+
+    if (log.Truncated)
+    {
+        fprintf(output, "<log is truncated, the game probably crashed while writing it>\n");
+    }
+
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+    return 0;
+}
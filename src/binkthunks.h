@@ -0,0 +1,280 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#ifdef _WIN32
+#include <mutex>
+#include <type_traits>
+#include <Windows.h>
+#include "utils/binkstats.h"
+#include "utils/flightrec.h"
+#include "utils/io.h"
+#include "utils/tickclock.h"
+#endif
+
+
+// Bink exports the proxy defines itself instead of forwarding (see dllexports.h for the rest):
+// the ones which open and close movies and decode their frames, so playback can be observed.
+// Each thunk calls the original in bink2w64_original (or MissingOriginal if it lacks the export);
+// with -binkstats off that is the whole thunk (a flag check and the call), except for open and
+// close which also go into the flight recorder.
+//
+// The signatures are the Bink 2 SDK's (bink.h), with HBINK as void*, U32/S32 as uint32_t/int32_t and
+// the BINK_OPEN_OPTIONS struct opaque. RADEXPLINK is __stdcall, which x64 ignores:
+//   HBINK BinkOpen(char const* name, U32 flags);
+//   HBINK BinkOpenWithOptions(char const* name, BINK_OPEN_OPTIONS const* boo, U32 flags);
+//   void  BinkClose(HBINK bink);
+//   S32   BinkDoFrame(HBINK bink);
+//   S32   BinkDoFrameAsync(HBINK bink, U32 thread_num, U32 second_thread_num);
+//   S32   BinkDoFrameAsyncWait(HBINK bink, S32 us);     // Non-zero once the frame is done.
+//   void  BinkNextFrame(HBINK bink);
+//   S32   BinkShouldSkip(HBINK bink);
+// An export listed here must not also be forwarded in dllexports.h (test_binkthunks checks both).
+//
+//  X(name, return type, (parameters), (arguments))
+#define BINK_THUNKED_EXPORTS(X) \
+    X(BinkOpen,             void*,   (const char* name, uint32_t flags),                               (name, flags)) \
+    X(BinkOpenWithOptions,  void*,   (const char* name, const void* options, uint32_t flags),          (name, options, flags)) \
+    X(BinkClose,            void,    (void* bink),                                                     (bink)) \
+    X(BinkDoFrame,          int32_t, (void* bink),                                                     (bink)) \
+    X(BinkDoFrameAsync,     int32_t, (void* bink, uint32_t threadIndex, uint32_t secondThreadIndex),   (bink, threadIndex, secondThreadIndex)) \
+    X(BinkDoFrameAsyncWait, int32_t, (void* bink, int32_t us),                                         (bink, us)) \
+    X(BinkNextFrame,        void,    (void* bink),                                                     (bink)) \
+    X(BinkShouldSkip,       int32_t, (void* bink),                                                     (bink))
+
+namespace BinkThunks
+{
+    // BinkOpen flags under which the name isn't a file name.
+    static const uint32_t BINK_FILE_HANDLE = 0x00800000;
+    static const uint32_t BINK_FROM_MEMORY = 0x04000000;
+
+    #define BINK_THUNK_TYPEDEF(NAME, RET, PARAMS, ARGS) typedef RET (*t##NAME) PARAMS;
+    BINK_THUNKED_EXPORTS(BINK_THUNK_TYPEDEF)
+    #undef BINK_THUNK_TYPEDEF
+
+    // The originals, one typed pointer per thunked export.
+    struct Originals
+    {
+        #define BINK_THUNK_FIELD(NAME, RET, PARAMS, ARGS) t##NAME NAME = nullptr;
+        BINK_THUNKED_EXPORTS(BINK_THUNK_FIELD)
+        #undef BINK_THUNK_FIELD
+    };
+
+    #define BINK_THUNK_NAME(NAME, RET, PARAMS, ARGS) #NAME,
+    static const char* const NAMES[] = { BINK_THUNKED_EXPORTS(BINK_THUNK_NAME) };
+    #undef BINK_THUNK_NAME
+    static const size_t COUNT = sizeof(NAMES) / sizeof(NAMES[0]);
+
+    #define BINK_THUNK_INDEX(NAME, RET, PARAMS, ARGS) INDEX_##NAME,
+    enum : size_t { BINK_THUNKED_EXPORTS(BINK_THUNK_INDEX) };
+    #undef BINK_THUNK_INDEX
+
+    // Told the name of an export the first time a thunk calls it without an original.
+    void (*GMissingCalled)(const char* name) = nullptr;
+
+    // Stands in for an original the DLL lacks, so no thunk calls nullptr: reports the first call
+    // through GMissingCalled and returns 0 / nullptr, a movie that didn't open or a frame not done.
+    template<size_t INDEX, typename TRet, typename... TArgs>
+    TRet MissingOriginal(TArgs...)
+    {
+        static std::atomic<bool> reported{ false };
+        if (!reported.exchange(true) && GMissingCalled)
+        {
+            GMissingCalled(NAMES[INDEX]);
+        }
+        return TRet();
+    }
+
+    template<size_t INDEX, typename TRet, typename... TArgs>
+    constexpr auto MissingFor(TRet (*)(TArgs...)) { return &MissingOriginal<INDEX, TRet, TArgs...>; }
+
+    // Fill in the originals through lookup(name) -> void* (GetProcAddress on the original DLL),
+    // missed(name) for each one it can't find, which gets a MissingOriginal instead.
+    // Returns how many were found.
+    template<typename TLookup, typename TMissed>
+    size_t Resolve(Originals& originals, TLookup&& lookup, TMissed&& missed)
+    {
+        size_t found = 0;
+        #define BINK_THUNK_RESOLVE(NAME, RET, PARAMS, ARGS) \
+            originals.NAME = reinterpret_cast<t##NAME>(lookup(#NAME)); \
+            if (originals.NAME) found++; else { missed(#NAME); originals.NAME = MissingFor<INDEX_##NAME>(originals.NAME); }
+        BINK_THUNKED_EXPORTS(BINK_THUNK_RESOLVE)
+        #undef BINK_THUNK_RESOLVE
+        return found;
+    }
+
+    // The name to show for a movie: the file name if it is one, its tail if it's longer than room.
+    inline const char* MovieName(const char* name, uint32_t flags, size_t room)
+    {
+        if (!name || (flags & (BINK_FILE_HANDLE | BINK_FROM_MEMORY)))
+        {
+            return "";
+        }
+        auto length = strlen(name);
+        return length > room ? name + length - room : name;
+    }
+
+#ifdef _WIN32
+    Originals GOriginals;
+    std::atomic<bool> GResolved{ false };
+    std::mutex GResolveMtx;
+    Utils::TickClock GClock;
+
+    // Bink isn't called before the game is well into its boot, the originals are looked up on first use.
+    __declspec(noinline) void ResolveOriginals()
+    {
+        const std::lock_guard<std::mutex> lock(GResolveMtx);
+        if (GResolved.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        GClock.Anchor(frequency.QuadPart, 0, 0);
+
+        auto original = LoadLibraryW(L"bink2w64_original.dll");
+        if (!original)
+        {
+            GLogger.writeln(L"ResolveOriginals: ERROR: failed to load bink2w64_original.dll (error code = %d)", GetLastError());
+        }
+        GMissingCalled = [](const char* name) { GLogger.writeln(L"%S: ERROR: bink2w64_original.dll has no such export, returned 0", name); };
+        auto found = Resolve(GOriginals,
+            [original](const char* name) { return original ? reinterpret_cast<void*>(GetProcAddress(original, name)) : nullptr; },
+            [](const char* name) { GLogger.writeln(L"ResolveOriginals: ERROR: bink2w64_original.dll has no %S", name); });
+        GLogger.writeln(L"ResolveOriginals: %zu of %zu thunked Bink exports resolved, stats are %s",
+            found, COUNT, Utils::GBinkStats.Enabled() ? L"on" : L"off");
+
+        GResolved.store(true, std::memory_order_release);
+    }
+
+    __forceinline const Originals& Get()
+    {
+        if (!GResolved.load(std::memory_order_acquire))
+        {
+            ResolveOriginals();
+        }
+        return GOriginals;
+    }
+
+    inline int64_t NowUs()
+    {
+        return GClock.MicrosecondsSinceAnchor(Utils::TickClock::Now());
+    }
+
+    void* Opened(void* bink, const char* name, uint32_t flags)
+    {
+        Utils::GFlightRecorder.Record(Utils::FE_MOVIE_OPENED, reinterpret_cast<ULONG_PTR>(bink), flags,
+            MovieName(name, flags, Utils::FLIGHT_TEXT_CHARS));
+        if (Utils::GBinkStats.Enabled())
+        {
+            Utils::GBinkStats.OnOpen(bink, MovieName(name, flags, SIZE_MAX));
+        }
+        return bink;
+    }
+#endif
+}
+
+#ifdef _WIN32
+extern "C" __declspec(dllexport) void* BinkOpen(const char* name, uint32_t flags)
+{
+    return BinkThunks::Opened(BinkThunks::Get().BinkOpen(name, flags), name, flags);
+}
+
+extern "C" __declspec(dllexport) void* BinkOpenWithOptions(const char* name, const void* options, uint32_t flags)
+{
+    return BinkThunks::Opened(BinkThunks::Get().BinkOpenWithOptions(name, options, flags), name, flags);
+}
+
+extern "C" __declspec(dllexport) void BinkClose(void* bink)
+{
+    uint64_t decoded = 0;
+    if (Utils::GBinkStats.Enabled())
+    {
+        Utils::GBinkStats.OnClose(bink, [&decoded](const Utils::BinkStats::Movie& movie)
+            {
+                decoded = movie.Decoded;
+                GLogger.writeln(L"BinkStats: movie #%u \"%S\": %llu frame(s) decoded, %llu skipped, %llu advanced; "
+                    L"decode us: min %lld, p50 <= %lld, p90 <= %lld, p99 <= %lld, max %lld, mean %lld",
+                    movie.Serial, movie.Name.c_str(), movie.Decoded, movie.Skipped, movie.Advanced,
+                    movie.Decode.MinUs(), movie.Decode.PercentileUs(50), movie.Decode.PercentileUs(90),
+                    movie.Decode.PercentileUs(99), movie.Decode.MaxUs(), movie.Decode.MeanUs());
+            });
+    }
+    Utils::GFlightRecorder.Record(Utils::FE_MOVIE_CLOSED, reinterpret_cast<ULONG_PTR>(bink), decoded, "");
+    BinkThunks::Get().BinkClose(bink);
+}
+
+extern "C" __declspec(dllexport) int32_t BinkDoFrame(void* bink)
+{
+    auto& originals = BinkThunks::Get();
+    if (!Utils::GBinkStats.Enabled())
+    {
+        return originals.BinkDoFrame(bink);
+    }
+
+    auto start = BinkThunks::NowUs();
+    auto result = originals.BinkDoFrame(bink);
+    Utils::GBinkStats.OnDecoded(bink, BinkThunks::NowUs() - start);
+    return result;
+}
+
+extern "C" __declspec(dllexport) int32_t BinkDoFrameAsync(void* bink, uint32_t threadIndex, uint32_t secondThreadIndex)
+{
+    auto& originals = BinkThunks::Get();
+    if (!Utils::GBinkStats.Enabled())
+    {
+        return originals.BinkDoFrameAsync(bink, threadIndex, secondThreadIndex);
+    }
+
+    auto start = BinkThunks::NowUs();
+    auto result = originals.BinkDoFrameAsync(bink, threadIndex, secondThreadIndex);
+    if (result)
+    {
+        Utils::GBinkStats.OnAsyncStarted(bink, start);
+    }
+    return result;
+}
+
+extern "C" __declspec(dllexport) int32_t BinkDoFrameAsyncWait(void* bink, int32_t us)
+{
+    auto& originals = BinkThunks::Get();
+    if (!Utils::GBinkStats.Enabled())
+    {
+        return originals.BinkDoFrameAsyncWait(bink, us);
+    }
+
+    auto result = originals.BinkDoFrameAsyncWait(bink, us);
+    Utils::GBinkStats.OnAsyncWaited(bink, result != 0, BinkThunks::NowUs());
+    return result;
+}
+
+extern "C" __declspec(dllexport) void BinkNextFrame(void* bink)
+{
+    auto& originals = BinkThunks::Get();
+    if (Utils::GBinkStats.Enabled())
+    {
+        Utils::GBinkStats.OnAdvanced(bink);
+    }
+    originals.BinkNextFrame(bink);
+}
+
+extern "C" __declspec(dllexport) int32_t BinkShouldSkip(void* bink)
+{
+    auto& originals = BinkThunks::Get();
+    auto result = originals.BinkShouldSkip(bink);
+    if (result && Utils::GBinkStats.Enabled())
+    {
+        Utils::GBinkStats.OnSkipped(bink);
+    }
+    return result;
+}
+
+// The thunks above are written out by hand, they have to keep the table's signatures.
+#define BINK_THUNK_CHECK(NAME, RET, PARAMS, ARGS) \
+    static_assert(std::is_same_v<decltype(&::NAME), BinkThunks::t##NAME>, #NAME " doesn't match BINK_THUNKED_EXPORTS");
+BINK_THUNKED_EXPORTS(BINK_THUNK_CHECK)
+#undef BINK_THUNK_CHECK
+#endif
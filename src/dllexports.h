@@ -1,15 +1,12 @@
 #pragma once
 
+// Everything is forwarded to the original DLL, except the exports in binkthunks.h.
 #pragma comment(linker, "/export:BinkAllocateFrameBuffers=bink2w64_original.BinkAllocateFrameBuffers")
-#pragma comment(linker, "/export:BinkClose=bink2w64_original.BinkClose")
 #pragma comment(linker, "/export:BinkCloseTrack=bink2w64_original.BinkCloseTrack")
 #pragma comment(linker, "/export:BinkControlBackgroundIO=bink2w64_original.BinkControlBackgroundIO")
 #pragma comment(linker, "/export:BinkCopyToBuffer=bink2w64_original.BinkCopyToBuffer")
 #pragma comment(linker, "/export:BinkCopyToBufferRect=bink2w64_original.BinkCopyToBufferRect")
-#pragma comment(linker, "/export:BinkDoFrame=bink2w64_original.BinkDoFrame")
-#pragma comment(linker, "/export:BinkDoFrameAsync=bink2w64_original.BinkDoFrameAsync")
 #pragma comment(linker, "/export:BinkDoFrameAsyncMulti=bink2w64_original.BinkDoFrameAsyncMulti")
-#pragma comment(linker, "/export:BinkDoFrameAsyncWait=bink2w64_original.BinkDoFrameAsyncWait")
 #pragma comment(linker, "/export:BinkDoFramePlane=bink2w64_original.BinkDoFramePlane")
 #pragma comment(linker, "/export:BinkFindXAudio2WinDevice=bink2w64_original.BinkFindXAudio2WinDevice")
 #pragma comment(linker, "/export:BinkFreeGlobals=bink2w64_original.BinkFreeGlobals")
@@ -27,13 +24,10 @@
 #pragma comment(linker, "/export:BinkGetTrackType=bink2w64_original.BinkGetTrackType")
 #pragma comment(linker, "/export:BinkGoto=bink2w64_original.BinkGoto")
 #pragma comment(linker, "/export:BinkLogoAddress=bink2w64_original.BinkLogoAddress")
-#pragma comment(linker, "/export:BinkNextFrame=bink2w64_original.BinkNextFrame")
-#pragma comment(linker, "/export:BinkOpen=bink2w64_original.BinkOpen")
 #pragma comment(linker, "/export:BinkOpenDirectSound=bink2w64_original.BinkOpenDirectSound")
 #pragma comment(linker, "/export:BinkOpenMiles=bink2w64_original.BinkOpenMiles")
 #pragma comment(linker, "/export:BinkOpenTrack=bink2w64_original.BinkOpenTrack")
 #pragma comment(linker, "/export:BinkOpenWaveOut=bink2w64_original.BinkOpenWaveOut")
-#pragma comment(linker, "/export:BinkOpenWithOptions=bink2w64_original.BinkOpenWithOptions")
 #pragma comment(linker, "/export:BinkOpenXAudio2=bink2w64_original.BinkOpenXAudio2")
 #pragma comment(linker, "/export:BinkOpenXAudio27=bink2w64_original.BinkOpenXAudio27")
 #pragma comment(linker, "/export:BinkOpenXAudio28=bink2w64_original.BinkOpenXAudio28")
@@ -60,7 +54,6 @@
 #pragma comment(linker, "/export:BinkSetVideoOnOff=bink2w64_original.BinkSetVideoOnOff")
 #pragma comment(linker, "/export:BinkSetVolume=bink2w64_original.BinkSetVolume")
 #pragma comment(linker, "/export:BinkSetWillLoop=bink2w64_original.BinkSetWillLoop")
-#pragma comment(linker, "/export:BinkShouldSkip=bink2w64_original.BinkShouldSkip")
 #pragma comment(linker, "/export:BinkStartAsyncThread=bink2w64_original.BinkStartAsyncThread")
 #pragma comment(linker, "/export:BinkUtilCPUs=bink2w64_original.BinkUtilCPUs")
 #pragma comment(linker, "/export:BinkUtilFree=bink2w64_original.BinkUtilFree")
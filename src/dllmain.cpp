@@ -1,113 +1,95 @@
 #include "dllexports.h"
 #define ASI_LOG_FNAME "bink2w64_proxy.log"
+#define ASI_ROLLINGLOG_FNAME "bink2w64_proxy.log.ring"
+#define ASI_TRACE_FNAME "bink2w64_proxy.trace.json"
+#define ASI_BINLOG_FNAME "bink2w64_proxy.log.bin"
+#define ASI_DUMPHELPER_FNAME L"bink2w64_dumphelper.exe"
 
 #include <Windows.h>
 #include <filesystem>
-#include <Dbghelp.h>
 
 #include <cwchar>
 
 #include "conf/version.h"
 #include "gamever.h"
+#include "utils/crashdump.h"
 #include "utils/io.h"
+#include "utils/profiler.h"
 #include "utils/hook.h"
 #include "dllstruct.h"
+#include "binkthunks.h"
 #include "utils/memory.h"
 #include "spi.h"
 #include "modules/asi_loader.h"
+#include "modules/asi_hot_reload.h"
 #include "modules/console_enabler.h"
+#include "modules/frame_tick.h"
 #include "modules/launcher_working_dir_fix.h"
 #include "modules/launcher_args.h"
 
 
 PVOID GhVEH = NULL;
+LPTOP_LEVEL_EXCEPTION_FILTER GPreviousUnhandledFilter = NULL;
+bool GUnhandledFilterSet = false;
 
 LONG LEBinkProxyVectoredExceptionHandler(PEXCEPTION_POINTERS pExceptionPtrs)
 {
-	// If this is a debugging exception, skip.
-	auto code = pExceptionPtrs->ExceptionRecord->ExceptionCode;
-	if (code == CONTROL_C_EXIT
-		|| code == STATUS_BREAKPOINT
-		|| code == DBG_PRINTEXCEPTION_C || code == DBG_PRINTEXCEPTION_WIDE_C
-		|| code == 0xE06D7363 || code == 0x406D1388)  // the stuff that gets thrown "normally"
+	// Only crash-class codes get through, the rest is "normal" engine noise (see Utils::CrashFilter).
+	if (!Utils::GCrashDumper.ShouldDump(pExceptionPtrs))
 	{
-		goto return_from_handler;
+		return EXCEPTION_CONTINUE_SEARCH;
 	}
 
+	// Get the queued log lines onto the disk before anything else can go wrong.
+	GLogger.FlushFromCrash();
 
-	// Load dbghelp and the MiniDumpWriteDump function.
+	// Write the dump (the whole process memory with -killmydisk), on the watchdog thread.
+	Utils::GCrashDumper.Dump(pExceptionPtrs);
 
-	auto libDbghelp = LoadLibraryA("dbghelp");
-	if (!libDbghelp)
-	{
-		goto return_from_handler;
-	}
-	auto fnMiniDumpWriteDump = (decltype(&MiniDumpWriteDump))GetProcAddress(libDbghelp, "MiniDumpWriteDump");
-	if (!fnMiniDumpWriteDump)
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+LONG WINAPI LEBinkProxyUnhandledExceptionFilter(PEXCEPTION_POINTERS pExceptionPtrs)
+{
+	// The crash nothing handled: it has a dump slot of its own, first-chance dumps can't use it up.
+	if (Utils::GCrashDumper.ShouldDump(pExceptionPtrs, true))
 	{
-		goto return_from_handler;
+		GLogger.FlushFromCrash();
+		Utils::GCrashDumper.Dump(pExceptionPtrs);
 	}
 
-
-	// Get the base dump file name, which will be completed depending on the dump mode.
-
-	wchar_t wstrDumpFile[MAX_PATH];
-	auto dwModuleNameLen = GetModuleFileNameW(GetModuleHandleW(0), wstrDumpFile, MAX_PATH);
-
-	MINIDUMP_TYPE dumpType;
-	SYSTEMTIME time;
-	GetSystemTime(&time);
-
-
-	// If -killmydisk is set, dump the entire process memory.
-	// Otherwise, only the crash call stack.
-
+	return GPreviousUnhandledFilter ? GPreviousUnhandledFilter(pExceptionPtrs) : EXCEPTION_CONTINUE_SEARCH;
+}
+bool SetVectoredExceptionHandler()
+{
 	// This loads before proxy handling class so we have to fetch full command line and not autoboot version.
-	if (nullptr != std::wcsstr(GetCommandLineW(), L" -killmydisk"))
+	if (!Utils::GCrashDumper.Initialize(nullptr != std::wcsstr(GetCommandLineW(), L" -killmydisk")))
 	{
-		dumpType = MINIDUMP_TYPE(MiniDumpWithFullMemory);
-		swprintf(wstrDumpFile + dwModuleNameLen - 4, MAX_PATH, L"_%4d%02d%02d_%02d%02d%02df.dmp",
-			time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
+		return false;
 	}
-	else
+	GhVEH = AddVectoredExceptionHandler(1, LEBinkProxyVectoredExceptionHandler);
+	if (GhVEH == NULL)
 	{
-		dumpType = MINIDUMP_TYPE(MiniDumpNormal);
-		swprintf(wstrDumpFile + dwModuleNameLen - 4, MAX_PATH, L"_%4d%02d%02d_%02d%02d%02dn.dmp",
-			time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
+		return false;
 	}
-
-
-	// Open a dump file in the game's directory.
-
-	auto dumpFile = CreateFileW(wstrDumpFile, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
-	if (dumpFile == INVALID_HANDLE_VALUE)
+	GPreviousUnhandledFilter = SetUnhandledExceptionFilter(LEBinkProxyUnhandledExceptionFilter);
+	GUnhandledFilterSet = true;
+	return true;
+}
+bool StartDumpHelper()
+{
+	// The helper ships next to the proxy DLL.
+	HMODULE proxyModule = nullptr;
+	wchar_t helperPath[MAX_PATH];
+	if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+		reinterpret_cast<LPCWSTR>(&StartDumpHelper), &proxyModule)
+		|| 0 == GetModuleFileNameW(proxyModule, helperPath, MAX_PATH))
 	{
-		goto return_from_handler;
+		return false;
 	}
 
-	MINIDUMP_EXCEPTION_INFORMATION exInfo;
-	exInfo.ThreadId = GetCurrentThreadId();
-	exInfo.ExceptionPointers = pExceptionPtrs;
-	exInfo.ClientPointers = FALSE;
-
-
-	// Write the dump.
-
-	auto dumped = fnMiniDumpWriteDump(
-		GetCurrentProcess(), GetCurrentProcessId(),
-		dumpFile, dumpType,
-		pExceptionPtrs ? &exInfo : nullptr,
-		nullptr, nullptr);
-
-	CloseHandle(dumpFile);
-
-return_from_handler:
-
-	return EXCEPTION_CONTINUE_SEARCH;
-}
-void SetVectoredExceptionHandler()
-{
-	GhVEH = AddVectoredExceptionHandler(1, LEBinkProxyVectoredExceptionHandler);
+	std::filesystem::path path = helperPath;
+	path.replace_filename(ASI_DUMPHELPER_FNAME);
+	return Utils::GCrashDumper.StartHelper(path.c_str());
 }
 void UnsetVectoredExceptionHandler()
 {
@@ -115,6 +97,15 @@ void UnsetVectoredExceptionHandler()
 	{
 		RemoveVectoredExceptionHandler(GhVEH);
 	}
+	if (GUnhandledFilterSet)
+	{
+		// Only if it's still ours, the game may have put its own in since.
+		auto current = SetUnhandledExceptionFilter(GPreviousUnhandledFilter);
+		if (current != LEBinkProxyUnhandledExceptionFilter)
+		{
+			SetUnhandledExceptionFilter(current);
+		}
+	}
 }
 
 // Fixes bad launcher logic when not using Autoboot (sets the wrong working directory)
@@ -127,8 +118,34 @@ void SetWorkingDirectory() {
 
 void __stdcall OnAttach()
 {
-	// Open console or log.
+	// Open console or log, then move log writes off the calling threads.
 	Utils::SetupOutput();
+	GLogger.StartWriter();
+
+	// Apply -loglevel= to the GLOG_* sites.
+	if (!GLogger.Filter.Configure(GetCommandLineW()))
+	{
+		GLogger.writeln(L"OnAttach: ERROR: -loglevel= has invalid items, they were ignored");
+	}
+
+	// Record GLOG_FAST lines in binary form if requested, decode them with LogDecoder.
+	if (nullptr != std::wcsstr(GetCommandLineW(), L" -binarylog") && !GLogger.Binary.Open(ASI_BINLOG_FNAME))
+	{
+		GLogger.writeln(L"OnAttach: ERROR: failed to open " ASI_BINLOG_FNAME L", binary logging is disabled (error code = %d)", errno);
+	}
+
+	// Record the boot timeline if requested, it is written out at the end of OnAttach.
+	auto bootStart = Utils::GProfiler.Now();
+	if (nullptr != std::wcsstr(GetCommandLineW(), L" -bootprofile"))
+	{
+		Utils::GProfiler.Enable();
+	}
+
+	// Time movie decoding per movie if requested, reported as each movie closes.
+	if (nullptr != std::wcsstr(GetCommandLineW(), L" -binkstats"))
+	{
+		Utils::GBinkStats.Enable(true);
+	}
 
 	GLogger.writeln(L"Attached...\n"
 		L"LEBinkProxy by d00telemental/ME3Tweaks\n"
@@ -138,8 +155,35 @@ void __stdcall OnAttach()
 	if (nullptr != std::wcsstr(GetCommandLineW(), L" -enableminidumps")) {
 		// Register exception handler for memory dumps.
 		// Removed on DETACH.
-		GLogger.writeln(L"Minidumps are enabled for this session");
-		SetVectoredExceptionHandler();
+		if (SetVectoredExceptionHandler())
+		{
+			GLogger.writeln(L"Minidumps are enabled for this session");
+		}
+		else
+		{
+			GLogger.writeln(L"OnAttach: ERROR: failed to prepare the minidump writer (error code = %d)", GetLastError());
+		}
+
+		// Store dumps compressed (.dmpz), LogDecoder turns them back into .dmp.
+		// Raw dumps left by earlier crashes are compressed in the background.
+		if (nullptr != std::wcsstr(GetCommandLineW(), L" -compressdumps"))
+		{
+			Utils::GCrashDumper.EnableCompression();
+			Utils::GCrashDumper.CompressLeftoverDumps();
+		}
+
+		// Write dumps from a helper process next to the proxy (-dumphelper).
+		if (nullptr != std::wcsstr(GetCommandLineW(), L" -dumphelper") && Utils::GCrashDumper.IsInitialized())
+		{
+			if (StartDumpHelper())
+			{
+				GLogger.writeln(L"Minidumps will be written by " ASI_DUMPHELPER_FNAME);
+			}
+			else
+			{
+				GLogger.writeln(L"OnAttach: ERROR: failed to start " ASI_DUMPHELPER_FNAME L", dumps are written in-process (error code = %d)", GetLastError());
+			}
+		}
 	}
 
 	// Initialize MinHook.
@@ -198,9 +242,23 @@ void __stdcall OnAttach()
 			break;
 		}
 
+		// Run plugins' tick callbacks at every frame boundary.
+		GLEBinkProxy.FrameTick = new FrameTickModule;
+		if (!GLEBinkProxy.FrameTick->Activate())
+		{
+			GLogger.writeln(L"OnAttach: ERROR: failed to hook the frame boundary, tick callbacks won't run!");
+		}
+
 		// Load all native mods that declare being post-drm.
 		GLEBinkProxy.AsiLoader->PostLoad(GLEBinkProxy.SPI);
 
+		// Start watching the plugins for changes if requested (-asihotreload).
+		GLEBinkProxy.AsiHotReload = new AsiHotReloadModule(GLEBinkProxy.AsiLoader);
+		if (!GLEBinkProxy.AsiHotReload->Activate())
+		{
+			GLogger.writeln(L"OnAttach: ERROR: failed to start the ASI hot reload watcher!");
+		}
+
 		break;
 	}
 	case LEGameVersion::Launcher:
@@ -228,6 +286,20 @@ void __stdcall OnAttach()
 	}
 	}
 
+	// Write out the boot timeline (-bootprofile).
+	if (Utils::GProfiler.Enabled())
+	{
+		Utils::GProfiler.Record(Utils::TraceCategory::Boot, "OnAttach", "", bootStart, Utils::GProfiler.Now());
+		if (!Utils::GProfiler.WriteChromeTrace(ASI_TRACE_FNAME))
+		{
+			GLogger.writeln(L"OnAttach: ERROR: failed to write the boot trace (error code = %d)", errno);
+		}
+		else
+		{
+			GLogger.writeln(L"OnAttach: boot trace written to " ASI_TRACE_FNAME);
+		}
+	}
+
 	return;
 }
 
@@ -235,17 +307,22 @@ void __stdcall OnDetach()
 {
 	GLogger.writeln(L"OnDetach: entered...");
 
-	// Unload the DLLs.
+	// Stop reloading and unload the DLLs.
+	if (GLEBinkProxy.AsiHotReload)    GLEBinkProxy.AsiHotReload->Deactivate();
 	if (GLEBinkProxy.AsiLoader)       GLEBinkProxy.AsiLoader->Deactivate();
 
+	// Stop ending frames.
+	if (GLEBinkProxy.FrameTick)       GLEBinkProxy.FrameTick->Deactivate();
+
 	// No-ops
 	if (GLEBinkProxy.LauncherArgs)    GLEBinkProxy.LauncherArgs->Deactivate();
 	if (GLEBinkProxy.ConsoleEnabler)  GLEBinkProxy.ConsoleEnabler->Deactivate();
 
 	GLogger.writeln(L"OnDetach: goodbye, I thought we were friends :(");
+	GLogger.Shutdown();
 	Utils::TeardownOutput();
 
-	// Remove the VEH handler we set in OnAttach.
+	// Remove the VEH handler and the unhandled exception filter we set in OnAttach.
 	UnsetVectoredExceptionHandler();
 }
 
@@ -11,7 +11,9 @@
 // Forward-declare these to avoid a cyclical header dependency.
 
 class AsiLoaderModule;
+class AsiHotReloadModule;
 class ConsoleEnablerModule;
+class FrameTickModule;
 class LauncherArgsModule;
 class LauncherProcessLaunchWorkingDirFixModule;
 
@@ -27,7 +29,9 @@ public:
     LEGameVersion Game;
 
     AsiLoaderModule*       AsiLoader;
+    AsiHotReloadModule*    AsiHotReload;
     ConsoleEnablerModule* ConsoleEnabler;
+    FrameTickModule*       FrameTick;
     LauncherProcessLaunchWorkingDirFixModule* LauncherFixer;
     LauncherArgsModule*    LauncherArgs;
 
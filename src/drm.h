@@ -4,6 +4,7 @@
 #include "utils/io.h"
 #include "utils/event.h"
 #include "utils/hook.h"
+#include "utils/profiler.h"
 #include "dllstruct.h"
 
 
@@ -64,6 +65,8 @@ namespace DRM
 
     void WaitForDRMv3()
     {
+        PROFILE_SCOPE(Boot, "WaitForDRMv3", nullptr);
+
         int iterations = 0;
         bool foundPattern = false;
         BYTE* offset = nullptr;
@@ -73,16 +76,16 @@ namespace DRM
             switch (GLEBinkProxy.Game)
             {
             case LEGameVersion::LE1:
-                foundPattern = nullptr != Utils::ScanProcess(LE1_UFunctionBind_Pattern, LE1_UFunctionBind_Mask);
+                foundPattern = nullptr != Utils::ScanProcessNoTrace(LE1_UFunctionBind_Pattern, LE1_UFunctionBind_Mask);
                 break;
             case LEGameVersion::LE2:
-                foundPattern = nullptr != Utils::ScanProcess(LE2_UFunctionBind_Pattern, LE2_UFunctionBind_Mask);
+                foundPattern = nullptr != Utils::ScanProcessNoTrace(LE2_UFunctionBind_Pattern, LE2_UFunctionBind_Mask);
                 break;
             case LEGameVersion::LE3:
-                foundPattern = nullptr != Utils::ScanProcess(LE3_UFunctionBind_Pattern, LE3_UFunctionBind_Mask);
+                foundPattern = nullptr != Utils::ScanProcessNoTrace(LE3_UFunctionBind_Pattern, LE3_UFunctionBind_Mask);
                 break;
             case LEGameVersion::Launcher:
-                foundPattern = nullptr != Utils::ScanProcess(LEL_DRMTest_Pattern, LEL_DRMTest_Mask);
+                foundPattern = nullptr != Utils::ScanProcessNoTrace(LEL_DRMTest_Pattern, LEL_DRMTest_Mask);
                 break;
             default:
                 foundPattern = true;
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <Windows.h>
+#include "../utils/io.h"
+#include "../utils/dirwatch.h"
+#include "../utils/pluginlife.h"
+#include "../dllstruct.h"
+#include "_base.h"
+#include "asi_loader.h"
+
+
+class AsiHotReloadModule
+    : public IModule
+{
+private:
+
+    // Config parameters.
+
+    static const DWORD SETTLE_TIME_MS = 500;  // Quiet period after the last change before reloading.
+    static const DWORD STOP_WAIT_MS = 2000;   // How long Deactivate waits for the watch loop to finish.
+
+    // Fields.
+
+    AsiLoaderModule* loader_;
+    Utils::DirectoryWatcher* watcher_ = nullptr;
+    HANDLE thread_ = nullptr;
+    HANDLE loopDone_ = nullptr;  // Set by the watch loop as the last thing it does.
+
+    // Methods.
+
+    // Collect changes until the directory has been quiet for a bit,
+    // so that a rebuild which touches the file several times is reloaded once.
+    void watchLoop_()
+    {
+        Utils::ReloadBatch batch;
+
+        while (true)
+        {
+            auto rc = watcher_->Wait([&batch](const wchar_t* path) { batch.Add(path); },
+                batch.Empty() ? INFINITE : SETTLE_TIME_MS);
+
+            if (rc == Utils::WatchResult::Stopped)
+            {
+                break;
+            }
+
+            if (rc == Utils::WatchResult::Timeout)
+            {
+                for (const auto& path : batch.Take())
+                {
+                    GLogger.writeln(L"AsiHotReloadModule: %s changed, reloading...", path.c_str());
+                    loader_->ReloadPlugin(GLEBinkProxy.SPI, path.c_str());
+                }
+            }
+        }
+
+        GLogger.writeln(L"AsiHotReloadModule: watcher stopped.");
+        SetEvent(loopDone_);
+    }
+
+    void release_()
+    {
+        delete watcher_;
+        watcher_ = nullptr;
+        if (thread_) CloseHandle(thread_);
+        thread_ = nullptr;
+        if (loopDone_) CloseHandle(loopDone_);
+        loopDone_ = nullptr;
+    }
+
+    static DWORD WINAPI watchThread_(LPVOID lpParameter)
+    {
+        reinterpret_cast<AsiHotReloadModule*>(lpParameter)->watchLoop_();
+        return 0;
+    }
+
+public:
+    AsiHotReloadModule(AsiLoaderModule* loader)
+        : IModule{ "AsiHotReload" }
+        , loader_{ loader }
+    {
+
+    }
+
+    bool Activate() override
+    {
+        if (!loader_ || !loader_->HotReloadEnabled())
+        {
+            return true;
+        }
+
+        watcher_ = new Utils::DirectoryWatcher(loader_->AsiRoot());
+        if (watcher_->InError())
+        {
+            GLogger.writeln(L"AsiHotReloadModule.Activate: failed to watch %s", loader_->AsiRoot());
+            release_();
+            return false;
+        }
+
+        loopDone_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        thread_ = loopDone_ ? CreateThread(nullptr, 0, watchThread_, this, 0, nullptr) : nullptr;
+        if (!thread_)
+        {
+            GLogger.writeln(L"AsiHotReloadModule.Activate: failed to create a thread (error code = %d)", GetLastError());
+            release_();
+            return false;
+        }
+
+        active_ = true;
+        GLogger.writeln(L"AsiHotReloadModule.Activate: watching %s for plugin changes.", loader_->AsiRoot());
+        return true;
+    }
+
+    void Deactivate() override
+    {
+        if (!watcher_)
+        {
+            return;
+        }
+
+        // This may run under the loader lock, where waiting on the thread handle itself would deadlock
+        // (a thread needs the lock to exit), so wait for the loop to say it's done with the watcher.
+        // A loop stuck in a reload (LoadLibrary wants the lock too) can't finish; the watcher is
+        // leaked rather than freed under it.
+        watcher_->Stop();
+        if (WAIT_OBJECT_0 != WaitForSingleObject(loopDone_, STOP_WAIT_MS))
+        {
+            GLogger.writeln(L"AsiHotReloadModule.Deactivate: the watch loop didn't stop in %d ms, leaving it be", STOP_WAIT_MS);
+            active_ = false;
+            return;
+        }
+
+        release_();
+        active_ = false;
+    }
+};
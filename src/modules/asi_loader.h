@@ -1,198 +1,77 @@
 #pragma once
 
+#include <algorithm>
+#include <mutex>
 #include <vector>
 #include <Windows.h>
+#include "../utils/flightrec.h"
 #include "../utils/io.h"
+#include "../utils/profiler.h"
+#include "../utils/pluginlife.h"
+#include "../utils/pluginprocs.h"
+#include "../utils/pluginscan.h"
+#include "../utils/strtable.h"
 #include "_base.h"
 #include "../spi/interface.h"
+#include "../spi/implementation.h"
 
 
-typedef void(* AsiSpiSupportType)(wchar_t** name, wchar_t** author, wchar_t** version, int* gameIndex, int* spiMinVersion);
-typedef bool(* AsiSpiShouldPreloadType)(void);
-typedef bool(* AsiSpiShouldSpawnThreadType)(void);
-typedef bool(* AsiOnAttachType)(ISharedProxyInterface* InterfacePtr);
-typedef bool(* AsiOnDetachType)(ISharedProxyInterface* InterfacePtr);
+typedef Utils::PluginProcs<ISharedProxyInterface>::tOnAttach AsiOnAttachType;
 
 
 struct AsiAsyncDispatchInfo
 {
     ISharedProxyInterface* InterfacePtr;
     AsiOnAttachType FunctionPtr;
+    const wchar_t* FileName;
 };
 void __stdcall AsiAsyncDispatchThread(LPVOID lpParameter)
 {
     auto infoPtr = reinterpret_cast<AsiAsyncDispatchInfo*>(lpParameter);
-    infoPtr->FunctionPtr(infoPtr->InterfacePtr);
+    {
+        PROFILE_SCOPE(PluginAttach, "OnAttach (async)", infoPtr->FileName);
+        auto attached = infoPtr->FunctionPtr(infoPtr->InterfacePtr);
+        Utils::GFlightRecorder.Record(Utils::FE_PLUGIN_ATTACHED, 0, attached, infoPtr->FileName);
+    }
 
     delete infoPtr;
 }
 
 
+typedef Utils::PluginState AsiPluginState;
+
+
 struct AsiPluginLoadInfo
+    : public Utils::PluginProcs<ISharedProxyInterface>
 {
-private:
-    bool shouldPreloadFetched_;
-    bool shouldSpawnThreadFetched_;
-    bool allSpiProcsLoaded_;
-
 public:
     wchar_t* FileName;
     HINSTANCE LibInstance;
 
-    AsiSpiSupportType SpiSupport;
-    AsiSpiShouldPreloadType DoPreload;
-    AsiSpiShouldSpawnThreadType DoSpawnThread;
-    AsiOnAttachType OnAttach;
-    AsiOnDetachType OnDetach;
-
-    wchar_t* PluginName;
-    wchar_t* PluginVersion;
-    wchar_t* PluginAuthor;
-    int SupportedGamesBitset;
-    int MinInterfaceVersion;
-    bool IsAsyncAttachMode;
+    AsiPluginState State;
+    int Generation;  // Number of times the plugin was hot-reloaded.
+    HANDLE AttachThread;  // The async OnAttach thread, until it's seen finished.
 
     AsiPluginLoadInfo(wchar_t* fileName, HINSTANCE libInstance)
         : FileName{ fileName }
         , LibInstance{ libInstance }
-        , PluginName{ nullptr }
-        , PluginVersion{ nullptr }
-        , PluginAuthor{ nullptr }
-        , SupportedGamesBitset{ 0 }
-        , MinInterfaceVersion { 0 }
-        , IsAsyncAttachMode { false }
-        , SpiSupport{ nullptr }
-        , DoPreload{ nullptr }
-        , DoSpawnThread{ nullptr }
-        , OnAttach{ nullptr }
-        , OnDetach{ nullptr }
-        , shouldPreloadFetched_{ false }
-        , shouldSpawnThreadFetched_{ false }
-        , allSpiProcsLoaded_{ true }  // set to false on first error
+        , State{ AsiPluginState::Loaded }
+        , Generation{ 0 }
+        , AttachThread{ nullptr }
     {
 
     }
 
-    __forceinline void MissingProc() { allSpiProcsLoaded_ = false; }
-
-    [[nodiscard]] __forceinline bool SupportsSPI() const noexcept { return SpiSupport != nullptr && allSpiProcsLoaded_; }
-    [[nodiscard]] __forceinline bool ShouldPreload()
-    {
-        if (!SupportsSPI())
-        {
-            return false;
-        }
-
-        static bool ranCall = false;
-        if (!ranCall && DoPreload)
-        {
-            shouldPreloadFetched_ = DoPreload();
-            ranCall = true;
-        }
-
-        if (!ranCall)
-        {
-            GLogger.writeln(L"ShouldPreload: fell through the call check, most likely DoPreload was NULL");
-            return false;
-        }
-
-        return shouldPreloadFetched_;
-    }
-    [[nodiscard]] __forceinline bool ShouldPostload()
-    {
-        if (!SupportsSPI())
-        {
-            return false;
-        }
-
-        static bool ranCall = false;
-        if (!ranCall && DoPreload)
-        {
-            shouldPreloadFetched_ = DoPreload();
-            ranCall = true;
-        }
-
-        if (!ranCall)
-        {
-            GLogger.writeln(L"ShouldPostload: fell through the call check, most likely DoPreload was NULL");
-            return false;
-        }
-
-        return !shouldPreloadFetched_;
-    }
-    [[nodiscard]] __forceinline bool ShouldSpawnThread()
-    {
-        if (!SupportsSPI())
-        {
-            return false;
-        }
-
-        static bool ranCall = false;
-        if (!ranCall && DoSpawnThread)
-        {
-            shouldSpawnThreadFetched_ = DoSpawnThread();
-            ranCall = true;
-        }
-
-        if (!ranCall)
-        {
-            GLogger.writeln(L"ShouldPostload: fell through the call check, most likely DoSpawnThread was NULL");
-            return false;
-        }
-
-        return shouldSpawnThreadFetched_;
-    }
-
-    [[nodiscard]] bool HasCorrectVersionFor(int proxyVer) const noexcept { return !(MinInterfaceVersion < 2 || MinInterfaceVersion > proxyVer); }
-    [[nodiscard]] bool HasCorrectFlagFor(LEGameVersion gameVer) const
+    // The SPI_GAME_* bit plugins declare for a game, 0 for none.
+    [[nodiscard]] static int GameBitFor(LEGameVersion gameVer) noexcept
     {
         switch (gameVer)
         {
-        case LEGameVersion::Launcher:
-            if (SupportedGamesBitset & SPI_GAME_LEL) return true;
-            return false;
-        case LEGameVersion::LE1:
-            if (SupportedGamesBitset & SPI_GAME_LE1) return true;
-            return false;
-        case LEGameVersion::LE2:
-            if (SupportedGamesBitset & SPI_GAME_LE2) return true;
-            return false;
-        case LEGameVersion::LE3:
-            if (SupportedGamesBitset & SPI_GAME_LE3) return true;
-            return false;
-        default:
-            return false;
-        }
-    }
-
-    void LoadConditionalProcs()
-    {
-        DoPreload = (AsiSpiShouldPreloadType)GetProcAddress(LibInstance, "SpiShouldPreload");
-        if (DoPreload == NULL)
-        {
-            allSpiProcsLoaded_ = false;
-            GLogger.writeln(L"LoadConditionalProcs: failed to find SpiShouldPreload (last error = %d)", GetLastError());
-        }
-
-        DoSpawnThread = (AsiSpiShouldPreloadType)GetProcAddress(LibInstance, "SpiShouldSpawnThread");
-        if (DoSpawnThread == NULL)
-        {
-            allSpiProcsLoaded_ = false;
-            GLogger.writeln(L"LoadConditionalProcs: failed to find SpiShouldSpawnThread (last error = %d)", GetLastError());
-        }
-
-        OnAttach = (AsiOnAttachType)GetProcAddress(LibInstance, "SpiOnAttach");
-        if (OnAttach == NULL)
-        {
-            allSpiProcsLoaded_ = false;
-            GLogger.writeln(L"LoadConditionalProcs: failed to find SpiOnAttach (last error = %d)", GetLastError());
-        }
-
-        OnDetach = (AsiOnDetachType)GetProcAddress(LibInstance, "SpiOnDetach");
-        if (OnDetach == NULL)
-        {
-            allSpiProcsLoaded_ = false;
-            GLogger.writeln(L"LoadConditionalProcs: failed to find SpiOnDetach (last error = %d)", GetLastError());
+        case LEGameVersion::Launcher:  return SPI_GAME_LEL;
+        case LEGameVersion::LE1:       return SPI_GAME_LE1;
+        case LEGameVersion::LE2:       return SPI_GAME_LE2;
+        case LEGameVersion::LE3:       return SPI_GAME_LE3;
+        default:                       return 0;
         }
     }
 };
@@ -208,16 +87,20 @@ private:
 
     // Config parameters.
 
-    static const int MAX_FILES = 128;       // Max. number of ASI plugins in the directory.
+    static const int MAX_DEPTH = 8;         // Max. nesting of subdirectories searched for ASI plugins.
     static const bool TRY_LOAD_ALL = true;  // Attempt to load further ASIs after an error on loading one.
+    static const DWORD ATTACH_WAIT_MS = 5000;  // How long a hot reload waits for a running async attach.
 
     // Fields.
 
-    int fileCount_ = 0;
-    wchar_t fileNames_[MAX_PATH][MAX_FILES];
+    Utils::StringTable<> fileNames_;        // Paths relative to asiRoot_, sorted once the search is done.
     wchar_t asiRoot_[512];
     AsiInfoList pluginLoadInfos_;
+    std::vector<size_t> preloadIndices_;    // Indices into pluginLoadInfos_, split once after loading.
+    std::vector<size_t> postloadIndices_;
+    std::mutex pluginsMtx_;                 // Guards pluginLoadInfos_ against hot reloads.
     DWORD lastErrorCode_ = 0;
+    bool hotReload_ = false;                // Load shadow copies so that the originals can be rebuilt.
 
     // Methods.
 
@@ -251,79 +134,204 @@ private:
         return static_cast<bool>(attributes & FILE_ATTRIBUTE_DIRECTORY);
     }
 
+    // Fill fileNames_ from the ASI directory tree, see Utils::PluginScan.
     bool findPluginFiles_()
+    {
+        auto listDir = [this](const wchar_t* relativeDir, auto&& visit)
+        {
+            wchar_t pattern[512];
+            if (-1 == _snwprintf_s(pattern, 512, _TRUNCATE, L"%s\\%s*", asiRoot_, relativeDir))
+            {
+                GLogger.writeln(L"findPluginFiles_: skipping %s because the path is too long", relativeDir);
+                return true;
+            }
+
+            WIN32_FIND_DATAW fd;
+            HANDLE findHandle = ::FindFirstFileW(pattern, &fd);
+            if (findHandle == INVALID_HANDLE_VALUE)
+            {
+                return (this->lastErrorCode_ = GetLastError()) == ERROR_FILE_NOT_FOUND;  // It's not a true error if we can't find anything.
+            }
+
+            do
+            {
+                visit(Utils::ScanEntry{ fd.cFileName,
+                    0 != (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY),
+                    0 != (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) });
+            } while (::FindNextFileW(findHandle, &fd));
+            ::FindClose(findHandle);
+            return true;
+        };
+
+        auto skipped = [](Utils::ScanSkip reason, const wchar_t* relativeDir, const wchar_t* name)
+        {
+            switch (reason)
+            {
+            case Utils::ScanSkip::TooDeep:
+                GLogger.writeln(L"findPluginFiles_: not descending into %s%s, too deep", relativeDir, name);
+                break;
+            case Utils::ScanSkip::PathTooLong:
+                GLogger.writeln(L"findPluginFiles_: skipping %s%s because the path is too long", relativeDir, name);
+                break;
+            case Utils::ScanSkip::TableFull:
+                GLogger.writeln(L"findPluginFiles_: ERROR: skipping %s%s, the plugin table is full", relativeDir, name);
+                break;
+            }
+        };
+
+        return Utils::ScanPlugins(this->fileNames_, listDir, skipped, MAX_DEPTH);
+    }
+
+    bool makeShadowPath_(const wchar_t* relativePath, int generation, wchar_t* outPath, size_t outLength)
+    {
+        if (-1 == _snwprintf_s(outPath, outLength, _TRUNCATE, L"%s\\.shadow\\%s.%d.asi", asiRoot_, relativePath, generation))
+        {
+            return false;
+        }
+
+        // Flatten the relative path into a single file name.
+        for (auto c = outPath + wcslen(asiRoot_) + wcslen(L"\\.shadow\\"); *c != L'\0'; c++)
+        {
+            if (*c == L'\\' || *c == L'/')
+            {
+                *c = L'_';
+            }
+        }
+        return true;
+    }
+
+    void prepareShadowDir_()
     {
         wchar_t pattern[512];
-        swprintf_s(pattern, 512, L"%s\\*.asi", asiRoot_);
+        if (-1 == _snwprintf_s(pattern, 512, _TRUNCATE, L"%s\\.shadow", asiRoot_))
+        {
+            return;
+        }
+        CreateDirectoryW(pattern, nullptr);
+
+        if (-1 == _snwprintf_s(pattern, 512, _TRUNCATE, L"%s\\.shadow\\*.asi", asiRoot_))
+        {
+            return;
+        }
 
-        WIN32_FIND_DATA fd;
-        HANDLE findHandle = ::FindFirstFile(pattern, &fd);
+        WIN32_FIND_DATAW fd;
+        HANDLE findHandle = ::FindFirstFileW(pattern, &fd);
         if (findHandle == INVALID_HANDLE_VALUE)
         {
-            return (this->lastErrorCode_ = GetLastError()) == ERROR_FILE_NOT_FOUND;  // It's not a true error if we can't find anything.
+            return;
         }
 
+        // Copies still mapped by another game instance will fail to delete, that's fine.
+        wchar_t shadowPath[MAX_PATH];
         do
         {
-            if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            if (-1 != _snwprintf_s(shadowPath, MAX_PATH, _TRUNCATE, L"%s\\.shadow\\%s", asiRoot_, fd.cFileName))
             {
-                wcscpy(this->fileNames_[this->fileCount_++], fd.cFileName);
+                DeleteFileW(shadowPath);
             }
-        } while (::FindNextFile(findHandle, &fd));
+        } while (::FindNextFileW(findHandle, &fd));
         ::FindClose(findHandle);
+    }
 
-        return true;
+    HINSTANCE loadPluginLibrary_(const wchar_t* relativePath, int generation)
+    {
+        wchar_t fileNameBuffer[MAX_PATH];
+        if (-1 == _snwprintf_s(fileNameBuffer, MAX_PATH, _TRUNCATE, L"ASI/%s", relativePath))
+        {
+            GLogger.writeln(L"loadPluginLibrary_: skipping %s because the path is too long.", relativePath);
+            return nullptr;
+        }
+
+        PROFILE_SCOPE(LoadLibrary, "LoadLibraryW", relativePath);
+
+        if (!hotReload_)
+        {
+            return LoadLibraryW(fileNameBuffer);
+        }
+
+        // In hot reload mode, load a copy so that the original file stays writable.
+        // A freshly rebuilt file may still be held by the linker, so retry the copy for a bit.
+        wchar_t shadowPath[MAX_PATH];
+        if (!makeShadowPath_(relativePath, generation, shadowPath, MAX_PATH))
+        {
+            GLogger.writeln(L"loadPluginLibrary_: skipping %s because the shadow path is too long.", relativePath);
+            return nullptr;
+        }
+
+        bool copied = false;
+        for (int attempt = 0; attempt < 10 && !copied; attempt++)
+        {
+            copied = CopyFileW(fileNameBuffer, shadowPath, FALSE);
+            if (!copied) Sleep(200);
+        }
+        if (!copied)
+        {
+            GLogger.writeln(L"loadPluginLibrary_: failed to copy %s into %s (error code = %d).", fileNameBuffer, shadowPath, GetLastError());
+            return nullptr;
+        }
+
+        return LoadLibraryW(shadowPath);
     }
 
     bool registerLoadInfo_(HINSTANCE dllModuleInstance, wchar_t* fileName)
     {
         AsiPluginLoadInfo loadInfo{ fileName, dllModuleInstance };
-
-        loadInfo.SpiSupport = (AsiSpiSupportType)GetProcAddress(dllModuleInstance, "SpiSupportDecl");
-        if (loadInfo.SpiSupport == NULL)
+        if (!resolveLoadInfo_(loadInfo))
         {
-            loadInfo.MissingProc();
-            GLogger.writeln(L"registerLoadInfo_: failed to find SpiSupportDecl (last error = %d). Likely, SPI is just not supported.", GetLastError());
-            // not an error
+            return false;
         }
 
-        // If the plugins declares SPI support, attempt to load other required procedures.
-        if (loadInfo.SupportsSPI())
+        pluginLoadInfos_.push_back(loadInfo);
+        return true;
+    }
+
+    bool resolveLoadInfo_(AsiPluginLoadInfo& loadInfo)
+    {
+        auto dllModuleInstance = loadInfo.LibInstance;
+        auto result = loadInfo.Register(
+            [dllModuleInstance](const char* name) { return reinterpret_cast<void*>(GetProcAddress(dllModuleInstance, name)); },
+            [](const char* name) { GLogger.writeln(L"registerLoadInfo_: failed to find %S (last error = %d)", name, GetLastError()); },
+            ASI_SPI_VERSION, AsiPluginLoadInfo::GameBitFor(GLEBinkProxy.Game));
+
+        switch (result)
         {
-            loadInfo.LoadConditionalProcs();
-            if (!loadInfo.SupportsSPI())
-            {
-                GLogger.writeln(L"registerLoadInfo_: SpiSupportDecl was found but some procs are missing:");
-                GLogger.writeln(L"registerLoadInfo_: SpiSupportDecl = %p, SpiShouldPreload = %p, SpiOnAttach = %p, SpiOnDetach = %p",
-                    loadInfo.SpiSupport, loadInfo.DoPreload, loadInfo.OnAttach, loadInfo.OnDetach);
-                return false;
-            }
-            GLogger.writeln(L"registerLoadInfo_: all SPI procs were found!");
+        case Utils::PluginRegistration::Raw:
+            GLogger.writeln(L"registerLoadInfo_: failed to find SpiSupportDecl (last error = %d). Likely, SPI is just not supported.", GetLastError());
+            return true;  // not an error
 
-            // Get SPI-required info from the plugin via SpiSupportDecl.
-            loadInfo.SpiSupport(&loadInfo.PluginName, &loadInfo.PluginAuthor, &loadInfo.PluginVersion, &loadInfo.SupportedGamesBitset, &loadInfo.MinInterfaceVersion);
-            GLogger.writeln(L"registerLoadInfo_: provided info: '%s' (ver %s) by '%s', supported games (bitset) = %d, min ver = %d",
-                loadInfo.PluginName, loadInfo.PluginVersion, loadInfo.PluginAuthor, loadInfo.SupportedGamesBitset, loadInfo.MinInterfaceVersion);
+        case Utils::PluginRegistration::MissingProcs:
+            GLogger.writeln(L"registerLoadInfo_: SpiSupportDecl was found but some procs are missing:");
+            GLogger.writeln(L"registerLoadInfo_: SpiSupportDecl = %p, SpiShouldPreload = %p, SpiOnAttach = %p, SpiOnDetach = %p",
+                loadInfo.SpiSupport, loadInfo.DoPreload, loadInfo.OnAttach, loadInfo.OnDetach);
+            return false;
 
-            // Ensure that the plugin's declared min SPI version is valid and less or equal to our version.
-            if (!loadInfo.HasCorrectVersionFor(ASI_SPI_VERSION))
-            {
-                GLogger.writeln(L"registerLoadInfo_: filtering out because the min version is higher than the build's one (%d)!", loadInfo.MinInterfaceVersion);
-                return false;
-            }
+        default:
+            break;
+        }
 
-            // Ensure that the plugin's declared game targets match the game we (the proxy) are attached to.
-            if (!loadInfo.HasCorrectFlagFor(GLEBinkProxy.Game))
-            {
-                GLogger.writeln(L"registerLoadInfo_: filtering out because the plugin was not designed for this game (need to have %d)!", GLEBinkProxy.Game);
-                return false;
-            }
+        GLogger.writeln(L"registerLoadInfo_: provided info: '%s' (ver %s) by '%s', supported games (bitset) = %d, min ver = %d",
+            loadInfo.PluginName, loadInfo.PluginVersion, loadInfo.PluginAuthor, loadInfo.SupportedGamesBitset, loadInfo.MinInterfaceVersion);
+
+        if (result == Utils::PluginRegistration::BadVersion)
+        {
+            GLogger.writeln(L"registerLoadInfo_: filtering out because the min version is higher than the build's one (%d)!", ASI_SPI_VERSION);
+            return false;
+        }
+        if (result == Utils::PluginRegistration::WrongGame)
+        {
+            GLogger.writeln(L"registerLoadInfo_: filtering out because the plugin was not designed for this game (need to have %d)!", GLEBinkProxy.Game);
+            return false;
         }
 
-        pluginLoadInfos_.push_back(loadInfo);
+        GLOG_DEBUG(Loader, L"registerLoadInfo_: preload = %d, spawn thread = %d", loadInfo.ShouldPreload(), loadInfo.ShouldSpawnThread());
         return true;
     }
 
+    void partitionPlugins_()
+    {
+        Utils::PartitionPlugins(this->pluginLoadInfos_, this->preloadIndices_, this->postloadIndices_);
+    }
+
     bool dispatchAttach_(ISharedProxyInterface* interfacePtr, AsiPluginLoadInfo* loadInfo)
     {
         if (!loadInfo || !interfacePtr)
@@ -333,17 +341,23 @@ private:
         }
 
         loadInfo->IsAsyncAttachMode = loadInfo->ShouldSpawnThread();
-        GLogger.writeln(L"dispatchAttach_: got IsAsyncAttachMode (= %d)", loadInfo->IsAsyncAttachMode);
+        GLOG_DEBUG(Loader, L"dispatchAttach_: got IsAsyncAttachMode (= %d)", loadInfo->IsAsyncAttachMode);
+        Utils::GFlightRecorder.Record(Utils::FE_PLUGIN_ATTACHING, reinterpret_cast<ULONG_PTR>(loadInfo->LibInstance), loadInfo->IsAsyncAttachMode, loadInfo->FileName);
 
         if (!loadInfo->IsAsyncAttachMode)  // seq
         {
-            return loadInfo->OnAttach(interfacePtr);
+            PROFILE_SCOPE(PluginAttach, "OnAttach", loadInfo->FileName);
+            auto attached = loadInfo->OnAttach(interfacePtr);
+            Utils::GFlightRecorder.Record(Utils::FE_PLUGIN_ATTACHED, reinterpret_cast<ULONG_PTR>(loadInfo->LibInstance), attached, loadInfo->FileName);
+            return attached;
         }
         else if (loadInfo->IsAsyncAttachMode)  // async
         {
-            auto dispatchInfo = new AsiAsyncDispatchInfo{ interfacePtr, loadInfo->OnAttach };  // deleted inside the dispatch
-            if (NULL == CreateThread(nullptr, 0, reinterpret_cast<LPTHREAD_START_ROUTINE>(AsiAsyncDispatchThread), dispatchInfo, 0, nullptr))
+            auto dispatchInfo = new AsiAsyncDispatchInfo{ interfacePtr, loadInfo->OnAttach, loadInfo->FileName };  // deleted inside the dispatch
+            loadInfo->AttachThread = CreateThread(nullptr, 0, reinterpret_cast<LPTHREAD_START_ROUTINE>(AsiAsyncDispatchThread), dispatchInfo, 0, nullptr);
+            if (NULL == loadInfo->AttachThread)
             {
+                delete dispatchInfo;
                 GLogger.writeln(L"dispatchAttach_: ERROR: CreateThread failed, error code = %d", GetLastError());
                 return false;
             }
@@ -353,6 +367,78 @@ private:
         return false;
     }
 
+    // The Windows side of Utils::ReloadPlugin and Utils::DetachPlugin.
+    struct PluginHost
+    {
+        AsiLoaderModule* Loader;
+        ISharedProxyInterface* Interface;
+
+        bool AttachRunning(AsiPluginLoadInfo& loadInfo, uint32_t waitMs)
+        {
+            if (!loadInfo.AttachThread)
+            {
+                return false;
+            }
+            if (WAIT_TIMEOUT == WaitForSingleObject(loadInfo.AttachThread, waitMs))
+            {
+                return true;
+            }
+            CloseHandle(loadInfo.AttachThread);
+            loadInfo.AttachThread = nullptr;
+            return false;
+        }
+
+        bool Detach(AsiPluginLoadInfo& loadInfo)
+        {
+            auto detached = !loadInfo.SupportsSPI() || loadInfo.OnDetach(Interface);
+            Utils::GFlightRecorder.Record(Utils::FE_PLUGIN_DETACHED, reinterpret_cast<ULONG_PTR>(loadInfo.LibInstance), detached, loadInfo.FileName);
+            if (!detached)
+            {
+                GLogger.writeln(L"PluginHost.Detach: ERROR: detach of %s reported a failure, continuing...", loadInfo.FileName);
+            }
+            return detached;
+        }
+
+        bool Release(AsiPluginLoadInfo& loadInfo)
+        {
+            return static_cast<SPI::SharedProxyInterface*>(Interface)->ReleaseOwnedBy(loadInfo.LibInstance);
+        }
+
+        bool Unload(AsiPluginLoadInfo& loadInfo)
+        {
+            if (!FreeLibrary(loadInfo.LibInstance))
+            {
+                GLogger.writeln(L"PluginHost.Unload: FreeLibrary failed (error code = %d), continuing...", GetLastError());
+                return false;
+            }
+            return true;
+        }
+
+        bool Load(AsiPluginLoadInfo& loadInfo, int generation)
+        {
+            auto newModule = Loader->loadPluginLibrary_(loadInfo.FileName, generation);
+            if (!newModule)
+            {
+                GLogger.writeln(L"PluginHost.Load: failed to load the new copy (error code = %d)", GetLastError());
+                return false;
+            }
+            Utils::GFlightRecorder.Record(Utils::FE_PLUGIN_LOADED, reinterpret_cast<ULONG_PTR>(newModule), generation, loadInfo.FileName);
+            loadInfo = AsiPluginLoadInfo{ loadInfo.FileName, newModule };
+            return true;
+        }
+
+        bool Register(AsiPluginLoadInfo& loadInfo)
+        {
+            return Loader->resolveLoadInfo_(loadInfo);
+        }
+
+        // Raw ASIs have no attach point, loading them was all there is to it.
+        bool Attach(AsiPluginLoadInfo& loadInfo)
+        {
+            return !loadInfo.SupportsSPI() || Loader->dispatchAttach_(Interface, &loadInfo);
+        }
+    };
+
 public:
     AsiLoaderModule()
         : IModule{ "AsiLoader" }
@@ -361,12 +447,15 @@ public:
         active_ = true;
     }
 
+    [[nodiscard]] __forceinline bool HotReloadEnabled() const noexcept { return hotReload_; }
+    [[nodiscard]] __forceinline const wchar_t* AsiRoot() const noexcept { return asiRoot_; }
+
     bool Activate() override
     {
-        for (int f = 0; f < MAX_FILES; f++)
-        {
-            memset(this->fileNames_[f], 0, MAX_PATH - 4);
-        }
+        PROFILE_SCOPE(Module, "AsiLoader.Activate", nullptr);
+
+        this->fileNames_.Clear();
+        this->hotReload_ = nullptr != wcsstr(GLEBinkProxy.CmdLine, L" -asihotreload");
 
         // Build the root path for ASI plugins.
         if (!makeAsiRoot_())
@@ -388,70 +477,125 @@ public:
             return false;
         }
 
+        // Load in a stable order, the file table must not grow past this point
+        // because load infos keep pointers into it.
+        this->fileNames_.Sort();
+        GLogger.writeln(L"AsiLoaderModule.Activate: found %llu plugin(s), file table uses %llu bytes.",
+            this->fileNames_.Count(), this->fileNames_.MemoryUsage());
+
+        if (this->hotReload_)
+        {
+            GLogger.writeln(L"AsiLoaderModule.Activate: hot reload is enabled, loading shadow copies.");
+            this->prepareShadowDir_();
+        }
+
         // For each found files, load the library and register SPI info.
-        wchar_t fileNameBuffer[MAX_PATH];
         HINSTANCE lastModule = nullptr;
-        for (int f = 0; f < this->fileCount_; f++)
+        for (size_t f = 0; f < this->fileNames_.Count(); f++)
         {
-            wsprintf(fileNameBuffer, L"ASI/%s", this->fileNames_[f]);
-
-            GLogger.writeln(L"AsiLoaderModule.Activate: loading %s...", this->fileNames_[f]);
+            GLogger.writeln(L"AsiLoaderModule.Activate: loading %s...", this->fileNames_.Get(f));
 
             // Load the DLL file.
             // DllMain() code will be executed here, SPI will be executed later, from dllmain.cpp:OnAttach().
-            if (NULL == (lastModule = LoadLibraryW(fileNameBuffer)))
+            if (NULL == (lastModule = this->loadPluginLibrary_(this->fileNames_.Get(f), 0)))
             {
                 GLogger.writeln(L"AsiLoaderModule.Activate:   failed with error code = %d.", (this->lastErrorCode_ = GetLastError()));
                 if (TRY_LOAD_ALL) continue;
                 return false;
             }
+            Utils::GFlightRecorder.Record(Utils::FE_PLUGIN_LOADED, reinterpret_cast<ULONG_PTR>(lastModule), 0, this->fileNames_.Get(f));
 
             // Get SPI info from the plugins.
             // This will populate pluginLoadInfos_ with data needed for executing plugins' attach points.
-            if (!this->registerLoadInfo_(lastModule, this->fileNames_[f]))
+            if (!this->registerLoadInfo_(lastModule, this->fileNames_.Get(f)))
             {
                 GLogger.writeln(L"AsiLoaderModule.Activate:   registerLoadInfo_ failed.");
                 if (TRY_LOAD_ALL) continue;
                 return false;
             }
 
-            // DEBUG THING
-            GLogger.writeln(L"AsiLoaderModule.Activate:   successfully registered the load info.");
-            // END DEBUG THING
+            GLOG_DEBUG(Loader, L"AsiLoaderModule.Activate:   successfully registered the load info.");
         }
 
+        this->partitionPlugins_();
+        GLogger.writeln(L"AsiLoaderModule.Activate: %llu pre-drm and %llu post-drm SPI plugin(s).",
+            this->preloadIndices_.size(), this->postloadIndices_.size());
+
         return true;
     }
     void Deactivate() override
     {
-        // maybe force-unload the ASIs?
+        const std::lock_guard<std::mutex> lock(this->pluginsMtx_);
+
+        // Only plugins which were attached get detached. This may run at process exit, where waiting
+        // for an async attach thread isn't an option (it is gone by then anyway).
+        PluginHost host{ this, GLEBinkProxy.SPI };
         GLogger.writeln(L"AsiLoaderModule.Deactivate: all pluginLoadInfos_:");
         for (auto& loadInfo : this->pluginLoadInfos_)
         {
             GLogger.writeln(L"AsiLoaderModule.Deactivate:   - [%p] {%s} %s",
                 loadInfo.LibInstance, (loadInfo.SupportsSPI() ? L"SPI" : L"RAW"), loadInfo.FileName);
 
-            if (loadInfo.SupportsSPI() && !loadInfo.OnDetach(GLEBinkProxy.SPI))
+            if (loadInfo.State == AsiPluginState::Attached && !Utils::DetachPlugin(loadInfo, host, 0))
             {
-                GLogger.writeln(L"AsiLoaderModule.Deactivate:   ERROR: detach reported a failure, continuing...");
+                GLogger.writeln(L"AsiLoaderModule.Deactivate:   its async attach is still running, not detaching it");
             }
         }
     }
 
+    // Swap a loaded plugin for the current version of its file (hot reload mode only):
+    // detach it, drop every hook it owns, unload it, load a fresh shadow copy and attach that.
+    // A plugin whose async attach is still running is given ATTACH_WAIT_MS to finish, then refused.
+    bool ReloadPlugin(ISharedProxyInterface* interfacePtr, const wchar_t* relativePath)
+    {
+        const std::lock_guard<std::mutex> lock(this->pluginsMtx_);
+
+        if (!this->hotReload_)
+        {
+            GLogger.writeln(L"ReloadPlugin: ERROR: hot reload is not enabled");
+            return false;
+        }
+
+        auto it = std::find_if(this->pluginLoadInfos_.begin(), this->pluginLoadInfos_.end(),
+            [relativePath](const AsiPluginLoadInfo& loadInfo) { return 0 == _wcsicmp(loadInfo.FileName, relativePath); });
+        if (it == this->pluginLoadInfos_.end())
+        {
+            GLogger.writeln(L"ReloadPlugin: %s was not loaded on startup, ignoring", relativePath);
+            return false;
+        }
+
+        auto& loadInfo = *it;
+        GLogger.writeln(L"ReloadPlugin: reloading %s (generation %d)...", loadInfo.FileName, loadInfo.Generation);
+
+        PluginHost host{ this, interfacePtr };
+        auto result = Utils::ReloadPlugin(loadInfo, host, ATTACH_WAIT_MS);
+        if (result != Utils::ReloadResult::Reloaded)
+        {
+            GLogger.writeln(L"ReloadPlugin:   %s: %S", loadInfo.FileName, Utils::ReloadResultName(result));
+            return false;
+        }
+
+        GLogger.writeln(L"ReloadPlugin:   reloaded %s as generation %d", loadInfo.FileName, loadInfo.Generation);
+        return true;
+    }
+
     bool PreLoad(ISharedProxyInterface* interfacePtr)
     {
-        for (auto& loadInfo : pluginLoadInfos_)
+        PROFILE_SCOPE(Module, "AsiLoader.PreLoad", nullptr);
+
+        std::unique_lock<std::mutex> lock(this->pluginsMtx_);
+        for (auto index : preloadIndices_)
         {
-            if (loadInfo.ShouldPreload())
+            auto& loadInfo = pluginLoadInfos_[index];
+            if (!dispatchAttach_(interfacePtr, &loadInfo))
             {
-                if (!dispatchAttach_(interfacePtr, &loadInfo))
-                {
-                    GLogger.writeln(L"PreLoad: OnAttach dispatch returned an error [%s]", loadInfo.FileName);
-                    continue;
-                }
-                GLogger.writeln(L"PreLoad: OnAttach dispatch succeeded [%s] (mode = %d)", loadInfo.FileName, loadInfo.IsAsyncAttachMode);
+                GLogger.writeln(L"PreLoad: OnAttach dispatch returned an error [%s]", loadInfo.FileName);
+                continue;
             }
+            loadInfo.State = AsiPluginState::Attached;
+            GLogger.writeln(L"PreLoad: OnAttach dispatch succeeded [%s] (mode = %d)", loadInfo.FileName, loadInfo.IsAsyncAttachMode);
         }
+        lock.unlock();
 
         //// Give async plugins some time to do things.
         Sleep(250);
@@ -460,18 +604,21 @@ public:
     }
     bool PostLoad(ISharedProxyInterface* interfacePtr)
     {
-        for (auto& loadInfo : pluginLoadInfos_)
+        PROFILE_SCOPE(Module, "AsiLoader.PostLoad", nullptr);
+
+        std::unique_lock<std::mutex> lock(this->pluginsMtx_);
+        for (auto index : postloadIndices_)
         {
-            if (loadInfo.ShouldPostload())
+            auto& loadInfo = pluginLoadInfos_[index];
+            if (!dispatchAttach_(interfacePtr, &loadInfo))
             {
-                if (!dispatchAttach_(interfacePtr, &loadInfo))
-                {
-                    GLogger.writeln(L"PostLoad: OnAttach dispatch returned an error [%s]", loadInfo.FileName);
-                    continue;
-                }
-                GLogger.writeln(L"PostLoad: OnAttach dispatch succeeded [%s] (mode = %d)", loadInfo.FileName, loadInfo.IsAsyncAttachMode);
+                GLogger.writeln(L"PostLoad: OnAttach dispatch returned an error [%s]", loadInfo.FileName);
+                continue;
             }
+            loadInfo.State = AsiPluginState::Attached;
+            GLogger.writeln(L"PostLoad: OnAttach dispatch succeeded [%s] (mode = %d)", loadInfo.FileName, loadInfo.IsAsyncAttachMode);
         }
+        lock.unlock();
 
         //// Give async plugins some time to do things.
         Sleep(250);
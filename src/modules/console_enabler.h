@@ -3,6 +3,7 @@
 #include <Windows.h>
 #include "../utils/io.h"
 #include "../utils/hook.h"
+#include "../utils/profiler.h"
 #include "../dllstruct.h"
 #include "_base.h"
 #include "drm.h"
@@ -57,9 +58,18 @@ private:
 
     bool detourOffsets_()
     {
+        if (!UE::InstallGameSpecialization())
+        {
+            return false;
+        }
+
         GLogger.writeln(L"detourOffsets_: installing %p into %p, preserving into %p",
-            UE::HookedUFunctionBind, UE::UFunctionBind, reinterpret_cast<LPVOID*>(&UE::UFunctionBind_orig));
-        return GHookManager.Install(UE::UFunctionBind, UE::HookedUFunctionBind, reinterpret_cast<LPVOID*>(&UE::UFunctionBind_orig), "UFunctionBind");
+            UE::HookedUFunctionBindForGame, UE::UFunctionBind, reinterpret_cast<LPVOID*>(&UE::UFunctionBind_orig));
+        if (!GHookManager.Install(UE::UFunctionBind, UE::HookedUFunctionBindForGame, reinterpret_cast<LPVOID*>(&UE::UFunctionBind_orig), "UFunctionBind"))
+        {
+            return false;
+        }
+        return true;
     }
 
 public:
@@ -71,6 +81,8 @@ public:
 
     bool Activate() override
     {
+        PROFILE_SCOPE(Module, "ConsoleEnabler.Activate", nullptr);
+
         if (!this->findOffsets_())
         {
             return false;
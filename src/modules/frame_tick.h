@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <Windows.h>
+#include "../utils/arena.h"
+#include "../utils/hook.h"
+#include "../utils/io.h"
+#include "../utils/profiler.h"
+#include "../utils/ticksched.h"
+#include "../dllstruct.h"
+#include "_base.h"
+
+
+// The frame boundary: the engine's main loop drains the game window's message queue once per tick
+// (appWinPumpMessages), so a PeekMessageW with PM_REMOVE that finds the queue empty on the window's
+// thread ends a frame. That needs no game pattern and is the same in all three games.
+// Only the main loop's own pump counts: all windows (hWnd NULL) and no filter range. Other pumps on
+// that thread (a filtered peek, a pump for one window) would end extra frames and reset the scratch.
+typedef BOOL(WINAPI* tPeekMessageW)(LPMSG lpMsg, HWND hWnd, UINT wMsgFilterMin, UINT wMsgFilterMax, UINT wRemoveMsg);
+tPeekMessageW PeekMessageW_orig = nullptr;
+
+class FrameTickModule
+    : public IModule
+{
+private:
+
+    // Config parameters.
+
+    static const DWORD FIND_WINDOW_INTERVAL = 256;  // Drained pumps (per thread) between looks for the game window.
+
+    // Fields.
+
+    static inline std::atomic<DWORD> frameThread_{ 0 };
+    static inline thread_local DWORD findCountdown_ = 0;
+    static inline LARGE_INTEGER frequency_{};
+    LPVOID target_ = nullptr;                       // PeekMessageW, hooked while the module is active.
+
+    // Methods.
+
+    static int64_t nowUs_()
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart / frequency_.QuadPart * 1000000 + counter.QuadPart % frequency_.QuadPart * 1000000 / frequency_.QuadPart;
+    }
+
+    // The frame thread is the one which owns the game window, which only exists a while into the boot.
+    static bool isFrameThread_()
+    {
+        auto frameThread = frameThread_.load(std::memory_order_relaxed);
+        if (frameThread != 0)
+        {
+            return frameThread == GetCurrentThreadId();
+        }
+
+        if (findCountdown_-- != 0)
+        {
+            return false;
+        }
+        findCountdown_ = FIND_WINDOW_INTERVAL;
+
+        DWORD processId = 0;
+        auto window = FindWindowW(nullptr, GLEBinkProxy.WinTitle);
+        if (!window || GetWindowThreadProcessId(window, &processId) != GetCurrentThreadId() || processId != GetCurrentProcessId())
+        {
+            return false;
+        }
+
+        frameThread_.store(GetCurrentThreadId(), std::memory_order_relaxed);
+        GLogger.writeln(L"FrameTickModule: frames are driven by thread %lu", GetCurrentThreadId());
+        return true;
+    }
+
+    static void endFrame_()
+    {
+        Utils::GScratch.AdvanceFrame();
+
+        Utils::GTickScheduler.RunFrame(nowUs_,
+            [](void* proc, void* context) { reinterpret_cast<void(__cdecl*)(void*)>(proc)(context); },
+            [](uint32_t id, int64_t costUs, int64_t budgetUs, uint64_t overruns)
+            {
+                GLogger.writeln(L"FrameTickModule: tick callback #%u took %lld us, over its budget of %lld us (%llu overrun(s) so far)",
+                    id, costUs, budgetUs, overruns);
+            });
+    }
+
+    static BOOL WINAPI hookedPeekMessageW_(LPMSG lpMsg, HWND hWnd, UINT wMsgFilterMin, UINT wMsgFilterMax, UINT wRemoveMsg)
+    {
+        auto result = PeekMessageW_orig(lpMsg, hWnd, wMsgFilterMin, wMsgFilterMax, wRemoveMsg);
+        if (!result && (wRemoveMsg & PM_REMOVE) && !hWnd && wMsgFilterMin == 0 && wMsgFilterMax == 0 && isFrameThread_())
+        {
+            endFrame_();
+        }
+        return result;
+    }
+
+    bool detourOffsets_()
+    {
+        auto target = reinterpret_cast<LPVOID>(GetProcAddress(GetModuleHandleW(L"user32.dll"), "PeekMessageW"));
+        if (!target)
+        {
+            GLogger.writeln(L"detourOffsets_: ERROR: failed to find PeekMessageW.");
+            return false;
+        }
+
+        GLogger.writeln(L"detourOffsets_: hooking PeekMessageW %p into %p, preserving into %p",
+            hookedPeekMessageW_, target, reinterpret_cast<LPVOID*>(&PeekMessageW_orig));
+        if (!GHookManager.Install(target, reinterpret_cast<LPVOID>(&hookedPeekMessageW_), reinterpret_cast<LPVOID*>(&PeekMessageW_orig), "PeekMessageW"))
+        {
+            return false;
+        }
+        target_ = target;
+        return true;
+    }
+
+public:
+    FrameTickModule()
+        : IModule{ "FrameTick" }
+    {
+        active_ = true;
+    }
+
+    bool Activate() override
+    {
+        PROFILE_SCOPE(Module, "FrameTick.Activate", nullptr);
+
+        QueryPerformanceFrequency(&frequency_);
+        return this->detourOffsets_();
+    }
+
+    void Deactivate() override
+    {
+        if (target_ && GHookManager.Uninstall(target_, "PeekMessageW"))
+        {
+            target_ = nullptr;
+            frameThread_.store(0, std::memory_order_relaxed);
+        }
+    }
+};
@@ -12,6 +12,7 @@
 
 #include "gamever.h"
 #include "../utils/io.h"
+#include "../utils/profiler.h"
 #include "_base.h"
 #include "dllstruct.h"
 
@@ -121,7 +122,7 @@ private:
 		// Detect '-game X'
 		if (startWCPtr != nullptr && (size_t)(startWCPtr + 7) < (size_t)endCmdLine) // Make sure there is enough length for game id + '-game ' which is 7 chars
 		{
-			GLogger.writeln(L"LauncherArgsModule.parseCmdLine_: startWCPtr = %s", startWCPtr);
+			GLOG_TRACE(Launcher, L"LauncherArgsModule.parseCmdLine_: startWCPtr = %s", startWCPtr);
 
 			auto numStrWCPtr = startWCPtr + 7;
 			auto gameNum = wcstol(numStrWCPtr, nullptr, 10);
@@ -160,13 +161,13 @@ private:
 						ClipOutSubString(startCmdLine, subtitlesPos - startCmdLine, 14);
 						endCmdLine -= 14;
 
-						GLogger.writeln(L"LauncherArgsModule.parseCmdLine_: Found command line parameter -Subtitle, setting subtitle size to %ls", this->subtitleSize_);
+						GLOG_DEBUG(Launcher, L"LauncherArgsModule.parseCmdLine_: Found command line parameter -Subtitle, setting subtitle size to %ls", this->subtitleSize_);
 						readSubs = true;
 					}
 				}
 				else
 				{
-					GLogger.writeln(L"LauncherArgsModule.parseCmdLine_: Didn't find -Subtitles, defaulting to 20 (will read config file)");
+					GLOG_DEBUG(Launcher, L"LauncherArgsModule.parseCmdLine_: Didn't find -Subtitles, defaulting to 20 (will read config file)");
 				}
 
 				// Look for '-OVERRIDELANGUAGE=' to set the language
@@ -174,7 +175,7 @@ private:
 
 				if (overrideLangPos != nullptr)
 				{
-					GLogger.writeln(L"LauncherArgsModule.parseCmdLine_: Found command line parameter -OVERRIDELANGUAGE= at %x", overrideLangPos);
+					GLOG_TRACE(Launcher, L"LauncherArgsModule.parseCmdLine_: Found command line parameter -OVERRIDELANGUAGE= at %x", overrideLangPos);
 					auto langStartPos = overrideLangPos + 19;
 					auto langEndPos = langStartPos;
 
@@ -194,7 +195,7 @@ private:
 					this->bootLanguage_ = newLang;
 
 					ClipOutSubString(startCmdLine, overrideLangPos - startCmdLine, (int)count + 19);
-					GLogger.writeln(L"LauncherArgsModule.parseCmdLine_: Found command line parameter -OVERRIDELANGUAGE=, setting lang to %ls", this->bootLanguage_);
+					GLOG_DEBUG(Launcher, L"LauncherArgsModule.parseCmdLine_: Found command line parameter -OVERRIDELANGUAGE=, setting lang to %ls", this->bootLanguage_);
 					readLang = true;
 				}
 				else
@@ -204,7 +205,7 @@ private:
 
 					if (overrideLangPos != nullptr)
 					{
-						GLogger.writeln(L"LauncherArgsModule.parseCmdLine_: Found command line parameter -language= at %x", overrideLangPos);
+						GLOG_TRACE(Launcher, L"LauncherArgsModule.parseCmdLine_: Found command line parameter -language= at %x", overrideLangPos);
 						auto langStartPos = overrideLangPos + 11;
 						auto langEndPos = langStartPos;
 
@@ -224,12 +225,12 @@ private:
 						this->bootLanguage_ = newLang;
 
 						ClipOutSubString(startCmdLine, overrideLangPos - startCmdLine, (int)count + 11);
-						GLogger.writeln(L"LauncherArgsModule.parseCmdLine_: Found command line parameter -language=, setting lang to %ls", this->bootLanguage_);
+						GLOG_DEBUG(Launcher, L"LauncherArgsModule.parseCmdLine_: Found command line parameter -language=, setting lang to %ls", this->bootLanguage_);
 						readLang = true;
 					}
 					else
 					{
-						GLogger.writeln(L"LauncherArgsModule.parseCmdLine_: Didn't find -OVERRIDELANGUAGE= or -language, defaulting to INT (will read config file)");
+						GLOG_DEBUG(Launcher, L"LauncherArgsModule.parseCmdLine_: Didn't find -OVERRIDELANGUAGE= or -language, defaulting to INT (will read config file)");
 
 					}
 				}
@@ -511,6 +512,8 @@ public:
 
 	bool Activate() override
 	{
+		PROFILE_SCOPE(Module, "LauncherArgs.Activate", nullptr);
+
 		// If we don't have parameters already for language and subtitle size in the command line options set
 		// Get options from command line.
 		if (!this->parseCmdLine_(GLEBinkProxy.CmdLine))
@@ -4,6 +4,7 @@
 #include <Windows.h>
 #include "../utils/io.h"
 #include "../utils/hook.h"
+#include "../utils/profiler.h"
 #include "../dllstruct.h"
 #include "_base.h"
 #include "drm.h"
@@ -62,6 +63,7 @@ public:
 
 	bool Activate() override
 	{
+		PROFILE_SCOPE(Module, "LauncherFixer.Activate", nullptr);
 
 		if (!this->detourOffsets_())
 		{
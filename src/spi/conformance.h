@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include "interface.h"
+
+
+namespace SPI
+{
+    // A v4 table entry and the capability bit which makes it callable.
+    struct V4Entry
+    {
+        unsigned long long Capability;
+        size_t Offset;
+        size_t Size;
+        const char* Name;
+    };
+
+    #define SPI_V4_ENTRY(CAPABILITY, FIELD) \
+        V4Entry{ CAPABILITY, offsetof(SharedProxyInterfaceV4, FIELD), sizeof(SharedProxyInterfaceV4::FIELD), #FIELD }
+
+    // Every entry of the v4 table, in table order. Append here when appending to the table.
+    static const V4Entry V4_ENTRIES[] =
+    {
+        SPI_V4_ENTRY(0, GetHostGame),
+        SPI_V4_ENTRY(SPI_CAP_BATCHED_HOOKS, InstallHooks),
+        SPI_V4_ENTRY(SPI_CAP_BATCHED_HOOKS, UninstallHooks),
+        SPI_V4_ENTRY(SPI_CAP_MULTI_PATTERN, FindPatterns),
+        SPI_V4_ENTRY(SPI_CAP_CACHED_OFFSETS, FindPatternCached),
+        SPI_V4_ENTRY(SPI_CAP_JOBS, SubmitJob),
+        SPI_V4_ENTRY(SPI_CAP_NATIVE_OVERRIDES, RegisterNativeOverride),
+        SPI_V4_ENTRY(SPI_CAP_NATIVE_OVERRIDES, UnregisterNativeOverride),
+        SPI_V4_ENTRY(SPI_CAP_NAME_CACHE, GetNameText),
+        SPI_V4_ENTRY(SPI_CAP_OBJECT_LOOKUP, FindObject),
+        SPI_V4_ENTRY(SPI_CAP_EVENT_DISPATCH, SubscribeEvent),
+        SPI_V4_ENTRY(SPI_CAP_EVENT_DISPATCH, UnsubscribeEvent),
+        SPI_V4_ENTRY(SPI_CAP_ALLOCATORS, AllocScratch),
+        SPI_V4_ENTRY(SPI_CAP_ALLOCATORS, ResetScratch),
+        SPI_V4_ENTRY(SPI_CAP_ALLOCATORS, AllocPooled),
+        SPI_V4_ENTRY(SPI_CAP_ALLOCATORS, FreePooled),
+        SPI_V4_ENTRY(SPI_CAP_TICK_CALLBACKS, RegisterTick),
+        SPI_V4_ENTRY(SPI_CAP_TICK_CALLBACKS, UnregisterTick),
+        SPI_V4_ENTRY(SPI_CAP_TICK_CALLBACKS, GetTickStats),
+    };
+
+    #undef SPI_V4_ENTRY
+
+    static const unsigned long long V4_KNOWN_CAPABILITIES = (SPI_CAP_TICK_CALLBACKS << 1) - 1;
+
+    /// <summary>
+    /// Check a v4 table against what plugins rely on: a header they can read, GetHostGame always
+    /// there, and every entry of an advertised capability inside StructSize and not NULL.
+    /// Each violation is reported through failed(entry or field name, what is wrong).
+    /// The host checks its own table with this, the tests check it against mock hosts.
+    /// </summary>
+    template<typename TFailed>
+    bool CheckV4Table(const SharedProxyInterfaceV4* table, TFailed&& failed)
+    {
+        if (!table)
+        {
+            failed("table", "is NULL");
+            return false;
+        }
+
+        bool conforms = true;
+        if (table->StructSize < offsetof(SharedProxyInterfaceV4, GetHostGame))
+        {
+            failed("StructSize", "doesn't cover the header");
+            return false;
+        }
+        if (table->Version < 4)
+        {
+            failed("Version", "is below 4");
+            conforms = false;
+        }
+        if ((table->Capabilities & ~V4_KNOWN_CAPABILITIES) != 0)
+        {
+            failed("Capabilities", "has bits this header doesn't know");
+            conforms = false;
+        }
+
+        auto base = reinterpret_cast<const unsigned char*>(table);
+        for (const auto& entry : V4_ENTRIES)
+        {
+            if (entry.Capability != 0 && (table->Capabilities & entry.Capability) == 0)
+            {
+                continue;
+            }
+
+            const void* proc = nullptr;
+            if (table->StructSize < entry.Offset + entry.Size)
+            {
+                failed(entry.Name, "is advertised but past StructSize");
+                conforms = false;
+                continue;
+            }
+            static_assert(sizeof(proc) == sizeof(table->GetHostGame), "entries are plain function pointers");
+            memcpy(&proc, base + entry.Offset, sizeof(proc));
+            if (!proc)
+            {
+                failed(entry.Name, "is advertised but NULL");
+                conforms = false;
+            }
+        }
+        return conforms;
+    }
+}
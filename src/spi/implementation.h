@@ -2,20 +2,30 @@
 
 #include <cstring>
 #include <mutex>
+#include <shared_mutex>
 #include <new>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 #include <Windows.h>
 #include "../conf/version.h"
+#include "../utils/arena.h"
 #include "../utils/io.h"
 #include "../utils/hook.h"
 #include "../utils/classutils.h"
 #include "../utils/memory.h"
+#include "../utils/ticksched.h"
 #include "../dllstruct.h"
+#include "../ue_objects.h"
+#include "../ue_types.h"
 #include "../spi/shared_hook_manager.h"
+#include "../spi/conformance.h"
 #include "../spi/interface.h"
 
 
-#define SPI_IMPL_INSTANCE_LOCK(MUTEX) const std::lock_guard<std::mutex> lock(this->MUTEX);
+#define SPI_IMPL_INSTANCE_LOCK_EX(SELF, MUTEX) const std::unique_lock<std::shared_mutex> lock(SELF->MUTEX);
+#define SPI_IMPL_INSTANCE_SHARED_LOCK_EX(SELF, MUTEX) const std::shared_lock<std::shared_mutex> lock(SELF->MUTEX);
 
 
 namespace SPI
@@ -34,12 +44,20 @@ namespace SPI
 
         SharedHookManager hookMngr_;
 
-        std::mutex mtxGetVersion_;
-        std::mutex mtxGetBuildMode_;
-        std::mutex mtxGetHostGame_;
-        std::mutex mtxFindPattern_;
-        std::mutex mtxInstallHook_;
-        std::mutex mtxUninstallHook_;
+        // Version, build mode and host game never change after construction and are read without locking.
+        // Pattern scans only read the game image and run concurrently.
+        // Hook mutations are serialized by the registry lock inside SharedHookManager.
+        std::shared_mutex mtxPatternCache_;
+
+        SharedProxyInterfaceV4 tableV4_;
+        std::unordered_map<std::string, void*> patternCache_;  // PEiD pattern => offset, successful searches only
+
+        static inline SharedProxyInterface* instance_ = nullptr;  // For the v4 table, which has no "this".
+
+        // A pattern of at most 300 chars holds at most 100 bytes; its mask string needs a byte more for the terminator.
+        static const size_t PATTERN_MAX_CHARS = 300;
+        static const size_t PATTERN_MAX_BYTES = 100;
+        static const size_t PATTERN_MASK_BYTES = PATTERN_MAX_BYTES + 1;
 
         // Implementation methods.
 
@@ -55,6 +73,7 @@ namespace SPI
             }
 
             char* token = nullptr;
+            char* context = nullptr;  // strtok_s keeps no global state, so scans can run in parallel
             char* endPtr = nullptr;
             long byteValue = 0;
             size_t parsedLength = 0;
@@ -62,7 +81,7 @@ namespace SPI
 
             do
             {
-                token = std::strtok(parsedLength == 0 ? inPattern : nullptr, " ");
+                token = strtok_s(parsedLength == 0 ? inPattern : nullptr, " ", &context);
                 if (token)
                 {
                     parsedLength = token + 2 - inPattern;
@@ -112,6 +131,406 @@ namespace SPI
             return true;
         }
 
+        // SharedProxyInterfaceV4 entries.
+
+        static SPIReturn __cdecl v4GetHostGame_(SPIGameVersion* outGameVersion)
+        {
+            if (!outGameVersion)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            *outGameVersion = static_cast<SPIGameVersion>(GLEBinkProxy.Game);
+            return SPIReturn::Success;
+        }
+
+        static SPIReturn __cdecl v4InstallHooks_(SPIHookDesc* hooks, unsigned long count)
+        {
+            if (!hooks || count == 0)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            auto self = instance_;
+
+            std::vector<LPVOID> targets(count);
+            std::vector<LPVOID> detours(count);
+            std::vector<LPVOID*> originals(count);
+            std::vector<const char*> names(count);
+            std::vector<char> results(count);  // not vector<bool>, need a bool* below
+            bool valid = true;
+            for (unsigned long i = 0; i < count; i++)
+            {
+                targets[i] = hooks[i].Target;
+                detours[i] = hooks[i].Detour;
+                originals[i] = hooks[i].Original;
+                names[i] = hooks[i].Name;
+
+                if (!hooks[i].Name || !hooks[i].Target || !hooks[i].Detour || !hooks[i].Original)
+                {
+                    hooks[i].Result = SPIReturn::FailureInvalidParam;
+                    valid = false;
+                }
+                else
+                {
+                    hooks[i].Result = SPIReturn::FailureGeneric;  // Not installed, unless the batch goes ahead.
+                }
+            }
+
+            // Every descriptor is checked before refusing, so the caller sees all the bad ones at once.
+            if (!valid)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            auto installedCount = self->hookMngr_.InstallBatch(count, targets.data(), detours.data(), originals.data(), names.data(), reinterpret_cast<bool*>(results.data()));
+            for (unsigned long i = 0; i < count; i++)
+            {
+                hooks[i].Result = results[i] ? SPIReturn::Success : SPIReturn::FailureHooking;
+            }
+
+            return installedCount == count ? SPIReturn::Success : SPIReturn::FailureHooking;
+        }
+
+        static SPIReturn __cdecl v4UninstallHooks_(const char* const* names, unsigned long count)
+        {
+            if (!names || count == 0)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            auto rc = SPIReturn::Success;
+            for (unsigned long i = 0; i < count; i++)
+            {
+                auto hookRc = instance_->UninstallHook(names[i]);
+                if (hookRc != SPIReturn::Success)
+                {
+                    rc = hookRc;
+                }
+            }
+            return rc;
+        }
+
+        static SPIReturn __cdecl v4FindPatterns_(SPIPatternDesc* patterns, unsigned long count)
+        {
+            if (!patterns || count == 0)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            auto self = instance_;
+
+            // Unpack all the patterns first, then scan the module once for all of them.
+            const size_t slotBytes = PATTERN_MAX_BYTES + PATTERN_MASK_BYTES;  // pattern, then its zero-terminated mask
+            std::vector<BYTE> buffers(count * slotBytes, 0);
+            std::vector<BYTE*> patternPtrs;
+            std::vector<BYTE*> maskPtrs;
+            std::vector<unsigned long> indices;
+            for (unsigned long i = 0; i < count; i++)
+            {
+                patterns[i].Offset = nullptr;
+                patterns[i].Result = SPIReturn::Undefined;
+
+                if (!patterns[i].Pattern)
+                {
+                    patterns[i].Result = SPIReturn::FailureInvalidParam;
+                    continue;
+                }
+                if (strlen(patterns[i].Pattern) > PATTERN_MAX_CHARS)
+                {
+                    patterns[i].Result = SPIReturn::FailurePatternTooLong;
+                    continue;
+                }
+
+                auto patternBytes = &buffers[i * slotBytes];
+                auto maskBytes = &buffers[i * slotBytes + PATTERN_MAX_BYTES];
+                auto inPatternCopy = _strdup(patterns[i].Pattern);
+                size_t patternLength = 0;
+                bool parsed = self->parseCombinedPattern_(inPatternCopy, patternBytes, maskBytes, &patternLength);
+                free(inPatternCopy);
+                if (!parsed)
+                {
+                    patterns[i].Result = SPIReturn::FailurePatternInvalid;
+                    continue;
+                }
+
+                patternPtrs.push_back(patternBytes);
+                maskPtrs.push_back(maskBytes);
+                indices.push_back(i);
+            }
+
+            std::vector<BYTE*> offsets(indices.size(), nullptr);
+            if (!indices.empty())
+            {
+                Utils::ScanProcessMany(patternPtrs.data(), maskPtrs.data(), indices.size(), offsets.data());
+            }
+
+            auto rc = SPIReturn::Success;
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                auto& pattern = patterns[indices[i]];
+                pattern.Offset = offsets[i];
+                pattern.Result = offsets[i] ? SPIReturn::Success : SPIReturn::FailureGeneric;
+            }
+            for (unsigned long i = 0; i < count; i++)
+            {
+                if (patterns[i].Result != SPIReturn::Success)
+                {
+                    rc = patterns[i].Result;
+                }
+            }
+            return rc;
+        }
+
+        static SPIReturn __cdecl v4FindPatternCached_(void** outOffsetPtr, const char* combinedPattern)
+        {
+            if (!outOffsetPtr || !combinedPattern)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            auto self = instance_;
+            {
+                SPI_IMPL_INSTANCE_SHARED_LOCK_EX(self, mtxPatternCache_);
+                auto it = self->patternCache_.find(combinedPattern);
+                if (it != self->patternCache_.end())
+                {
+                    *outOffsetPtr = it->second;
+                    return SPIReturn::Success;
+                }
+            }
+
+            // Two plugins missing the cache at once will both scan, that's harmless.
+            auto rc = self->FindPattern(outOffsetPtr, const_cast<char*>(combinedPattern));
+            if (rc == SPIReturn::Success)
+            {
+                SPI_IMPL_INSTANCE_LOCK_EX(self, mtxPatternCache_);
+                self->patternCache_.emplace(combinedPattern, *outOffsetPtr);
+            }
+            return rc;
+        }
+
+        struct JobData
+        {
+            SPIJobProc Proc;
+            void* Context;
+        };
+
+        static VOID CALLBACK jobCallback_(PTP_CALLBACK_INSTANCE instance, PVOID context)
+        {
+            auto job = reinterpret_cast<JobData*>(context);
+            job->Proc(job->Context);
+            delete job;
+        }
+
+        static SPIReturn __cdecl v4SubmitJob_(SPIJobProc proc, void* context)
+        {
+            if (!proc)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            auto job = new JobData{ proc, context };  // deleted by the callback
+            if (!TrySubmitThreadpoolCallback(jobCallback_, job, nullptr))
+            {
+                delete job;
+                return SPIReturn::ErrorWinApi;
+            }
+            return SPIReturn::Success;
+        }
+
+        static SPIReturn __cdecl v4RegisterNativeOverride_(const SPINativeOverrideDesc* desc)
+        {
+            if (!desc || !desc->Path)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            // Natives are per game, the launcher binds no script.
+            auto gameIndex = static_cast<int>(GLEBinkProxy.Game) - static_cast<int>(LEGameVersion::LE1);
+            if (gameIndex < 0 || gameIndex >= 3)
+            {
+                return SPIReturn::FailureUnsupportedYet;
+            }
+            auto native = reinterpret_cast<void*>(desc->Natives[gameIndex]);
+            if (!native)
+            {
+                return SPIReturn::Success;
+            }
+
+            // Owned by whichever module the native lives in, so it goes away with the plugin.
+            HMODULE owner = nullptr;
+            GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                reinterpret_cast<LPCWSTR>(native), &owner);
+
+            if (!UE::GNativeOverrides.Register(desc->Path, native, owner))
+            {
+                GLogger.writeln(L"RegisterNativeOverride: failed to register [%s], ill-formed or already overridden", desc->Path);
+                return SPIReturn::FailureDuplicacy;
+            }
+            GLOG_INFO(Spi, L"RegisterNativeOverride: [%s] => 0x%p (owner = 0x%p)", desc->Path, native, owner);
+            return SPIReturn::Success;
+        }
+
+        static SPIReturn __cdecl v4UnregisterNativeOverride_(const wchar_t* path)
+        {
+            if (!path)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            return UE::GNativeOverrides.Unregister(path) ? SPIReturn::Success : SPIReturn::FailureDuplicacy;
+        }
+
+        static SPIReturn __cdecl v4GetNameText_(const void* name, SPINameView* outView)
+        {
+            if (!name || !outView)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            Utils::NameView view{};
+            if (!UE::GetCachedName(name, view))
+            {
+                return UE::DecodeNameForGame ? SPIReturn::FailureGeneric : SPIReturn::FailureUnsupportedYet;
+            }
+
+            *outView = SPINameView{ view.Wide, view.Narrow, view.Length };
+            return SPIReturn::Success;
+        }
+
+        static SPIReturn __cdecl v4SubscribeEvent_(SPIEventSubscriptionDesc* desc)
+        {
+            if (!desc || !desc->Proc || (!desc->Function && !desc->NameKey))
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            HMODULE owner = nullptr;
+            GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                reinterpret_cast<LPCWSTR>(desc->Proc), &owner);
+
+            auto flags = (desc->Flags & SPI_EVENT_POST) ? Utils::EventDispatchTable::FLAG_POST : 0u;
+            // Names of functions bound before the first name subscription weren't tracked, they are
+            // looked up in GObjects (nothing was bound before the first bind, nothing to look up).
+            desc->Id = UE::GEventDispatch.Subscribe(desc->Function, desc->NameKey, reinterpret_cast<void*>(desc->Proc), desc->Context, flags, owner,
+                [](uint64_t nameKey, auto&& visit)
+                {
+                    if (UE::GFirstBoundObject && !UE::GObjectLookup.ForEachNamed(nameKey, visit))
+                    {
+                        GLogger.writeln(L"SubscribeEvent: ERROR: GObjects wasn't found, functions named 0x%llx bound so far are missed", nameKey);
+                    }
+                });
+            if (desc->Id == 0)
+            {
+                GLogger.writeln(L"SubscribeEvent: ERROR: no room left for function 0x%p", desc->Function);
+                return SPIReturn::FailureGeneric;
+            }
+
+            // Stored before hooking, so a first bind running meanwhile either sees the subscription
+            // or is seen here. Before the first bind it stays Pending, the bind hooks ProcessEvent.
+            if (UE::HookProcessEvent() == UE::ProcessEventHook::Unavailable)
+            {
+                UE::GEventDispatch.Unsubscribe(desc->Id);
+                desc->Id = 0;
+                return SPIReturn::FailureUnsupportedYet;
+            }
+            GLOG_INFO(Spi, L"SubscribeEvent: #%lu, function 0x%p / name key 0x%llx => 0x%p (owner = 0x%p)",
+                desc->Id, desc->Function, desc->NameKey, desc->Proc, owner);
+            return SPIReturn::Success;
+        }
+
+        static SPIReturn __cdecl v4UnsubscribeEvent_(unsigned long id)
+        {
+            return UE::GEventDispatch.Unsubscribe(id) ? SPIReturn::Success : SPIReturn::FailureInvalidParam;
+        }
+
+        static SPIReturn __cdecl v4AllocScratch_(unsigned long long size, unsigned long alignment, void** outMemory)
+        {
+            if (!outMemory || alignment == 0 || (alignment & (alignment - 1)) != 0)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            *outMemory = Utils::GScratch.Allocate(static_cast<size_t>(size), alignment);
+            return *outMemory ? SPIReturn::Success : SPIReturn::FailureGeneric;
+        }
+
+        static SPIReturn __cdecl v4ResetScratch_()
+        {
+            Utils::GScratch.ResetThread();
+            return SPIReturn::Success;
+        }
+
+        static SPIReturn __cdecl v4AllocPooled_(unsigned long long size, void** outMemory)
+        {
+            if (!outMemory)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            *outMemory = Utils::GPools.Allocate(static_cast<size_t>(size));
+            return *outMemory ? SPIReturn::Success : SPIReturn::FailureGeneric;
+        }
+
+        static SPIReturn __cdecl v4FreePooled_(void* memory)
+        {
+            Utils::GPools.Free(memory);
+            return SPIReturn::Success;
+        }
+
+        static SPIReturn __cdecl v4RegisterTick_(SPITickDesc* desc)
+        {
+            if (!desc || !desc->Proc)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            HMODULE owner = nullptr;
+            GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                reinterpret_cast<LPCWSTR>(desc->Proc), &owner);
+
+            desc->Id = Utils::GTickScheduler.Register(reinterpret_cast<void*>(desc->Proc), desc->Context, desc->Priority, desc->BudgetUs, owner);
+            GLOG_INFO(Spi, L"RegisterTick: #%lu => 0x%p, priority %d, budget %lu us (owner = 0x%p)",
+                desc->Id, desc->Proc, desc->Priority, desc->BudgetUs, owner);
+            return SPIReturn::Success;
+        }
+
+        static SPIReturn __cdecl v4UnregisterTick_(unsigned long id)
+        {
+            return Utils::GTickScheduler.Unregister(id) ? SPIReturn::Success : SPIReturn::FailureInvalidParam;
+        }
+
+        static SPIReturn __cdecl v4GetTickStats_(unsigned long id, SPITickStats* outStats)
+        {
+            Utils::TickScheduler::Stats stats;
+            if (!outStats || !Utils::GTickScheduler.GetStats(id, stats))
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            *outStats = SPITickStats{ stats.Calls, stats.Overruns, stats.LastUs, stats.MaxUs, stats.AverageUs };
+            return SPIReturn::Success;
+        }
+
+        static SPIReturn __cdecl v4FindObject_(const wchar_t* path, void** outObject)
+        {
+            if (!path || !outObject)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            UE::UObjectPartial* object = nullptr;
+            if (!UE::GObjectLookup.Find(path, &object))
+            {
+                *outObject = nullptr;
+                return SPIReturn::FailureUnsupportedYet;
+            }
+
+            *outObject = object;
+            return object ? SPIReturn::Success : SPIReturn::FailureGeneric;
+        }
+
     public:
         SharedProxyInterface()
             : NonCopyMovable()
@@ -122,14 +541,45 @@ namespace SPI
 #ifndef ASI_DEBUG
             isRelease_ = true;
 #endif
+
+            instance_ = this;
+
+            ZeroMemory(&tableV4_, sizeof(tableV4_));
+            tableV4_.StructSize = sizeof(SharedProxyInterfaceV4);
+            tableV4_.Version = ASI_SPI_VERSION;
+            tableV4_.Capabilities = SPI_CAP_BATCHED_HOOKS | SPI_CAP_MULTI_PATTERN | SPI_CAP_CACHED_OFFSETS | SPI_CAP_JOBS
+                | SPI_CAP_NATIVE_OVERRIDES | SPI_CAP_NAME_CACHE | SPI_CAP_OBJECT_LOOKUP
+                | SPI_CAP_EVENT_DISPATCH | SPI_CAP_ALLOCATORS | SPI_CAP_TICK_CALLBACKS;
+            tableV4_.GetHostGame = v4GetHostGame_;
+            tableV4_.InstallHooks = v4InstallHooks_;
+            tableV4_.UninstallHooks = v4UninstallHooks_;
+            tableV4_.FindPatterns = v4FindPatterns_;
+            tableV4_.FindPatternCached = v4FindPatternCached_;
+            tableV4_.SubmitJob = v4SubmitJob_;
+            tableV4_.RegisterNativeOverride = v4RegisterNativeOverride_;
+            tableV4_.UnregisterNativeOverride = v4UnregisterNativeOverride_;
+            tableV4_.GetNameText = v4GetNameText_;
+            tableV4_.FindObject = v4FindObject_;
+            tableV4_.SubscribeEvent = v4SubscribeEvent_;
+            tableV4_.UnsubscribeEvent = v4UnsubscribeEvent_;
+            tableV4_.AllocScratch = v4AllocScratch_;
+            tableV4_.ResetScratch = v4ResetScratch_;
+            tableV4_.AllocPooled = v4AllocPooled_;
+            tableV4_.FreePooled = v4FreePooled_;
+            tableV4_.RegisterTick = v4RegisterTick_;
+            tableV4_.UnregisterTick = v4UnregisterTick_;
+            tableV4_.GetTickStats = v4GetTickStats_;
+
+            CheckV4Table(&tableV4_, [](const char* name, const char* problem)
+                {
+                    GLogger.writeln(L"SharedProxyInterface: ERROR: v4 table entry %S %S", name, problem);
+                });
         }
 
         // ISharedProxyInterface implementation.
 
         SPIDEFN GetVersion(unsigned long* outVersionPtr)
         {
-            SPI_IMPL_INSTANCE_LOCK(mtxGetVersion_);
-
             if (!outVersionPtr)
             {
                 return SPIReturn::FailureInvalidParam;
@@ -141,8 +591,6 @@ namespace SPI
 
         SPIDEFN GetBuildMode(bool* outIsRelease)
         {
-            SPI_IMPL_INSTANCE_LOCK(mtxGetBuildMode_);
-
             if (!outIsRelease)
             {
                 return SPIReturn::FailureInvalidParam;
@@ -154,8 +602,6 @@ namespace SPI
 
         SPIDEFN GetHostGame(SPIGameVersion* outGameVersion)
         {
-            SPI_IMPL_INSTANCE_LOCK(mtxGetHostGame_);
-
             if (!outGameVersion)
             {
                 return SPIReturn::FailureInvalidParam;
@@ -167,13 +613,11 @@ namespace SPI
 
         SPIDEFN FindPattern(void** outOffsetPtr, char* combinedPattern)
         {
-            SPI_IMPL_INSTANCE_LOCK(mtxFindPattern_);
-
             if (!outOffsetPtr || !combinedPattern)
             {
                 return SPIReturn::FailureInvalidParam;
             }
-            if (strlen(combinedPattern) > 300)
+            if (strlen(combinedPattern) > PATTERN_MAX_CHARS)
             {
                 return SPIReturn::FailurePatternTooLong;
             }
@@ -183,15 +627,16 @@ namespace SPI
 
             auto inPatternCopy = _strdup(combinedPattern);
 
-            BYTE patternBytes[100];
-            BYTE maskBytes[100];
+            BYTE patternBytes[PATTERN_MAX_BYTES];
+            BYTE maskBytes[PATTERN_MASK_BYTES];
             size_t patternLength = 0;
 
-            ZeroMemory(patternBytes, 100);
-            ZeroMemory(maskBytes, 100);
+            ZeroMemory(patternBytes, sizeof(patternBytes));
+            ZeroMemory(maskBytes, sizeof(maskBytes));
             
             if (!this->parseCombinedPattern_(inPatternCopy, (BYTE*)patternBytes, (BYTE*)maskBytes, &patternLength))
             {
+                free(inPatternCopy);
                 return SPIReturn::FailurePatternInvalid;
             }
 
@@ -216,8 +661,6 @@ namespace SPI
 
         SPIDEFN InstallHook(const char* name, void* target, void* detour, void** original)
         {
-            SPI_IMPL_INSTANCE_LOCK(mtxInstallHook_);
-
             if (hookMngr_.HookExists(const_cast<char*>(name)))
             {
                 GLogger.writeln(L"Failed to install the hook [%S] because it already exists", name);
@@ -235,8 +678,6 @@ namespace SPI
 
         SPIDEFN UninstallHook(const char* name)
         {
-            SPI_IMPL_INSTANCE_LOCK(mtxUninstallHook_);
-
             if (!hookMngr_.HookExists(const_cast<char*>(name)))
             {
                 GLogger.writeln(L"Failed to uninstall the hook [%S] because it doesn't exist", name);
@@ -252,6 +693,55 @@ namespace SPI
             return SPIReturn::Success;
         }
 
+        SPIDEFN QueryInterface(unsigned long version, const void** outTable)
+        {
+            if (!outTable)
+            {
+                return SPIReturn::FailureInvalidParam;
+            }
+
+            // The v4 table only grows, so any v4 plugin can use it.
+            if (version != 4)
+            {
+                *outTable = nullptr;
+                return SPIReturn::FailureUnsupportedYet;
+            }
+
+            *outTable = &tableV4_;
+            return SPIReturn::Success;
+        }
+
         // End of ISharedProxyInterface implementation.
+
+        // Proxy-side helpers, not exposed to plugins.
+
+        // Drop everything a plugin left registered, used when it is unloaded. Functions bound to its native
+        // overrides get the engine's natives back, event subscriptions and tick callbacks wait for calls in
+        // progress. A script call already inside one of its natives isn't waited for (the VM gives no way to),
+        // it's the one window left. False if some of its hooks are still installed, the plugin must then
+        // stay loaded.
+        bool ReleaseOwnedBy(HMODULE owner)
+        {
+            auto released = hookMngr_.UninstallAllOwnedBy(owner);
+
+            auto overrideCount = UE::GNativeOverrides.UnregisterOwnedBy(owner);
+            if (overrideCount != 0)
+            {
+                GLogger.writeln(L"ReleaseOwnedBy: dropped %llu native override(s) owned by 0x%p", overrideCount, owner);
+            }
+
+            auto subscriptionCount = UE::GEventDispatch.UnsubscribeOwnedBy(owner);
+            if (subscriptionCount != 0)
+            {
+                GLogger.writeln(L"ReleaseOwnedBy: dropped %llu event subscription(s) owned by 0x%p", subscriptionCount, owner);
+            }
+
+            auto tickCount = Utils::GTickScheduler.UnregisterOwnedBy(owner);
+            if (tickCount != 0)
+            {
+                GLogger.writeln(L"ReleaseOwnedBy: dropped %llu tick callback(s) owned by 0x%p", tickCount, owner);
+            }
+            return released;
+        }
     };
 }
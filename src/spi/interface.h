@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 
 #pragma region Plugin-side utilities
 
@@ -16,7 +18,7 @@
 /// Duplicate the stuff in version.h!!!
 
 #define SPI_VERSION_ANY     3
-#define SPI_VERSION_LATEST  3
+#define SPI_VERSION_LATEST  4
 
 /// Plugin-side definition which marks the dll as supporting SPI.
 #define SPI_PLUGINSIDE_SUPPORT(NAME,AUTHOR,VERSION,GAME_FLAGS,SPIMINVER) \
@@ -164,6 +166,227 @@ public:
     /// <param name="name">Name of the hook to remove.</param>
     /// <returns>An appropriate <see cref="SPIReturn"/> code.</returns>
     SPIDECL UninstallHook(const char* name) = 0;
+
+    /// <summary>
+    /// Get a newer, C-ABI function table of the host proxy (see <see cref="SharedProxyInterfaceV4"/>).
+    /// Only exists on hosts which report version 4 or higher through <see cref="ISharedProxyInterface::GetVersion"/>,
+    /// use <see cref="SPI_QueryV4"/> which checks that.
+    /// </summary>
+    /// <param name="version">Version of the table to get.</param>
+    /// <param name="outTable">Output value for the table, set to NULL if the version is not provided.</param>
+    /// <returns>An appropriate <see cref="SPIReturn"/> code.</returns>
+    SPIDECL QueryInterface(unsigned long version, const void** outTable) = 0;
+};
+
+#pragma endregion
+
+
+#pragma region The v4 function table
+
+/// Capability bits of SharedProxyInterfaceV4::Capabilities.
+/// A function pointer is only valid to call if its capability bit is set.
+
+#define SPI_CAP_BATCHED_HOOKS    (1ull << 0)  // InstallHooks, UninstallHooks
+#define SPI_CAP_MULTI_PATTERN    (1ull << 1)  // FindPatterns
+#define SPI_CAP_CACHED_OFFSETS   (1ull << 2)  // FindPatternCached
+#define SPI_CAP_JOBS             (1ull << 3)  // SubmitJob
+#define SPI_CAP_NATIVE_OVERRIDES (1ull << 4)  // RegisterNativeOverride, UnregisterNativeOverride
+#define SPI_CAP_NAME_CACHE       (1ull << 5)  // GetNameText
+#define SPI_CAP_OBJECT_LOOKUP    (1ull << 6)  // FindObject
+#define SPI_CAP_EVENT_DISPATCH   (1ull << 7)  // SubscribeEvent, UnsubscribeEvent
+#define SPI_CAP_ALLOCATORS       (1ull << 8)  // AllocScratch, ResetScratch, AllocPooled, FreePooled
+#define SPI_CAP_TICK_CALLBACKS   (1ull << 9)  // RegisterTick, UnregisterTick, GetTickStats
+
+/// One hook of a SharedProxyInterfaceV4::InstallHooks batch.
+struct SPIHookDesc
+{
+    const char* Name;
+    void* Target;
+    void* Detour;
+    void** Original;
+    SPIReturn Result;  // Filled in by the host.
+};
+
+/// One pattern of a SharedProxyInterfaceV4::FindPatterns batch.
+struct SPIPatternDesc
+{
+    const char* Pattern;  // PEiD-style, same limits as ISharedProxyInterface::FindPattern.
+    void* Offset;         // Filled in by the host, NULL if not found.
+    SPIReturn Result;     // Filled in by the host.
+};
+
+typedef void(__cdecl* SPIJobProc)(void* context);
+
+/// A UnrealScript native: the object it runs on, the script stack frame and where the return value goes.
+/// A replacement must consume its parameters from the frame like the original does.
+typedef void(__cdecl* SPINativeProc)(void* object, void* frame, void* result);
+
+/// Text of an FName from SharedProxyInterfaceV4::GetNameText.
+struct SPINameView
+{
+    const wchar_t* Wide;
+    const char* Narrow;     // UTF-8, NULL if the host's cache was full and only Wide could be provided.
+    unsigned long Length;   // In wide chars.
+};
+
+/// A ProcessEvent handler: the object, the UFunction called on it, its packed parameters and return value.
+/// Return true from a pre-call handler to skip the function, post-call handlers' return values are ignored.
+typedef bool(__cdecl* SPIEventProc)(void* object, void* function, void* parms, void* result, void* context);
+
+#define SPI_EVENT_POST  1ul   // SPIEventSubscriptionDesc::Flags: run after the function instead of before.
+
+/// A subscription for SharedProxyInterfaceV4::SubscribeEvent.
+struct SPIEventSubscriptionDesc
+{
+    void* Function;                 // UFunction to subscribe to, or NULL for every function named NameKey.
+    unsigned long long NameKey;     // FName value (the 8 bytes at UFunction + 0x48), if Function is NULL.
+    SPIEventProc Proc;
+    void* Context;                  // Passed to Proc.
+    unsigned long Flags;            // SPI_EVENT_*.
+    unsigned long Id;               // Filled in by the host, for UnsubscribeEvent.
+};
+
+/// A per-frame callback, run on the game thread.
+typedef void(__cdecl* SPITickProc)(void* context);
+
+/// A tick callback for SharedProxyInterfaceV4::RegisterTick.
+struct SPITickDesc
+{
+    SPITickProc Proc;
+    void* Context;                  // Passed to Proc.
+    int Priority;                   // Lower runs earlier in the frame, ties run in registration order.
+    unsigned long BudgetUs;         // Cost per frame above which the host logs an overrun, 0 for none.
+    unsigned long Id;               // Filled in by the host, for UnregisterTick and GetTickStats.
 };
 
+/// What the host measured for a tick callback, from SharedProxyInterfaceV4::GetTickStats.
+struct SPITickStats
+{
+    unsigned long long Calls;
+    unsigned long long Overruns;    // Frames it went over its budget.
+    long long LastUs;
+    long long MaxUs;
+    long long AverageUs;            // Over roughly the last 16 frames.
+};
+
+/// A native override for SharedProxyInterfaceV4::RegisterNativeOverride.
+struct SPINativeOverrideDesc
+{
+    const wchar_t* Path;        // "Function" for every function of that name, or "Outer.Function" (Outer = class or state).
+    SPINativeProc Natives[3];   // For LE1, LE2 and LE3, NULL leaves the function alone in that game.
+};
+
+/// <summary>
+/// SPI v4 function table (plain C layout), obtained through ISharedProxyInterface::QueryInterface.
+/// New entries are only ever appended, check StructSize (or use SPI_V4_HAS) before touching
+/// an entry which was added after the version a plugin is built against.
+/// </summary>
+struct SharedProxyInterfaceV4
+{
+    unsigned long StructSize;           // sizeof(SharedProxyInterfaceV4) as built by the host.
+    unsigned long Version;              // Version of the host proxy's SPI.
+    unsigned long long Capabilities;    // SPI_CAP_* bits.
+
+    /// Same as ISharedProxyInterface::GetHostGame.
+    SPIReturn(__cdecl* GetHostGame)(SPIGameVersion* outGameVersion);
+
+    /// Install several hooks at once, with a single suspension of the game's threads.
+    /// Returns Success if all hooks were installed, otherwise check each SPIHookDesc::Result.
+    /// If any descriptor is incomplete nothing is installed: those get FailureInvalidParam, the rest
+    /// FailureGeneric, and the call returns FailureInvalidParam.
+    SPIReturn(__cdecl* InstallHooks)(SPIHookDesc* hooks, unsigned long count);
+    /// Remove several hooks installed by InstallHooks or ISharedProxyInterface::InstallHook.
+    SPIReturn(__cdecl* UninstallHooks)(const char* const* names, unsigned long count);
+
+    /// Search the main game module for several patterns in one pass.
+    /// Returns Success if all patterns were found, otherwise check each SPIPatternDesc::Result.
+    SPIReturn(__cdecl* FindPatterns)(SPIPatternDesc* patterns, unsigned long count);
+    /// Same as ISharedProxyInterface::FindPattern, but the result is remembered by the host
+    /// and shared by all plugins searching for the same pattern.
+    SPIReturn(__cdecl* FindPatternCached)(void** outOffsetPtr, const char* combinedPattern);
+
+    /// Run a procedure on the host's thread pool.
+    SPIReturn(__cdecl* SubmitJob)(SPIJobProc proc, void* context);
+
+    /// Have UFunction::Bind point matching functions at a replacement native for the host game.
+    /// Only functions bound after the call are affected, so register from the attach point.
+    /// Overrides of an unloaded plugin are dropped and the functions using them get their original native
+    /// back. Returns FailureDuplicacy if the path already has one.
+    SPIReturn(__cdecl* RegisterNativeOverride)(const SPINativeOverrideDesc* desc);
+    /// Remove an override registered by RegisterNativeOverride, functions already bound to it get their
+    /// original native back. A script call already inside the override finishes in it.
+    SPIReturn(__cdecl* UnregisterNativeOverride)(const wchar_t* path);
+
+    /// Get the text of an FName (pointer to the 8-byte value, UObject + 0x48 for an object's name).
+    /// The game decodes each name once, after that it comes from the host's cache without locking.
+    /// The strings stay valid until the game exits, don't modify them.
+    SPIReturn(__cdecl* GetNameText)(const void* name, SPINameView* outView);
+
+    /// Find a UObject by its full path ("Package.Group.Object", case-insensitive) through the host's
+    /// index of GObjects, which catches up with new and collected objects as it's used.
+    /// Call from the game thread. Returns FailureGeneric if there is no such object, and
+    /// FailureUnsupportedYet if GObjects isn't known yet (before the first UFunction was bound).
+    SPIReturn(__cdecl* FindObject)(const wchar_t* path, void** outObject);
+
+    /// Have the host's ProcessEvent detour call a handler around calls of a function, instead of
+    /// hooking ProcessEvent and comparing names in every plugin. Calls nobody subscribed to cost
+    /// a single table probe. Subscriptions of an unloaded plugin are dropped.
+    /// The host finds and hooks ProcessEvent with the first subscription, or when the first UFunction
+    /// is bound for subscriptions made before that (they are kept until then). Returns
+    /// FailureUnsupportedYet if ProcessEvent wasn't found or couldn't be hooked in this game; for
+    /// subscriptions made before the first bind that only shows in the log, and they never run.
+    /// A subscription by name key after the first bind looks up the functions of that name bound so
+    /// far in GObjects, so like FindObject it belongs on the game thread.
+    SPIReturn(__cdecl* SubscribeEvent)(SPIEventSubscriptionDesc* desc);
+    /// Remove a subscription by SPIEventSubscriptionDesc::Id. Once it returns, the handler isn't
+    /// running on any other thread.
+    SPIReturn(__cdecl* UnsubscribeEvent)(unsigned long id);
+
+    /// Get scratch memory from the calling thread's bump arena, for temporaries of the current frame.
+    /// On the game thread, where tick callbacks run (see RegisterTick), it is valid until the next
+    /// frame boundary (its next AllocScratch after one). Other threads don't follow the game's frames:
+    /// their scratch is valid until they call ResetScratch, which they must do once in a while or it
+    /// keeps growing. Never free it. alignment must be a power of two.
+    SPIReturn(__cdecl* AllocScratch)(unsigned long long size, unsigned long alignment, void** outMemory);
+    /// Drop the calling thread's scratch memory now, for threads which don't run per frame.
+    SPIReturn(__cdecl* ResetScratch)();
+    /// Allocate from the host's size-class pools (16-aligned), for long-lived small objects.
+    /// Up to 2 KB comes from per-thread free lists without taking a lock, larger sizes fall back to the heap.
+    SPIReturn(__cdecl* AllocPooled)(unsigned long long size, void** outMemory);
+    /// Give back memory from AllocPooled, on any thread.
+    SPIReturn(__cdecl* FreePooled)(void* memory);
+
+    /// Have a callback run once per frame on the game thread, instead of hooking a tick function or
+    /// polling from a thread. The host times every call against the budget and logs overruns.
+    /// Callbacks of an unloaded plugin are dropped.
+    SPIReturn(__cdecl* RegisterTick)(SPITickDesc* desc);
+    /// Remove a tick callback by SPITickDesc::Id. Once this returns the callback won't run again,
+    /// it's fine to call from inside a tick callback.
+    SPIReturn(__cdecl* UnregisterTick)(unsigned long id);
+    SPIReturn(__cdecl* GetTickStats)(unsigned long id, SPITickStats* outStats);
+};
+
+/// Check if the host's v4 table is large enough to contain FIELD.
+#define SPI_V4_HAS(TABLE, FIELD) \
+    ((TABLE) && (TABLE)->StructSize >= offsetof(SharedProxyInterfaceV4, FIELD) + sizeof((TABLE)->FIELD) && (TABLE)->FIELD != nullptr)
+
+/// <summary>
+/// Get the v4 function table, or NULL if the host proxy is too old to have one.
+/// </summary>
+inline const SharedProxyInterfaceV4* SPI_QueryV4(ISharedProxyInterface* InterfacePtr)
+{
+    unsigned long version = 0;
+    if (!InterfacePtr || InterfacePtr->GetVersion(&version) != SPIReturn::Success || version < 4)
+    {
+        return nullptr;
+    }
+
+    const void* table = nullptr;
+    if (InterfacePtr->QueryInterface(4, &table) != SPIReturn::Success)
+    {
+        return nullptr;
+    }
+    return reinterpret_cast<const SharedProxyInterfaceV4*>(table);
+}
+
 #pragma endregion
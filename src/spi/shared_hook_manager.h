@@ -2,13 +2,19 @@
 
 #include "../minhook/include/MinHook.h"
 #include "utils/classutils.h"
+#include "utils/flightrec.h"
+#include "utils/profiler.h"
 #include "../dllstruct.h"
+#include <algorithm>
 #include <map>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
-#define SHOOKMNGR_LOCK(MUTEX) const std::lock_guard<std::mutex> lock(MUTEX);
+#define SHOOKMNGR_LOCK(MUTEX) const std::unique_lock<std::shared_mutex> lock(MUTEX);
+#define SHOOKMNGR_SHARED_LOCK(MUTEX) const std::shared_lock<std::shared_mutex> lock(MUTEX);
 
 namespace SPI
 {
@@ -16,9 +22,10 @@ namespace SPI
     {
         LPVOID Target;
         ULONG_PTR Identity;
+        HMODULE Owner;
 
         HookComboData() = default;
-        HookComboData(ULONG_PTR ident, LPVOID target) : Identity{ ident }, Target{ target } { }
+        HookComboData(ULONG_PTR ident, LPVOID target, HMODULE owner) : Identity{ ident }, Target{ target }, Owner{ owner } { }
     };
 
     /// <summary>
@@ -34,11 +41,50 @@ namespace SPI
         bool mhInitialized_;
         MH_STATUS mhLastStatus_;
 
-        std::mutex installMtx_;
-        std::mutex uninstallMtx_;
+        // One registry lock for every mutation (install, uninstall, owner cleanup),
+        // lookups share it.
+        std::shared_mutex registryMtx_;
 
         std::map<std::string, HookComboData> nameToHookMap_;
 
+        bool hookExists_(const char* name) const
+        {
+            return nameToHookMap_.find(std::string{ name }) != nameToHookMap_.end();
+        }
+
+        // Create a (disabled) hook and return its identity, or 0 on failure.
+        ULONG_PTR create_(LPVOID target, LPVOID detour, LPVOID* original, const char* name, HMODULE* outOwner)
+        {
+            if (hookExists_(name))
+            {
+                GLogger.writeln(L"SharedHookMngr.Install: hook of this name already exists");
+                return 0;
+            }
+
+            // The owning module serves as the hook identity, so that all hooks of a plugin
+            // can be removed in one pass. If the plugin hooks the same function twice,
+            // or the detour isn't inside a module, fall back to a unique counter.
+            auto owner = FindOwnerModule(detour);
+            auto identity = reinterpret_cast<ULONG_PTR>(owner);
+
+            mhLastStatus_ = owner ? MH_CreateHookEx(identity, original, detour, target) : MH_ERROR_ALREADY_CREATED;
+            if (mhLastStatus_ == MH_ERROR_ALREADY_CREATED)
+            {
+                identity = ++hookCounter_;
+                mhLastStatus_ = MH_CreateHookEx(identity, original, detour, target);
+            }
+            if (mhLastStatus_ != MH_OK)
+            {
+                GLogger.writeln(L"SharedHookMngr.Install: create failed, status = %d", mhLastStatus_);
+                Utils::GFlightRecorder.Record(Utils::FE_HOOK_FAILED, reinterpret_cast<ULONG_PTR>(target), mhLastStatus_, name);
+                return 0;
+            }
+
+            GLOG_DEBUG(Hooks, L"SharedHookMngr.Install: created [%S] 0x%p -> 0x%p (owner = 0x%p)", name, target, detour, owner);
+            *outOwner = owner;
+            return identity;
+        }
+
     public:
 
         SharedHookManager()
@@ -57,12 +103,26 @@ namespace SPI
 
         bool HookExists(char* name)
         {
-            return nameToHookMap_.find(std::string{ name }) != nameToHookMap_.end();
+            SHOOKMNGR_SHARED_LOCK(registryMtx_);
+            return hookExists_(name);
+        }
+
+        // Get the module whose code the detour lives in, which is the plugin that installed the hook.
+        static HMODULE FindOwnerModule(LPVOID detour)
+        {
+            HMODULE owner = nullptr;
+            if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                reinterpret_cast<LPCWSTR>(detour), &owner))
+            {
+                return nullptr;
+            }
+            return owner;
         }
 
         bool Install(LPVOID target, LPVOID detour, LPVOID* original, char* name)
         {
-            SHOOKMNGR_LOCK(installMtx_);
+            SHOOKMNGR_LOCK(registryMtx_);
+            PROFILE_SCOPE(Hook, "SharedHookMngr.Install", name);
 
             if (!IsInitialized() || !IsOK(mhLastStatus_))
             {
@@ -70,43 +130,114 @@ namespace SPI
                 return false;
             }
 
-            if (HookExists(name))
+            HMODULE owner = nullptr;
+            auto identity = create_(target, detour, original, name, &owner);
+            if (identity == 0)
             {
-                GLogger.writeln(L"SharedHookMngr.Install: hook of this name already exists");
                 return false;
             }
 
-            // Hook counter serves as the hook identity.
-            // Sometime around v3 I want to limit it to one hook per plugin for the same function.
-            ++hookCounter_;
-
-            mhLastStatus_ = MH_CreateHookEx(hookCounter_, original, detour, target);
+            mhLastStatus_ = MH_EnableHookEx(identity, target);
             if (mhLastStatus_ != MH_OK)
             {
-                GLogger.writeln(L"SharedHookMngr.Install: create failed, status = %d", mhLastStatus_);
+                GLogger.writeln(L"SharedHookMngr.Install: enable failed, status = %d", mhLastStatus_);
+                Utils::GFlightRecorder.Record(Utils::FE_HOOK_FAILED, reinterpret_cast<ULONG_PTR>(target), mhLastStatus_, name);
                 return false;
             }
 
-            GLogger.writeln(L"SharedHookMngr.Install: created [%S] 0x%p -> 0x%p", name, target, detour);
+            // Save the installed hook info
+            nameToHookMap_.insert({ name, HookComboData{ identity, target, owner } });
+            Utils::GFlightRecorder.Record(Utils::FE_HOOK_INSTALLED, reinterpret_cast<ULONG_PTR>(target), reinterpret_cast<ULONG_PTR>(detour), name);
+
+            GLOG_DEBUG(Hooks, L"SharedHookMngr.Install: enabled [%S] 0x%p", name, target);
+            return true;
 
-            mhLastStatus_ = MH_EnableHookEx(hookCounter_, target);
-            if (mhLastStatus_ != MH_OK)
+        }
+
+        // Create several hooks, then enable them with one thread freeze per identity
+        // (usually one in total, since a batch comes from a single plugin).
+        // outResults receives true for every hook which was installed.
+        // Returns the number of hooks installed.
+        size_t InstallBatch(size_t count, LPVOID* targets, LPVOID* detours, LPVOID** originals, const char** names, bool* outResults)
+        {
+            SHOOKMNGR_LOCK(registryMtx_);
+            PROFILE_SCOPE(Hook, "SharedHookMngr.InstallBatch", nullptr);
+
+            for (size_t i = 0; i < count; i++)
             {
-                GLogger.writeln(L"SharedHookMngr.Install: enable failed, status = %d", mhLastStatus_);
-                return false;
+                outResults[i] = false;
             }
 
-            // Save the installed hook info
-            nameToHookMap_.insert({ name, HookComboData{ hookCounter_, target } });
+            if (!IsInitialized() || !IsOK(mhLastStatus_))
+            {
+                GLogger.writeln(L"SharedHookMngr.InstallBatch: was not initialized or was in bad status");
+                return 0;
+            }
 
-            GLogger.writeln(L"SharedHookMngr.Install: enabled [%S] 0x%p", name, target);
-            return true;
+            std::vector<ULONG_PTR> identities(count, 0);
+            std::vector<HMODULE> owners(count, nullptr);
+            for (size_t i = 0; i < count; i++)
+            {
+                bool duplicate = false;
+                for (size_t j = 0; j < i && !duplicate; j++)
+                {
+                    duplicate = identities[j] != 0 && 0 == strcmp(names[i], names[j]);
+                }
+                if (duplicate)
+                {
+                    GLogger.writeln(L"SharedHookMngr.InstallBatch: [%S] appears twice in the batch", names[i]);
+                    continue;
+                }
+
+                identities[i] = create_(targets[i], detours[i], originals[i], names[i], &owners[i]);
+            }
+
+            // Created hooks are disabled, so enabling "all" hooks of an identity only touches this batch.
+            std::vector<ULONG_PTR> enabledIdentities;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (identities[i] == 0 || std::find(enabledIdentities.begin(), enabledIdentities.end(), identities[i]) != enabledIdentities.end())
+                {
+                    continue;
+                }
+
+                auto status = MH_EnableHookEx(identities[i], MH_ALL_HOOKS);
+                if (status != MH_OK)
+                {
+                    GLogger.writeln(L"SharedHookMngr.InstallBatch: enable failed for identity 0x%p, status = %d", identities[i], status);
+                    continue;
+                }
+                enabledIdentities.push_back(identities[i]);
+            }
+
+            size_t installedCount = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (identities[i] == 0)
+                {
+                    continue;
+                }
+
+                if (std::find(enabledIdentities.begin(), enabledIdentities.end(), identities[i]) == enabledIdentities.end())
+                {
+                    MH_RemoveHookEx((void*)4123, identities[i], targets[i]);
+                    Utils::GFlightRecorder.Record(Utils::FE_HOOK_FAILED, reinterpret_cast<ULONG_PTR>(targets[i]), MH_UNKNOWN, names[i]);
+                    continue;
+                }
+
+                nameToHookMap_.insert({ names[i], HookComboData{ identities[i], targets[i], owners[i] } });
+                Utils::GFlightRecorder.Record(Utils::FE_HOOK_INSTALLED, reinterpret_cast<ULONG_PTR>(targets[i]), reinterpret_cast<ULONG_PTR>(detours[i]), names[i]);
+                outResults[i] = true;
+                ++installedCount;
+            }
 
+            GLogger.writeln(L"SharedHookMngr.InstallBatch: enabled %llu of %llu hook(s)", installedCount, count);
+            return installedCount;
         }
 
         bool Uninstall(char* name)
         {
-            SHOOKMNGR_LOCK(uninstallMtx_);
+            SHOOKMNGR_LOCK(registryMtx_);
 
             if (!IsInitialized() || !IsOK(mhLastStatus_))
             {
@@ -114,7 +245,7 @@ namespace SPI
                 return false;
             }
 
-            if (!HookExists(name))
+            if (!hookExists_(name))
             {
                 GLogger.writeln(L"SharedHookMngr.Uninstall: hook of this name already exists");
                 return false;
@@ -129,6 +260,74 @@ namespace SPI
                 return false;
             }
             nameToHookMap_.erase(keyval);
+            Utils::GFlightRecorder.Record(Utils::FE_HOOK_REMOVED, reinterpret_cast<ULONG_PTR>(hookInfo.Target), 1, name);
+            return true;
+        }
+
+        // Remove every hook installed by a module, used when a plugin is unloaded.
+        // Returns false if any of its hooks couldn't be removed: those stay registered and their detours
+        // still point into the module, which must then not be freed. outRemoved gets the number removed.
+        bool UninstallAllOwnedBy(HMODULE owner, int* outRemoved = nullptr)
+        {
+            SHOOKMNGR_LOCK(registryMtx_);
+
+            if (outRemoved)
+            {
+                *outRemoved = 0;
+            }
+            if (!owner || !IsInitialized())
+            {
+                return true;   // Nothing can have been hooked for it.
+            }
+
+            // Hooks created under the owner's identity go in a single batch with one thread freeze.
+            // If that fails, nothing was removed and they are tried one by one below.
+            auto ownerIdentity = reinterpret_cast<ULONG_PTR>(owner);
+            auto batchStatus = MH_RemoveHookEx((void*)4123, ownerIdentity, MH_ALL_HOOKS);
+            if (batchStatus != MH_OK)
+            {
+                GLogger.writeln(L"SharedHookMngr.UninstallAllOwnedBy: batch remove failed, status = %d, removing one by one", batchStatus);
+            }
+
+            int removedCount = 0;
+            int failedCount = 0;
+            for (auto it = nameToHookMap_.begin(); it != nameToHookMap_.end(); )
+            {
+                if (it->second.Owner != owner)
+                {
+                    ++it;
+                    continue;
+                }
+
+                // Duplicates which had to fall back to a counter identity are removed one by one.
+                if (it->second.Identity != ownerIdentity || batchStatus != MH_OK)
+                {
+                    auto status = MH_RemoveHookEx((void*)4123, it->second.Identity, it->second.Target);
+                    if (status != MH_OK && status != MH_ERROR_NOT_CREATED)
+                    {
+                        GLogger.writeln(L"SharedHookMngr.UninstallAllOwnedBy: remove of [%S] failed, status = %d", it->first.c_str(), status);
+                        Utils::GFlightRecorder.Record(Utils::FE_HOOK_FAILED, reinterpret_cast<ULONG_PTR>(it->second.Target), status, it->first.c_str());
+                        ++failedCount;
+                        ++it;
+                        continue;
+                    }
+                }
+
+                it = nameToHookMap_.erase(it);
+                ++removedCount;
+            }
+
+            if (outRemoved)
+            {
+                *outRemoved = removedCount;
+            }
+            Utils::GFlightRecorder.Record(Utils::FE_HOOK_REMOVED, reinterpret_cast<ULONG_PTR>(owner), removedCount, "<all owned by module>");
+            if (failedCount != 0)
+            {
+                GLogger.writeln(L"SharedHookMngr.UninstallAllOwnedBy: ERROR: removed %d hook(s) owned by 0x%p, %d still installed", removedCount, owner, failedCount);
+                return false;
+            }
+            GLogger.writeln(L"SharedHookMngr.UninstallAllOwnedBy: removed %d hook(s) owned by 0x%p", removedCount, owner);
             return true;
         }
     };
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+
+// Engine containers shared by the proxy and plugins (include it instead of re-declaring FString):
+// TArray and FString with the engine's layout, non-owning views over them, and growth through
+// the game's own allocator so arrays the engine hands out can be grown and handed back.
+// Portable on purpose, nothing here needs Windows.
+
+namespace UE
+{
+    // Structure of a generic array used across the engine.
+    #pragma pack(push, 4)
+    template<typename T>
+    struct TArray
+    {
+        T* Data;
+        uint32_t Count;
+        uint32_t Max;
+    };
+    #pragma pack(pop)
+
+    // Structure of a TArray specialization used as a string.
+    // Count includes the terminator, an empty string has Count 0 (and possibly no Data).
+    struct FString : TArray<wchar_t>
+    {
+        [[nodiscard]] inline wchar_t* GetStr() const noexcept { return Data; }
+    };
+
+    static_assert(sizeof(TArray<void*>) == 0x10 && offsetof(TArray<void*>, Count) == 0x8 && offsetof(TArray<void*>, Max) == 0xC,
+        "TArray must match the engine's layout");
+    static_assert(sizeof(FString) == sizeof(TArray<wchar_t>), "FString adds no fields");
+
+
+    // A non-owning view of a TArray's elements, valid until the array is changed.
+    template<typename T>
+    class TArrayView
+    {
+    private:
+        T* data_ = nullptr;
+        size_t size_ = 0;
+
+    public:
+        constexpr TArrayView() noexcept = default;
+        constexpr TArrayView(T* data, size_t size) noexcept : data_{ data }, size_{ data ? size : 0 } { }
+        constexpr TArrayView(const TArray<std::remove_const_t<T>>& array) noexcept : TArrayView{ array.Data, array.Count } { }
+
+        [[nodiscard]] constexpr T* data() const noexcept { return data_; }
+        [[nodiscard]] constexpr size_t size() const noexcept { return size_; }
+        [[nodiscard]] constexpr bool empty() const noexcept { return size_ == 0; }
+        [[nodiscard]] constexpr T* begin() const noexcept { return data_; }
+        [[nodiscard]] constexpr T* end() const noexcept { return data_ + size_; }
+        [[nodiscard]] constexpr T& operator[](size_t index) const noexcept { return data_[index]; }
+
+        [[nodiscard]] constexpr TArrayView subview(size_t offset, size_t count = SIZE_MAX) const noexcept
+        {
+            offset = offset < size_ ? offset : size_;
+            return TArrayView{ data_ + offset, count < size_ - offset ? count : size_ - offset };
+        }
+    };
+
+    // A non-owning view of an FString's text without the terminator, valid until the string is changed.
+    class FStringView
+    {
+    private:
+        std::wstring_view text_;
+
+    public:
+        constexpr FStringView() noexcept = default;
+        constexpr FStringView(const FString& string) noexcept
+            : text_{ string.Data && string.Count > 0 ? std::wstring_view{ string.Data, string.Count - 1 } : std::wstring_view{} }
+        {
+        }
+
+        [[nodiscard]] constexpr std::wstring_view View() const noexcept { return text_; }
+        [[nodiscard]] constexpr const wchar_t* data() const noexcept { return text_.data(); }
+        [[nodiscard]] constexpr size_t size() const noexcept { return text_.size(); }
+        [[nodiscard]] constexpr bool empty() const noexcept { return text_.empty(); }
+
+        // Terminated as long as the string isn't empty, engine strings always are.
+        [[nodiscard]] constexpr const wchar_t* c_str() const noexcept { return text_.empty() ? L"" : text_.data(); }
+
+        [[nodiscard]] constexpr bool operator==(std::wstring_view other) const noexcept { return text_ == other; }
+        [[nodiscard]] constexpr bool operator!=(std::wstring_view other) const noexcept { return text_ != other; }
+    };
+
+
+    // The game's allocator, through the FMalloc object GMalloc points at. Plugins find the GMalloc
+    // global themselves (it's pattern-specific) and hand its address over. The virtual table is called
+    // by slot, so the layout is spelled out here: FExec's destructor and Exec, then Malloc, Realloc, Free.
+    class GameAllocator
+    {
+    public:
+        static const size_t MALLOC_SLOT = 2;
+        static const size_t REALLOC_SLOT = 3;
+        static const size_t FREE_SLOT = 4;
+        static const uint32_t DEFAULT_ALIGNMENT = 0;   // The allocator's own default.
+
+    private:
+        typedef void* (*tMalloc)(void* self, size_t count, uint32_t alignment);
+        typedef void* (*tRealloc)(void* self, void* original, size_t count, uint32_t alignment);
+        typedef void (*tFree)(void* self, void* original);
+
+        void** gmalloc_ = nullptr;   // &GMalloc, which is only set once the engine is up.
+
+        template<typename TFunc>
+        TFunc slot_(void* self, size_t index) const noexcept
+        {
+            return reinterpret_cast<TFunc>((*static_cast<void***>(self))[index]);
+        }
+
+    public:
+        constexpr GameAllocator() noexcept = default;
+        explicit constexpr GameAllocator(void** gmallocGlobal) noexcept : gmalloc_{ gmallocGlobal } { }
+
+        [[nodiscard]] bool Ready() const noexcept { return gmalloc_ && *gmalloc_; }
+
+        void* Malloc(size_t count, uint32_t alignment = DEFAULT_ALIGNMENT) const
+        {
+            return Ready() ? slot_<tMalloc>(*gmalloc_, MALLOC_SLOT)(*gmalloc_, count, alignment) : nullptr;
+        }
+
+        // Grows (or shrinks) in place when the allocator can, moves the block otherwise.
+        void* Realloc(void* original, size_t count, uint32_t alignment = DEFAULT_ALIGNMENT) const
+        {
+            return Ready() ? slot_<tRealloc>(*gmalloc_, REALLOC_SLOT)(*gmalloc_, original, count, alignment) : nullptr;
+        }
+
+        void Free(void* original) const
+        {
+            if (Ready() && original)
+            {
+                slot_<tFree>(*gmalloc_, FREE_SLOT)(*gmalloc_, original);
+            }
+        }
+    };
+
+
+    // Growth of engine arrays through the game's allocator. Elements are moved by the allocator's
+    // Realloc like the engine's own TArray does, so only trivially copyable types are allowed.
+    // All of these return false (leaving the array as it was) if the allocator isn't ready or fails.
+
+    // Engine-style slack: room for a few more appends before the next Realloc.
+    inline uint32_t ArraySlack(uint32_t count) noexcept
+    {
+        return count + 3 * count / 8 + 16;
+    }
+
+    template<typename T, typename TAllocator>
+    bool ArrayReserve(TArray<T>& array, uint32_t max, const TAllocator& allocator)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "TArray elements are moved by Realloc");
+
+        if (max <= array.Max)
+        {
+            return true;
+        }
+        auto data = static_cast<T*>(allocator.Realloc(array.Data, static_cast<size_t>(max) * sizeof(T)));
+        if (!data)
+        {
+            return false;
+        }
+        array.Data = data;
+        array.Max = max;
+        return true;
+    }
+
+    template<typename T, typename TAllocator>
+    bool ArrayAppend(TArray<T>& array, const T* items, uint32_t count, const TAllocator& allocator)
+    {
+        if (count == 0)
+        {
+            return true;
+        }
+        if (array.Count + count > array.Max && !ArrayReserve(array, ArraySlack(array.Count + count), allocator))
+        {
+            return false;
+        }
+        memcpy(array.Data + array.Count, items, static_cast<size_t>(count) * sizeof(T));
+        array.Count += count;
+        return true;
+    }
+
+    template<typename T, typename TAllocator>
+    void ArrayFree(TArray<T>& array, const TAllocator& allocator)
+    {
+        allocator.Free(array.Data);
+        array = TArray<T>{ nullptr, 0, 0 };
+    }
+
+    // Replace a string's text, reusing its buffer when it's large enough.
+    template<typename TAllocator>
+    bool StringAssign(FString& string, std::wstring_view text, const TAllocator& allocator)
+    {
+        if (text.empty())
+        {
+            string.Count = 0;
+            return true;
+        }
+        auto count = static_cast<uint32_t>(text.size() + 1);
+        if (!ArrayReserve<wchar_t>(string, count, allocator))
+        {
+            return false;
+        }
+        memcpy(string.Data, text.data(), text.size() * sizeof(wchar_t));
+        string.Data[text.size()] = L'\0';
+        string.Count = count;
+        return true;
+    }
+
+    // Append to a string in place, the terminator moves along.
+    template<typename TAllocator>
+    bool StringAppend(FString& string, std::wstring_view text, const TAllocator& allocator)
+    {
+        if (string.Count == 0)
+        {
+            return StringAssign(string, text, allocator);
+        }
+        if (text.empty())
+        {
+            return true;
+        }
+        auto count = static_cast<uint32_t>(string.Count + text.size());
+        if (count > string.Max && !ArrayReserve<wchar_t>(string, ArraySlack(count), allocator))
+        {
+            return false;
+        }
+        memcpy(string.Data + string.Count - 1, text.data(), text.size() * sizeof(wchar_t));
+        string.Data[count - 1] = L'\0';
+        string.Count = count;
+        return true;
+    }
+}
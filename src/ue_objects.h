@@ -0,0 +1,254 @@
+#pragma once
+
+#include <mutex>
+#include <Windows.h>
+#include "utils/hook.h"
+#include "utils/io.h"
+#include "utils/memory.h"
+#include "utils/objindex.h"
+#include "ue_types.h"
+
+
+namespace UE
+{
+    // The engine's object array, found by LocateObjectArray.
+    TArray<UObjectPartial*>* GObjects = nullptr;
+
+    // Whether [pointer, pointer + size) is committed, readable memory.
+    bool IsReadable(const void* pointer, size_t size)
+    {
+        MEMORY_BASIC_INFORMATION mi;
+        if (!VirtualQuery(pointer, &mi, sizeof(mi)) || mi.State != MEM_COMMIT || (mi.Protect & (PAGE_GUARD | PAGE_NOACCESS))
+            || !(mi.Protect & (PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE)))
+        {
+            return false;
+        }
+        auto regionEnd = static_cast<const BYTE*>(mi.BaseAddress) + mi.RegionSize;
+        return static_cast<const BYTE*>(pointer) + size <= regionEnd || IsReadable(regionEnd, static_cast<const BYTE*>(pointer) + size - regionEnd);
+    }
+
+    // Whether function is one of the first slots of an object's vtable, i.e. a virtual method of its class.
+    bool IsVirtualOf(const UObjectPartial* object, const void* function, size_t slots = 256)
+    {
+        const void* const* vtable;
+        memcpy(&vtable, object, sizeof(vtable));
+        for (size_t i = 0; i < slots && IsReadable(vtable + i, sizeof(void*)); i++)
+        {
+            if (vtable[i] == function)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::mutex GProcessEventMtx;
+    bool GProcessEventScanned = false;
+
+    // ProcessEvent is found and hooked once a plugin subscribed to an event (see SubscribeEvent in
+    // SPI) and a function was bound, so games where no plugin subscribes never pay for the scan,
+    // and a game where the pattern found something else only breaks for the plugins which subscribe.
+    // The pattern is a bare prolog, so it must match once only and be a virtual method of UObject
+    // (checked on the first bound object). Pending until the first bind, which calls this again if
+    // there are subscriptions by then. Tried once, a failure isn't retried.
+    ProcessEventHook HookProcessEvent()
+    {
+        const std::lock_guard<std::mutex> lock(GProcessEventMtx);
+        if (ProcessEvent_orig)
+        {
+            return ProcessEventHook::Hooked;
+        }
+        if (GProcessEventScanned && !ProcessEvent)
+        {
+            return ProcessEventHook::Unavailable;
+        }
+        if (!GFirstBoundObject)
+        {
+            return ProcessEventHook::Pending;
+        }
+
+        GProcessEventScanned = true;
+        switch (GLEBinkProxy.Game)
+        {
+        case LEGameVersion::LE1:  ProcessEvent = reinterpret_cast<tProcessEvent>(Utils::ScanProcessUnique(LE1_ProcessEvent_Pattern, LE1_ProcessEvent_Mask));  break;
+        case LEGameVersion::LE2:  ProcessEvent = reinterpret_cast<tProcessEvent>(Utils::ScanProcessUnique(LE2_ProcessEvent_Pattern, LE2_ProcessEvent_Mask));  break;
+        case LEGameVersion::LE3:  ProcessEvent = reinterpret_cast<tProcessEvent>(Utils::ScanProcessUnique(LE3_ProcessEvent_Pattern, LE3_ProcessEvent_Mask));  break;
+        default:                  break;
+        }
+        if (!ProcessEvent)
+        {
+            GLogger.writeln(L"HookProcessEvent: ERROR: failed to find ProcessEvent, event subscriptions are disabled.");
+            return ProcessEventHook::Unavailable;
+        }
+        GLogger.writeln(L"HookProcessEvent: found ProcessEvent at %p.", ProcessEvent);
+
+        if (!IsVirtualOf(GFirstBoundObject, ProcessEvent))
+        {
+            GLogger.writeln(L"HookProcessEvent: ERROR: 0x%p isn't in UObject's vtable, event subscriptions are disabled.", ProcessEvent);
+            ProcessEvent = nullptr;
+            return ProcessEventHook::Unavailable;
+        }
+        if (!GHookManager.Install(ProcessEvent, reinterpret_cast<LPVOID>(&HookedProcessEvent), reinterpret_cast<LPVOID*>(&ProcessEvent_orig), "ProcessEvent"))
+        {
+            GLogger.writeln(L"HookProcessEvent: ERROR: failed to hook ProcessEvent, event subscriptions are disabled.");
+            ProcessEvent = nullptr;
+            return ProcessEventHook::Unavailable;
+        }
+        return ProcessEventHook::Hooked;
+    }
+
+    // Find GObjects through an object we already have: it's a TArray somewhere in the game's
+    // writable sections holding that object at the object's own index. The proxy has no pattern
+    // for GObjects in any of the games, but the Bind hook hands us objects early on.
+    // Any pointer-sized value can look like that by chance, so a candidate must also hold objects
+    // at their own index all over the array (see ObjectPathIndex::ValidateObjectArray).
+    TArray<UObjectPartial*>* LocateObjectArray(UObjectPartial* sample)
+    {
+        auto module = reinterpret_cast<BYTE*>(GetModuleHandleW(nullptr));
+        auto dosHeader = reinterpret_cast<PIMAGE_DOS_HEADER>(module);
+        auto ntHeaders = reinterpret_cast<PIMAGE_NT_HEADERS>(module + dosHeader->e_lfanew);
+        auto section = IMAGE_FIRST_SECTION(ntHeaders);
+        auto sampleIndex = static_cast<DWORD>(sample->ObjectInternalInteger);
+
+        for (WORD i = 0; i < ntHeaders->FileHeader.NumberOfSections; i++, section++)
+        {
+            if (!(section->Characteristics & IMAGE_SCN_MEM_WRITE))
+            {
+                continue;
+            }
+
+            auto start = module + section->VirtualAddress;
+            auto end = start + section->Misc.VirtualSize - sizeof(TArray<UObjectPartial*>);
+            for (auto pointer = start; pointer <= end; pointer += sizeof(void*))
+            {
+                auto candidate = reinterpret_cast<TArray<UObjectPartial*>*>(pointer);
+                if (candidate->Count <= sampleIndex || candidate->Max < candidate->Count || candidate->Count > 0x1000000
+                    || !candidate->Data || (reinterpret_cast<ULONG_PTR>(candidate->Data) & 7) != 0)
+                {
+                    continue;
+                }
+
+                auto slot = candidate->Data + sampleIndex;
+                if (!IsReadable(slot, sizeof(void*)) || *slot != sample)
+                {
+                    continue;
+                }
+                if (Utils::ObjectPathIndex::ValidateObjectArray(reinterpret_cast<const void* const*>(candidate->Data), candidate->Count,
+                    OBJECT_HEADER_SIZE, IsReadable,
+                    [](const void* object) { return static_cast<size_t>(static_cast<const UObjectPartial*>(object)->ObjectInternalInteger); }))
+                {
+                    return candidate;
+                }
+                GLOG_DEBUG(Ue, L"LocateObjectArray: 0x%p holds the sample but isn't an object array", candidate);
+            }
+        }
+        return nullptr;
+    }
+
+
+    // Object lookup by full path for plugins (SPI FindObject), over an index which follows GObjects.
+    // Lookups read GObjects, so they belong on the game thread like any other GObjects walk.
+    class ObjectLookup
+    {
+    private:
+        // A miss only re-sweeps the array this often, plugins probing for absent objects would pay
+        // a full sweep per call otherwise. Objects that took over a collected one's slot may take
+        // this long to be found, appended ones are found right away.
+        static const ULONGLONG MISS_RESWEEP_MS = 1000;
+
+        std::mutex mtx_;
+        Utils::ObjectPathIndex index_;
+        size_t lastCount_ = 0;
+        ULONGLONG lastSweepMs_ = 0;
+        bool located_ = false;
+
+        void update_()
+        {
+            auto count = static_cast<size_t>(GObjects->Count);
+            auto data = GObjects->Data;
+            auto changed = index_.Update(count,
+                [data](size_t i) -> const void* { return data[i]; },
+                [](const void* object) -> const void* { return static_cast<const UObjectPartial*>(object)->Outer; },
+                [](const void* object) { return static_cast<size_t>(static_cast<const UObjectPartial*>(object)->ObjectInternalInteger); },
+                [](const void* object) { return const_cast<UObjectPartial*>(static_cast<const UObjectPartial*>(object))->GetName(); },
+                [](const void* object) { return static_cast<const UObjectPartial*>(object)->GetNameKey(); });
+            lastCount_ = count;
+            lastSweepMs_ = GetTickCount64();
+            GLOG_DEBUG(Ue, L"ObjectLookup: %llu object(s), %llu (re-)indexed", count, changed);
+        }
+
+        UObjectPartial* find_(const wchar_t* path)
+        {
+            // Candidates no longer where they were indexed were collected since, and aren't read.
+            auto count = static_cast<size_t>(GObjects->Count);
+            auto data = GObjects->Data;
+            return static_cast<UObjectPartial*>(const_cast<void*>(index_.Find(path,
+                [count, data](size_t i) -> const void* { return i < count ? data[i] : nullptr; },
+                [](const void* object) -> const void* { return static_cast<const UObjectPartial*>(object)->Outer; },
+                [](const void* object) { return const_cast<UObjectPartial*>(static_cast<const UObjectPartial*>(object))->GetName(); })));
+        }
+
+        bool locate_()
+        {
+            if (!located_)
+            {
+                if (!GFirstBoundObject || !(GObjects = LocateObjectArray(GFirstBoundObject)))
+                {
+                    return false;
+                }
+                located_ = true;
+                GLogger.writeln(L"ObjectLookup: found GObjects at 0x%p (%d objects)", GObjects, GObjects->Count);
+            }
+            return true;
+        }
+
+    public:
+        // Returns false if GObjects isn't known (yet).
+        bool Find(const wchar_t* path, UObjectPartial** outObject)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+
+            if (!locate_())
+            {
+                return false;
+            }
+
+            // Catch up when objects were added, and on a miss in case slots got reused (rate-limited).
+            if (GObjects->Count != lastCount_)
+            {
+                update_();
+            }
+            *outObject = find_(path);
+            if (!*outObject && GetTickCount64() - lastSweepMs_ >= MISS_RESWEEP_MS)
+            {
+                update_();
+                *outObject = find_(path);
+            }
+            return true;
+        }
+
+        // Call visit(UObjectPartial*) for every object named nameKey (FName value), a sweep of
+        // the whole array. Returns false if GObjects isn't known (yet).
+        template<typename TVisit>
+        bool ForEachNamed(uint64_t nameKey, TVisit&& visit)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+
+            if (!locate_())
+            {
+                return false;
+            }
+            for (DWORD i = 0; i < GObjects->Count; i++)
+            {
+                auto object = GObjects->Data[i];
+                if (object && object->GetNameKey() == nameKey)
+                {
+                    visit(object);
+                }
+            }
+            return true;
+        }
+    };
+
+    ObjectLookup GObjectLookup;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "gamever.h"
+
+
+namespace UE
+{
+    // Engine layout of each game, everything engine-facing code needs to know resolved at compile time.
+    // Code touching the engine is templated on these, and the specialization for the detected game
+    // is picked once (see WithGameTraits), so natives the script VM calls and the Bind hook
+    // run without switching on GLEBinkProxy.Game.
+
+    struct LE1Traits
+    {
+        static constexpr LEGameVersion Game = LEGameVersion::LE1;
+        static constexpr size_t FrameCodeOffset = 0x24;      // FFrame::Code
+        static constexpr size_t FunctionFuncOffset = 0xF8;   // UFunction::Func
+        static constexpr bool LegacyGetName = true;          // Names come from GetName, not NewGetName.
+    };
+
+    struct LE2Traits
+    {
+        static constexpr LEGameVersion Game = LEGameVersion::LE2;
+        static constexpr size_t FrameCodeOffset = 0x24;
+        static constexpr size_t FunctionFuncOffset = 0xF0;
+        static constexpr bool LegacyGetName = false;
+    };
+
+    struct LE3Traits
+    {
+        static constexpr LEGameVersion Game = LEGameVersion::LE3;
+        static constexpr size_t FrameCodeOffset = 0x28;
+        static constexpr size_t FunctionFuncOffset = 0xD8;
+        static constexpr bool LegacyGetName = false;
+    };
+
+    // UObject header, the same in all three games.
+    static constexpr size_t OBJECT_INDEX_OFFSET = 0x38;     // Slot in GObjects.
+    static constexpr size_t OBJECT_OUTER_OFFSET = 0x40;
+    static constexpr size_t OBJECT_NAME_OFFSET = 0x48;
+    static constexpr size_t OBJECT_HEADER_SIZE = 0x60;
+
+
+    // Field access for a game, checked against what the engine's layout allows.
+    template<typename TGame>
+    struct GameLayout : TGame
+    {
+        static_assert(TGame::FrameCodeOffset >= 0x20 && TGame::FrameCodeOffset % 4 == 0,
+            "FFrame::Code comes after the FOutputDevice base, Node and Object, 4-packed");
+        static_assert(TGame::FunctionFuncOffset >= OBJECT_HEADER_SIZE && TGame::FunctionFuncOffset % 8 == 0,
+            "UFunction::Func lies past the UObject header and is pointer-aligned");
+
+        static uint8_t*& FrameCode(void* frame) noexcept
+        {
+            return *reinterpret_cast<uint8_t**>(static_cast<uint8_t*>(frame) + TGame::FrameCodeOffset);
+        }
+
+        static void*& FunctionFunc(void* function) noexcept
+        {
+            return *reinterpret_cast<void**>(static_cast<uint8_t*>(function) + TGame::FunctionFuncOffset);
+        }
+    };
+
+
+    // A GNative function which takes no arguments and returns TRUE.
+    template<typename TGame>
+    void AlwaysPositiveNative(void* /* pObject */, void* pFrame, void* pResult)
+    {
+        GameLayout<TGame>::FrameCode(pFrame)++;  // Past EX_EndFunctionParms.
+        *static_cast<long long*>(pResult) = 1;
+    }
+
+    // A GNative function which takes no arguments and returns FALSE.
+    template<typename TGame>
+    void AlwaysNegativeNative(void* /* pObject */, void* pFrame, void* pResult)
+    {
+        GameLayout<TGame>::FrameCode(pFrame)++;
+        *static_cast<long long*>(pResult) = 0;
+    }
+
+
+    // Call func with the traits object of a game, the one place which switches on it.
+    // Returns false for the launcher and unsupported games.
+    template<typename TFunc>
+    bool WithGameTraits(LEGameVersion game, TFunc&& func)
+    {
+        switch (game)
+        {
+        case LEGameVersion::LE1:  func(LE1Traits{});  return true;
+        case LEGameVersion::LE2:  func(LE2Traits{});  return true;
+        case LEGameVersion::LE3:  func(LE3Traits{});  return true;
+        default:                  return false;
+        }
+    }
+}
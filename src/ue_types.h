@@ -1,7 +1,12 @@
 #pragma once
 
 #include "gamever.h"
+#include "ue_containers.h"
+#include "ue_traits.h"
+#include "utils/eventdispatch.h"
 #include "utils/io.h"
+#include "utils/namecache.h"
+#include "utils/nativeregistry.h"
 #include "dllstruct.h"
 
 
@@ -11,23 +16,6 @@
 
 namespace UE
 {
-    // Structure of a generic array used across the engine.
-    #pragma pack(4)
-    template<typename T>
-    struct TArray
-    {
-        T* Data;
-        DWORD Count;
-        DWORD Max;
-    };
-
-    // Structure of a TArray specialization used as a string.
-    struct FString : TArray<wchar_t>
-    {
-        [[nodiscard]] __forceinline wchar_t* GetStr() const noexcept { return Data; }
-    };
-
-
     // A prototype of a function which LE1 uses to decode
     // a char name from a FNameEntry structure.
     typedef void* (__stdcall* tGetName)(void* name, wchar_t* outBuffer);
@@ -51,172 +39,215 @@ namespace UE
     tUFunctionBind UFunctionBind_orig = nullptr;
 
 
-    // A partial representation of a UObject class.
+    // A prototype of UObject::ProcessEvent, which calls a UFunction
+    // with its parameters packed into a structure.
+    typedef void(__thiscall* tProcessEvent)(void* pObject, void* pFunction, void* pParms, void* pResult);
+    tProcessEvent ProcessEvent = nullptr;
+    tProcessEvent ProcessEvent_orig = nullptr;
 
-    struct UObjectPartial
-    {
-        BYTE a[0x48];  // 0x48 seems to be the offset to Name across all three games
-        void* Name;
+    // Whether ProcessEvent is hooked for GEventDispatch, see HookProcessEvent in ue_objects.h.
+    enum class ProcessEventHook { Pending, Hooked, Unavailable };
+    ProcessEventHook HookProcessEvent();
+
+
+    // Name decoding for the detected game, see DecodeName.
+    typedef wchar_t* (*tDecodeName)(void* name);
+    tDecodeName DecodeNameForGame = nullptr;
 
-        // A game-agnostic wrapper around GetName to retrieve object names.
-        wchar_t* GetName()
+    // Names decoded so far, GetName and plugins (through SPI) are served from here.
+    Utils::NameCache GNameCache;
+
+    // Text of an FName (pointer to the 8-byte value), decoded by the game the first time only.
+    // Returns false if it can't be decoded.
+    bool GetCachedName(const void* name, Utils::NameView& outView)
+    {
+        if (!DecodeNameForGame)
         {
-            wchar_t bufferLE1[2048];
-            memset(bufferLE1, 0, 2048);
-            wchar_t bufferLE23[16];
-            memset(bufferLE23, 0, 16);
+            return false;
+        }
+
+        uint64_t key;
+        memcpy(&key, name, sizeof(key));
+        return GNameCache.Get(key, [name](uint64_t) -> const wchar_t* { return DecodeNameForGame(const_cast<void*>(name)); }, outView)
+            || outView.Wide != nullptr;
+    }
 
-            //GLogger.writeln(L"DEBUG DEBUG DEBUG: ATTACH AT %p", &Name);
-            //Sleep(30 * 1000);
 
-            auto nameEntryPtr = &Name;
+    // A partial representation of a UObject class.
 
-            switch (GLEBinkProxy.Game)
+    struct UObjectPartial
+    {
+        BYTE a[0x38];
+        int ObjectInternalInteger;
+        int NetIndex;
+        UObjectPartial* Outer;
+        void* Name;    // 0x48 seems to be the offset to Name across all three games
+
+        // The FName as a value (name table index + instance number), the same value is always the same string.
+        [[nodiscard]] uint64_t GetNameKey() const noexcept
+        {
+            uint64_t key;
+            memcpy(&key, &Name, sizeof(key));
+            return key;
+        }
+
+        // A game-agnostic wrapper around GetName to retrieve object names, cached per name.
+        const wchar_t* GetName()
+        {
+            Utils::NameView view;
+            if (!GetCachedName(&Name, view))
             {
-            case LEGameVersion::LE1:
-                return *(wchar_t**)UE::GetName(nameEntryPtr, bufferLE1);
-            case LEGameVersion::LE2:
-            case LEGameVersion::LE3:
-                UE::NewGetName(nameEntryPtr, bufferLE23);
-                return *(wchar_t**)bufferLE23;
-            default:
                 GLogger.writeln(L"GetObjectName: ERROR: unsupported game version.");
                 return nullptr;
             }
+            return view.Wide;
         }
     };
 
 
-    // A partial representation of a FFrame structure used
-    // across the UScript VM to encapsulate an execution stack frame.
+    static_assert(offsetof(UObjectPartial, ObjectInternalInteger) == OBJECT_INDEX_OFFSET
+        && offsetof(UObjectPartial, Outer) == OBJECT_OUTER_OFFSET && offsetof(UObjectPartial, Name) == OBJECT_NAME_OFFSET);
 
-    #pragma pack(4)
-    struct FFramePartialLE1
-    {
-        BYTE a[0x24];
-        BYTE* Code;
-    };
-    #pragma pack(4)
-    struct FFramePartialLE2
+    // Have the game decode an FName, uncached.
+    template<typename TGame>
+    wchar_t* DecodeName(void* name)
     {
-        BYTE a[0x24];
-        BYTE* Code;
-    };
-    #pragma pack(4)
-    struct FFramePartialLE3
+        if constexpr (TGame::LegacyGetName)
+        {
+            wchar_t buffer[2048];
+            memset(buffer, 0, 2048);
+            return *(wchar_t**)UE::GetName(name, buffer);
+        }
+        else
+        {
+            wchar_t buffer[16];
+            memset(buffer, 0, 16);
+            UE::NewGetName(name, buffer);
+            return *(wchar_t**)buffer;
+        }
+    }
+
+    // Same as UObjectPartial::GetName, without going through DecodeNameForGame.
+    template<typename TGame>
+    const wchar_t* GetObjectName(UObjectPartial* object)
     {
-        BYTE a[0x28];
-        BYTE* Code;
-    };
+        Utils::NameView view{};
+        GNameCache.Get(object->GetNameKey(), [object](uint64_t) { return DecodeName<TGame>(&object->Name); }, view);
+        return view.Wide;
+    }
 
 
-    // A partial representation of a UFunction class.
-    // TODO: once I have SDKs built, use complete definitions for UObject -> UField -> UStruct -> UFunction.
+    // Replacement natives applied by HookedUFunctionBind, the proxy's own and the ones plugins
+    // register through SPI. Bind runs for every UFunction during boot, so they are found by FName value.
+    Utils::NativeOverrideRegistry GNativeOverrides;
 
-    struct UFunctionPartialLE1
-    {
-        BYTE a[0xF8];
-        void* Func;
-    };
-    struct UFunctionPartialLE2
-    {
-        BYTE a[0xF0];
-        void* Func;
-    };
-    struct UFunctionPartialLE3
-    {
-        BYTE a[0xD8];
-        void* Func;
-    };
+    // Plugins' ProcessEvent subscriptions (through SPI), dispatched by HookedProcessEvent.
+    Utils::EventDispatchTable GEventDispatch;
 
+    // The first function bound, used to find GObjects (see ue_objects.h).
+    UObjectPartial* GFirstBoundObject = nullptr;
 
-    // A GNative function which takes no arguments and returns TRUE.
-    void AlwaysPositiveNative(UObjectPartial* pObject, void* pFrame, void* pResult)
+    // A hooked wrapper around UFunction::Bind which calls the original and then points
+    // the function at its override, if there is one (IsShippingPCBuild etc., see InstallGameSpecialization).
+    template<typename TGame>
+    void HookedUFunctionBind(UObjectPartial* pFunction)
     {
-        //GLogger.writeln(L"UE::AlwaysPositiveNative: called for %s.", pObject->GetName());
+        UFunctionBind_orig(pFunction);
 
-        switch (GLEBinkProxy.Game)
+        if (!GFirstBoundObject)
         {
-        case LEGameVersion::LE1:
-            ((FFramePartialLE1*)(pFrame))->Code++;
-            *(long long*)pResult = TRUE;
-            break;
-        case LEGameVersion::LE2:
-            ((FFramePartialLE2*)(pFrame))->Code++;
-            *(long long*)pResult = TRUE;
-            break;
-        case LEGameVersion::LE3:
-            ((FFramePartialLE3*)(pFrame))->Code++;
-            *(long long*)pResult = TRUE;
-            break;
-        default:
-            GLogger.writeln(L"UE::AlwaysPositiveNative: ERROR: unsupported game version.");
-            break;
+            GFirstBoundObject = pFunction;
+
+            // Subscriptions made before anything was bound waited for this to hook ProcessEvent.
+            if (GEventDispatch.SubscriptionCount() != 0)
+            {
+                HookProcessEvent();
+            }
+        }
+
+        GLOG_TRACE(Ue, L"UFunctionBind: %s (pFunction = 0x%p).", GetObjectName<TGame>(pFunction), pFunction);
+
+        GEventDispatch.OnBind(pFunction, pFunction->GetNameKey());
+
+        auto native = GNativeOverrides.Apply(pFunction->GetNameKey(),
+            [pFunction](uint64_t) { return GetObjectName<TGame>(pFunction); },
+            [pFunction]() { return pFunction->Outer ? GetObjectName<TGame>(pFunction->Outer) : nullptr; },
+            &GameLayout<TGame>::FunctionFunc(pFunction));
+        if (native)
+        {
+            GLOG_DEBUG(Ue, L"UFunctionBind: %s (pFunction = 0x%p) => 0x%p.", GetObjectName<TGame>(pFunction), pFunction, native);
         }
     }
 
-    // A GNative function which takes no arguments and returns FALSE.
-    void AlwaysNegativeNative(UObjectPartial* pObject, void* pFrame, void* pResult)
+    // A hooked wrapper around ProcessEvent, shared by every plugin which subscribed to calls of
+    // a function: calls nobody subscribed to cost one probe of GEventDispatch before the original.
+    // A pre-call handler returning true skips the original (post-call handlers still run).
+    // Handlers run inside a Reader, but the original doesn't (it nests and can take long), so
+    // post-call handlers are looked up again after it.
+    void HookedProcessEvent(UObjectPartial* pObject, UObjectPartial* pFunction, void* pParms, void* pResult)
     {
-        //GLogger.writeln(L"UE::AlwaysNegativeNative: called for %s.", pObject->GetName());
+        if (!GEventDispatch.Find(pFunction))
+        {
+            ProcessEvent_orig(pObject, pFunction, pParms, pResult);
+            return;
+        }
+
+        typedef bool(__cdecl* tHandler)(void* pObject, void* pFunction, void* pParms, void* pResult, void* pContext);
 
-        switch (GLEBinkProxy.Game)
+        bool skip = false;
         {
-        case LEGameVersion::LE1:
-            ((FFramePartialLE1*)(pFrame))->Code++;
-            *(long long*)pResult = FALSE;
-            break;
-        case LEGameVersion::LE2:
-            ((FFramePartialLE2*)(pFrame))->Code++;
-            *(long long*)pResult = FALSE;
-            break;
-        case LEGameVersion::LE3:
-            ((FFramePartialLE3*)(pFrame))->Code++;
-            *(long long*)pResult = FALSE;
-            break;
-        default:
-            GLogger.writeln(L"UE::AlwaysNegativeNative: ERROR: unsupported game version.");
-            break;
+            const Utils::EventDispatchTable::Reader reader(GEventDispatch);
+            if (auto handlers = GEventDispatch.Find(pFunction))
+            {
+                for (const auto& handler : handlers->Pre)
+                {
+                    skip |= reinterpret_cast<tHandler>(handler.Proc)(pObject, pFunction, pParms, pResult, handler.Context);
+                }
+            }
+        }
+        if (!skip)
+        {
+            ProcessEvent_orig(pObject, pFunction, pParms, pResult);
+        }
+
+        const Utils::EventDispatchTable::Reader reader(GEventDispatch);
+        if (auto handlers = GEventDispatch.Find(pFunction))
+        {
+            for (const auto& handler : handlers->Post)
+            {
+                reinterpret_cast<tHandler>(handler.Proc)(pObject, pFunction, pParms, pResult, handler.Context);
+            }
         }
     }
 
+    // The Bind hook for the detected game, set by InstallGameSpecialization.
+    void* HookedUFunctionBindForGame = nullptr;
 
-    // A hooked wrapper around UFunction::Bind which calls the original and then
-    // binds IsShippingPCBuild and IsFinalReleaseDebugConsoleBuild to AlwaysPositiveNative.
-    void HookedUFunctionBind(UObjectPartial* pFunction)
+    // Pick the code for the detected game once and register the proxy's own overrides.
+    bool InstallGameSpecialization()
     {
-        UFunctionBind_orig(pFunction);
+        auto supported = WithGameTraits(GLEBinkProxy.Game, [](auto traits)
+        {
+            using TGame = decltype(traits);
 
-        auto name = pFunction->GetName();
+            DecodeNameForGame = DecodeName<TGame>;
+            HookedUFunctionBindForGame = reinterpret_cast<void*>(&HookedUFunctionBind<TGame>);
 
-        if (0 == wcscmp(name, L"IsShippingPCBuild") || 0 == wcscmp(name, L"IsShippingBuild")
-            || 0 == wcscmp(name, L"IsFinalReleaseDebugConsoleBuild"))
-        {
-            switch (GLEBinkProxy.Game)
+            GNativeOverrides.Register(L"IsShippingPCBuild", reinterpret_cast<void*>(&AlwaysPositiveNative<TGame>), nullptr);
+            GNativeOverrides.Register(L"IsShippingBuild", reinterpret_cast<void*>(&AlwaysPositiveNative<TGame>), nullptr);
+            GNativeOverrides.Register(L"IsFinalReleaseDebugConsoleBuild", reinterpret_cast<void*>(&AlwaysPositiveNative<TGame>), nullptr);
+
+            // Thanks to Mgamerz's research into why LE3 profiles disappeared:
+            if constexpr (TGame::Game == LEGameVersion::LE3)
             {
-            case LEGameVersion::LE1:
-                GLogger.writeln(L"UFunctionBind (LE1): %s (pFunction = 0x%p).", name, pFunction);
-                ((UFunctionPartialLE1*)pFunction)->Func = AlwaysPositiveNative;
-                break;
-            case LEGameVersion::LE2:
-                GLogger.writeln(L"UFunctionBind (LE2): %s (pFunction = 0x%p).", name, pFunction);
-                ((UFunctionPartialLE2*)pFunction)->Func = AlwaysPositiveNative;
-                break;
-            case LEGameVersion::LE3:
-                GLogger.writeln(L"UFunctionBind (LE3): %s (pFunction = 0x%p).", name, pFunction);
-                ((UFunctionPartialLE3*)pFunction)->Func = AlwaysPositiveNative;
-                break;
-            default:
-                GLogger.writeln(L"HookedUFunctionBind: ERROR: unsupported game version.");
-                break;
+                GNativeOverrides.Register(L"IsShip", reinterpret_cast<void*>(&AlwaysNegativeNative<TGame>), nullptr);
             }
-        }
+        });
 
-        // Thanks to Mgamerz's research into why LE3 profiles disappeared:
-        if (0 == wcscmp(name, L"IsShip") && GLEBinkProxy.Game == LEGameVersion::LE3)
+        if (!supported)
         {
-            GLogger.writeln(L"UFunctionBind (LE3): %s (pFunction = 0x%p).", name, pFunction);
-            ((UFunctionPartialLE3*)pFunction)->Func = AlwaysNegativeNative;
+            GLogger.writeln(L"InstallGameSpecialization: ERROR: unsupported game version.");
         }
+        return supported;
     }
 }
@@ -0,0 +1,388 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace Utils
+{
+    /// <summary>
+    /// Bump allocator for short-lived memory: allocation is a pointer increment, nothing is freed
+    /// on its own and Reset drops everything at once. Chunks are kept across resets, so a thread
+    /// which needs about the same amount every frame stops touching the heap after the first one.
+    /// Single-threaded, see FrameArenas for the per-thread wrapper.
+    /// </summary>
+    class ScratchArena
+    {
+    public:
+        static const size_t CHUNK_SIZE = 64 * 1024;
+
+    private:
+        struct Chunk
+        {
+            std::unique_ptr<uint8_t[]> Memory;
+            size_t Size;
+        };
+
+        std::vector<Chunk> chunks_;           // Reused across resets.
+        std::vector<std::unique_ptr<uint8_t[]>> oversized_;  // Freed on reset.
+        size_t current_ = 0;
+        size_t used_ = 0;
+        size_t bytes_ = 0;
+
+        static uint8_t* align_(uint8_t* pointer, size_t alignment) noexcept
+        {
+            auto address = reinterpret_cast<uintptr_t>(pointer);
+            return reinterpret_cast<uint8_t*>((address + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+        }
+
+    public:
+        // alignment must be a power of two, returns nullptr otherwise or if the heap is out of memory.
+        void* Allocate(size_t size, size_t alignment = 16)
+        {
+            if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+            {
+                return nullptr;
+            }
+
+            // Large blocks get a block of their own instead of wasting most of a chunk.
+            if (alignment > CHUNK_SIZE / 4 || size > CHUNK_SIZE / 4 - alignment)
+            {
+                if (size > SIZE_MAX - alignment)
+                {
+                    return nullptr;
+                }
+                oversized_.emplace_back(new (std::nothrow) uint8_t[size + alignment]);
+                if (!oversized_.back())
+                {
+                    oversized_.pop_back();
+                    return nullptr;
+                }
+                bytes_ += size;
+                return align_(oversized_.back().get(), alignment);
+            }
+
+            while (current_ < chunks_.size())
+            {
+                auto& chunk = chunks_[current_];
+                auto memory = align_(chunk.Memory.get() + used_, alignment);
+                if (memory + size <= chunk.Memory.get() + chunk.Size)
+                {
+                    used_ = static_cast<size_t>(memory + size - chunk.Memory.get());
+                    bytes_ += size;
+                    return memory;
+                }
+                current_++;
+                used_ = 0;
+            }
+
+            chunks_.push_back(Chunk{ std::unique_ptr<uint8_t[]>(new (std::nothrow) uint8_t[CHUNK_SIZE]), CHUNK_SIZE });
+            if (!chunks_.back().Memory)
+            {
+                chunks_.pop_back();
+                return nullptr;
+            }
+            current_ = chunks_.size() - 1;
+            used_ = 0;
+            return Allocate(size, alignment);
+        }
+
+        void Reset() noexcept
+        {
+            oversized_.clear();
+            current_ = 0;
+            used_ = 0;
+            bytes_ = 0;
+        }
+
+        // Allocated since the last reset.
+        [[nodiscard]] size_t Bytes() const noexcept { return bytes_; }
+        [[nodiscard]] size_t Capacity() const noexcept { return chunks_.size() * CHUNK_SIZE; }
+    };
+
+
+    /// <summary>
+    /// One ScratchArena per thread. The thread which ends frames (AdvanceFrame) has its arena reset
+    /// at each frame boundary: AdvanceFrame only bumps a counter, the arena resets itself on its next
+    /// allocation after that, so no thread ever touches another thread's arena. Other threads don't
+    /// follow the game's frames, which would reuse a worker's memory in the middle of its work;
+    /// their scratch lasts until they call ResetThread.
+    /// </summary>
+    class FrameArenas
+    {
+    private:
+        std::atomic<uint64_t> frame_{ 0 };
+
+        struct Local
+        {
+            ScratchArena Arena;
+            uint64_t Frame = 0;
+            bool FollowsFrames = false;
+        };
+
+        static Local& local_() noexcept
+        {
+            thread_local Local local;
+            return local;
+        }
+
+    public:
+        // Valid until ResetThread, or on the thread which ends frames until the next frame boundary.
+        void* Allocate(size_t size, size_t alignment = 16)
+        {
+            auto& local = local_();
+            if (local.FollowsFrames)
+            {
+                auto frame = frame_.load(std::memory_order_relaxed);
+                if (local.Frame != frame)
+                {
+                    local.Arena.Reset();
+                    local.Frame = frame;
+                }
+            }
+            return local.Arena.Allocate(size, alignment);
+        }
+
+        // For threads without frames (workers), drop this thread's scratch memory now.
+        void ResetThread() noexcept
+        {
+            local_().Arena.Reset();
+        }
+
+        // At the end of a frame, on the thread which runs them.
+        void AdvanceFrame() noexcept
+        {
+            local_().FollowsFrames = true;
+            frame_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] uint64_t Frame() const noexcept { return frame_.load(std::memory_order_relaxed); }
+    };
+
+
+    // Classes of SizeClassPools: 16, 32, 48, 64, then 96, 128, 192, 256 ... 2048 (two steps per power of two).
+    static constexpr size_t POOL_CLASS_COUNT = 14;
+    static constexpr size_t POOL_CLASS_SIZES[POOL_CLASS_COUNT] = { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048 };
+
+    // Class by size in 16-byte steps, so finding it is a table lookup.
+    struct PoolClassTable
+    {
+        uint8_t Classes[2048 / 16 + 1] = {};
+
+        constexpr PoolClassTable()
+        {
+            size_t c = 0;
+            for (size_t step = 0; step <= 2048 / 16; step++)
+            {
+                while (POOL_CLASS_SIZES[c] < step * 16) c++;
+                Classes[step] = static_cast<uint8_t>(c);
+            }
+        }
+    };
+    static constexpr PoolClassTable POOL_CLASS_TABLE{};
+
+
+    /// <summary>
+    /// Size-class pools for long-lived small objects, 16 bytes up to 2 KB. Each thread keeps its own
+    /// free lists and trades blocks with a shared depot in batches, so the depot's lock is taken
+    /// once per BATCH allocations or frees rather than every time. Blocks come from slabs which are
+    /// never returned to the heap, which keeps same-sized objects together instead of fragmenting it.
+    /// Larger requests go to malloc. Blocks may be freed on any thread.
+    /// The threads' lists are thread_local, so there must be only one instance (GPools).
+    /// </summary>
+    class SizeClassPools
+    {
+    public:
+        static const size_t MAX_POOLED = 2048;
+        static const size_t HEADER = 16;         // Keeps blocks 16-aligned, holds the class.
+        static const size_t BATCH = 32;
+        static const size_t SLAB_SIZE = 64 * 1024;
+
+        static_assert(MAX_POOLED == POOL_CLASS_SIZES[POOL_CLASS_COUNT - 1], "the largest class is the pooling limit");
+
+    private:
+        static const uint32_t HEAP_CLASS = ~0u;
+        static const size_t CLASS_COUNT = POOL_CLASS_COUNT;
+
+        struct FreeBlock
+        {
+            FreeBlock* Next;
+        };
+
+        struct Depot
+        {
+            std::mutex Mtx;
+            std::vector<FreeBlock*> Batches;   // Each a list of up to BATCH blocks.
+        };
+
+        static constexpr const size_t* CLASS_SIZES = POOL_CLASS_SIZES;
+
+        Depot depots_[CLASS_COUNT];
+        std::mutex slabMtx_;
+        std::vector<std::unique_ptr<uint8_t[]>> slabs_;
+        std::atomic<size_t> slabBytes_{ 0 };
+        std::atomic<size_t> heapBlocks_{ 0 };
+
+        struct LocalList
+        {
+            FreeBlock* Head = nullptr;
+            size_t Count = 0;
+        };
+
+        struct Local
+        {
+            SizeClassPools* Owner = nullptr;
+            LocalList Lists[CLASS_COUNT];
+
+            ~Local()
+            {
+                // Give the blocks back so other threads can use them.
+                for (size_t c = 0; Owner && c < CLASS_COUNT; c++)
+                {
+                    while (Lists[c].Head)
+                    {
+                        Owner->flush_(c, Lists[c]);
+                    }
+                }
+            }
+        };
+
+        static size_t classOf_(size_t size) noexcept
+        {
+            return size <= MAX_POOLED ? POOL_CLASS_TABLE.Classes[(size + 15) / 16] : CLASS_COUNT;
+        }
+
+        Local& local_() noexcept
+        {
+            thread_local Local local;
+            local.Owner = this;
+            return local;
+        }
+
+        // Move up to BATCH blocks from a thread's list to the depot.
+        void flush_(size_t c, LocalList& list)
+        {
+            FreeBlock* batch = nullptr;
+            for (size_t i = 0; i < BATCH && list.Head; i++)
+            {
+                auto block = list.Head;
+                list.Head = block->Next;
+                list.Count--;
+                block->Next = batch;
+                batch = block;
+            }
+            const std::lock_guard<std::mutex> lock(depots_[c].Mtx);
+            depots_[c].Batches.push_back(batch);
+        }
+
+        // Fill an empty thread list from the depot, or from a new slab.
+        bool refill_(size_t c, LocalList& list)
+        {
+            {
+                const std::lock_guard<std::mutex> lock(depots_[c].Mtx);
+                if (!depots_[c].Batches.empty())
+                {
+                    list.Head = depots_[c].Batches.back();
+                    depots_[c].Batches.pop_back();
+                    list.Count = 0;
+                    for (auto block = list.Head; block; block = block->Next) list.Count++;
+                    return true;
+                }
+            }
+
+            auto stride = HEADER + CLASS_SIZES[c];
+            auto slab = std::unique_ptr<uint8_t[]>(new (std::nothrow) uint8_t[SLAB_SIZE + 16]);
+            if (!slab)
+            {
+                return false;
+            }
+            auto base = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(slab.get()) + 15) & ~static_cast<uintptr_t>(15));
+            for (size_t offset = 0; offset + stride <= SLAB_SIZE; offset += stride)
+            {
+                *reinterpret_cast<uint32_t*>(base + offset) = static_cast<uint32_t>(c);
+                auto block = reinterpret_cast<FreeBlock*>(base + offset + HEADER);
+                block->Next = list.Head;
+                list.Head = block;
+                list.Count++;
+            }
+
+            const std::lock_guard<std::mutex> lock(slabMtx_);
+            slabs_.push_back(std::move(slab));
+            slabBytes_.fetch_add(SLAB_SIZE + 16, std::memory_order_relaxed);
+            return true;
+        }
+
+    public:
+        void* Allocate(size_t size)
+        {
+            auto c = classOf_(size);
+            if (c == CLASS_COUNT)
+            {
+                auto memory = static_cast<uint8_t*>(malloc(HEADER + size));
+                if (!memory)
+                {
+                    return nullptr;
+                }
+                *reinterpret_cast<uint32_t*>(memory) = HEAP_CLASS;
+                heapBlocks_.fetch_add(1, std::memory_order_relaxed);
+                return memory + HEADER;
+            }
+
+            auto& list = local_().Lists[c];
+            if (!list.Head && !refill_(c, list))
+            {
+                return nullptr;
+            }
+            auto block = list.Head;
+            list.Head = block->Next;
+            list.Count--;
+            return block;
+        }
+
+        void Free(void* memory)
+        {
+            if (!memory)
+            {
+                return;
+            }
+
+            auto header = static_cast<uint8_t*>(memory) - HEADER;
+            auto c = *reinterpret_cast<uint32_t*>(header);
+            if (c == HEAP_CLASS)
+            {
+                heapBlocks_.fetch_sub(1, std::memory_order_relaxed);
+                free(header);
+                return;
+            }
+
+            auto& list = local_().Lists[c];
+            auto block = static_cast<FreeBlock*>(memory);
+            block->Next = list.Head;
+            list.Head = block;
+            if (++list.Count >= 2 * BATCH)
+            {
+                flush_(c, list);
+            }
+        }
+
+        // Usable size of a block from Allocate.
+        [[nodiscard]] static size_t ClassSize(size_t size) noexcept
+        {
+            auto c = classOf_(size);
+            return c == CLASS_COUNT ? size : CLASS_SIZES[c];
+        }
+
+        [[nodiscard]] size_t SlabBytes() const noexcept { return slabBytes_.load(std::memory_order_relaxed); }
+        [[nodiscard]] size_t HeapBlocks() const noexcept { return heapBlocks_.load(std::memory_order_relaxed); }
+    };
+
+
+    // Served to plugins through SPI (AllocScratch, AllocPooled), the proxy ends frames on GScratch.
+    FrameArenas GScratch;
+    SizeClassPools GPools;
+}
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+namespace Utils
+{
+    /// <summary>
+    /// Latency histogram in microseconds with four buckets per power of two, so any recorded value
+    /// is known to within 25%: 0-3 us get a bucket each, then [4, 5), [5, 6), [6, 7), [7, 8), [8, 10)...
+    /// up to about 4 seconds, anything longer lands in the last bucket. Min, max and the sum are exact.
+    /// </summary>
+    class LatencyHistogram
+    {
+    public:
+        static const size_t SUB_BUCKETS = 4;
+        static const size_t MAX_OCTAVE = 21;        // [2^21, 2^22) us is the last regular octave.
+        static const size_t BUCKETS = SUB_BUCKETS * MAX_OCTAVE + 1;  // The last one holds everything longer.
+
+    private:
+        uint64_t counts_[BUCKETS] = {};
+        uint64_t total_ = 0;
+        int64_t sumUs_ = 0;
+        int64_t minUs_ = 0;
+        int64_t maxUs_ = 0;
+
+    public:
+        static size_t BucketOf(int64_t us) noexcept
+        {
+            if (us < static_cast<int64_t>(SUB_BUCKETS))
+            {
+                return us > 0 ? static_cast<size_t>(us) : 0;
+            }
+
+            size_t octave = 63;
+            while ((static_cast<uint64_t>(us) >> octave) == 0) octave--;
+            if (octave > MAX_OCTAVE)
+            {
+                return BUCKETS - 1;
+            }
+            auto sub = static_cast<size_t>(us >> (octave - 2)) & (SUB_BUCKETS - 1);
+            return SUB_BUCKETS * (octave - 1) + sub;
+        }
+
+        // First value past the bucket, what a percentile reports (it's at most this).
+        static int64_t BucketLimit(size_t bucket) noexcept
+        {
+            if (bucket < SUB_BUCKETS)
+            {
+                return static_cast<int64_t>(bucket) + 1;
+            }
+            if (bucket >= BUCKETS - 1)
+            {
+                return INT64_MAX;
+            }
+            auto octave = bucket / SUB_BUCKETS + 1;
+            auto sub = bucket % SUB_BUCKETS;
+            return static_cast<int64_t>((SUB_BUCKETS + sub + 1) << (octave - 2));
+        }
+
+        void Add(int64_t us) noexcept
+        {
+            us = us > 0 ? us : 0;
+            counts_[BucketOf(us)]++;
+            minUs_ = total_ == 0 || us < minUs_ ? us : minUs_;
+            maxUs_ = us > maxUs_ ? us : maxUs_;
+            sumUs_ += us;
+            total_++;
+        }
+
+        // Upper bound of the p-th percentile (0 < p <= 100), capped by the exact maximum; 0 if empty.
+        [[nodiscard]] int64_t PercentileUs(double p) const noexcept
+        {
+            if (total_ == 0)
+            {
+                return 0;
+            }
+
+            auto rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total_) + 0.5);
+            rank = rank < 1 ? 1 : rank > total_ ? total_ : rank;
+            uint64_t seen = 0;
+            for (size_t bucket = 0; bucket < BUCKETS; bucket++)
+            {
+                seen += counts_[bucket];
+                if (seen >= rank)
+                {
+                    auto limit = BucketLimit(bucket) - 1;
+                    return limit < maxUs_ ? limit : maxUs_;
+                }
+            }
+            return maxUs_;
+        }
+
+        void Merge(const LatencyHistogram& other) noexcept
+        {
+            if (other.total_ == 0)
+            {
+                return;
+            }
+            for (size_t bucket = 0; bucket < BUCKETS; bucket++)
+            {
+                counts_[bucket] += other.counts_[bucket];
+            }
+            minUs_ = total_ == 0 || other.minUs_ < minUs_ ? other.minUs_ : minUs_;
+            maxUs_ = other.maxUs_ > maxUs_ ? other.maxUs_ : maxUs_;
+            sumUs_ += other.sumUs_;
+            total_ += other.total_;
+        }
+
+        [[nodiscard]] uint64_t Count() const noexcept { return total_; }
+        [[nodiscard]] uint64_t CountIn(size_t bucket) const noexcept { return bucket < BUCKETS ? counts_[bucket] : 0; }
+        [[nodiscard]] int64_t MinUs() const noexcept { return minUs_; }
+        [[nodiscard]] int64_t MaxUs() const noexcept { return maxUs_; }
+        [[nodiscard]] int64_t MeanUs() const noexcept { return total_ ? sumUs_ / static_cast<int64_t>(total_) : 0; }
+    };
+
+
+    /// <summary>
+    /// Per-movie playback counters, keyed by the movie's handle (HBINK) from open to close, fed by the
+    /// Bink export thunks: decoded frames and how long each decode took (BinkDoFrame, or BinkDoFrameAsync
+    /// until the BinkDoFrameAsyncWait which reports it done), frames the game was told to skip
+    /// (BinkShouldSkip) and frames advanced (BinkNextFrame). A handle the table never saw opened
+    /// gets an unnamed entry on its first frame.
+    /// Nothing is recorded while disabled, the thunks check Enabled before anything else.
+    /// </summary>
+    class BinkStats
+    {
+    public:
+        struct Movie
+        {
+            uint32_t Serial;            // Order of opening, from 1.
+            std::string Name;           // Empty if opened from memory or a file handle.
+            uint64_t Decoded = 0;
+            uint64_t Skipped = 0;
+            uint64_t Advanced = 0;
+            LatencyHistogram Decode;
+            int64_t AsyncStartUs = -1;  // A BinkDoFrameAsync in flight, -1 for none.
+        };
+
+    private:
+        std::atomic<bool> enabled_{ false };
+        std::mutex mtx_;
+        std::unordered_map<const void*, Movie> movies_;
+        LatencyHistogram closedDecode_;  // Every closed movie, merged.
+        uint64_t closedMovies_ = 0;
+        uint32_t nextSerial_ = 1;
+
+        // mtx_ held.
+        Movie& movie_(const void* handle)
+        {
+            auto it = movies_.find(handle);
+            if (it == movies_.end())
+            {
+                it = movies_.emplace(handle, Movie{}).first;
+                it->second.Serial = nextSerial_++;
+            }
+            return it->second;
+        }
+
+    public:
+        void Enable(bool enabled) noexcept { enabled_.store(enabled, std::memory_order_relaxed); }
+        [[nodiscard]] bool Enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+        void OnOpen(const void* handle, const char* name)
+        {
+            if (!handle)
+            {
+                return;
+            }
+            const std::lock_guard<std::mutex> lock(mtx_);
+            movies_.erase(handle);   // A handle reused without a close we saw.
+            movie_(handle).Name = name ? name : "";
+        }
+
+        // Hands the movie's final counters to report(const Movie&), then forgets the handle.
+        template<typename TReport>
+        void OnClose(const void* handle, TReport&& report)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            auto it = movies_.find(handle);
+            if (it == movies_.end())
+            {
+                return;
+            }
+            report(static_cast<const Movie&>(it->second));
+            closedDecode_.Merge(it->second.Decode);
+            closedMovies_++;
+            movies_.erase(it);
+        }
+
+        void OnDecoded(const void* handle, int64_t us)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            auto& movie = movie_(handle);
+            movie.Decoded++;
+            movie.Decode.Add(us);
+        }
+
+        void OnAsyncStarted(const void* handle, int64_t nowUs)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            movie_(handle).AsyncStartUs = nowUs;
+        }
+
+        // After a BinkDoFrameAsyncWait, done when it returned non-zero.
+        void OnAsyncWaited(const void* handle, bool done, int64_t nowUs)
+        {
+            if (!done)
+            {
+                return;
+            }
+            const std::lock_guard<std::mutex> lock(mtx_);
+            auto& movie = movie_(handle);
+            if (movie.AsyncStartUs >= 0)
+            {
+                movie.Decoded++;
+                movie.Decode.Add(nowUs - movie.AsyncStartUs);
+                movie.AsyncStartUs = -1;
+            }
+        }
+
+        void OnSkipped(const void* handle)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            movie_(handle).Skipped++;
+        }
+
+        void OnAdvanced(const void* handle)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            movie_(handle).Advanced++;
+        }
+
+        // Copy of an open movie's counters, false if the handle isn't known.
+        bool Get(const void* handle, Movie& outMovie)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            auto it = movies_.find(handle);
+            if (it == movies_.end())
+            {
+                return false;
+            }
+            outMovie = it->second;
+            return true;
+        }
+
+        // Decode latency over every movie closed so far.
+        LatencyHistogram Closed(uint64_t* outMovies = nullptr)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            if (outMovies)
+            {
+                *outMovies = closedMovies_;
+            }
+            return closedDecode_;
+        }
+
+        [[nodiscard]] size_t OpenCount()
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            return movies_.size();
+        }
+    };
+
+
+    // Fed by the Bink export thunks (binkthunks.h), enabled with -binkstats.
+    BinkStats GBinkStats;
+}
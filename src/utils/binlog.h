@@ -0,0 +1,724 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <cwchar>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+#include "../utils/logring.h"
+#include "../utils/tickclock.h"
+
+
+/// Log a line through the binary log if it is enabled (-binarylog), or as text otherwise.
+/// FMT must be a wide string literal, it is hashed into the call site's ID at compile time
+/// and registered with the log once. Only the ID, a tick and the raw arguments are recorded per call,
+/// LogDecoder turns the file back into text. A site whose ID is taken by another format logs as text.
+/// The arguments may be left out: ", ##__VA_ARGS__" drops the comma without them, which MSVC (either
+/// preprocessor), GCC and Clang all support in C++17.
+#define GLOG_FAST(FMT, ...) \
+do { \
+    constexpr uint32_t logSiteId_ = Utils::BinaryLog::MakeId(FMT); \
+    bool logSiteBinary_ = false; \
+    if (GLogger.Binary.Enabled()) \
+    { \
+        static const bool logSiteRegistered_ = GLogger.RegisterFastSite(logSiteId_, FMT); \
+        logSiteBinary_ = logSiteRegistered_; \
+    } \
+    if (logSiteBinary_) \
+    { \
+        GLogger.Binary.Write(logSiteId_, ##__VA_ARGS__); \
+    } \
+    else \
+    { \
+        GLogger.writeln(FMT, ##__VA_ARGS__); \
+    } \
+} while (0)
+
+
+namespace Utils
+{
+    /// Binary log file format (little endian), shared with LogDecoder:
+    ///   header:   char[8] "LEBPBIN1", u64 ticks per second, u64 origin tick, u64 origin local FILETIME
+    ///   records:  u8 kind, then (an event may come before the format of its ID)
+    ///     BLK_FORMAT:   u32 id, u16 length, u16[length] UTF-16 format string
+    ///     BLK_EVENT:    u32 id, u64 tick, u16 payload size, payload (tagged arguments, see BinLogArg)
+    ///     BLK_DROPPED:  u64 number of events lost because the ring was full
+    /// Strings are UTF-16 whatever the size of wchar_t, code points outside the BMP become '?'
+    /// where wchar_t is 32 bits.
+    enum BinLogKind : uint8_t
+    {
+        BLK_FORMAT = 1,
+        BLK_EVENT = 2,
+        BLK_DROPPED = 3,
+    };
+
+    enum BinLogArg : uint8_t
+    {
+        BLA_INT = 1,      // i64
+        BLA_UINT = 2,     // u64
+        BLA_DOUBLE = 3,   // f64
+        BLA_POINTER = 4,  // u64
+        BLA_WSTR = 5,     // u16 length, u16[length]
+        BLA_STR = 6,      // u16 length, u8[length]
+    };
+
+    struct BinLogRecord
+    {
+        static const size_t MAX_PAYLOAD = 232;
+
+        uint32_t Id;
+        uint16_t Size;
+        int64_t Tick;
+        uint8_t Payload[MAX_PAYLOAD];
+    };
+
+    // Narrow wide text to the UTF-16 units the file holds.
+    inline uint16_t ToUtf16Unit(wchar_t c)
+    {
+        return static_cast<uint32_t>(c) > 0xFFFF ? static_cast<uint16_t>(u'?') : static_cast<uint16_t>(c);
+    }
+
+    class BinaryLog
+    {
+    private:
+        static const size_t RING_CAPACITY = 4096;  // Records, ~1 MB.
+
+        MpscRing<BinLogRecord, RING_CAPACITY> ring_;
+        std::atomic<bool> enabled_{ false };
+        std::atomic<size_t> droppedCount_{ 0 };
+        FILE* file_ = nullptr;
+#ifdef _WIN32
+        HANDLE wakeEvent_ = nullptr;               // Writer's event, set when the ring fills up.
+#endif
+
+        std::mutex formatsMtx_;                    // Registration happens once per call site.
+        std::unordered_map<uint32_t, const wchar_t*> formats_;
+        std::vector<std::pair<uint32_t, const wchar_t*>> pendingFormats_;
+
+        // Argument encoding.
+
+        static bool put_(BinLogRecord& record, const void* data, size_t size)
+        {
+            if (record.Size + size > BinLogRecord::MAX_PAYLOAD)
+            {
+                return false;
+            }
+            memcpy(record.Payload + record.Size, data, size);
+            record.Size += static_cast<uint16_t>(size);
+            return true;
+        }
+
+        static void writeUtf16_(FILE* file, const wchar_t* text, size_t length)
+        {
+            if constexpr (sizeof(wchar_t) == 2)
+            {
+                fwrite(text, 2, length, file);
+            }
+            else
+            {
+                for (size_t i = 0; i < length; i++)
+                {
+                    auto unit = ToUtf16Unit(text[i]);
+                    fwrite(&unit, 2, 1, file);
+                }
+            }
+        }
+
+        template<typename TChar>
+        static void putString_(BinLogRecord& record, BinLogArg tag, const TChar* value)
+        {
+            if (!value)
+            {
+                if constexpr (sizeof(TChar) == 1) value = "(null)";
+                else value = L"(null)";
+            }
+
+            // Truncate to what is left of the payload.
+            const size_t unitSize = sizeof(TChar) == 1 ? 1 : 2;
+            size_t length = 0;
+            while (value[length] != 0) length++;
+            auto room = BinLogRecord::MAX_PAYLOAD - record.Size;
+            if (room < 3)
+            {
+                return;
+            }
+            length = (std::min)(length, (room - 3) / unitSize);
+
+            auto length16 = static_cast<uint16_t>(length);
+            put_(record, &tag, 1);
+            put_(record, &length16, 2);
+            if constexpr (sizeof(TChar) == unitSize)
+            {
+                put_(record, value, length * unitSize);
+            }
+            else
+            {
+                for (size_t i = 0; i < length; i++)
+                {
+                    auto unit = ToUtf16Unit(value[i]);
+                    put_(record, &unit, 2);
+                }
+            }
+        }
+
+        template<typename T>
+        static void putArg_(BinLogRecord& record, T value)
+        {
+            using TValue = std::decay_t<T>;
+            uint8_t tag;
+
+            if constexpr (std::is_same_v<TValue, wchar_t*> || std::is_same_v<TValue, const wchar_t*>)
+            {
+                putString_(record, BLA_WSTR, static_cast<const wchar_t*>(value));
+                return;
+            }
+            else if constexpr (std::is_same_v<TValue, char*> || std::is_same_v<TValue, const char*>)
+            {
+                putString_(record, BLA_STR, static_cast<const char*>(value));
+                return;
+            }
+            else if constexpr (std::is_pointer_v<TValue> || std::is_null_pointer_v<TValue>)
+            {
+                tag = BLA_POINTER;
+                auto raw = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(value));
+                if (put_(record, &tag, 1)) put_(record, &raw, 8);
+            }
+            else if constexpr (std::is_floating_point_v<TValue>)
+            {
+                tag = BLA_DOUBLE;
+                auto raw = static_cast<double>(value);
+                if (put_(record, &tag, 1)) put_(record, &raw, 8);
+            }
+            else if constexpr (std::is_enum_v<TValue> || std::is_signed_v<TValue>)
+            {
+                tag = BLA_INT;
+                auto raw = static_cast<long long>(value);
+                if (put_(record, &tag, 1)) put_(record, &raw, 8);
+            }
+            else
+            {
+                static_assert(std::is_integral_v<TValue>, "GLOG_FAST: unsupported argument type");
+                tag = BLA_UINT;
+                auto raw = static_cast<unsigned long long>(value);
+                if (put_(record, &tag, 1)) put_(record, &raw, 8);
+            }
+        }
+
+        void writeHeader_()
+        {
+            unsigned long long header[3];
+#ifdef _WIN32
+            LARGE_INTEGER frequency, origin;
+            QueryPerformanceFrequency(&frequency);
+            QueryPerformanceCounter(&origin);
+
+            SYSTEMTIME localTime;
+            FILETIME localFileTime;
+            GetLocalTime(&localTime);
+            SystemTimeToFileTime(&localTime, &localFileTime);
+
+            header[0] = static_cast<unsigned long long>(frequency.QuadPart);
+            header[1] = static_cast<unsigned long long>(origin.QuadPart);
+            header[2] = (static_cast<unsigned long long>(localFileTime.dwHighDateTime) << 32) | localFileTime.dwLowDateTime;
+#else
+            // Same header from steady_clock ticks and the local time as a FILETIME (100 ns since 1601).
+            auto now = std::chrono::system_clock::now();
+            auto seconds = std::chrono::system_clock::to_time_t(now);
+            auto subsecond = std::chrono::duration_cast<std::chrono::duration<long long, std::ratio<1, 10000000>>>(now.time_since_epoch()).count() % 10000000;
+            tm local;
+            localtime_r(&seconds, &local);
+
+            header[0] = static_cast<unsigned long long>(std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num);
+            header[1] = static_cast<unsigned long long>(TickClock::Now());
+            header[2] = (static_cast<unsigned long long>(timegm(&local)) + 11644473600ull) * 10000000ull + subsecond;
+#endif
+            fwrite("LEBPBIN1", 1, 8, file_);
+            fwrite(header, sizeof(header), 1, file_);
+        }
+
+    public:
+        // FNV-1a of the format string, computed at compile time by GLOG_FAST.
+        static constexpr uint32_t MakeId(const wchar_t* format)
+        {
+            uint32_t hash = 2166136261u;
+            for (; *format != L'\0'; format++)
+            {
+                hash = (hash ^ static_cast<uint32_t>(*format)) * 16777619u;
+            }
+            return hash;
+        }
+
+        // Start recording into fileName, call before anything uses GLOG_FAST.
+        bool Open(const char* fileName)
+        {
+            if (ring_.InError() || nullptr == (file_ = fopen(fileName, "wb")))
+            {
+                return false;
+            }
+
+            writeHeader_();
+            enabled_.store(true);
+            return true;
+        }
+
+        [[nodiscard]] bool Enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+#ifdef _WIN32
+        void SetWakeEvent(HANDLE wakeEvent) { wakeEvent_ = wakeEvent; }
+#endif
+
+        // Register a call site's format under its ID. Fails if the ID already belongs to another format,
+        // which is then returned through outTaken: events of both would decode with whichever came first.
+        bool Register(uint32_t id, const wchar_t* format, const wchar_t** outTaken = nullptr)
+        {
+            const std::lock_guard<std::mutex> lock(formatsMtx_);
+            auto [it, added] = formats_.emplace(id, format);
+            if (!added)
+            {
+                if (0 != wcscmp(it->second, format))
+                {
+                    if (outTaken) *outTaken = it->second;
+                    return false;
+                }
+                return true;  // The same format from another site, e.g. an inline function in several units.
+            }
+            pendingFormats_.emplace_back(id, format);
+            return true;
+        }
+
+        template<typename... TArgs>
+        void Write(uint32_t id, TArgs... args)
+        {
+            bool pushed = ring_.TryPush([id, &args...](BinLogRecord& record)
+                {
+                    record.Id = id;
+                    record.Tick = TickClock::Now();
+                    record.Size = 0;
+                    (putArg_(record, args), ...);
+                });
+
+            if (!pushed)
+            {
+                droppedCount_.fetch_add(1, std::memory_order_relaxed);
+            }
+#ifdef _WIN32
+            if (wakeEvent_ && (!pushed || ring_.ApproxSize() >= RING_CAPACITY / 2))
+            {
+                SetEvent(wakeEvent_);
+            }
+#endif
+        }
+
+        // Move everything recorded to the file. Consumer side, called by the logger's writer.
+        void DrainLocked()
+        {
+            if (!file_)
+            {
+                return;
+            }
+
+            // Formats go first, though an event from a site registered during the drain can still beat its format.
+            {
+                const std::lock_guard<std::mutex> lock(formatsMtx_);
+                for (const auto& [id, format] : pendingFormats_)
+                {
+                    uint8_t kind = BLK_FORMAT;
+                    auto length = static_cast<uint16_t>((std::min)(wcslen(format), static_cast<size_t>(0xFFFF)));
+                    fwrite(&kind, 1, 1, file_);
+                    fwrite(&id, 4, 1, file_);
+                    fwrite(&length, 2, 1, file_);
+                    writeUtf16_(file_, format, length);
+                }
+                pendingFormats_.clear();
+            }
+
+            bool any = false;
+            while (ring_.TryPop([this](const BinLogRecord& record)
+                {
+                    uint8_t kind = BLK_EVENT;
+                    fwrite(&kind, 1, 1, file_);
+                    fwrite(&record.Id, 4, 1, file_);
+                    fwrite(&record.Tick, 8, 1, file_);
+                    fwrite(&record.Size, 2, 1, file_);
+                    fwrite(record.Payload, 1, record.Size, file_);
+                }))
+            {
+                any = true;
+            }
+
+            unsigned long long dropped = droppedCount_.exchange(0, std::memory_order_relaxed);
+            if (dropped != 0)
+            {
+                uint8_t kind = BLK_DROPPED;
+                fwrite(&kind, 1, 1, file_);
+                fwrite(&dropped, 8, 1, file_);
+                any = true;
+            }
+
+            if (any)
+            {
+                fflush(file_);
+            }
+        }
+
+        void Close()
+        {
+            enabled_.store(false);
+            if (file_)
+            {
+                fclose(file_);
+                file_ = nullptr;
+            }
+        }
+    };
+
+    struct BinLogHeader
+    {
+        uint64_t TicksPerSecond;
+        uint64_t OriginTick;
+        uint64_t OriginFileTime;  // local time
+    };
+
+    struct BinLogEvent
+    {
+        uint32_t Id;
+        uint64_t Tick;
+        std::vector<uint8_t> Payload;
+        uint64_t DroppedCount;    // != 0 for a dropped events marker
+    };
+
+    struct BinLogArgument
+    {
+        uint8_t Tag;
+        uint64_t Bits;
+        double Double;
+        std::string Text;         // UTF-8
+    };
+
+    // A whole binary log, as read back by LogDecoder.
+    struct BinLogContents
+    {
+        BinLogHeader Header{};
+        std::unordered_map<uint32_t, std::string> Formats;  // UTF-8, the first one seen for each ID
+        std::unordered_set<uint32_t> Collisions;            // IDs seen with more than one format
+        std::vector<BinLogEvent> Events;
+        bool Truncated = false;
+    };
+
+    /// <summary>
+    /// Reads the binary log format back. Portable, shared by LogDecoder and the tests.
+    /// </summary>
+    class BinLogReader
+    {
+    private:
+        class Cursor
+        {
+        private:
+            const uint8_t* data_;
+            size_t size_;
+            size_t offset_;
+
+        public:
+            Cursor(const uint8_t* data, size_t size, size_t offset) : data_{ data }, size_{ size }, offset_{ offset } { }
+
+            [[nodiscard]] bool AtEnd() const { return offset_ >= size_; }
+
+            bool Read(void* out, size_t size)
+            {
+                if (offset_ + size > size_)
+                {
+                    return false;
+                }
+                memcpy(out, data_ + offset_, size);
+                offset_ += size;
+                return true;
+            }
+
+            template<typename T>
+            bool Read(T& out) { return Read(&out, sizeof(T)); }
+        };
+
+        static bool readUtf16_(Cursor& cursor, uint16_t length, std::string& out)
+        {
+            std::vector<uint16_t> units(length);
+            if (length && !cursor.Read(units.data(), length * 2u))
+            {
+                return false;
+            }
+            out = Utf16ToUtf8(units.data(), units.size());
+            return true;
+        }
+
+    public:
+        static void AppendUtf8(std::string& out, uint32_t codePoint)
+        {
+            if (codePoint < 0x80)
+            {
+                out += static_cast<char>(codePoint);
+            }
+            else if (codePoint < 0x800)
+            {
+                out += static_cast<char>(0xC0 | (codePoint >> 6));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | (codePoint >> 12));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | (codePoint >> 18));
+                out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        static std::string Utf16ToUtf8(const uint16_t* units, size_t length)
+        {
+            std::string out;
+            for (size_t i = 0; i < length; i++)
+            {
+                uint32_t codePoint = units[i];
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 && i + 1 < length && units[i + 1] >= 0xDC00 && units[i + 1] < 0xE000)
+                {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (units[i + 1] - 0xDC00);
+                    i++;
+                }
+                AppendUtf8(out, codePoint);
+            }
+            return out;
+        }
+
+        // Read the header and every record. False if this isn't a binary log or its header is broken;
+        // a damaged or cut off tail only sets Truncated, everything before it is kept.
+        static bool Read(const uint8_t* data, size_t size, BinLogContents& out)
+        {
+            out = BinLogContents{};
+            if (size < 8 + sizeof(BinLogHeader) || 0 != memcmp(data, "LEBPBIN1", 8))
+            {
+                return false;
+            }
+            memcpy(&out.Header, data + 8, sizeof(BinLogHeader));
+            if (out.Header.TicksPerSecond == 0)
+            {
+                return false;
+            }
+
+            // Formats can come after their first event, so everything is read before anything is printed.
+            Cursor cursor{ data, size, 8 + sizeof(BinLogHeader) };
+            while (!cursor.AtEnd())
+            {
+                uint8_t kind = 0;
+                cursor.Read(kind);
+
+                if (kind == BLK_FORMAT)
+                {
+                    uint32_t id = 0;
+                    uint16_t length = 0;
+                    std::string format;
+                    if (!cursor.Read(id) || !cursor.Read(length) || !readUtf16_(cursor, length, format))
+                    {
+                        out.Truncated = true;
+                        break;
+                    }
+                    auto [it, added] = out.Formats.emplace(id, format);
+                    if (!added && it->second != format)
+                    {
+                        out.Collisions.insert(id);
+                    }
+                }
+                else if (kind == BLK_EVENT)
+                {
+                    BinLogEvent event{};
+                    uint16_t payloadSize = 0;
+                    if (!cursor.Read(event.Id) || !cursor.Read(event.Tick) || !cursor.Read(payloadSize)
+                        || (event.Payload.resize(payloadSize), payloadSize && !cursor.Read(event.Payload.data(), payloadSize)))
+                    {
+                        out.Truncated = true;
+                        break;
+                    }
+                    out.Events.push_back(std::move(event));
+                }
+                else if (kind == BLK_DROPPED)
+                {
+                    BinLogEvent event{};
+                    if (!cursor.Read(event.DroppedCount))
+                    {
+                        out.Truncated = true;
+                        break;
+                    }
+                    event.Tick = out.Events.empty() ? out.Header.OriginTick : out.Events.back().Tick;
+                    out.Events.push_back(std::move(event));
+                }
+                else
+                {
+                    out.Truncated = true;
+                    break;
+                }
+            }
+            return true;
+        }
+
+        static bool DecodeArguments(const std::vector<uint8_t>& payload, std::vector<BinLogArgument>& outArgs)
+        {
+            Cursor cursor{ payload.data(), payload.size(), 0 };
+            while (!cursor.AtEnd())
+            {
+                BinLogArgument arg{};
+                if (!cursor.Read(arg.Tag))
+                {
+                    return false;
+                }
+
+                switch (arg.Tag)
+                {
+                case BLA_INT:
+                case BLA_UINT:
+                case BLA_POINTER:
+                    if (!cursor.Read(arg.Bits)) return false;
+                    break;
+                case BLA_DOUBLE:
+                    if (!cursor.Read(arg.Double)) return false;
+                    break;
+                case BLA_WSTR:
+                case BLA_STR:
+                {
+                    uint16_t length = 0;
+                    if (!cursor.Read(length)) return false;
+                    if (arg.Tag == BLA_WSTR)
+                    {
+                        if (!readUtf16_(cursor, length, arg.Text)) return false;
+                    }
+                    else
+                    {
+                        arg.Text.resize(length);
+                        if (length && !cursor.Read(&arg.Text[0], length)) return false;
+                    }
+                    break;
+                }
+                default:
+                    return false;
+                }
+
+                outArgs.push_back(arg);
+            }
+            return true;
+        }
+
+        // printf-style formatting of one event with the (MSVC wide printf) format of its call site.
+        static std::string FormatEvent(const std::string& format, const std::vector<BinLogArgument>& args)
+        {
+            std::string out;
+            size_t nextArg = 0;
+
+            for (size_t i = 0; i < format.size(); i++)
+            {
+                if (format[i] != '%')
+                {
+                    out += format[i];
+                    continue;
+                }
+                if (i + 1 < format.size() && format[i + 1] == '%')
+                {
+                    out += '%';
+                    i++;
+                    continue;
+                }
+
+                // Split the spec into flags / width / precision, skip length modifiers, find the conversion.
+                std::string spec = "%";
+                size_t j = i + 1;
+                while (j < format.size() && strchr("-+ #0123456789.", format[j])) spec += format[j++];
+                while (j < format.size() && strchr("hlLzjtIwq36", format[j])) j++;
+                if (j >= format.size())
+                {
+                    out += format.substr(i);
+                    break;
+                }
+                char conversion = format[j];
+                i = j;
+
+                if (nextArg >= args.size())
+                {
+                    out += "<missing>";
+                    continue;
+                }
+                const auto& arg = args[nextArg++];
+
+                char buffer[128];
+                switch (conversion)
+                {
+                case 's':
+                case 'S':
+                    out += arg.Text;
+                    continue;
+                case 'p':
+                    snprintf(buffer, sizeof(buffer), "%016llX", static_cast<unsigned long long>(arg.Bits));
+                    break;
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                    spec += conversion;
+                    snprintf(buffer, sizeof(buffer), spec.c_str(), arg.Tag == BLA_DOUBLE ? arg.Double : static_cast<double>(static_cast<int64_t>(arg.Bits)));
+                    break;
+                case 'c':
+                case 'C':
+                    AppendUtf8(out, static_cast<uint32_t>(arg.Bits));
+                    continue;
+                case 'd': case 'i':
+                    spec += "lld";
+                    snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<long long>(arg.Bits));
+                    break;
+                default:  // u, x, X, o
+                    spec += "ll";
+                    spec += conversion;
+                    snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<unsigned long long>(arg.Bits));
+                    break;
+                }
+                out += buffer;
+            }
+            return out;
+        }
+
+        // The text of one event, without its time.
+        static std::string FormatLine(const BinLogContents& log, const BinLogEvent& event)
+        {
+            char buffer[96];
+            if (event.DroppedCount != 0)
+            {
+                return "<" + std::to_string(event.DroppedCount) + " event(s) dropped, the log ring was full>";
+            }
+
+            auto format = log.Formats.find(event.Id);
+            if (format == log.Formats.end())
+            {
+                snprintf(buffer, sizeof(buffer), "<unknown format %08X>", event.Id);
+                return buffer;
+            }
+            if (log.Collisions.count(event.Id) != 0)
+            {
+                snprintf(buffer, sizeof(buffer), "<ID %08X has several formats, undecodable> ", event.Id);
+                return buffer + format->second;
+            }
+
+            std::vector<BinLogArgument> args;
+            if (!DecodeArguments(event.Payload, args))
+            {
+                return "<broken arguments> " + format->second;
+            }
+            return FormatEvent(format->second, args);
+        }
+    };
+}
@@ -0,0 +1,412 @@
+#pragma once
+
+#include <atomic>
+#include <cwchar>
+#include <Windows.h>
+#include <Dbghelp.h>
+#include "../utils/crashfilter.h"
+#include "../utils/dumpcompress.h"
+#include "../utils/dumpipc.h"
+#include "../utils/flightrec.h"
+
+
+namespace Utils
+{
+    /// <summary>
+    /// Minidump writer behind the vectored exception handler (-enableminidumps).
+    /// Initialize() does the slow parts up front (dbghelp, the dump path, a spare dump file,
+    /// a watchdog thread), so that on a crash the handler only filters, snapshots the flight
+    /// recorder and hands the dump over to the watchdog, which also has a healthy stack.
+    /// With StartHelper() (-dumphelper), dumps are written by a separate process instead,
+    /// falling back to the watchdog if the helper is gone.
+    /// </summary>
+    class CrashDumper
+    {
+    private:
+        static const SIZE_T EMERGENCY_RESERVE_SIZE = 4 * 1024 * 1024;  // Given back right before dumping.
+        static const DWORD DUMP_TIMEOUT_MS = 5 * 60 * 1000;            // Full memory dumps take a while.
+
+        decltype(&MiniDumpWriteDump) fnMiniDumpWriteDump_ = nullptr;
+        MINIDUMP_TYPE dumpType_ = MiniDumpNormal;
+        bool compress_ = false;
+        wchar_t dumpTypeSuffix_ = L'n';
+        wchar_t dumpPath_[MAX_PATH];                // Game exe path without the extension, completed per dump.
+        size_t dumpPathBaseLength_ = 0;
+        wchar_t leftoverPattern_[MAX_PATH];         // Dumps of earlier sessions, <exe path>_*.dmp.
+
+        HANDLE spareFile_ = INVALID_HANDLE_VALUE;   // Marked for deletion until a dump is written into it.
+        LPVOID emergencyReserve_ = nullptr;
+
+        HANDLE requestEvent_ = nullptr;
+        HANDLE doneEvent_ = nullptr;
+        bool watchdogRunning_ = false;
+        std::atomic<bool> busy_{ false };
+        PEXCEPTION_POINTERS requestPointers_ = nullptr;
+        DWORD requestThreadId_ = 0;
+
+        HANDLE helperProcess_ = nullptr;
+        HANDLE helperMapping_ = nullptr;
+        HANDLE helperRequest_ = nullptr;
+        HANDLE helperDone_ = nullptr;
+        DumpIpcBlock* helperBlock_ = nullptr;
+
+        CrashFilter filter_;
+        size_t flightSnapshotSize_ = 0;
+        BYTE flightSnapshot_[FlightRecorder::SNAPSHOT_SIZE];
+        BYTE renameInfo_[sizeof(FILE_RENAME_INFO) + MAX_PATH * sizeof(wchar_t)];
+
+        // Complete the dump path with the time and the mode (f = full memory, n = normal).
+        void completeDumpPath_(const wchar_t* extension)
+        {
+            SYSTEMTIME time;
+            GetSystemTime(&time);
+            swprintf(dumpPath_ + dumpPathBaseLength_, MAX_PATH - dumpPathBaseLength_, L"_%4d%02d%02d_%02d%02d%02d%c%s",
+                time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond, dumpTypeSuffix_, extension);
+        }
+
+        // Take over the spare file: keep it and give it its final name. Returns INVALID_HANDLE_VALUE if it's gone.
+        HANDLE claimSpareFile_()
+        {
+            auto file = spareFile_;
+            spareFile_ = INVALID_HANDLE_VALUE;
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                return file;
+            }
+
+            FILE_DISPOSITION_INFO disposition{ FALSE };
+            auto renameInfo = reinterpret_cast<FILE_RENAME_INFO*>(renameInfo_);
+            auto nameLength = wcslen(dumpPath_);
+            ZeroMemory(renameInfo_, sizeof(renameInfo_));
+            renameInfo->ReplaceIfExists = TRUE;
+            renameInfo->FileNameLength = static_cast<DWORD>(nameLength * sizeof(wchar_t));
+            wmemcpy(renameInfo->FileName, dumpPath_, nameLength);
+
+            if (!SetFileInformationByHandle(file, FileDispositionInfo, &disposition, sizeof(disposition))
+                || !SetFileInformationByHandle(file, FileRenameInfo, renameInfo, sizeof(renameInfo_)))
+            {
+                CloseHandle(file);
+                return INVALID_HANDLE_VALUE;
+            }
+            return file;
+        }
+
+        void writeDump_(PEXCEPTION_POINTERS pointers, DWORD threadId)
+        {
+            // If the crash is an out of memory one, this is what dbghelp gets to work with.
+            if (emergencyReserve_)
+            {
+                VirtualFree(emergencyReserve_, 0, MEM_RELEASE);
+                emergencyReserve_ = nullptr;
+            }
+
+            completeDumpPath_(L".dmp");
+            auto dumpFile = claimSpareFile_();
+            if (dumpFile == INVALID_HANDLE_VALUE)
+            {
+                dumpFile = CreateFileW(dumpPath_, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+                if (dumpFile == INVALID_HANDLE_VALUE)
+                {
+                    return;
+                }
+            }
+
+            MINIDUMP_EXCEPTION_INFORMATION exInfo;
+            exInfo.ThreadId = threadId;
+            exInfo.ExceptionPointers = pointers;
+            exInfo.ClientPointers = FALSE;
+
+            MINIDUMP_USER_STREAM flightStream;
+            flightStream.Type = FLIGHT_STREAM_TYPE;
+            flightStream.BufferSize = static_cast<ULONG>(flightSnapshotSize_);
+            flightStream.Buffer = flightSnapshot_;
+
+            MINIDUMP_USER_STREAM_INFORMATION userStreams;
+            userStreams.UserStreamCount = 1;
+            userStreams.UserStreamArray = &flightStream;
+
+            fnMiniDumpWriteDump_(
+                GetCurrentProcess(), GetCurrentProcessId(),
+                dumpFile, dumpType_,
+                pointers ? &exInfo : nullptr,
+                &userStreams, nullptr);
+
+            CloseHandle(dumpFile);
+
+            // Also keep the flight record next to the dump (<dump name>.flight), readable with LogDecoder.
+            wchar_t flightPath[MAX_PATH];
+            wcscpy(flightPath, dumpPath_);
+            wcscpy(flightPath + wcslen(flightPath) - 4, L".flight");
+            auto flightFile = CreateFileW(flightPath, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+            if (flightFile != INVALID_HANDLE_VALUE)
+            {
+                DWORD written = 0;
+                WriteFile(flightFile, flightSnapshot_, static_cast<DWORD>(flightSnapshotSize_), &written, nullptr);
+                CloseHandle(flightFile);
+            }
+        }
+
+        // Have the helper process write the dump. Returns false if it isn't there to do it.
+        bool requestHelperDump_(PEXCEPTION_POINTERS pointers)
+        {
+            if (!helperBlock_ || !DumpIpc::TryTransition(helperBlock_->State, DHS_READY, DHS_REQUESTED))
+            {
+                return false;
+            }
+
+            completeDumpPath_(L".dmp");
+            auto pathLength = min(wcslen(dumpPath_), DUMP_IPC_PATH_CHARS - 1);
+            memcpy(helperBlock_->DumpPath, dumpPath_, pathLength * sizeof(wchar_t));
+            helperBlock_->DumpPath[pathLength] = 0;
+            helperBlock_->ClientThreadId = GetCurrentThreadId();
+            helperBlock_->ExceptionPointers = reinterpret_cast<ULONG_PTR>(pointers);
+            helperBlock_->FlightSnapshot = reinterpret_cast<ULONG_PTR>(flightSnapshot_);
+            helperBlock_->FlightSnapshotSize = static_cast<uint32_t>(flightSnapshotSize_);
+            helperBlock_->DumpType = dumpType_;
+            helperBlock_->Result = 0;
+            helperBlock_->Flags = compress_ ? DUMP_IPC_FLAG_COMPRESS : 0;
+            SetEvent(helperRequest_);
+
+            // Done, or the helper died on us.
+            HANDLE waits[2] = { helperDone_, helperProcess_ };
+            auto wait = WaitForMultipleObjects(2, waits, FALSE, DUMP_TIMEOUT_MS);
+            if (wait == WAIT_OBJECT_0 + 1 || wait == WAIT_FAILED)
+            {
+                helperBlock_ = nullptr;
+                return false;
+            }
+            if (wait != WAIT_OBJECT_0)
+            {
+                return true;  // Still writing, leave it to finish.
+            }
+
+            auto state = helperBlock_->State.load();
+            DumpIpc::TryTransition(helperBlock_->State, state, DHS_READY);
+            return state == DHS_DONE;
+        }
+
+        // Compress the raw dumps earlier sessions wrote in-process (see CompressLeftoverDumps).
+        void compressLeftovers_()
+        {
+            WIN32_FIND_DATAW findData;
+            auto find = FindFirstFileW(leftoverPattern_, &findData);
+            if (find == INVALID_HANDLE_VALUE)
+            {
+                return;
+            }
+
+            auto directoryLength = wcsrchr(leftoverPattern_, L'\\') + 1 - leftoverPattern_;
+            do
+            {
+                // "*.dmp" also matches through 8.3 names, and the spare belongs to a running session.
+                auto nameLength = wcslen(findData.cFileName);
+                if (nameLength < 4 || 0 != _wcsicmp(findData.cFileName + nameLength - 4, L".dmp")
+                    || nullptr != wcsstr(findData.cFileName, L"_pending.dmp")
+                    || directoryLength + nameLength + 1 >= MAX_PATH)
+                {
+                    continue;
+                }
+
+                wchar_t rawPath[MAX_PATH];
+                wchar_t packedPath[MAX_PATH + 1];
+                swprintf(rawPath, MAX_PATH, L"%.*s%s", static_cast<int>(directoryLength), leftoverPattern_, findData.cFileName);
+                swprintf(packedPath, MAX_PATH + 1, L"%sz", rawPath);
+                CompressDumpFile(rawPath, packedPath, 1);
+            } while (FindNextFileW(find, &findData));
+            FindClose(find);
+        }
+
+        static DWORD WINAPI leftoverThread_(LPVOID lpParameter)
+        {
+            reinterpret_cast<CrashDumper*>(lpParameter)->compressLeftovers_();
+            return 0;
+        }
+
+        void watchdogLoop_()
+        {
+            while (WAIT_OBJECT_0 == WaitForSingleObject(requestEvent_, INFINITE))
+            {
+                writeDump_(requestPointers_, requestThreadId_);
+                SetEvent(doneEvent_);
+            }
+        }
+
+        static DWORD WINAPI watchdogThread_(LPVOID lpParameter)
+        {
+            reinterpret_cast<CrashDumper*>(lpParameter)->watchdogLoop_();
+            return 0;
+        }
+
+    public:
+        // Resolve and prepare everything the crash path needs. fullMemory is -killmydisk.
+        bool Initialize(bool fullMemory)
+        {
+            auto libDbghelp = LoadLibraryA("dbghelp");
+            auto fnMiniDumpWriteDump = libDbghelp ? (decltype(&MiniDumpWriteDump))GetProcAddress(libDbghelp, "MiniDumpWriteDump") : nullptr;
+            if (!fnMiniDumpWriteDump)
+            {
+                return false;
+            }
+
+            dumpType_ = fullMemory ? MINIDUMP_TYPE(MiniDumpWithFullMemory) : MINIDUMP_TYPE(MiniDumpNormal);
+            dumpTypeSuffix_ = fullMemory ? L'f' : L'n';
+
+            // Leave room for "_yyyymmdd_hhmmssX.flight".
+            auto length = GetModuleFileNameW(GetModuleHandleW(0), dumpPath_, MAX_PATH);
+            if (length < 4 || length + 32 >= MAX_PATH)
+            {
+                return false;
+            }
+            dumpPathBaseLength_ = length - 4;
+
+            // The file system work for the first dump happens now. The spare is deleted when the
+            // process exits (or dies) without having used it.
+            wcscpy(dumpPath_ + dumpPathBaseLength_, L"_pending.dmp");
+            spareFile_ = CreateFileW(dumpPath_, GENERIC_WRITE | DELETE, FILE_SHARE_READ | FILE_SHARE_DELETE, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+            if (spareFile_ != INVALID_HANDLE_VALUE)
+            {
+                FILE_DISPOSITION_INFO disposition{ TRUE };
+                if (!SetFileInformationByHandle(spareFile_, FileDispositionInfo, &disposition, sizeof(disposition)))
+                {
+                    CloseHandle(spareFile_);
+                    DeleteFileW(dumpPath_);
+                    spareFile_ = INVALID_HANDLE_VALUE;
+                }
+            }
+
+            emergencyReserve_ = VirtualAlloc(nullptr, EMERGENCY_RESERVE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+            requestEvent_ = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+            doneEvent_ = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+            watchdogRunning_ = requestEvent_ && doneEvent_ && CreateThread(nullptr, 0, watchdogThread_, this, 0, nullptr);
+
+            fnMiniDumpWriteDump_ = fnMiniDumpWriteDump;
+            return true;
+        }
+
+        // Start the out-of-process writer (bink2w64_dumphelper.exe). Call after Initialize().
+        bool StartHelper(const wchar_t* helperPath)
+        {
+            static_assert(sizeof(wchar_t) == sizeof(uint16_t), "DumpIpcBlock paths are UTF-16");
+
+            auto processId = GetCurrentProcessId();
+            wchar_t name[64];
+
+            DumpIpc::Name(name, 64, L"Block", processId);
+            helperMapping_ = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(DumpIpcBlock), name);
+            if (!helperMapping_)
+            {
+                return false;
+            }
+            auto block = reinterpret_cast<DumpIpcBlock*>(MapViewOfFile(helperMapping_, FILE_MAP_WRITE, 0, 0, sizeof(DumpIpcBlock)));
+            if (!block)
+            {
+                return false;
+            }
+            memcpy(block->Magic, "LEBPDIPC", 8);
+            block->Version = DUMP_IPC_VERSION;
+            block->State.store(DHS_STARTING);
+
+            DumpIpc::Name(name, 64, L"Request", processId);
+            helperRequest_ = CreateEventW(nullptr, FALSE, FALSE, name);
+            DumpIpc::Name(name, 64, L"Done", processId);
+            helperDone_ = CreateEventW(nullptr, FALSE, FALSE, name);
+            if (!helperRequest_ || !helperDone_)
+            {
+                return false;
+            }
+
+            wchar_t commandLine[MAX_PATH + 32];
+            swprintf(commandLine, MAX_PATH + 32, L"\"%s\" %u", helperPath, processId);
+
+            STARTUPINFOW startupInfo{};
+            startupInfo.cb = sizeof(startupInfo);
+            PROCESS_INFORMATION processInfo;
+            if (!CreateProcessW(helperPath, commandLine, nullptr, nullptr, FALSE, CREATE_NO_WINDOW, nullptr, nullptr, &startupInfo, &processInfo))
+            {
+                return false;
+            }
+            CloseHandle(processInfo.hThread);
+            helperProcess_ = processInfo.hProcess;
+
+            // Requests only go out once the helper has moved the block to Ready.
+            helperBlock_ = block;
+            return true;
+        }
+
+        // Store dumps as .dmpz (chunked LZ4, see dumpcompress.h), -compressdumps.
+        // A crashing process only ever writes the raw .dmp: the helper compresses its dumps once the
+        // game is let go, and dumps written in-process are left for CompressLeftoverDumps().
+        void EnableCompression() { compress_ = true; }
+
+        // Compress the .dmp files of earlier sessions on a background thread, one core, low priority.
+        // Call after Initialize().
+        bool CompressLeftoverDumps()
+        {
+            if (!IsInitialized())
+            {
+                return false;
+            }
+            wmemcpy(leftoverPattern_, dumpPath_, dumpPathBaseLength_);
+            wcscpy(leftoverPattern_ + dumpPathBaseLength_, L"_*.dmp");
+
+            auto thread = CreateThread(nullptr, 0, leftoverThread_, this, CREATE_SUSPENDED, nullptr);
+            if (!thread)
+            {
+                return false;
+            }
+            SetThreadPriority(thread, THREAD_PRIORITY_LOWEST);
+            ResumeThread(thread);
+            CloseHandle(thread);
+            return true;
+        }
+
+        [[nodiscard]] bool IsInitialized() const noexcept { return fnMiniDumpWriteDump_ != nullptr; }
+        [[nodiscard]] const CrashFilter& Filter() const noexcept { return filter_; }
+
+        // Cheap enough for every first-chance exception. unhandled: called from the unhandled exception filter.
+        bool ShouldDump(PEXCEPTION_POINTERS pointers, bool unhandled = false)
+        {
+            auto record = pointers->ExceptionRecord;
+            return IsInitialized()
+                && filter_.ShouldDump(record->ExceptionCode, reinterpret_cast<ULONG_PTR>(record->ExceptionAddress), GetTickCount64(), unhandled);
+        }
+
+        // Write a dump of the current exception, on the watchdog thread if it's running.
+        void Dump(PEXCEPTION_POINTERS pointers)
+        {
+            bool expected = false;
+            if (!busy_.compare_exchange_strong(expected, true))
+            {
+                return;
+            }
+
+            auto record = pointers->ExceptionRecord;
+            GFlightRecorder.Record(FE_EXCEPTION, record->ExceptionCode, reinterpret_cast<ULONG_PTR>(record->ExceptionAddress), "");
+            flightSnapshotSize_ = GFlightRecorder.Snapshot(flightSnapshot_, GetCurrentThreadId());
+
+            if (requestHelperDump_(pointers))
+            {
+                // Written from outside.
+            }
+            else if (watchdogRunning_)
+            {
+                requestPointers_ = pointers;
+                requestThreadId_ = GetCurrentThreadId();
+                SetEvent(requestEvent_);
+                if (WAIT_OBJECT_0 != WaitForSingleObject(doneEvent_, DUMP_TIMEOUT_MS))
+                {
+                    return;  // Still writing, stay busy.
+                }
+            }
+            else
+            {
+                writeDump_(pointers, GetCurrentThreadId());
+            }
+
+            busy_.store(false);
+        }
+    };
+
+    CrashDumper GCrashDumper;
+}
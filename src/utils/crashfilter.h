@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace Utils
+{
+    /// <summary>
+    /// Decides which exceptions seen by the vectored handler are worth a dump.
+    /// The handler sees every first-chance exception, including the ones the engine throws
+    /// and catches itself, so only crash-class codes pass, each site dumps once,
+    /// and dumps are spaced out and capped per session. Crashes which are still unhandled at the
+    /// unhandled exception filter have one more dump of their own, so first-chance faults the engine
+    /// recovers from can't use up the session's dumps before the one that takes the game down.
+    /// </summary>
+    class CrashFilter
+    {
+    public:
+        static const uint32_t MAX_DUMPS = 3;            // Of first-chance crashes.
+        static const uint32_t MAX_UNHANDLED_DUMPS = 1;  // On top of those.
+        static const uint64_t MIN_INTERVAL_MS = 5000;   // Between first-chance dumps.
+
+    private:
+        struct Signature
+        {
+            std::atomic<uint32_t> Code{ 0 };
+            std::atomic<uint64_t> Address{ 0 };
+        };
+
+        std::atomic<uint64_t> lastDumpMs_{ 0 };
+        std::atomic<uint32_t> firstChanceCount_{ 0 };
+        std::atomic<uint32_t> unhandledCount_{ 0 };
+        std::atomic<uint32_t> dumpCount_{ 0 };
+        std::atomic<uint32_t> suppressedCount_{ 0 };
+        Signature signatures_[MAX_DUMPS + MAX_UNHANDLED_DUMPS];
+
+        bool dumpedBefore_(uint32_t code, uint64_t address) const noexcept
+        {
+            auto count = dumpCount_.load(std::memory_order_acquire);
+            count = count < MAX_DUMPS + MAX_UNHANDLED_DUMPS ? count : MAX_DUMPS + MAX_UNHANDLED_DUMPS;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (signatures_[i].Code.load(std::memory_order_relaxed) == code
+                    && signatures_[i].Address.load(std::memory_order_relaxed) == address)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool suppress_() noexcept
+        {
+            suppressedCount_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+    public:
+        // Exception codes which mean the process is (about to be) in trouble.
+        [[nodiscard]] static bool IsCrashCode(uint32_t code) noexcept
+        {
+            switch (code)
+            {
+            case 0xC0000005:  // EXCEPTION_ACCESS_VIOLATION
+            case 0xC0000006:  // EXCEPTION_IN_PAGE_ERROR
+            case 0xC000001D:  // EXCEPTION_ILLEGAL_INSTRUCTION
+            case 0xC0000025:  // EXCEPTION_NONCONTINUABLE_EXCEPTION
+            case 0xC0000026:  // EXCEPTION_INVALID_DISPOSITION
+            case 0xC000008C:  // EXCEPTION_ARRAY_BOUNDS_EXCEEDED
+            case 0xC0000094:  // EXCEPTION_INT_DIVIDE_BY_ZERO
+            case 0xC0000096:  // EXCEPTION_PRIV_INSTRUCTION
+            case 0xC00000FD:  // EXCEPTION_STACK_OVERFLOW
+            case 0xC0000374:  // STATUS_HEAP_CORRUPTION
+            case 0xC0000409:  // STATUS_STACK_BUFFER_OVERRUN
+            case 0xC0000420:  // STATUS_ASSERTION_FAILURE
+            case 0x80000002:  // EXCEPTION_DATATYPE_MISALIGNMENT
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // Thread-safe, at most one of several threads crashing at the same time gets true.
+        // unhandled: seen by the unhandled exception filter, not the vectored handler. Those skip the
+        // interval and have their own slot, but a site which was dumped at first chance isn't dumped again.
+        bool ShouldDump(uint32_t code, uint64_t address, uint64_t nowMs, bool unhandled = false) noexcept
+        {
+            if (!IsCrashCode(code))
+            {
+                return false;
+            }
+            if (dumpedBefore_(code, address))
+            {
+                return suppress_();
+            }
+
+            if (unhandled)
+            {
+                if (unhandledCount_.fetch_add(1, std::memory_order_acq_rel) >= MAX_UNHANDLED_DUMPS)
+                {
+                    return suppress_();
+                }
+                lastDumpMs_.store(nowMs != 0 ? nowMs : 1, std::memory_order_relaxed);
+            }
+            else
+            {
+                auto count = firstChanceCount_.load(std::memory_order_acquire);
+                if (count >= MAX_DUMPS)
+                {
+                    return suppress_();
+                }
+
+                auto last = lastDumpMs_.load(std::memory_order_relaxed);
+                if ((last != 0 && nowMs - last < MIN_INTERVAL_MS)
+                    || !lastDumpMs_.compare_exchange_strong(last, nowMs != 0 ? nowMs : 1, std::memory_order_acq_rel))
+                {
+                    return suppress_();
+                }
+
+                // Only the thread that moved lastDumpMs_ gets here within an interval, so the count is ours.
+                firstChanceCount_.store(count + 1, std::memory_order_release);
+            }
+
+            // The unhandled filter may run alongside a first-chance dump, so the slot is taken atomically.
+            auto slot = dumpCount_.fetch_add(1, std::memory_order_acq_rel);
+            if (slot < MAX_DUMPS + MAX_UNHANDLED_DUMPS)
+            {
+                signatures_[slot].Code.store(code, std::memory_order_relaxed);
+                signatures_[slot].Address.store(address, std::memory_order_relaxed);
+            }
+            return true;
+        }
+
+        [[nodiscard]] uint32_t DumpCount() const noexcept { return dumpCount_.load(std::memory_order_relaxed); }
+        [[nodiscard]] uint32_t SuppressedCount() const noexcept { return suppressedCount_.load(std::memory_order_relaxed); }
+    };
+}
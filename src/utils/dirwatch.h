@@ -0,0 +1,131 @@
+#pragma once
+
+#include <Windows.h>
+#include "../utils/io.h"
+
+
+namespace Utils
+{
+    enum class WatchResult
+    {
+        Changed = 0,
+        Timeout = 1,
+        Stopped = 2
+    };
+
+    /// <summary>
+    /// Blocking watcher for file writes and renames in a directory tree.
+    /// Wait() returns the changed paths (relative to the root) through a callback.
+    /// </summary>
+    class DirectoryWatcher
+    {
+    private:
+        HANDLE dirHandle_;
+        HANDLE stopEvent_;
+        OVERLAPPED overlapped_;
+        bool readPending_;
+        alignas(DWORD) BYTE buffer_[16 * 1024];
+
+    public:
+        DirectoryWatcher(const DirectoryWatcher& other) = delete;
+        DirectoryWatcher& operator=(const DirectoryWatcher& other) = delete;
+
+        DirectoryWatcher(const wchar_t* root)
+            : dirHandle_{ INVALID_HANDLE_VALUE }
+            , stopEvent_{ CreateEventW(nullptr, TRUE, FALSE, nullptr) }
+            , overlapped_{}
+            , readPending_{ false }
+        {
+            overlapped_.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            dirHandle_ = CreateFileW(root, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+            if (dirHandle_ == INVALID_HANDLE_VALUE)
+            {
+                GLogger.writeln(L"DirectoryWatcher: failed to open %s (error code = %d)", root, GetLastError());
+            }
+        }
+
+        ~DirectoryWatcher()
+        {
+            if (dirHandle_ != INVALID_HANDLE_VALUE)
+            {
+                CancelIo(dirHandle_);
+                CloseHandle(dirHandle_);
+            }
+            if (overlapped_.hEvent) CloseHandle(overlapped_.hEvent);
+            if (stopEvent_) CloseHandle(stopEvent_);
+        }
+
+        [[nodiscard]] bool InError() const noexcept { return dirHandle_ == INVALID_HANDLE_VALUE || !stopEvent_ || !overlapped_.hEvent; }
+
+        // Make a pending or future Wait() return WatchResult::Stopped.
+        void Stop() { SetEvent(stopEvent_); }
+
+        // Wait for the next batch of changes and report each changed path through onChange(const wchar_t*).
+        // A timed out read stays pending and is picked up by the next call.
+        template<typename TCallback>
+        WatchResult Wait(TCallback onChange, DWORD timeoutMs)
+        {
+            if (InError())
+            {
+                return WatchResult::Stopped;
+            }
+
+            if (!readPending_)
+            {
+                ResetEvent(overlapped_.hEvent);
+                if (!ReadDirectoryChangesW(dirHandle_, buffer_, sizeof(buffer_), TRUE,
+                    FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, &overlapped_, nullptr))
+                {
+                    GLogger.writeln(L"DirectoryWatcher.Wait: ReadDirectoryChangesW failed (error code = %d)", GetLastError());
+                    return WatchResult::Stopped;
+                }
+                readPending_ = true;
+            }
+
+            HANDLE handles[2] = { overlapped_.hEvent, stopEvent_ };
+            auto rc = WaitForMultipleObjects(2, handles, FALSE, timeoutMs);
+            if (rc == WAIT_TIMEOUT)
+            {
+                return WatchResult::Timeout;
+            }
+            if (rc != WAIT_OBJECT_0)
+            {
+                CancelIo(dirHandle_);
+                return WatchResult::Stopped;
+            }
+            readPending_ = false;
+
+            DWORD bytesRead = 0;
+            if (!GetOverlappedResult(dirHandle_, &overlapped_, &bytesRead, FALSE))
+            {
+                GLogger.writeln(L"DirectoryWatcher.Wait: GetOverlappedResult failed (error code = %d)", GetLastError());
+                return WatchResult::Stopped;
+            }
+
+            // Zero bytes means the buffer overflowed and the changes were lost, nothing to report.
+            DWORD offset = 0;
+            while (bytesRead != 0)
+            {
+                auto info = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(buffer_ + offset);
+
+                wchar_t path[MAX_PATH];
+                auto length = min(info->FileNameLength / sizeof(wchar_t), static_cast<size_t>(MAX_PATH - 1));
+                wcsncpy_s(path, MAX_PATH, info->FileName, length);
+
+                if (info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+                {
+                    onChange(static_cast<const wchar_t*>(path));
+                }
+
+                if (info->NextEntryOffset == 0)
+                {
+                    break;
+                }
+                offset += info->NextEntryOffset;
+            }
+
+            return WatchResult::Changed;
+        }
+    };
+}
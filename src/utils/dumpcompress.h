@@ -0,0 +1,398 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+
+namespace Utils
+{
+    /// Compressed dump layout (.dmpz, little endian), shared with LogDecoder:
+    ///   DumpzHeader
+    ///   chunks: each ChunkSize bytes of the raw dump (the last one shorter), LZ4 block or stored
+    ///   DumpzChunk[ChunkCount] index
+    ///   DumpzTrailer
+    /// The index at the end makes it seekable: the raw offset X lives in chunk X / ChunkSize.
+    struct DumpzHeader
+    {
+        char Magic[8];             // "LEBPDMPZ"
+        uint32_t Version;
+        uint32_t ChunkSize;
+    };
+
+    enum DumpzCodec : uint32_t
+    {
+        DZC_STORED = 0,
+        DZC_LZ4 = 1,               // LZ4 block format
+    };
+
+    struct DumpzChunk
+    {
+        uint64_t RawOffset;
+        uint64_t FileOffset;
+        uint32_t RawSize;
+        uint32_t PackedSize;
+        uint32_t Codec;
+        uint32_t Reserved;
+    };
+
+    struct DumpzTrailer
+    {
+        uint64_t IndexOffset;
+        uint64_t RawSize;
+        uint32_t ChunkCount;
+        char Magic[4];             // "DZIX"
+    };
+
+    /// <summary>
+    /// Minimal LZ4 block codec (greedy, 64 KB window). Output is standard LZ4 block format.
+    /// </summary>
+    class Lz4Block
+    {
+    private:
+        static const size_t MIN_MATCH = 4;
+        static const size_t LAST_LITERALS = 5;
+        static const size_t MF_LIMIT = 12;
+        static const uint32_t HASH_BITS = 16;
+        static const size_t MAX_DISTANCE = 65535;
+
+        static uint32_t read32_(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+        static uint32_t hash_(uint32_t v) { return (v * 2654435761u) >> (32 - HASH_BITS); }
+
+        // Literal and match lengths over 15 spill into 255-runs.
+        static bool putLength_(uint8_t*& out, const uint8_t* outEnd, size_t length)
+        {
+            for (; length >= 255; length -= 255)
+            {
+                if (out >= outEnd) return false;
+                *out++ = 255;
+            }
+            if (out >= outEnd) return false;
+            *out++ = static_cast<uint8_t>(length);
+            return true;
+        }
+
+        static bool putSequence_(uint8_t*& out, const uint8_t* outEnd, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+        {
+            if (out >= outEnd) return false;
+            auto token = out++;
+            *token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+            if (literalLength >= 15 && !putLength_(out, outEnd, literalLength - 15)) return false;
+            if (static_cast<size_t>(outEnd - out) < literalLength) return false;
+            if (literalLength != 0)
+            {
+                memcpy(out, literals, literalLength);  // literals may be null for empty input.
+                out += literalLength;
+            }
+
+            if (matchLength == 0)
+            {
+                return true;  // Last literals, no match.
+            }
+            if (outEnd - out < 2) return false;
+            *out++ = static_cast<uint8_t>(offset);
+            *out++ = static_cast<uint8_t>(offset >> 8);
+            auto extra = matchLength - MIN_MATCH;
+            *token |= static_cast<uint8_t>(extra < 15 ? extra : 15);
+            return extra < 15 || putLength_(out, outEnd, extra - 15);
+        }
+
+    public:
+        [[nodiscard]] static size_t Bound(size_t size) { return size + size / 255 + 16; }
+
+        // Returns the compressed size, or 0 if it doesn't fit (store the data instead).
+        // table must hold 1 << 16 entries, its contents don't matter.
+        static size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity, uint32_t* table)
+        {
+            auto out = dst;
+            auto outEnd = dst + dstCapacity;
+            size_t anchor = 0;
+
+            if (srcSize > MF_LIMIT)
+            {
+                memset(table, 0, sizeof(uint32_t) << HASH_BITS);
+
+                size_t position = 0;
+                size_t misses = 0;
+                auto matchLimit = srcSize - MF_LIMIT;
+                while (position < matchLimit)
+                {
+                    auto sequence = read32_(src + position);
+                    auto& slot = table[hash_(sequence)];
+                    size_t candidate = slot;
+                    slot = static_cast<uint32_t>(position + 1);  // 0 = empty
+
+                    if (candidate == 0 || position - (candidate - 1) > MAX_DISTANCE || read32_(src + candidate - 1) != sequence)
+                    {
+                        position += 1 + (misses++ >> 6);  // Skip faster through incompressible data.
+                        continue;
+                    }
+                    candidate--;
+                    misses = 0;
+
+                    auto matchLength = MIN_MATCH;
+                    while (position + matchLength < srcSize - LAST_LITERALS && src[candidate + matchLength] == src[position + matchLength])
+                    {
+                        matchLength++;
+                    }
+
+                    if (!putSequence_(out, outEnd, src + anchor, position - anchor, position - candidate, matchLength))
+                    {
+                        return 0;
+                    }
+                    position += matchLength;
+                    anchor = position;
+                }
+            }
+
+            if (!putSequence_(out, outEnd, src + anchor, srcSize - anchor, 0, 0))
+            {
+                return 0;
+            }
+            return out - dst;
+        }
+
+        // Returns the decompressed size, or -1 on malformed input.
+        static long long Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+        {
+            auto in = src;
+            auto inEnd = src + srcSize;
+            auto out = dst;
+            auto outEnd = dst + dstCapacity;
+
+            auto getLength = [&in, inEnd](size_t length) -> long long
+            {
+                if (length != 15) return static_cast<long long>(length);
+                uint8_t byte;
+                do
+                {
+                    if (in >= inEnd) return -1;
+                    byte = *in++;
+                    length += byte;
+                } while (byte == 255);
+                return static_cast<long long>(length);
+            };
+
+            while (in < inEnd)
+            {
+                auto token = *in++;
+                auto literalLength = getLength(token >> 4);
+                if (literalLength < 0 || inEnd - in < literalLength || outEnd - out < literalLength) return -1;
+                if (literalLength != 0)
+                {
+                    memcpy(out, in, static_cast<size_t>(literalLength));
+                    in += literalLength;
+                    out += literalLength;
+                }
+
+                if (in == inEnd)
+                {
+                    break;  // Last literals.
+                }
+
+                if (inEnd - in < 2) return -1;
+                size_t offset = in[0] | (in[1] << 8);
+                in += 2;
+                auto matchLength = getLength(token & 0xF);
+                if (matchLength < 0 || offset == 0 || offset > static_cast<size_t>(out - dst)) return -1;
+                matchLength += MIN_MATCH;
+                if (outEnd - out < matchLength) return -1;
+
+                // Byte by byte, matches may overlap their own output.
+                auto match = out - offset;
+                for (long long i = 0; i < matchLength; i++)
+                {
+                    *out++ = *match++;
+                }
+            }
+            return out - dst;
+        }
+    };
+
+    /// <summary>
+    /// Chunked, multithreaded dump compression into the .dmpz layout.
+    /// read(void*, size_t) -> size_t fills the next raw bytes (short only at the end),
+    /// write(const void*, size_t) -> bool appends to the output. Both are only called from the calling thread.
+    /// </summary>
+    class DumpCompressor
+    {
+    public:
+        static const uint32_t VERSION = 1;
+        static const uint32_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+        template<typename TRead, typename TWrite>
+        static bool Compress(TRead&& read, TWrite&& write, unsigned threadCount, uint64_t* outPackedSize = nullptr)
+        {
+            threadCount = threadCount == 0 ? 1 : threadCount;
+
+            DumpzHeader header{};
+            memcpy(header.Magic, "LEBPDMPZ", 8);
+            header.Version = VERSION;
+            header.ChunkSize = CHUNK_SIZE;
+            if (!write(&header, sizeof(header)))
+            {
+                return false;
+            }
+
+            std::vector<DumpzChunk> index;
+            uint64_t rawOffset = 0;
+            uint64_t fileOffset = sizeof(header);
+
+            // A batch is one chunk per thread, buffers are reused across batches.
+            std::vector<std::vector<uint8_t>> raw(threadCount, std::vector<uint8_t>(CHUNK_SIZE));
+            std::vector<std::vector<uint8_t>> packed(threadCount, std::vector<uint8_t>(Lz4Block::Bound(CHUNK_SIZE)));
+            std::vector<std::vector<uint32_t>> tables(threadCount, std::vector<uint32_t>(1 << 16));
+            std::vector<size_t> rawSizes(threadCount), packedSizes(threadCount);
+
+            bool atEnd = false;
+            while (!atEnd)
+            {
+                unsigned filled = 0;
+                for (; filled < threadCount; filled++)
+                {
+                    rawSizes[filled] = read(raw[filled].data(), CHUNK_SIZE);
+                    if (rawSizes[filled] < CHUNK_SIZE) atEnd = true;
+                    if (rawSizes[filled] == 0) break;
+                    if (atEnd) { filled++; break; }
+                }
+
+                std::vector<std::thread> workers;
+                for (unsigned i = 1; i < filled; i++)
+                {
+                    workers.emplace_back([&, i]() { packedSizes[i] = Lz4Block::Compress(raw[i].data(), rawSizes[i], packed[i].data(), packed[i].size(), tables[i].data()); });
+                }
+                if (filled != 0)
+                {
+                    packedSizes[0] = Lz4Block::Compress(raw[0].data(), rawSizes[0], packed[0].data(), packed[0].size(), tables[0].data());
+                }
+                for (auto& worker : workers)
+                {
+                    worker.join();
+                }
+
+                for (unsigned i = 0; i < filled; i++)
+                {
+                    // Keep chunks that don't shrink as they are.
+                    bool stored = packedSizes[i] == 0 || packedSizes[i] >= rawSizes[i];
+                    DumpzChunk chunk{ rawOffset, fileOffset, static_cast<uint32_t>(rawSizes[i]),
+                        static_cast<uint32_t>(stored ? rawSizes[i] : packedSizes[i]), stored ? DZC_STORED : DZC_LZ4, 0 };
+                    if (!write(stored ? raw[i].data() : packed[i].data(), chunk.PackedSize))
+                    {
+                        return false;
+                    }
+                    index.push_back(chunk);
+                    rawOffset += chunk.RawSize;
+                    fileOffset += chunk.PackedSize;
+                }
+            }
+
+            DumpzTrailer trailer{ fileOffset, rawOffset, static_cast<uint32_t>(index.size()), { 'D', 'Z', 'I', 'X' } };
+            if ((!index.empty() && !write(index.data(), index.size() * sizeof(DumpzChunk))) || !write(&trailer, sizeof(trailer)))
+            {
+                return false;
+            }
+
+            if (outPackedSize)
+            {
+                *outPackedSize = fileOffset + index.size() * sizeof(DumpzChunk) + sizeof(trailer);
+            }
+            return true;
+        }
+
+        // Check a whole .dmpz in memory and get its index.
+        static bool ReadIndex(const uint8_t* data, size_t size, DumpzTrailer& outTrailer, std::vector<DumpzChunk>& outIndex)
+        {
+            if (size < sizeof(DumpzHeader) + sizeof(DumpzTrailer) || 0 != memcmp(data, "LEBPDMPZ", 8))
+            {
+                return false;
+            }
+            memcpy(&outTrailer, data + size - sizeof(DumpzTrailer), sizeof(DumpzTrailer));
+            if (0 != memcmp(outTrailer.Magic, "DZIX", 4) || outTrailer.IndexOffset > size - sizeof(DumpzTrailer)
+                || (size - sizeof(DumpzTrailer) - outTrailer.IndexOffset) / sizeof(DumpzChunk) < outTrailer.ChunkCount)
+            {
+                return false;
+            }
+
+            outIndex.resize(outTrailer.ChunkCount);
+            if (outTrailer.ChunkCount != 0)
+            {
+                memcpy(outIndex.data(), data + outTrailer.IndexOffset, outTrailer.ChunkCount * sizeof(DumpzChunk));
+            }
+            for (const auto& chunk : outIndex)
+            {
+                if (chunk.FileOffset > outTrailer.IndexOffset || outTrailer.IndexOffset - chunk.FileOffset < chunk.PackedSize
+                    || chunk.RawOffset > outTrailer.RawSize || outTrailer.RawSize - chunk.RawOffset < chunk.RawSize)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Decompress one chunk into out (chunk.RawSize bytes).
+        static bool ReadChunk(const uint8_t* data, const DumpzChunk& chunk, uint8_t* out)
+        {
+            if (chunk.Codec == DZC_STORED)
+            {
+                if (chunk.PackedSize != chunk.RawSize) return false;
+                if (chunk.RawSize != 0)
+                {
+                    memcpy(out, data + chunk.FileOffset, chunk.RawSize);
+                }
+                return true;
+            }
+            return chunk.Codec == DZC_LZ4
+                && Lz4Block::Decompress(data + chunk.FileOffset, chunk.PackedSize, out, chunk.RawSize) == chunk.RawSize;
+        }
+    };
+
+#ifdef _WIN32
+    // Compress a dump file into a .dmpz next to it, on up to maxThreads cores. The raw dump is deleted on success.
+    inline bool CompressDumpFile(const wchar_t* rawPath, const wchar_t* packedPath, unsigned maxThreads = 8)
+    {
+        auto rawFile = CreateFileW(rawPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (rawFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        auto packedFile = CreateFileW(packedPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (packedFile == INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(rawFile);
+            return false;
+        }
+
+        auto read = [rawFile](void* buffer, size_t size) -> size_t
+        {
+            size_t total = 0;
+            DWORD got = 0;
+            while (total < size && ReadFile(rawFile, static_cast<uint8_t*>(buffer) + total, static_cast<DWORD>(size - total), &got, nullptr) && got != 0)
+            {
+                total += got;
+            }
+            return total;
+        };
+        auto write = [packedFile](const void* data, size_t size) -> bool
+        {
+            DWORD written = 0;
+            return WriteFile(packedFile, data, static_cast<DWORD>(size), &written, nullptr) && written == size;
+        };
+
+        auto threadCount = std::thread::hardware_concurrency();
+        bool compressed = DumpCompressor::Compress(read, write, threadCount > maxThreads ? maxThreads : threadCount);
+
+        CloseHandle(packedFile);
+        CloseHandle(rawFile);
+        if (!compressed)
+        {
+            DeleteFileW(packedPath);
+            return false;
+        }
+        return DeleteFileW(rawPath) != FALSE;
+    }
+#endif
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cwchar>
+
+
+namespace Utils
+{
+    /// Crash dump helper protocol (-dumphelper), shared by the proxy and bink2w64_dumphelper.exe.
+    /// The proxy creates a DumpIpcBlock in a named mapping plus a request and a done event
+    /// (names from DumpIpcName with the game's process ID), then starts the helper with that ID.
+    /// On a crash the proxy fills the block, sets State to Requested and signals; the helper
+    /// writes the dump from outside, reporting through State and Result.
+    enum DumpHelperState : uint32_t
+    {
+        DHS_STARTING = 0,    // Block created, helper not attached yet.
+        DHS_READY = 1,       // Helper is waiting for a request.
+        DHS_REQUESTED = 2,   // Proxy filled the block and signalled.
+        DHS_WRITING = 3,     // Helper picked the request up.
+        DHS_DONE = 4,        // Dump written, Result = 0.
+        DHS_FAILED = 5,      // Result = the helper's error code.
+    };
+
+    static const uint32_t DUMP_IPC_VERSION = 1;
+    static const size_t DUMP_IPC_PATH_CHARS = 260;
+    static const uint32_t DUMP_IPC_FLAG_COMPRESS = 1;   // Turn the dump into a .dmpz once it's written.
+
+    struct DumpIpcBlock
+    {
+        char Magic[8];                  // "LEBPDIPC"
+        uint32_t Version;
+        uint32_t HelperProcessId;
+        std::atomic<uint32_t> State;    // DumpHelperState
+        uint32_t ClientThreadId;        // Thread that crashed.
+        uint64_t ExceptionPointers;     // EXCEPTION_POINTERS*, in the proxy's address space.
+        uint64_t FlightSnapshot;        // Flight recorder snapshot, in the proxy's address space.
+        uint32_t FlightSnapshotSize;
+        uint32_t DumpType;              // MINIDUMP_TYPE
+        uint32_t Result;
+        uint32_t Flags;                 // DUMP_IPC_FLAG_*
+        uint16_t DumpPath[DUMP_IPC_PATH_CHARS];  // UTF-16, terminated.
+    };
+
+    class DumpIpc
+    {
+    public:
+        // Who may move the state where: the proxy claims Ready and re-arms after a result,
+        // the helper does everything else.
+        [[nodiscard]] static bool CanTransition(uint32_t from, uint32_t to) noexcept
+        {
+            switch (from)
+            {
+            case DHS_STARTING:   return to == DHS_READY;
+            case DHS_READY:      return to == DHS_REQUESTED;
+            case DHS_REQUESTED:  return to == DHS_WRITING || to == DHS_FAILED;
+            case DHS_WRITING:    return to == DHS_DONE || to == DHS_FAILED;
+            case DHS_DONE:
+            case DHS_FAILED:     return to == DHS_READY;
+            default:             return false;
+            }
+        }
+
+        // Move state from one value to another if it still holds from. Both sides only use this.
+        static bool TryTransition(std::atomic<uint32_t>& state, uint32_t from, uint32_t to) noexcept
+        {
+            return CanTransition(from, to) && state.compare_exchange_strong(from, to, std::memory_order_acq_rel);
+        }
+
+        // Kernel object names, kind is "Block", "Request" or "Done".
+        static void Name(wchar_t* out, size_t outChars, const wchar_t* kind, uint32_t clientProcessId)
+        {
+            swprintf(out, outChars, L"Local\\LEBinkProxyDump%ls_%u", kind, clientProcessId);
+        }
+    };
+}
@@ -0,0 +1,473 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+namespace Utils
+{
+    /// <summary>
+    /// Subscriptions to calls of specific functions (UFunction* for ProcessEvent), for one shared detour.
+    /// The detour asks Find for the handlers of the function being called: a lock-free probe of
+    /// an open-addressing table which only holds subscribed functions, so it is nearly always empty
+    /// where an unsubscribed function lands and the miss costs a single probe.
+    /// Subscriptions are either for a function or for every function with a given name key
+    /// (FName value). While there are name subscriptions, OnBind keeps track of the functions bound
+    /// and their names; those bound before come from the caller (forEachNamed, see Subscribe).
+    /// Without any, a bind costs one probe like a dispatch.
+    /// Handler lists are immutable once published. A dispatch reads them inside a Reader, changes
+    /// publish a new list and free the old one once every Reader that could have seen it is gone
+    /// (two reader counts, one per parity of the epoch). So once Unsubscribe returns, the handler
+    /// won't run again, which is what makes unloading a plugin safe; from inside a dispatch on the
+    /// same thread it can't wait for itself, the old lists are then freed by the next change made
+    /// outside of one.
+    /// </summary>
+    class EventDispatchTable
+    {
+    public:
+        static const size_t KEY_SLOTS = 1 << 14;   // Power of two, functions with subscriptions.
+        static const uint32_t FLAG_POST = 1;        // Run after the function instead of before.
+
+        struct Handler
+        {
+            void* Proc;
+            void* Context;
+            uint32_t Flags;
+        };
+
+        struct HandlerList
+        {
+            std::vector<Handler> Pre;
+            std::vector<Handler> Post;
+        };
+
+    private:
+        static const size_t MAX_PROBES = 64;
+
+        struct Slot
+        {
+            std::atomic<const void*> Key{ nullptr };
+            std::atomic<const HandlerList*> Handlers{ nullptr };
+        };
+
+        struct Subscription
+        {
+            uint32_t Id;
+            const void* Function;   // nullptr for a name subscription.
+            uint64_t NameKey;
+            Handler Entry;
+            const void* Owner;
+        };
+
+        std::unique_ptr<Slot[]> slots_;
+        std::mutex writeMtx_;
+        std::vector<Subscription> subscriptions_;
+        std::unordered_map<const void*, std::unique_ptr<HandlerList>> published_;
+        std::vector<std::unique_ptr<HandlerList>> retired_;   // Unpublished, not freed yet.
+        std::atomic<bool> tracking_{ false };       // Whether there are name subscriptions, OnBind skips the rest otherwise.
+        size_t nameSubscriptions_ = 0;
+        std::unordered_map<uint64_t, std::vector<const void*>> boundByName_;
+        std::unordered_map<const void*, uint64_t> nameOfBound_;
+        std::unordered_set<uint64_t> resolvedNames_;   // Looked up through forEachNamed since tracking began.
+        uint32_t nextId_ = 1;
+
+        std::mutex syncMtx_;                        // One writer waits for readers at a time.
+        std::atomic<uint64_t> epoch_{ 0 };
+        mutable std::atomic<size_t> readers_[2] = {};
+
+        static inline thread_local size_t readDepth_ = 0;
+
+        static size_t slot_(const void* function) noexcept
+        {
+            return static_cast<size_t>((reinterpret_cast<uintptr_t>(function) * 0x9E3779B97F4A7C15ull) >> 40) & (KEY_SLOTS - 1);
+        }
+
+        // Writers only: the slot holding function, or the empty one it would take, or nullptr if full around it.
+        Slot* claim_(const void* function) noexcept
+        {
+            for (size_t i = 0, s = slot_(function); i < MAX_PROBES; i++, s = (s + 1) & (KEY_SLOTS - 1))
+            {
+                auto key = slots_[s].Key.load(std::memory_order_relaxed);
+                if (key == function || key == nullptr)
+                {
+                    return &slots_[s];
+                }
+            }
+            return nullptr;
+        }
+
+        // Writers only: publish the handlers of a function as the subscriptions stand.
+        bool rebuild_(const void* function)
+        {
+            auto nameIt = nameOfBound_.find(function);
+            auto list = std::make_unique<HandlerList>();
+            for (const auto& sub : subscriptions_)
+            {
+                bool applies = sub.Function
+                    ? sub.Function == function
+                    : nameIt != nameOfBound_.end() && nameIt->second == sub.NameKey;
+                if (applies)
+                {
+                    (sub.Entry.Flags & FLAG_POST ? list->Post : list->Pre).push_back(sub.Entry);
+                }
+            }
+
+            auto slot = claim_(function);
+            if (!slot)
+            {
+                return false;
+            }
+            auto old = published_.find(function);
+            if (list->Pre.empty() && list->Post.empty())
+            {
+                // The key stays where it is, Find returns nullptr for it like for any other miss.
+                if (slot->Key.load(std::memory_order_relaxed) == function)
+                {
+                    slot->Handlers.store(nullptr, std::memory_order_release);
+                }
+                if (old != published_.end())
+                {
+                    retired_.push_back(std::move(old->second));
+                    published_.erase(old);
+                }
+                return true;
+            }
+
+            slot->Handlers.store(list.get(), std::memory_order_release);
+            slot->Key.store(function, std::memory_order_release);
+            if (old != published_.end())
+            {
+                retired_.push_back(std::move(old->second));
+                old->second = std::move(list);
+            }
+            else
+            {
+                published_.emplace(function, std::move(list));
+            }
+            return true;
+        }
+
+        // After unpublishing lists (writeMtx_ not held, a handler may change subscriptions too):
+        // wait until no dispatch can still be using them and free them.
+        void reclaim_()
+        {
+            std::vector<std::unique_ptr<HandlerList>> retired;
+            if (readDepth_ != 0)
+            {
+                return;     // Inside a dispatch, which would wait for itself.
+            }
+            {
+                const std::lock_guard<std::mutex> lock(writeMtx_);
+                retired.swap(retired_);
+            }
+
+            // Readers which entered before the flip count under the old parity, the ones after it
+            // can only see the lists published since.
+            const std::lock_guard<std::mutex> sync(syncMtx_);
+            auto parity = epoch_.fetch_add(1) & 1;
+            while (readers_[parity].load() != 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        // Writers only: remember a bound function's name, it's in no other name's list.
+        void track_(const void* function, uint64_t nameKey)
+        {
+            nameOfBound_[function] = nameKey;
+            boundByName_[nameKey].push_back(function);
+        }
+
+        // Writers only: the subscriptions left have no names, nothing needs tracking until the next.
+        void stopTracking_()
+        {
+            tracking_.store(false, std::memory_order_relaxed);
+            boundByName_.clear();
+            nameOfBound_.clear();
+            resolvedNames_.clear();
+        }
+
+        // Writers only, after a subscription went.
+        void forget_(const Subscription& sub)
+        {
+            rebuildFor_(sub);
+            if (!sub.Function && --nameSubscriptions_ == 0)
+            {
+                stopTracking_();
+            }
+        }
+
+        void rebuildFor_(const Subscription& sub)
+        {
+            if (sub.Function)
+            {
+                rebuild_(sub.Function);
+                return;
+            }
+            auto it = boundByName_.find(sub.NameKey);
+            if (it != boundByName_.end())
+            {
+                for (auto function : it->second)
+                {
+                    rebuild_(function);
+                }
+            }
+        }
+
+    public:
+        // Held while a dispatch uses handler lists, the lists it got from Find stay valid until it goes.
+        class Reader
+        {
+        private:
+            const EventDispatchTable& table_;
+            size_t parity_;
+
+        public:
+            explicit Reader(const EventDispatchTable& table) noexcept
+                : table_{ table }
+            {
+                for (;;)
+                {
+                    auto epoch = table_.epoch_.load();
+                    parity_ = static_cast<size_t>(epoch & 1);
+                    table_.readers_[parity_].fetch_add(1);
+                    if (table_.epoch_.load() == epoch)
+                    {
+                        break;
+                    }
+                    table_.readers_[parity_].fetch_sub(1);    // A writer flipped it in between.
+                }
+                readDepth_++;
+            }
+
+            ~Reader()
+            {
+                readDepth_--;
+                table_.readers_[parity_].fetch_sub(1);
+            }
+
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+        };
+
+        EventDispatchTable()
+            : slots_{ new Slot[KEY_SLOTS] }
+        {
+        }
+
+        // Handlers of a function, nullptr if it has none. Lock-free, called for every dispatched call.
+        // Only compare the result with nullptr, unless there's a Reader around it.
+        const HandlerList* Find(const void* function) const noexcept
+        {
+            for (size_t i = 0, s = slot_(function); i < MAX_PROBES; i++, s = (s + 1) & (KEY_SLOTS - 1))
+            {
+                auto key = slots_[s].Key.load(std::memory_order_acquire);
+                if (key == function)
+                {
+                    return slots_[s].Handlers.load(std::memory_order_acquire);
+                }
+                if (key == nullptr)
+                {
+                    return nullptr;
+                }
+            }
+            return nullptr;
+        }
+
+        // Subscribe to a function, or with function nullptr to every function named nameKey.
+        // OnBind only tracks names while there are name subscriptions, so a name subscription looks
+        // up the functions named nameKey bound so far: forEachNamed(nameKey, visit) calls
+        // visit(const void* function) for each of them (anything else of that name is harmless).
+        // It runs under the write lock, once per name until the name subscriptions are all gone.
+        // Returns the subscription's ID, 0 if there's no room left for the function.
+        template<typename TForEachNamed>
+        uint32_t Subscribe(const void* function, uint64_t nameKey, void* proc, void* context, uint32_t flags, const void* owner,
+            TForEachNamed&& forEachNamed)
+        {
+            if (!proc)
+            {
+                return 0;
+            }
+
+            uint32_t id;
+            {
+                const std::lock_guard<std::mutex> lock(writeMtx_);
+
+                subscriptions_.push_back(Subscription{ nextId_, function, nameKey, Handler{ proc, context, flags }, owner });
+                if (function && !rebuild_(function))
+                {
+                    subscriptions_.pop_back();
+                    return 0;
+                }
+                if (!function)
+                {
+                    // Tracking first: a function bound meanwhile is either tracked or already there to find.
+                    nameSubscriptions_++;
+                    tracking_.store(true, std::memory_order_relaxed);
+                    if (resolvedNames_.insert(nameKey).second)
+                    {
+                        forEachNamed(nameKey, [this, nameKey](const void* bound)
+                        {
+                            if (nameOfBound_.find(bound) == nameOfBound_.end())
+                            {
+                                track_(bound, nameKey);
+                            }
+                        });
+                    }
+                    rebuildFor_(subscriptions_.back());
+                }
+                id = nextId_++;
+            }
+            reclaim_();
+            return id;
+        }
+
+        // Subscribe with nothing bound before, or nothing to look it up with.
+        uint32_t Subscribe(const void* function, uint64_t nameKey, void* proc, void* context, uint32_t flags, const void* owner)
+        {
+            return Subscribe(function, nameKey, proc, context, flags, owner, [](uint64_t, auto&&) {});
+        }
+
+        // Once it returns, the handler isn't running anywhere (except in the calling thread).
+        bool Unsubscribe(uint32_t id)
+        {
+            {
+                const std::lock_guard<std::mutex> lock(writeMtx_);
+
+                auto it = subscriptions_.begin();
+                while (it != subscriptions_.end() && it->Id != id)
+                {
+                    ++it;
+                }
+                if (it == subscriptions_.end())
+                {
+                    return false;
+                }
+                auto sub = *it;
+                subscriptions_.erase(it);
+                forget_(sub);
+            }
+            reclaim_();
+            return true;
+        }
+
+        // Drop everything a plugin subscribed.
+        size_t UnsubscribeOwnedBy(const void* owner)
+        {
+            if (!owner)
+            {
+                return 0;
+            }
+
+            std::vector<Subscription> removed;
+            {
+                const std::lock_guard<std::mutex> lock(writeMtx_);
+
+                for (auto it = subscriptions_.begin(); it != subscriptions_.end(); )
+                {
+                    if (it->Owner == owner)
+                    {
+                        removed.push_back(*it);
+                        it = subscriptions_.erase(it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+                for (const auto& sub : removed)
+                {
+                    forget_(sub);
+                }
+            }
+            if (!removed.empty())
+            {
+                reclaim_();
+            }
+            return removed.size();
+        }
+
+        // A function was bound (loaded), name subscriptions pick it up from here.
+        // A function bound again at the same address is a new function, whatever was subscribed
+        // to the old one by pointer is dropped (so is anything subscribed to it by pointer before
+        // its first bind, plugins get functions from GObjects once they are loaded).
+        // Called for every function the game binds: without name subscriptions, and nothing
+        // subscribed to this function, it's one probe and no lock.
+        void OnBind(const void* function, uint64_t nameKey)
+        {
+            if (!tracking_.load(std::memory_order_relaxed) && !Find(function))
+            {
+                return;
+            }
+
+            {
+                const std::lock_guard<std::mutex> lock(writeMtx_);
+
+                for (auto it = subscriptions_.begin(); it != subscriptions_.end(); )
+                {
+                    it = it->Function == function ? subscriptions_.erase(it) : it + 1;
+                }
+
+                bool named = false;
+                if (tracking_.load(std::memory_order_relaxed))
+                {
+                    auto known = nameOfBound_.find(function);
+                    if (known != nameOfBound_.end())
+                    {
+                        auto& functions = boundByName_[known->second];
+                        for (auto it = functions.begin(); it != functions.end(); ++it)
+                        {
+                            if (*it == function)
+                            {
+                                functions.erase(it);
+                                break;
+                            }
+                        }
+                    }
+                    track_(function, nameKey);
+
+                    for (const auto& sub : subscriptions_)
+                    {
+                        named |= !sub.Function && sub.NameKey == nameKey;
+                    }
+                }
+                if (named || Find(function))
+                {
+                    rebuild_(function);
+                }
+                if (retired_.empty())
+                {
+                    return;
+                }
+            }
+            reclaim_();
+        }
+
+        // Functions whose names are tracked, 0 without name subscriptions.
+        [[nodiscard]] size_t TrackedCount()
+        {
+            const std::lock_guard<std::mutex> lock(writeMtx_);
+            return nameOfBound_.size();
+        }
+
+        [[nodiscard]] size_t SubscriptionCount()
+        {
+            const std::lock_guard<std::mutex> lock(writeMtx_);
+            return subscriptions_.size();
+        }
+
+        // Handler lists allocated, the published ones and those waiting to be freed.
+        [[nodiscard]] size_t ListCount()
+        {
+            const std::lock_guard<std::mutex> lock(writeMtx_);
+            return published_.size() + retired_.size();
+        }
+    };
+}
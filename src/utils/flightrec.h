@@ -0,0 +1,260 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <unistd.h>
+#endif
+#include "../utils/tickclock.h"
+
+
+namespace Utils
+{
+    /// Flight recorder snapshot layout (little endian), shared with LogDecoder.
+    /// The same bytes go into the minidump as a user stream (FLIGHT_STREAM_TYPE) and into a sidecar .flight file:
+    ///   FlightSnapshotHeader, then EntryCount FlightEntry records, oldest first
+    enum FlightEvent : uint16_t
+    {
+        FE_NOTE = 1,
+        FE_HOOK_INSTALLED = 2,     // A = target, B = detour, text = hook name
+        FE_HOOK_FAILED = 3,        // A = target, B = status, text = hook name
+        FE_HOOK_REMOVED = 4,       // A = target or owner, B = count, text = hook name
+        FE_PATTERN_FOUND = 5,      // A = address, text = leading pattern bytes
+        FE_PATTERN_MISSED = 6,     // text = leading pattern bytes
+        FE_PLUGIN_LOADED = 7,      // A = module, text = file name
+        FE_PLUGIN_ATTACHING = 8,   // A = module, B = 1 if async, text = file name
+        FE_PLUGIN_ATTACHED = 9,    // A = module, B = result, text = file name
+        FE_PLUGIN_DETACHED = 10,   // A = module, B = result, text = file name
+        FE_EXCEPTION = 11,         // A = code, B = address
+        FE_MOVIE_OPENED = 12,      // A = HBINK, B = open flags, text = file name
+        FE_MOVIE_CLOSED = 13,      // A = HBINK, B = frames decoded (with -binkstats)
+    };
+
+    static const uint32_t FLIGHT_STREAM_TYPE = 0x4C450001;  // Above LastReservedStream.
+    static const size_t FLIGHT_TEXT_CHARS = 24;
+
+    struct FlightEntry
+    {
+        uint32_t Sequence;         // FlightSequence(position), 0 while the slot is being written.
+        uint16_t Kind;
+        uint16_t Reserved;
+        uint32_t ThreadId;
+        uint32_t Reserved2;
+        uint64_t Tick;
+        uint64_t A;
+        uint64_t B;
+        char Text[FLIGHT_TEXT_CHARS];  // Not terminated if full.
+    };
+    static_assert(sizeof(FlightEntry) == 64, "FlightEntry must stay 64 bytes, LogDecoder depends on it");
+
+    struct FlightSnapshotHeader
+    {
+        char Magic[8];             // "LEBPFLT1"
+        uint64_t TicksPerSecond;
+        uint64_t SnapshotTick;
+        uint64_t SnapshotFileTime; // local FILETIME
+        uint32_t ProcessId;
+        uint32_t CrashThreadId;
+        uint32_t EntryCount;
+        uint32_t EntrySize;
+    };
+
+    // The Sequence an entry at a recorder position is published with. Skips 0 when the 32-bit
+    // value wraps, which a plain position + 1 would hit every 2^32 events.
+    inline uint32_t FlightSequence(uint64_t position)
+    {
+        return static_cast<uint32_t>(position % 0xFFFFFFFFull) + 1;
+    }
+
+    inline const char* FlightEventName(uint16_t kind)
+    {
+        switch (kind)
+        {
+        case FE_NOTE:              return "note";
+        case FE_HOOK_INSTALLED:    return "hook installed";
+        case FE_HOOK_FAILED:       return "hook failed";
+        case FE_HOOK_REMOVED:      return "hook removed";
+        case FE_PATTERN_FOUND:     return "pattern found";
+        case FE_PATTERN_MISSED:    return "pattern missed";
+        case FE_PLUGIN_LOADED:     return "plugin loaded";
+        case FE_PLUGIN_ATTACHING:  return "plugin attaching";
+        case FE_PLUGIN_ATTACHED:   return "plugin attached";
+        case FE_PLUGIN_DETACHED:   return "plugin detached";
+        case FE_EXCEPTION:         return "exception";
+        case FE_MOVIE_OPENED:      return "movie opened";
+        case FE_MOVIE_CLOSED:      return "movie closed";
+        default:                   return "unknown";
+        }
+    }
+
+    /// <summary>
+    /// Always-on, fixed-size record of the last proxy events (hooks, patterns, plugin steps),
+    /// attached to minidumps so a crash report says what happened right before it.
+    /// Recording is one atomic increment and a 64-byte write, old entries are overwritten.
+    /// </summary>
+    class FlightRecorder
+    {
+    public:
+        static const size_t CAPACITY = 1024;  // Entries, 64 KB.
+        static const size_t SNAPSHOT_SIZE = sizeof(FlightSnapshotHeader) + CAPACITY * sizeof(FlightEntry);
+
+    private:
+        FlightEntry entries_[CAPACITY];
+        std::atomic<uint64_t> nextPosition_{ 0 };
+
+        static std::atomic<uint32_t>& sequenceOf_(FlightEntry& entry) { return reinterpret_cast<std::atomic<uint32_t>&>(entry.Sequence); }
+        static const std::atomic<uint32_t>& sequenceOf_(const FlightEntry& entry) { return reinterpret_cast<const std::atomic<uint32_t>&>(entry.Sequence); }
+
+        static uint32_t currentThreadId_()
+        {
+#ifdef _WIN32
+            return GetCurrentThreadId();
+#else
+            return static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+#endif
+        }
+
+        // Writers work like a seqlock: clear the sequence, fill the entry, publish the new sequence.
+        FlightEntry& claim_(uint16_t kind, uint64_t a, uint64_t b, uint32_t* outSequence)
+        {
+            auto position = nextPosition_.fetch_add(1, std::memory_order_relaxed);
+            auto& entry = entries_[position % CAPACITY];
+
+            sequenceOf_(entry).store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);  // The 0 goes out before any field changes.
+            entry.Kind = kind;
+            entry.ThreadId = currentThreadId_();
+            entry.Tick = TickClock::Now();
+            entry.A = a;
+            entry.B = b;
+            *outSequence = FlightSequence(position);
+            return entry;
+        }
+
+        static void publish_(FlightEntry& entry, uint32_t sequence)
+        {
+            sequenceOf_(entry).store(sequence, std::memory_order_release);
+        }
+
+        void stampHeader_(FlightSnapshotHeader* header, uint32_t crashThreadId)
+        {
+            memcpy(header->Magic, "LEBPFLT1", 8);
+#ifdef _WIN32
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            SYSTEMTIME localTime;
+            FILETIME localFileTime;
+            GetLocalTime(&localTime);
+            SystemTimeToFileTime(&localTime, &localFileTime);
+
+            header->TicksPerSecond = frequency.QuadPart;
+            header->SnapshotFileTime = (static_cast<uint64_t>(localFileTime.dwHighDateTime) << 32) | localFileTime.dwLowDateTime;
+            header->ProcessId = GetCurrentProcessId();
+#else
+            // steady_clock ticks, UTC as a FILETIME (100 ns since 1601).
+            auto sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+            header->TicksPerSecond = std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+            header->SnapshotFileTime = std::chrono::duration_cast<std::chrono::microseconds>(sinceEpoch).count() * 10ull + 116444736000000000ull;
+            header->ProcessId = static_cast<uint32_t>(getpid());
+#endif
+            header->SnapshotTick = TickClock::Now();
+            header->CrashThreadId = crashThreadId;
+            header->EntrySize = sizeof(FlightEntry);
+        }
+
+    public:
+        // firstPosition lets the tests start where the 32-bit sequence wraps.
+        explicit FlightRecorder(uint64_t firstPosition = 0)
+            : nextPosition_{ firstPosition }
+        {
+            memset(entries_, 0, sizeof(entries_));
+        }
+
+        void Record(FlightEvent kind, uint64_t a, uint64_t b, const char* text)
+        {
+            uint32_t sequence;
+            auto& entry = claim_(kind, a, b, &sequence);
+            auto length = text ? strnlen(text, FLIGHT_TEXT_CHARS) : 0;
+            memcpy(entry.Text, text ? text : "", length);
+            memset(entry.Text + length, 0, FLIGHT_TEXT_CHARS - length);
+            publish_(entry, sequence);
+        }
+
+        // Keeps the tail of the text (the file name end of a path), non-ASCII becomes '?'.
+        void Record(FlightEvent kind, uint64_t a, uint64_t b, const wchar_t* text)
+        {
+            uint32_t sequence;
+            auto& entry = claim_(kind, a, b, &sequence);
+            auto length = text ? wcslen(text) : 0;
+            auto skip = length > FLIGHT_TEXT_CHARS ? length - FLIGHT_TEXT_CHARS : 0;
+            for (size_t i = 0; i < FLIGHT_TEXT_CHARS; i++)
+            {
+                auto c = skip + i < length ? text[skip + i] : L'\0';
+                entry.Text[i] = c < 0x80 ? static_cast<char>(c) : '?';
+            }
+            publish_(entry, sequence);
+        }
+
+        // Records the leading bytes of a pattern as hex, "??" for wildcards.
+        void RecordPattern(uint8_t* address, const uint8_t* pattern, const uint8_t* mask)
+        {
+            static const char digits[] = "0123456789ABCDEF";
+
+            uint32_t sequence;
+            auto& entry = claim_(address ? FE_PATTERN_FOUND : FE_PATTERN_MISSED, reinterpret_cast<uintptr_t>(address), 0, &sequence);
+            memset(entry.Text, 0, FLIGHT_TEXT_CHARS);
+            for (size_t i = 0; i < FLIGHT_TEXT_CHARS / 2 && mask[i] != '\0'; i++)
+            {
+                entry.Text[i * 2] = mask[i] == '?' ? '?' : digits[pattern[i] >> 4];
+                entry.Text[i * 2 + 1] = mask[i] == '?' ? '?' : digits[pattern[i] & 0xF];
+            }
+            publish_(entry, sequence);
+        }
+
+        // Copy the recorded entries into buffer (SNAPSHOT_SIZE bytes), oldest first.
+        // Allocation-free, meant for the crash handler. Returns the number of bytes used.
+        size_t Snapshot(uint8_t* buffer, uint32_t crashThreadId)
+        {
+            auto header = reinterpret_cast<FlightSnapshotHeader*>(buffer);
+            auto out = reinterpret_cast<FlightEntry*>(buffer + sizeof(FlightSnapshotHeader));
+            stampHeader_(header, crashThreadId);
+
+            // Walk from the oldest possible position, skipping slots that are empty, torn or already reused.
+            // Other threads keep recording meanwhile, so an entry only counts if its sequence is still
+            // the expected one after the copy.
+            auto end = nextPosition_.load(std::memory_order_acquire);
+            auto begin = end > CAPACITY ? end - CAPACITY : 0;
+            uint32_t count = 0;
+            for (auto position = begin; position != end; position++)
+            {
+                const auto& entry = entries_[position % CAPACITY];
+                auto expected = FlightSequence(position);
+                if (sequenceOf_(entry).load(std::memory_order_acquire) != expected)
+                {
+                    continue;
+                }
+                memcpy(&out[count], &entry, sizeof(FlightEntry));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequenceOf_(entry).load(std::memory_order_relaxed) != expected)
+                {
+                    continue;
+                }
+                out[count++].Sequence = expected;
+            }
+
+            header->EntryCount = count;
+            return sizeof(FlightSnapshotHeader) + count * sizeof(FlightEntry);
+        }
+    };
+
+#ifdef _WIN32
+    FlightRecorder GFlightRecorder;
+#endif
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "../minhook/include/MinHook.h"
+#include "utils/flightrec.h"
 #include "utils/io.h"
+#include "utils/profiler.h"
 
 
 namespace Utils
@@ -23,6 +25,8 @@ namespace Utils
 
         bool Install(LPVOID pTarget, LPVOID pDetour, LPVOID* ppOriginal, char* name)
         {
+            PROFILE_SCOPE(Hook, "HookManager.Install", name);
+
             if (!initialized_)
             {
                 GLogger.writeln(L"HookManager.Install: ERROR: the manager wasn't initialized properly.");
@@ -33,24 +37,36 @@ namespace Utils
             if (lastStatus_ != MH_OK)
             {
                 GLogger.writeln(L"HookManager.Install: ERROR: creating [%S] failed, status = %d", name, lastStatus_);
+                GFlightRecorder.Record(FE_HOOK_FAILED, reinterpret_cast<ULONG_PTR>(pTarget), lastStatus_, name);
                 return false;
             }
-            GLogger.writeln(L"HookManager.Install: created hook [%S]", name);
+            GLOG_DEBUG(Hooks, L"HookManager.Install: created hook [%S]", name);
 
 
             lastStatus_ = MH_EnableHook(pTarget);
             if (lastStatus_ != MH_OK)
             {
                 GLogger.writeln(L"HookManager.Install: ERROR: enabling [%S] failed, status = %d", name, lastStatus_);
+                GFlightRecorder.Record(FE_HOOK_FAILED, reinterpret_cast<ULONG_PTR>(pTarget), lastStatus_, name);
                 return false;
             }
-            GLogger.writeln(L"HookManager.Install: installed hook [%S]", name);
+            GLOG_DEBUG(Hooks, L"HookManager.Install: installed hook [%S]", name);
+            GFlightRecorder.Record(FE_HOOK_INSTALLED, reinterpret_cast<ULONG_PTR>(pTarget), reinterpret_cast<ULONG_PTR>(pDetour), name);
 
             return true;
         }
 
-        bool Uninstall(LPVOID pTarget)
+        // Disable and remove a hook made by Install.
+        bool Uninstall(LPVOID pTarget, char* name)
         {
+            lastStatus_ = MH_RemoveHook(nullptr, pTarget);
+            if (lastStatus_ != MH_OK)
+            {
+                GLogger.writeln(L"HookManager.Uninstall: ERROR: removing [%S] failed, status = %d", name, lastStatus_);
+                return false;
+            }
+            GLOG_DEBUG(Hooks, L"HookManager.Uninstall: removed hook [%S]", name);
+            GFlightRecorder.Record(FE_HOOK_REMOVED, reinterpret_cast<ULONG_PTR>(pTarget), 1, name);
             return true;
         }
     };
@@ -7,22 +7,32 @@
 #include <cstdio>
 #include <cstring>
 
+#include <atomic>
 #include <mutex>
 #include <thread>
 
+#include "../utils/binlog.h"
+#include "../utils/logfilter.h"
+#include "../utils/logring.h"
+#include "../utils/rollinglog.h"
+#include "../utils/tickclock.h"
+
 
 #ifndef ASI_LOG_FNAME
 #error Must set ASI log filename!
 #endif
+#ifndef ASI_ROLLINGLOG_FNAME
+#error Must set ASI rolling log filename!
+#endif
 
 #define ASI_IO_LOCK(MUTEX) const std::lock_guard<std::mutex> lock(MUTEX);
 
 namespace Utils
 {
     FILE* FGLog = nullptr;
+    RollingLogFile GRollingLog;
 	std::mutex GOpenConsoleMtx;
 	std::mutex GCloseConsoleMtx;
-	std::mutex GWriteLineMtx;
 
 	void OpenConsole(FILE* out, FILE* err)
 	{
@@ -45,7 +55,7 @@ namespace Utils
 	}
 
     // Open a console window and redirect output to it.
-    // In release mode, redirect all output to a file.
+    // In release mode, redirect all output to a file, or to the rolling log with -rollinglog.
     void SetupOutput()
     {
 #ifdef ASI_DEBUG
@@ -54,6 +64,12 @@ namespace Utils
 #else
 #define ASIOUT FGLog
 
+		// Keeps the last few sessions in a fixed-size file, read it with LogDecoder.
+		if (nullptr != wcsstr(GetCommandLineW(), L" -rollinglog") && GRollingLog.Open(ASI_ROLLINGLOG_FNAME))
+		{
+			return;
+		}
+
 		FGLog = fopen(ASI_LOG_FNAME, "w");
         if (FGLog == NULL)
         {
@@ -72,54 +88,269 @@ namespace Utils
         if (FGLog != nullptr)
         {
             fclose(FGLog);
+            FGLog = nullptr;
         }
+        GRollingLog.Close();
 #endif
     }
 
+	struct LogRecord
+	{
+		static const size_t MAX_CHARS = 1024;
+
+		LONGLONG Tick;                                    // QPC, turned into wall clock time by the writer.
+		int Length;
+		wchar_t Text[MAX_CHARS];
+	};
+
+	/// <summary>
+	/// Asynchronous logger. Callers format straight into a slot of a lock-free ring,
+	/// a writer thread drains it and writes whole batches with a single flush.
+	/// Until StartWriter() (and after Shutdown()), lines are written synchronously.
+	/// </summary>
 	struct RuntimeLogger
 	{
 	private:
-		bool initialized = false;
-		SYSTEMTIME localTime;
+		static const size_t RING_CAPACITY = 2048;         // Records, ~4.2 MB.
+		static const size_t BATCH_CHARS = 64 * 1024;      // Writer batch buffer size.
+		static const DWORD WRITER_PERIOD_MS = 50;         // Max. delay before a line reaches the disk.
+		static const int PUSH_RETRIES = 64;               // Attempts on a full ring before dropping a line.
+		static const LONGLONG REANCHOR_SECONDS = 60;      // Follow wall clock changes this often.
+		static const int SHUTDOWN_WAIT_MS = 500;          // How long Shutdown() waits for the writer to let go.
+
+		MpscRing<LogRecord, RING_CAPACITY> ring_;
+		std::mutex drainMtx_;                             // One consumer at a time: writer thread, sync writes, shutdown. Only a crash may steal it.
+		std::atomic<bool> writerRunning_{ false };
+		std::atomic<bool> stopping_{ false };
+		std::atomic<size_t> droppedCount_{ 0 };
+		HANDLE wakeEvent_ = nullptr;
+		wchar_t batch_[BATCH_CHARS];
+		TickClock clock_;                                 // Consumer side only.
+		bool clockAnchored_ = false;
+
+		void writeBatch_(size_t length)
+		{
+			if (ASIOUT != nullptr)
+			{
+				batch_[length] = L'\0';
+				fputws(batch_, ASIOUT);
+			}
+			if (GRollingLog.IsOpen())
+			{
+				GRollingLog.Write(batch_, length);
+			}
+		}
+
+		// Move everything in the ring to the output. Caller must own drainMtx_ (or be the crash handler, see below).
+		void drainLocked_()
+		{
+			// Calibrate once per batch at most, each record then only needs arithmetic.
+			if (!clockAnchored_ || clock_.MicrosecondsSinceAnchor(TickClock::Now()) > REANCHOR_SECONDS * 1000000)
+			{
+				clock_.AnchorNow();
+				clockAnchored_ = true;
+			}
+
+			size_t length = 0;
+			auto appendRecord = [this, &length](const LogRecord& record)
+			{
+				// Worst case: timestamp (14) + text + newline.
+				if (length + 16 + record.Length >= BATCH_CHARS)
+				{
+					writeBatch_(length);
+					length = 0;
+				}
+
+				auto time = clock_.ToWallTime(record.Tick);
+				auto written = _snwprintf_s(batch_ + length, BATCH_CHARS - length, _TRUNCATE, L"%02u:%02u:%02u.%03u  %s\n",
+					time.Hour, time.Minute, time.Second, time.Millisecond, record.Text);
+				length += written > 0 ? written : 0;
+			};
+
+			bool any = false;
+			while (ring_.TryPop(appendRecord))
+			{
+				any = true;
+			}
+
+			Binary.DrainLocked();
+
+			auto dropped = droppedCount_.exchange(0, std::memory_order_relaxed);
+			if (dropped != 0)
+			{
+				LogRecord note;
+				note.Tick = TickClock::Now();
+				note.Length = _snwprintf_s(note.Text, LogRecord::MAX_CHARS, _TRUNCATE, L"writeln: dropped %llu line(s), the log ring was full", dropped);
+				appendRecord(note);
+				any = true;
+			}
+
+			if (any)
+			{
+				writeBatch_(length);
+				if (ASIOUT != nullptr) fflush(ASIOUT);
+			}
+		}
+
+		// The crash handler's drain. The owner of drainMtx_ may be the crashing thread, or frozen by it,
+		// so after a short wait this drains anyway. Nothing else may do that: it makes a second consumer.
+		void drainForCrash_()
+		{
+			for (int attempt = 0; attempt < 100; attempt++)
+			{
+				if (drainMtx_.try_lock())
+				{
+					drainLocked_();
+					drainMtx_.unlock();
+					return;
+				}
+				Sleep(1);
+			}
 
-		int writeInternal(FILE* stream, wchar_t* line, wchar_t* postfix)
+			// Whoever holds it isn't coming back, a torn line is better than a lost log.
+			drainLocked_();
+		}
+
+		void writerLoop_()
 		{
-			GetLocalTime(&localTime);
-			return fwprintf(stream, L"%02d:%02d:%02d.%03d  %s%s", localTime.wHour, localTime.wMinute, localTime.wSecond, localTime.wMilliseconds, line, postfix ? postfix : L"");
+			while (true)
+			{
+				WaitForSingleObject(wakeEvent_, WRITER_PERIOD_MS);
+				ASI_IO_LOCK(drainMtx_);
+				if (stopping_.load(std::memory_order_relaxed))
+				{
+					return;  // Shutdown() drains what is left, under the lock.
+				}
+				drainLocked_();
+			}
 		}
 
-		int writeAndFlush(wchar_t* line, wchar_t* postfix)
+		static DWORD WINAPI writerThread_(LPVOID lpParameter)
 		{
-			int rv = writeInternal(ASIOUT, line, postfix);
-			fflush(ASIOUT);
-			return rv;
+			reinterpret_cast<RuntimeLogger*>(lpParameter)->writerLoop_();
+			return 0;
 		}
 
 	public:
-		int writeln(wchar_t* fmt_line, ...)
+		BinaryLog Binary;                                 // Only used with -binarylog, see GLOG_FAST.
+		LogFilter Filter;                                 // Levels for GLOG_*, see -loglevel=.
+
+		// Start the background writer thread.
+		bool StartWriter()
+		{
+			if (writerRunning_.load() || ring_.InError())
+			{
+				return false;
+			}
+
+			wakeEvent_ = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+			if (!wakeEvent_ || !CreateThread(nullptr, 0, writerThread_, this, 0, nullptr))
+			{
+				return false;
+			}
+			Binary.SetWakeEvent(wakeEvent_);
+
+			writerRunning_.store(true);
+			return true;
+		}
+
+		// Write out everything queued so far, on the calling thread.
+		// Crash handler only, this drains even if drainMtx_ can't be had.
+		void FlushFromCrash()
 		{
-			ASI_IO_LOCK(GWriteLineMtx);
+			drainForCrash_();
+		}
 
-			int rc;
-			wchar_t buffer[1024];
+		// Stop the writer, then flush and close the outputs under drainMtx_, call before TeardownOutput().
+		// Doesn't wait for the writer thread to exit, this runs under the loader lock; the writer only
+		// has to let go of drainMtx_, which it does as soon as it sees stopping_.
+		// If it can't be had in time (the writer was frozen mid-drain), the queue is left as it is.
+		void Shutdown()
+		{
+			stopping_.store(true);
+			if (wakeEvent_)
+			{
+				SetEvent(wakeEvent_);
+			}
+
+			for (int waited = 0; !drainMtx_.try_lock(); waited++)
+			{
+				if (waited >= SHUTDOWN_WAIT_MS)
+				{
+					return;
+				}
+				Sleep(1);
+			}
+
+			writerRunning_.store(false);
+			drainLocked_();
+			Binary.Close();
+			drainMtx_.unlock();
+		}
+
+		// GLOG_FAST's one-time registration of a call site. Two formats under one ID would decode as
+		// each other, so a site whose ID is taken logs as text from then on, and says so here.
+		bool RegisterFastSite(uint32_t id, const wchar_t* format)
+		{
+			const wchar_t* taken = nullptr;
+			if (Binary.Register(id, format, &taken))
+			{
+				return true;
+			}
+			writeln(L"GLOG_FAST: ERROR: ID %08X of \"%s\" is taken by \"%s\", this site logs as text", id, format, taken);
+			return false;
+		}
+
+		int writeln(wchar_t* fmt_line, ...)
+		{
+			int rc = 0;
 
 			va_list args;
 			va_start(args, fmt_line);
-			rc = _vsnwprintf(buffer, 1024, fmt_line, args);
+			bool pushed = false;
+			for (int attempt = 0; attempt < PUSH_RETRIES && !pushed; attempt++)
+			{
+				pushed = ring_.TryPush([&rc, fmt_line, args](LogRecord& record)
+					{
+						record.Tick = TickClock::Now();
+						rc = _vsnwprintf_s(record.Text, LogRecord::MAX_CHARS, _TRUNCATE, fmt_line, args);
+						if (rc < 0 && record.Text[0] != L'\0')
+						{
+							rc = static_cast<int>(wcslen(record.Text));  // truncated, keep what fit
+						}
+						else if (rc < 0)
+						{
+							rc = _snwprintf_s(record.Text, LogRecord::MAX_CHARS, _TRUNCATE, L"writeln: vsnprintf error or truncation [%s]", fmt_line);
+						}
+						record.Length = rc;
+					});
+
+				if (!pushed)
+				{
+					// Ring is full, hurry the writer up (it may also be suspended by a thread freeze).
+					if (wakeEvent_) SetEvent(wakeEvent_);
+					SwitchToThread();
+				}
+			}
 			va_end(args);
 
-			if (rc < 0)
+			if (!pushed)
 			{
-				writeAndFlush(L"writeln: vsnprintf encoding error", L"\n");
+				droppedCount_.fetch_add(1, std::memory_order_relaxed);
 				return -1;
 			}
-			else if (rc == 0)
+
+			if (!writerRunning_.load(std::memory_order_relaxed))
 			{
-				writeAndFlush(L"writeln: vsnprintf runtime constraint violation", L"\n");
-				return -1;
+				ASI_IO_LOCK(drainMtx_);
+				drainLocked_();
+			}
+			else if (ring_.ApproxSize() >= RING_CAPACITY / 2)
+			{
+				SetEvent(wakeEvent_);
 			}
 
-			return writeAndFlush(buffer, L"\n");
+			return rc;
 		}
 	};
 }
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+#include <cwchar>
+#include <cwctype>
+
+
+/// Lowest level compiled in at all. Sites below it are dropped by the compiler,
+/// arguments included. Override with /D ASI_LOG_LEVEL_FLOOR=n.
+#ifndef ASI_LOG_LEVEL_FLOOR
+#ifdef ASI_DEBUG
+#define ASI_LOG_LEVEL_FLOOR 0  // Trace
+#else
+#define ASI_LOG_LEVEL_FLOOR 1  // Debug
+#endif
+#endif
+
+/// Leveled logging: GLOG(Debug, Hooks, L"format", args...), the arguments may be left out.
+/// The runtime check comes first, so a filtered-out line costs a load and a compare.
+#define GLOG(LEVEL, CATEGORY, FMT, ...) \
+do { \
+    if constexpr (static_cast<int>(Utils::LogLevel::LEVEL) >= ASI_LOG_LEVEL_FLOOR) \
+    { \
+        if (GLogger.Filter.IsEnabled(Utils::LogLevel::LEVEL, Utils::LogCategory::CATEGORY)) \
+        { \
+            GLOG_FAST(FMT, ##__VA_ARGS__); \
+        } \
+    } \
+} while (0)
+
+#define GLOG_TRACE(CATEGORY, FMT, ...)  GLOG(Trace, CATEGORY, FMT, ##__VA_ARGS__)
+#define GLOG_DEBUG(CATEGORY, FMT, ...)  GLOG(Debug, CATEGORY, FMT, ##__VA_ARGS__)
+#define GLOG_INFO(CATEGORY, FMT, ...)   GLOG(Info, CATEGORY, FMT, ##__VA_ARGS__)
+#define GLOG_WARN(CATEGORY, FMT, ...)   GLOG(Warn, CATEGORY, FMT, ##__VA_ARGS__)
+#define GLOG_ERROR(CATEGORY, FMT, ...)  GLOG(Error, CATEGORY, FMT, ##__VA_ARGS__)
+
+
+namespace Utils
+{
+    enum class LogLevel : unsigned char
+    {
+        Trace = 0,
+        Debug = 1,
+        Info = 2,
+        Warn = 3,
+        Error = 4,
+        Off = 5,
+    };
+
+    enum class LogCategory : unsigned char
+    {
+        General = 0,
+        Loader = 1,    // ASI loader, plugins
+        Hooks = 2,     // both hook managers
+        Spi = 3,
+        Ue = 4,        // UE-side hooks and types
+        Launcher = 5,
+        Count
+    };
+
+    /// <summary>
+    /// Per-category minimum levels, configured once from the command line:
+    ///   -loglevel=<level>[,<category>:<level>...]    e.g. -loglevel=info,hooks:trace
+    /// Plain GLogger.writeln lines are not filtered.
+    /// </summary>
+    class LogFilter
+    {
+    private:
+        static const size_t CATEGORY_COUNT = static_cast<size_t>(LogCategory::Count);
+
+        LogLevel minLevels_[CATEGORY_COUNT];
+
+        // Match a token (case-insensitive) against a name list, return the index or -1.
+        static int matchName_(const wchar_t* token, size_t length, const wchar_t* const* names, int count)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                if (wcslen(names[i]) != length)
+                {
+                    continue;
+                }
+
+                size_t c = 0;
+                while (c < length && static_cast<wchar_t>(towlower(token[c])) == names[i][c]) c++;
+                if (c == length)
+                {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+    public:
+        static const LogLevel DEFAULT_LEVEL = LogLevel::Debug;
+
+        LogFilter()
+        {
+            SetAll(DEFAULT_LEVEL);
+        }
+
+        [[nodiscard]] bool IsEnabled(LogLevel level, LogCategory category) const noexcept
+        {
+            return level >= minLevels_[static_cast<size_t>(category)];
+        }
+
+        void SetAll(LogLevel level)
+        {
+            for (auto& minLevel : minLevels_)
+            {
+                minLevel = level;
+            }
+        }
+
+        void Set(LogCategory category, LogLevel level)
+        {
+            minLevels_[static_cast<size_t>(category)] = level;
+        }
+
+        [[nodiscard]] LogLevel Get(LogCategory category) const
+        {
+            return minLevels_[static_cast<size_t>(category)];
+        }
+
+        static bool ParseLevel(const wchar_t* token, size_t length, LogLevel* outLevel)
+        {
+            static const wchar_t* const names[] = { L"trace", L"debug", L"info", L"warn", L"error", L"off" };
+            auto index = matchName_(token, length, names, 6);
+            if (index < 0)
+            {
+                return false;
+            }
+            *outLevel = static_cast<LogLevel>(index);
+            return true;
+        }
+
+        static bool ParseCategory(const wchar_t* token, size_t length, LogCategory* outCategory)
+        {
+            static const wchar_t* const names[] = { L"general", L"loader", L"hooks", L"spi", L"ue", L"launcher" };
+            auto index = matchName_(token, length, names, static_cast<int>(CATEGORY_COUNT));
+            if (index < 0)
+            {
+                return false;
+            }
+            *outCategory = static_cast<LogCategory>(index);
+            return true;
+        }
+
+        // Apply a -loglevel= switch if the command line has one.
+        // The bare level sets the base for every category wherever it appears in the list, category items
+        // override it: -loglevel=hooks:trace,info is the same as -loglevel=info,hooks:trace.
+        // Returns false if the switch was present but (partially) invalid, valid items are applied regardless.
+        bool Configure(const wchar_t* cmdLine)
+        {
+            static const wchar_t SWITCH[] = L" -loglevel=";
+
+            auto value = cmdLine ? wcsstr(cmdLine, SWITCH) : nullptr;
+            if (!value)
+            {
+                return true;
+            }
+            value += (sizeof(SWITCH) / sizeof(wchar_t)) - 1;
+
+            bool allValid = true;
+            for (bool categoryPass : { false, true })
+            {
+                for (auto item = value; *item != L'\0' && *item != L' ' && *item != L'"'; )
+                {
+                    auto itemEnd = item;
+                    while (*itemEnd != L'\0' && *itemEnd != L' ' && *itemEnd != L'"' && *itemEnd != L',') itemEnd++;
+
+                    auto colon = item;
+                    while (colon < itemEnd && *colon != L':') colon++;
+
+                    LogLevel level;
+                    LogCategory category;
+                    if (colon == itemEnd && !categoryPass)
+                    {
+                        if (ParseLevel(item, itemEnd - item, &level)) SetAll(level);
+                        else allValid = false;
+                    }
+                    else if (colon != itemEnd && categoryPass)
+                    {
+                        if (ParseCategory(item, colon - item, &category) && ParseLevel(colon + 1, itemEnd - colon - 1, &level)) Set(category, level);
+                        else allValid = false;
+                    }
+
+                    item = *itemEnd == L',' ? itemEnd + 1 : itemEnd;
+                }
+            }
+            return allValid;
+        }
+    };
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <new>
+#endif
+
+
+namespace Utils
+{
+    /// <summary>
+    /// Bounded lock-free ring for many producers and a single consumer.
+    /// Producers fill a claimed slot in place, so a record is written exactly once.
+    /// CAPACITY must be a power of two.
+    /// </summary>
+    template<typename TRecord, size_t CAPACITY>
+    class MpscRing
+    {
+        static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "MpscRing capacity must be a power of two");
+
+    private:
+        struct Slot
+        {
+            std::atomic<size_t> Sequence;  // == position when free, == position + 1 when filled
+            TRecord Record;
+        };
+
+        Slot* slots_;
+        alignas(64) std::atomic<size_t> enqueuePos_;
+        alignas(64) size_t dequeuePos_;  // consumer only
+
+    public:
+        MpscRing(const MpscRing& other) = delete;
+        MpscRing& operator=(const MpscRing& other) = delete;
+
+        MpscRing()
+            : slots_{ nullptr }
+            , enqueuePos_{ 0 }
+            , dequeuePos_{ 0 }
+        {
+            // Never freed, producers may still be running on process exit.
+#ifdef _WIN32
+            slots_ = reinterpret_cast<Slot*>(VirtualAlloc(nullptr, sizeof(Slot) * CAPACITY, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+            slots_ = reinterpret_cast<Slot*>(::operator new(sizeof(Slot) * CAPACITY, std::nothrow));
+#endif
+            if (slots_)
+            {
+                for (size_t i = 0; i < CAPACITY; i++)
+                {
+                    slots_[i].Sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        [[nodiscard]] bool InError() const noexcept { return slots_ == nullptr; }
+
+        // Approximate number of records waiting for the consumer.
+        [[nodiscard]] size_t ApproxSize() const noexcept
+        {
+            return enqueuePos_.load(std::memory_order_relaxed) - dequeuePos_;
+        }
+
+        // Claim a slot and fill it with fill(TRecord&). Returns false if the ring is full.
+        template<typename TFill>
+        bool TryPush(TFill fill)
+        {
+            if (InError())
+            {
+                return false;
+            }
+
+            auto pos = enqueuePos_.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto& slot = slots_[pos & (CAPACITY - 1)];
+                auto sequence = slot.Sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                if (diff == 0)
+                {
+                    if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        fill(slot.Record);
+                        slot.Sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = enqueuePos_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Hand the oldest filled record to consume(const TRecord&). Consumer side only.
+        // Returns false if the ring is empty, or the oldest slot is still being filled.
+        template<typename TConsume>
+        bool TryPop(TConsume consume)
+        {
+            if (InError())
+            {
+                return false;
+            }
+
+            auto& slot = slots_[dequeuePos_ & (CAPACITY - 1)];
+            if (slot.Sequence.load(std::memory_order_acquire) != dequeuePos_ + 1)
+            {
+                return false;
+            }
+
+            consume(slot.Record);
+            slot.Sequence.store(dequeuePos_ + CAPACITY, std::memory_order_release);
+            dequeuePos_++;
+            return true;
+        }
+    };
+}
@@ -4,7 +4,9 @@
 #include <Windows.h>
 #include <psapi.h>
 #include <tlhelp32.h>
+#include "../utils/flightrec.h"
 #include "../utils/io.h"
+#include "../utils/profiler.h"
 
 
 namespace Utils
@@ -32,9 +34,10 @@ namespace Utils
 
     /// <summary>
     /// Scan the game module for a sequence of bytes defined by a pattern and a mask.
+    /// Same as ScanProcess, but doesn't show up on the boot timeline (for polling).
     /// TODO: refactor it to use PEiD patterns.
     /// </summary>
-    BYTE* ScanProcess(BYTE* pattern, BYTE* mask)
+    BYTE* ScanProcessNoTrace(BYTE* pattern, BYTE* mask)
     {
         size_t patternLength = strlen((char*)mask);
 
@@ -70,6 +73,116 @@ namespace Utils
     }
 
 
+    /// <summary>
+    /// Scan the game module for a sequence of bytes defined by a pattern and a mask.
+    /// </summary>
+    BYTE* ScanProcess(BYTE* pattern, BYTE* mask)
+    {
+        PROFILE_SCOPE(PatternScan, "ScanProcess", nullptr);
+        auto address = ScanProcessNoTrace(pattern, mask);
+        GFlightRecorder.RecordPattern(address, pattern, mask);
+        return address;
+    }
+
+
+    /// <summary>
+    /// Scan the game module for several patterns in a single pass.
+    /// Unlike ScanProcess, every byte of a pattern (including the last one) must match.
+    /// </summary>
+    /// <returns>The number of patterns found, outOffsets gets NULL for the missing ones.</returns>
+    size_t ScanProcessMany(BYTE** patterns, BYTE** masks, size_t count, BYTE** outOffsets)
+    {
+        PROFILE_SCOPE(PatternScan, "ScanProcessMany", nullptr);
+
+        std::vector<size_t> lengths(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            lengths[i] = strlen((char*)masks[i]);
+            outOffsets[i] = nullptr;
+        }
+
+        BYTE* start, * end;
+        if (!GetGameModuleRange(&start, &end))
+        {
+            GLogger.writeln(L"ScanProcessMany: ERROR: GetGameModuleRange failed.");
+            return 0;
+        }
+
+        size_t foundCount = 0;
+        for (auto pointer = start; pointer < end && foundCount < count; pointer++)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                if (outOffsets[i] || lengths[i] == 0 || pointer + lengths[i] > end)
+                {
+                    continue;
+                }
+
+                size_t matchLength = 0;
+                while (matchLength < lengths[i]
+                    && (patterns[i][matchLength] == pointer[matchLength] || masks[i][matchLength] == '?'))
+                {
+                    matchLength++;
+                }
+
+                if (matchLength == lengths[i])
+                {
+                    outOffsets[i] = pointer;
+                    foundCount++;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            GFlightRecorder.RecordPattern(outOffsets[i], patterns[i], masks[i]);
+        }
+        return foundCount;
+    }
+
+
+    /// <summary>
+    /// Scan the game module for a pattern which must occur exactly once, every byte must match.
+    /// For short patterns which could also match the prolog of some other function.
+    /// </summary>
+    /// <returns>The match, NULL if there is none or more than one.</returns>
+    BYTE* ScanProcessUnique(BYTE* pattern, BYTE* mask)
+    {
+        PROFILE_SCOPE(PatternScan, "ScanProcessUnique", nullptr);
+
+        size_t patternLength = strlen((char*)mask);
+        BYTE* start, * end;
+        if (!GetGameModuleRange(&start, &end))
+        {
+            GLogger.writeln(L"ScanProcessUnique: ERROR: GetGameModuleRange failed.");
+            return nullptr;
+        }
+
+        BYTE* found = nullptr;
+        size_t matchCount = 0;
+        for (auto pointer = start; pointer + patternLength <= end; pointer++)
+        {
+            size_t matchLength = 0;
+            while (matchLength < patternLength && (pattern[matchLength] == pointer[matchLength] || mask[matchLength] == '?'))
+            {
+                matchLength++;
+            }
+            if (matchLength == patternLength && matchCount++ == 0)
+            {
+                found = pointer;
+            }
+        }
+
+        if (matchCount > 1)
+        {
+            GLogger.writeln(L"ScanProcessUnique: ERROR: the pattern matched %llu times.", matchCount);
+            found = nullptr;
+        }
+        GFlightRecorder.RecordPattern(found, pattern, mask);
+        return found;
+    }
+
+
     /// <summary>
     /// Object which freezes all but the current thread for the duration of the scope.
     /// </summary>
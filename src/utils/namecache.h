@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace Utils
+{
+    // A cached name, both strings are terminated and live as long as the cache.
+    struct NameView
+    {
+        const wchar_t* Wide;
+        const char* Narrow;     // UTF-8
+        uint32_t Length;        // In wide chars.
+    };
+
+    /// <summary>
+    /// Append-only cache from an FName value (name table index + instance number) to its text.
+    /// Each value is decoded by the game once, then its wide and UTF-8 strings are interned
+    /// in a bump-allocated arena and served from there. Readers never lock: a slot's key is
+    /// published after its entry, so a reader which sees the key sees a finished entry.
+    /// Writers take a mutex, which only happens the first time a name is seen.
+    /// </summary>
+    class NameCache
+    {
+    public:
+        static const size_t KEY_SLOTS = 1 << 17;        // Power of two.
+        static const size_t ARENA_CHUNK = 256 * 1024;
+
+    private:
+        static const uint64_t EMPTY_KEY = ~0ull;
+        static const size_t MAX_PROBES = 64;
+
+        struct Slot
+        {
+            std::atomic<uint64_t> Key{ EMPTY_KEY };
+            NameView* Entry = nullptr;
+        };
+
+        std::unique_ptr<Slot[]> slots_;
+        std::mutex writeMtx_;
+        std::vector<std::unique_ptr<uint8_t[]>> chunks_;
+        size_t chunkUsed_ = ARENA_CHUNK;
+        std::atomic<size_t> count_{ 0 };
+        std::atomic<size_t> arenaBytes_{ 0 };
+
+        static size_t slot_(uint64_t key) noexcept
+        {
+            return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 40) & (KEY_SLOTS - 1);
+        }
+
+        // Writers only.
+        void* allocate_(size_t size)
+        {
+            size = (size + 7) & ~static_cast<size_t>(7);
+            if (size > ARENA_CHUNK / 4)
+            {
+                chunks_.emplace_back(new uint8_t[size]);
+                arenaBytes_.fetch_add(size, std::memory_order_relaxed);
+                return chunks_.back().get();
+            }
+            if (chunkUsed_ + size > ARENA_CHUNK)
+            {
+                chunks_.emplace_back(new uint8_t[ARENA_CHUNK]);
+                chunkUsed_ = 0;
+                arenaBytes_.fetch_add(ARENA_CHUNK, std::memory_order_relaxed);
+            }
+            auto memory = chunks_.back().get() + chunkUsed_;
+            chunkUsed_ += size;
+            return memory;
+        }
+
+        static size_t utf8Length_(const wchar_t* text, size_t length) noexcept
+        {
+            size_t bytes = 0;
+            for (size_t i = 0; i < length; i++)
+            {
+                auto c = static_cast<uint32_t>(text[i]);
+                bytes += c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+            }
+            return bytes;
+        }
+
+        // Surrogate pairs are encoded one half at a time, names don't have any in practice.
+        static void toUtf8_(const wchar_t* text, size_t length, char* out) noexcept
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                auto c = static_cast<uint32_t>(text[i]);
+                if (c < 0x80)
+                {
+                    *out++ = static_cast<char>(c);
+                }
+                else if (c < 0x800)
+                {
+                    *out++ = static_cast<char>(0xC0 | (c >> 6));
+                    *out++ = static_cast<char>(0x80 | (c & 0x3F));
+                }
+                else if (c < 0x10000)
+                {
+                    *out++ = static_cast<char>(0xE0 | (c >> 12));
+                    *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | (c & 0x3F));
+                }
+                else
+                {
+                    *out++ = static_cast<char>(0xF0 | (c >> 18));
+                    *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | (c & 0x3F));
+                }
+            }
+            *out = '\0';
+        }
+
+    public:
+        NameCache()
+            : slots_{ new Slot[KEY_SLOTS] }
+        {
+        }
+
+        // Lock-free lookup, false if the name hasn't been cached.
+        bool Find(uint64_t key, NameView& outView) const noexcept
+        {
+            if (key == EMPTY_KEY)
+            {
+                return false;   // It would match any empty slot.
+            }
+            for (size_t i = 0, s = slot_(key); i < MAX_PROBES; i++, s = (s + 1) & (KEY_SLOTS - 1))
+            {
+                auto slotKey = slots_[s].Key.load(std::memory_order_acquire);
+                if (slotKey == key)
+                {
+                    outView = *slots_[s].Entry;
+                    return true;
+                }
+                if (slotKey == EMPTY_KEY)
+                {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        // Cached text of a name, decode(key) -> const wchar_t* is called if it isn't cached yet.
+        // Returns false if decode fails, or if the cache is full around this key, in which case
+        // outView holds the decoded text without a narrow string (nullptr).
+        template<typename TDecode>
+        bool Get(uint64_t key, TDecode&& decode, NameView& outView)
+        {
+            if (Find(key, outView))
+            {
+                return true;
+            }
+
+            // Decode outside the lock, two threads missing the same name both decode it, one of them wins.
+            const wchar_t* text = decode(key);
+            if (!text || key == EMPTY_KEY)
+            {
+                outView = NameView{ text, nullptr, text ? static_cast<uint32_t>(wcslen(text)) : 0 };
+                return false;
+            }
+
+            const std::lock_guard<std::mutex> lock(writeMtx_);
+
+            for (size_t i = 0, s = slot_(key); i < MAX_PROBES; i++, s = (s + 1) & (KEY_SLOTS - 1))
+            {
+                auto& slot = slots_[s];
+                auto slotKey = slot.Key.load(std::memory_order_relaxed);
+                if (slotKey == key)
+                {
+                    outView = *slot.Entry;
+                    return true;
+                }
+                if (slotKey != EMPTY_KEY)
+                {
+                    continue;
+                }
+
+                auto length = wcslen(text);
+                auto narrowLength = utf8Length_(text, length);
+                auto entry = static_cast<NameView*>(allocate_(sizeof(NameView)));
+                auto wide = static_cast<wchar_t*>(allocate_((length + 1) * sizeof(wchar_t)));
+                auto narrow = static_cast<char*>(allocate_(narrowLength + 1));
+                wmemcpy(wide, text, length + 1);
+                toUtf8_(text, length, narrow);
+                *entry = NameView{ wide, narrow, static_cast<uint32_t>(length) };
+
+                slot.Entry = entry;
+                slot.Key.store(key, std::memory_order_release);
+                count_.fetch_add(1, std::memory_order_relaxed);
+                outView = *entry;
+                return true;
+            }
+
+            outView = NameView{ text, nullptr, static_cast<uint32_t>(wcslen(text)) };
+            return false;
+        }
+
+        [[nodiscard]] size_t Count() const noexcept { return count_.load(std::memory_order_relaxed); }
+        [[nodiscard]] size_t ArenaBytes() const noexcept { return arenaBytes_.load(std::memory_order_relaxed); }
+    };
+}
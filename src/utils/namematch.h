@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <string>
+#include <unordered_map>
+
+
+namespace Utils
+{
+    /// <summary>
+    /// Matches FNames against a set of target names by their value instead of their text.
+    /// An FName value (name table index + instance number) always stands for the same string,
+    /// so each distinct value is decoded at most once and its verdict (target ID or miss) goes
+    /// into an open-addressing table: matching is one probe no matter how many targets there are.
+    /// Once every target has been seen, unknown values are misses without decoding them at all.
+    /// Not thread-safe, callers lock.
+    /// </summary>
+    class NameIndexMatcher
+    {
+    public:
+        static const int NO_MATCH = -1;
+        static const size_t KEY_SLOTS = 1 << 16;   // Power of two, 768 KB, room for a game's worth of function names.
+
+    private:
+        static const uint64_t EMPTY_KEY = ~0ull;
+        static const size_t MAX_PROBES = 32;
+
+        std::unordered_map<std::wstring, int> targets_;  // Text => target ID.
+        size_t resolvedCount_ = 0;
+        size_t decodeCount_ = 0;
+        uint64_t keys_[KEY_SLOTS];
+        int32_t verdicts_[KEY_SLOTS];
+
+        static size_t slot_(uint64_t key) noexcept
+        {
+            return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 40) & (KEY_SLOTS - 1);
+        }
+
+        // Slot holding key, or the empty slot where it would go, or KEY_SLOTS if the neighbourhood is full.
+        size_t find_(uint64_t key) const noexcept
+        {
+            for (size_t i = 0, s = slot_(key); i < MAX_PROBES; i++, s = (s + 1) & (KEY_SLOTS - 1))
+            {
+                if (keys_[s] == key || keys_[s] == EMPTY_KEY) return s;
+            }
+            return KEY_SLOTS;
+        }
+
+        void forget_() noexcept
+        {
+            for (auto& key : keys_)
+            {
+                key = EMPTY_KEY;
+            }
+            resolvedCount_ = 0;
+        }
+
+    public:
+        NameIndexMatcher()
+        {
+            forget_();
+        }
+
+        // Returns the target's ID, IDs count up from 0 and adding the same text again returns the same one.
+        // A new target makes every value undecided again, so add targets up front where possible.
+        int AddTarget(const wchar_t* name)
+        {
+            auto it = targets_.find(name);
+            if (it != targets_.end())
+            {
+                return it->second;
+            }
+
+            auto id = static_cast<int>(targets_.size());
+            targets_.emplace(name, id);
+            forget_();
+            return id;
+        }
+
+        [[nodiscard]] int FindTarget(const wchar_t* name) const
+        {
+            auto it = targets_.find(name);
+            return it != targets_.end() ? it->second : NO_MATCH;
+        }
+
+        // decode(key) -> const wchar_t* is only called for values without a verdict yet
+        // and may return nullptr if the name can't be read.
+        template<typename TDecode>
+        int Match(uint64_t key, TDecode&& decode)
+        {
+            // The reserved key would "find" any empty slot, it never gets a verdict stored.
+            auto s = key != EMPTY_KEY ? find_(key) : KEY_SLOTS;
+            if (s != KEY_SLOTS && keys_[s] == key)
+            {
+                return verdicts_[s];
+            }
+            if (resolvedCount_ == targets_.size())
+            {
+                return NO_MATCH;
+            }
+
+            decodeCount_++;
+            int verdict = NO_MATCH;
+            if (const wchar_t* name = decode(key))
+            {
+                auto it = targets_.find(name);
+                if (it != targets_.end())
+                {
+                    verdict = it->second;
+                }
+            }
+
+            // A full neighbourhood (or the reserved key) just means this value gets decoded again next time.
+            if (s != KEY_SLOTS)
+            {
+                keys_[s] = key;
+                verdicts_[s] = verdict;
+                if (verdict != NO_MATCH)
+                {
+                    resolvedCount_++;
+                }
+            }
+            return verdict;
+        }
+
+        [[nodiscard]] size_t TargetCount() const noexcept { return targets_.size(); }
+        [[nodiscard]] bool AllResolved() const noexcept { return resolvedCount_ == targets_.size(); }
+        [[nodiscard]] size_t ResolvedCount() const noexcept { return resolvedCount_; }
+        [[nodiscard]] size_t DecodeCount() const noexcept { return decodeCount_; }
+    };
+}
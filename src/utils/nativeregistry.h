@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../utils/namematch.h"
+
+
+namespace Utils
+{
+    /// <summary>
+    /// Replacement natives for UFunctions, applied by the UFunction::Bind hook.
+    /// Overrides are registered by path, "Function" for every function of that name or
+    /// "Outer.Function" for the one in a specific class or state. Binds find theirs by FName value
+    /// through a NameIndexMatcher, so the cost per bind doesn't grow with the number of overrides.
+    /// Apply remembers what each function's native slot held before, so removing an override puts the
+    /// engine's native back in the functions already bound to it.
+    /// Thread-safe, plugins register from their own threads while the game binds.
+    /// </summary>
+    class NativeOverrideRegistry
+    {
+    public:
+        struct Override
+        {
+            std::wstring Outer;   // Empty for any outer.
+            void* Native;
+            const void* Owner;    // Module which registered it, nullptr for the proxy.
+            uint64_t Serial;      // Ties the functions it was applied to back to it.
+        };
+
+    private:
+        // A function pointed at an override: its native slot (UFunction::Func) and what it held before.
+        struct Applied
+        {
+            void* Original;
+            void* Native;
+            uint64_t Serial;
+        };
+
+        std::mutex mtx_;
+        NameIndexMatcher names_;
+        std::vector<std::vector<Override>> overrides_;  // By NameIndexMatcher target ID.
+        std::unordered_map<void**, Applied> applied_;   // By native slot.
+        size_t count_ = 0;
+        uint64_t nextSerial_ = 1;
+
+        static bool splitPath_(const wchar_t* path, std::wstring& outOuter, std::wstring& outName)
+        {
+            if (!path || !*path)
+            {
+                return false;
+            }
+
+            auto dot = wcsrchr(path, L'.');
+            outOuter = dot ? std::wstring(path, dot - path) : std::wstring{};
+            outName = dot ? dot + 1 : path;
+            return !outName.empty() && (!dot || !outOuter.empty());
+        }
+
+        // mtx_ held. Put the original native back in the slots an override was applied to, unless the
+        // slot has been changed since (rebound, or the function is gone and its memory reused).
+        template<typename TRemoved>
+        size_t restore_(TRemoved&& removed)
+        {
+            size_t restored = 0;
+            for (auto it = applied_.begin(); it != applied_.end(); )
+            {
+                if (!removed(it->second.Serial))
+                {
+                    ++it;
+                    continue;
+                }
+                if (*it->first == it->second.Native)
+                {
+                    *it->first = it->second.Original;
+                    restored++;
+                }
+                it = applied_.erase(it);
+            }
+            return restored;
+        }
+
+        // mtx_ held.
+        template<typename TDecodeName, typename TDecodeOuter>
+        const Override* find_(uint64_t nameKey, TDecodeName&& decodeName, TDecodeOuter&& decodeOuter)
+        {
+            auto id = names_.Match(nameKey, decodeName);
+            if (id == NameIndexMatcher::NO_MATCH || static_cast<size_t>(id) >= overrides_.size())
+            {
+                return nullptr;
+            }
+
+            const Override* anyOuter = nullptr;
+            const wchar_t* outer = nullptr;
+            bool outerDecoded = false;
+            for (const auto& entry : overrides_[id])
+            {
+                if (entry.Outer.empty())
+                {
+                    anyOuter = &entry;
+                    continue;
+                }
+                if (!outerDecoded)
+                {
+                    outer = decodeOuter();
+                    outerDecoded = true;
+                }
+                if (outer && entry.Outer == outer)
+                {
+                    return &entry;
+                }
+            }
+            return anyOuter;
+        }
+
+    public:
+        // Returns false for an ill-formed path or one that already has an override.
+        bool Register(const wchar_t* path, void* native, const void* owner)
+        {
+            std::wstring outer, name;
+            if (!native || !splitPath_(path, outer, name))
+            {
+                return false;
+            }
+
+            const std::lock_guard<std::mutex> lock(mtx_);
+
+            auto id = static_cast<size_t>(names_.AddTarget(name.c_str()));
+            if (id >= overrides_.size())
+            {
+                overrides_.resize(id + 1);
+            }
+            for (const auto& entry : overrides_[id])
+            {
+                if (entry.Outer == outer)
+                {
+                    return false;
+                }
+            }
+
+            overrides_[id].push_back(Override{ outer, native, owner, nextSerial_++ });
+            count_++;
+            return true;
+        }
+
+        // Also restores the functions it was applied to.
+        bool Unregister(const wchar_t* path)
+        {
+            std::wstring outer, name;
+            if (!splitPath_(path, outer, name))
+            {
+                return false;
+            }
+
+            const std::lock_guard<std::mutex> lock(mtx_);
+
+            // Targets stay in the matcher, an empty list simply finds nothing.
+            auto id = names_.FindTarget(name.c_str());
+            if (id == NameIndexMatcher::NO_MATCH)
+            {
+                return false;
+            }
+            auto& entries = overrides_[id];
+            for (auto it = entries.begin(); it != entries.end(); ++it)
+            {
+                if (it->Outer == outer)
+                {
+                    auto serial = it->Serial;
+                    entries.erase(it);
+                    count_--;
+                    restore_([serial](uint64_t applied) { return applied == serial; });
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Drop everything a plugin registered and restore the functions it was applied to, so none of
+        // them calls into the plugin any more. The proxy's own overrides (owner nullptr) are kept.
+        size_t UnregisterOwnedBy(const void* owner)
+        {
+            if (!owner)
+            {
+                return 0;
+            }
+
+            const std::lock_guard<std::mutex> lock(mtx_);
+
+            size_t removed = 0;
+            std::vector<uint64_t> serials;
+            for (auto& entries : overrides_)
+            {
+                for (auto it = entries.begin(); it != entries.end(); )
+                {
+                    if (it->Owner == owner)
+                    {
+                        serials.push_back(it->Serial);
+                        it = entries.erase(it);
+                        removed++;
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+            }
+            count_ -= removed;
+            if (!serials.empty())
+            {
+                restore_([&serials](uint64_t applied) { return std::find(serials.begin(), serials.end(), applied) != serials.end(); });
+            }
+            return removed;
+        }
+
+        // The native for a function being bound, or nullptr. decodeName(key) -> const wchar_t* is
+        // called for names without a verdict yet, decodeOuter() -> const wchar_t* only when an
+        // override for this name is tied to an outer. An override for the exact outer wins over a plain one.
+        template<typename TDecodeName, typename TDecodeOuter>
+        void* Find(uint64_t nameKey, TDecodeName&& decodeName, TDecodeOuter&& decodeOuter)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            auto entry = find_(nameKey, decodeName, decodeOuter);
+            return entry ? entry->Native : nullptr;
+        }
+
+        // Find, then point the function's native slot (UFunction::Func, just set by the original Bind)
+        // at the override and remember what it held. Returns the native applied, or nullptr.
+        template<typename TDecodeName, typename TDecodeOuter>
+        void* Apply(uint64_t nameKey, TDecodeName&& decodeName, TDecodeOuter&& decodeOuter, void** slot)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            auto entry = find_(nameKey, decodeName, decodeOuter);
+            if (!entry)
+            {
+                // Rebound without an override now, what the slot held is the engine's again.
+                if (!applied_.empty())
+                {
+                    applied_.erase(slot);
+                }
+                return nullptr;
+            }
+
+            applied_[slot] = Applied{ *slot, entry->Native, entry->Serial };
+            *slot = entry->Native;
+            return entry->Native;
+        }
+
+        [[nodiscard]] size_t Count()
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            return count_;
+        }
+
+        // Functions currently pointed at an override.
+        [[nodiscard]] size_t AppliedCount()
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+            return applied_.size();
+        }
+    };
+}
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <vector>
+
+
+namespace Utils
+{
+    /// <summary>
+    /// Hash index from full object path ("Package.Group.Object", ASCII case-insensitive) to a slot
+    /// of the engine's object array, kept up to date incrementally instead of rebuilt.
+    /// Update catches up with objects appended since the last call and re-indexes slots whose object
+    /// changed (garbage collected, reused, or reallocated at the same address under another name or
+    /// outer), each object's path hash building on its outer's.
+    /// The table only stores 32 bits of the hash and the slot, a hit is confirmed against the object's
+    /// actual path, so collisions and stale entries cost a comparison but never a wrong answer.
+    /// Find only reads a candidate still in the slot it was indexed from, objects collected since the
+    /// last Update may be freed memory. Not thread-safe, callers lock.
+    ///
+    /// The object model comes in as callables, to keep this portable:
+    ///   at(index) -> const void*        object in a slot of the array (may be nullptr),
+    ///   outerOf(object) -> const void*  its outer (nullptr for packages),
+    ///   indexOf(object) -> size_t       its slot in the array,
+    ///   nameOf(object) -> const wchar_t*,
+    ///   nameKeyOf(object) -> uint64_t     its name as a value, the same key is always the same name.
+    /// </summary>
+    class ObjectPathIndex
+    {
+    private:
+        static const uint32_t EMPTY_SLOT = ~0u;
+        static const uint32_t DELETED_SLOT = ~0u - 1;
+        static const uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+        static const uint64_t FNV_PRIME = 0x100000001B3ull;
+        static const size_t MAX_DEPTH = 64;  // Outer chains are a handful deep, this only stops cycles.
+
+        struct Slot
+        {
+            uint32_t HashHigh;
+            uint32_t Index;
+        };
+
+        std::vector<Slot> table_;
+        size_t used_ = 0;               // Including deleted slots.
+        size_t live_ = 0;
+        std::vector<const void*> objects_;  // Object each array slot was indexed with,
+        std::vector<const void*> outers_;   // its outer and name key then.
+        std::vector<uint64_t> nameKeys_;
+        std::vector<uint64_t> hashes_;
+
+        static wchar_t fold_(wchar_t c) noexcept
+        {
+            return (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c - L'A' + L'a') : c;
+        }
+
+        static uint64_t hashChars_(uint64_t hash, const wchar_t* text) noexcept
+        {
+            for (; text && *text; text++)
+            {
+                hash = (hash ^ static_cast<uint64_t>(fold_(*text))) * FNV_PRIME;
+            }
+            return hash;
+        }
+
+        void insert_(uint64_t hash, uint32_t index)
+        {
+            // Sized by the live entries, so churn doesn't keep growing the table.
+            if ((used_ + 1) * 2 > table_.size())
+            {
+                size_t slotCount = 1024;
+                while (slotCount < (live_ + 1) * 4) slotCount *= 2;
+                rehash_(slotCount);
+            }
+
+            auto mask = table_.size() - 1;
+            for (auto s = static_cast<size_t>(hash) & mask; ; s = (s + 1) & mask)
+            {
+                if (table_[s].Index == EMPTY_SLOT)
+                {
+                    table_[s] = Slot{ static_cast<uint32_t>(hash >> 32), index };
+                    used_++;
+                    live_++;
+                    return;
+                }
+            }
+        }
+
+        void erase_(uint64_t hash, uint32_t index) noexcept
+        {
+            auto mask = table_.size() - 1;
+            for (auto s = static_cast<size_t>(hash) & mask; table_[s].Index != EMPTY_SLOT; s = (s + 1) & mask)
+            {
+                if (table_[s].Index == index)
+                {
+                    table_[s].Index = DELETED_SLOT;
+                    live_--;
+                    return;
+                }
+            }
+        }
+
+        void rehash_(size_t slotCount)
+        {
+            // Deleted slots go away here, live entries are rebuilt from the per-object hashes.
+            table_.assign(slotCount, Slot{ 0, EMPTY_SLOT });
+            used_ = 0;
+            auto mask = slotCount - 1;
+            for (size_t i = 0; i < objects_.size(); i++)
+            {
+                if (!objects_[i]) continue;
+                for (auto s = static_cast<size_t>(hashes_[i]) & mask; ; s = (s + 1) & mask)
+                {
+                    if (table_[s].Index == EMPTY_SLOT)
+                    {
+                        table_[s] = Slot{ static_cast<uint32_t>(hashes_[i] >> 32), static_cast<uint32_t>(i) };
+                        used_++;
+                        break;
+                    }
+                }
+            }
+        }
+
+        template<typename TOuterOf, typename TIndexOf, typename TNameOf>
+        uint64_t hashOf_(const void* object, TOuterOf& outerOf, TIndexOf& indexOf, TNameOf& nameOf, size_t depth)
+        {
+            auto outer = outerOf(object);
+            if (!outer || depth >= MAX_DEPTH)
+            {
+                return hashChars_(FNV_OFFSET, nameOf(object));
+            }
+
+            // Outers are usually older than what they contain, so their hash is already known.
+            auto outerIndex = indexOf(outer);
+            auto outerHash = outerIndex < objects_.size() && objects_[outerIndex] == outer
+                ? hashes_[outerIndex]
+                : hashOf_(outer, outerOf, indexOf, nameOf, depth + 1);
+            return hashChars_((outerHash ^ static_cast<uint64_t>(L'.')) * FNV_PRIME, nameOf(object));
+        }
+
+        // Compare an object's path with text, from the last segment backwards.
+        template<typename TOuterOf, typename TNameOf>
+        static bool pathEquals_(const void* object, const wchar_t* path, size_t length, TOuterOf& outerOf, TNameOf& nameOf)
+        {
+            auto end = length;
+            for (size_t depth = 0; object && depth < MAX_DEPTH; depth++, object = outerOf(object))
+            {
+                auto start = end;
+                while (start > 0 && path[start - 1] != L'.') start--;
+
+                auto name = nameOf(object);
+                auto nameLength = name ? wcslen(name) : 0;
+                if (nameLength != end - start)
+                {
+                    return false;
+                }
+                for (size_t i = 0; i < nameLength; i++)
+                {
+                    if (fold_(name[i]) != fold_(path[start + i])) return false;
+                }
+
+                if (start == 0)
+                {
+                    return outerOf(object) == nullptr;
+                }
+                end = start - 1;
+            }
+            return false;
+        }
+
+    public:
+        // Hash of a path as Find computes it.
+        [[nodiscard]] static uint64_t HashPath(const wchar_t* path) noexcept
+        {
+            return hashChars_(FNV_OFFSET, path);
+        }
+
+        // Catch up with an array of count objects, returns the number of slots (re-)indexed.
+        template<typename TAt, typename TOuterOf, typename TIndexOf, typename TNameOf, typename TNameKeyOf>
+        size_t Update(size_t count, TAt&& at, TOuterOf&& outerOf, TIndexOf&& indexOf, TNameOf&& nameOf, TNameKeyOf&& nameKeyOf)
+        {
+            if (count > EMPTY_SLOT - 2)
+            {
+                count = EMPTY_SLOT - 2;
+            }
+
+            size_t changed = 0;
+            for (auto i = count; i < objects_.size(); i++)
+            {
+                if (objects_[i])
+                {
+                    erase_(hashes_[i], static_cast<uint32_t>(i));
+                    changed++;
+                }
+            }
+            objects_.resize(count, nullptr);
+            outers_.resize(count, nullptr);
+            nameKeys_.resize(count, 0);
+            hashes_.resize(count, 0);
+
+            // Slots are compared by pointer, outer and name key, that's cheap enough to do for the
+            // whole array. The pointer alone would miss an object freed and reallocated in place.
+            for (size_t i = 0; i < count; i++)
+            {
+                auto object = at(i);
+                if (object == objects_[i] && (!object || (outerOf(object) == outers_[i] && nameKeyOf(object) == nameKeys_[i])))
+                {
+                    continue;
+                }
+
+                if (objects_[i])
+                {
+                    erase_(hashes_[i], static_cast<uint32_t>(i));
+                    objects_[i] = nullptr;
+                }
+                if (object)
+                {
+                    // Inserted before objects_ knows it, a rehash in insert_ would add it twice.
+                    hashes_[i] = hashOf_(object, outerOf, indexOf, nameOf, 0);
+                    insert_(hashes_[i], static_cast<uint32_t>(i));
+                    objects_[i] = object;
+                    outers_[i] = outerOf(object);
+                    nameKeys_[i] = nameKeyOf(object);
+                }
+                changed++;
+            }
+            return changed;
+        }
+
+        // Object with this path as of the last Update and still in its slot (at, as for Update), or nullptr.
+        template<typename TAt, typename TOuterOf, typename TNameOf>
+        const void* Find(const wchar_t* path, TAt&& at, TOuterOf&& outerOf, TNameOf&& nameOf) const
+        {
+            if (!path || table_.empty())
+            {
+                return nullptr;
+            }
+
+            auto hash = HashPath(path);
+            auto length = wcslen(path);
+            auto mask = table_.size() - 1;
+            for (auto s = static_cast<size_t>(hash) & mask; table_[s].Index != EMPTY_SLOT; s = (s + 1) & mask)
+            {
+                const auto& slot = table_[s];
+                if (slot.Index == DELETED_SLOT || slot.HashHigh != static_cast<uint32_t>(hash >> 32) || hashes_[slot.Index] != hash)
+                {
+                    continue;
+                }
+                // Only dereferenced while the array still holds it, a collected object may be freed.
+                auto object = objects_[slot.Index];
+                if (object && at(slot.Index) == object && pathEquals_(object, path, length, outerOf, nameOf))
+                {
+                    return object;
+                }
+            }
+            return nullptr;
+        }
+
+        // Check that data[count] looks like the engine's object array: evenly spread slots (and the
+        // last one) are empty or hold an object which knows its own slot, and at least minObjects do.
+        // isReadable(pointer, size) -> bool guards every read, the array may be anything.
+        template<typename TReadable, typename TIndexOf>
+        static bool ValidateObjectArray(const void* const* data, size_t count, size_t objectSize,
+            TReadable&& isReadable, TIndexOf&& indexOf, size_t probes = 32, size_t minObjects = 8)
+        {
+            if (!data || count == 0 || probes == 0)
+            {
+                return false;
+            }
+
+            size_t verified = 0;
+            size_t previous = count;
+            for (size_t probe = 0; probe <= probes; probe++)
+            {
+                // Small arrays map several probes to one slot, count it once.
+                auto index = probe < probes ? probe * count / probes : count - 1;
+                if (index == previous)
+                {
+                    continue;
+                }
+                previous = index;
+                if (!isReadable(data + index, sizeof(void*)))
+                {
+                    return false;
+                }
+                auto object = data[index];
+                if (!object)
+                {
+                    continue;
+                }
+                if (!isReadable(object, objectSize) || indexOf(object) != index)
+                {
+                    return false;
+                }
+                verified++;
+            }
+            return verified >= minObjects;
+        }
+
+        [[nodiscard]] size_t IndexedCount() const noexcept { return objects_.size(); }
+        [[nodiscard]] size_t TableBytes() const noexcept { return table_.size() * sizeof(Slot) + objects_.size() * (2 * sizeof(void*) + 2 * sizeof(uint64_t)); }
+    };
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "strtable.h"
+
+
+// Plugin lifecycle steps shared by the ASI loader and its hot reload, kept apart from LoadLibrary and
+// friends so the sequence can be driven by dlopen-based mock plugins in the Linux tests.
+
+namespace Utils
+{
+    enum class PluginState
+    {
+        Loaded = 0,    // The library is loaded, its attach point has not run (or failed)
+        Attached = 1,  // OnAttach was dispatched, on a thread of its own in async mode
+        Detached = 2,  // OnDetach was run
+        Unloaded = 3   // The library was freed (hot reload only)
+    };
+
+    enum class ReloadResult
+    {
+        Reloaded = 0,
+        AttachRunning = 1,   // Refused: the plugin's async OnAttach hasn't returned, it's left as it was.
+        LoadFailed = 2,      // The old copy is gone, the new one couldn't be loaded.
+        RegisterFailed = 3,  // The new copy is loaded like a raw ASI, not attached.
+        AttachFailed = 4,
+        ReleaseFailed = 5,   // Refused: the host couldn't drop all it holds for the old copy, which stays loaded.
+    };
+
+    /// <summary>
+    /// The platform side of the lifecycle, for a plugin record TPlugin with State and Generation fields:
+    ///   bool AttachRunning(TPlugin&, uint32_t waitMs)  async OnAttach still running after waiting up to waitMs
+    ///   bool Detach(TPlugin&)                          run OnDetach, its result
+    ///   bool Release(TPlugin&)                         drop everything the plugin owns in the host (hooks...),
+    ///                                                  false if some of it is still in place
+    ///   bool Unload(TPlugin&)                          free the library
+    ///   bool Load(TPlugin&, int generation)            load a fresh copy, forgetting what came from the old one
+    ///   bool Register(TPlugin&)                        resolve and check the fresh copy's exports
+    ///   bool Attach(TPlugin&)                          dispatch OnAttach (synchronously or on a thread)
+    /// </summary>
+
+    // Detach a plugin for good (shutdown). Only plugins whose attach point was dispatched and has returned
+    // are detached, an async attach which is still running after waitMs is left alone. Returns true if
+    // OnDetach ran.
+    template<typename TPlugin, typename THost>
+    bool DetachPlugin(TPlugin& plugin, THost& host, uint32_t waitMs, bool* outResult = nullptr)
+    {
+        if (plugin.State != PluginState::Attached || host.AttachRunning(plugin, waitMs))
+        {
+            return false;
+        }
+
+        auto detached = host.Detach(plugin);
+        if (outResult)
+        {
+            *outResult = detached;
+        }
+        plugin.State = PluginState::Detached;
+        return true;
+    }
+
+    // Swap a plugin for the current version of its file: detach it, drop what it owns, unload it,
+    // load a fresh copy and attach that. A plugin whose async attach doesn't finish within waitMs is
+    // refused rather than unloaded under its own attach thread.
+    template<typename TPlugin, typename THost>
+    ReloadResult ReloadPlugin(TPlugin& plugin, THost& host, uint32_t waitMs)
+    {
+        if (plugin.State == PluginState::Attached && host.AttachRunning(plugin, waitMs))
+        {
+            return ReloadResult::AttachRunning;
+        }
+
+        DetachPlugin(plugin, host, 0);
+        if (plugin.State != PluginState::Unloaded)
+        {
+            // Something still calling into the old copy: keep it loaded, detached. A later reload retries.
+            if (!host.Release(plugin))
+            {
+                return ReloadResult::ReleaseFailed;
+            }
+            host.Unload(plugin);
+            plugin.State = PluginState::Unloaded;
+        }
+
+        auto generation = plugin.Generation + 1;
+        if (!host.Load(plugin, generation))
+        {
+            return ReloadResult::LoadFailed;
+        }
+        plugin.Generation = generation;
+        plugin.State = PluginState::Loaded;
+
+        if (!host.Register(plugin))
+        {
+            return ReloadResult::RegisterFailed;
+        }
+        if (!host.Attach(plugin))
+        {
+            return ReloadResult::AttachFailed;
+        }
+        plugin.State = PluginState::Attached;
+        return ReloadResult::Reloaded;
+    }
+
+    [[nodiscard]] inline const char* ReloadResultName(ReloadResult result)
+    {
+        switch (result)
+        {
+        case ReloadResult::Reloaded:        return "reloaded";
+        case ReloadResult::AttachRunning:   return "refused, its async attach is still running";
+        case ReloadResult::LoadFailed:      return "failed to load the new copy";
+        case ReloadResult::RegisterFailed:  return "the new copy failed to register";
+        case ReloadResult::AttachFailed:    return "the new copy failed to attach";
+        case ReloadResult::ReleaseFailed:   return "refused, some of its hooks couldn't be removed";
+        default:                            return "unknown";
+        }
+    }
+
+
+    /// <summary>
+    /// Plugin files changed since the last reload, as reported by the directory watcher: each path
+    /// once, only *.asi files, not the loader's own shadow copies (anything under a dot directory).
+    /// The watcher takes the batch once the directory has been quiet for a bit, so a rebuild which
+    /// touches the file several times is reloaded once.
+    /// </summary>
+    class ReloadBatch
+    {
+    private:
+        std::vector<std::wstring> paths_;
+
+    public:
+        static bool IsPluginPath(const wchar_t* path)
+        {
+            return path[0] != L'.' && EndsWithIgnoreCase(path, L".asi");
+        }
+
+        // Returns true if the path was added.
+        bool Add(const wchar_t* path)
+        {
+            if (!IsPluginPath(path) || std::find(paths_.begin(), paths_.end(), path) != paths_.end())
+            {
+                return false;
+            }
+            paths_.emplace_back(path);
+            return true;
+        }
+
+        std::vector<std::wstring> Take()
+        {
+            std::vector<std::wstring> paths;
+            paths.swap(paths_);
+            return paths;
+        }
+
+        [[nodiscard]] bool Empty() const noexcept { return paths_.empty(); }
+    };
+}
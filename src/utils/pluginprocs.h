@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace Utils
+{
+    enum class PluginRegistration
+    {
+        Raw = 0,             // No SpiSupportDecl, loaded like any ASI and left alone.
+        Spi = 1,             // All SPI procs found, declaration accepted, attach flags resolved.
+        MissingProcs = 2,    // SpiSupportDecl found, some other SPI proc not.
+        BadVersion = 3,      // Declared min SPI version is invalid or newer than the proxy's.
+        WrongGame = 4,       // Not declared for the running game.
+    };
+
+    /// <summary>
+    /// The SPI side of a plugin record: its exported procs, what it declared through SpiSupportDecl
+    /// and its attach flags, packed in one byte and asked from the plugin once per plugin.
+    /// Exports are looked up through lookup(name) -> void* (GetProcAddress in the loader, a mock
+    /// export table in the tests), so none of this depends on the platform.
+    /// </summary>
+    template<typename TInterface>
+    class PluginProcs
+    {
+    public:
+        typedef void(*tSupport)(wchar_t** name, wchar_t** author, wchar_t** version, int* gameIndex, int* spiMinVersion);
+        typedef bool(*tShouldPreload)(void);
+        typedef bool(*tShouldSpawnThread)(void);
+        typedef bool(*tOnAttach)(TInterface* InterfacePtr);
+        typedef bool(*tOnDetach)(TInterface* InterfacePtr);
+
+    private:
+        enum : uint8_t
+        {
+            FLAG_MISSING_PROC   = 1 << 0,  // set on the first SPI proc which could not be found
+            FLAG_RESOLVED       = 1 << 1,  // SpiShouldPreload / SpiShouldSpawnThread were called
+            FLAG_PRELOAD        = 1 << 2,
+            FLAG_SPAWN_THREAD   = 1 << 3,
+        };
+        uint8_t flags_ = 0;
+
+        [[nodiscard]] bool hasFlag_(uint8_t flag) const noexcept { return (flags_ & flag) != 0; }
+
+        template<typename TProc, typename TLookup, typename TMissing>
+        void lookup_(TProc& proc, const char* name, TLookup& lookup, TMissing& missing)
+        {
+            proc = reinterpret_cast<TProc>(lookup(name));
+            if (!proc)
+            {
+                MissingProc();
+                missing(name);
+            }
+        }
+
+    public:
+        tSupport SpiSupport = nullptr;
+        tShouldPreload DoPreload = nullptr;
+        tShouldSpawnThread DoSpawnThread = nullptr;
+        tOnAttach OnAttach = nullptr;
+        tOnDetach OnDetach = nullptr;
+
+        wchar_t* PluginName = nullptr;
+        wchar_t* PluginVersion = nullptr;
+        wchar_t* PluginAuthor = nullptr;
+        int SupportedGamesBitset = 0;
+        int MinInterfaceVersion = 0;
+        bool IsAsyncAttachMode = false;
+
+        void MissingProc() noexcept { flags_ |= FLAG_MISSING_PROC; }
+
+        // Ask the plugin where and how it wants to be attached. Only the first call reaches the plugin.
+        void ResolveFlags()
+        {
+            if (!SupportsSPI() || hasFlag_(FLAG_RESOLVED))
+            {
+                return;
+            }
+
+            if (DoPreload())      flags_ |= FLAG_PRELOAD;
+            if (DoSpawnThread())  flags_ |= FLAG_SPAWN_THREAD;
+            flags_ |= FLAG_RESOLVED;
+        }
+
+        [[nodiscard]] bool SupportsSPI() const noexcept { return SpiSupport != nullptr && !hasFlag_(FLAG_MISSING_PROC); }
+        [[nodiscard]] bool ShouldPreload() const noexcept { return SupportsSPI() && hasFlag_(FLAG_RESOLVED) && hasFlag_(FLAG_PRELOAD); }
+        [[nodiscard]] bool ShouldPostload() const noexcept { return SupportsSPI() && hasFlag_(FLAG_RESOLVED) && !hasFlag_(FLAG_PRELOAD); }
+        [[nodiscard]] bool ShouldSpawnThread() const noexcept { return SupportsSPI() && hasFlag_(FLAG_RESOLVED) && hasFlag_(FLAG_SPAWN_THREAD); }
+
+        [[nodiscard]] bool HasCorrectVersionFor(int proxyVer) const noexcept { return !(MinInterfaceVersion < 2 || MinInterfaceVersion > proxyVer); }
+        [[nodiscard]] bool HasCorrectFlagFor(int gameBit) const noexcept { return gameBit != 0 && (SupportedGamesBitset & gameBit) != 0; }
+
+        // Look up the procs the SPI requires once SpiSupportDecl is there, missing(name) for each one that isn't.
+        template<typename TLookup, typename TMissing>
+        void LoadConditionalProcs(TLookup&& lookup, TMissing&& missing)
+        {
+            lookup_(DoPreload, "SpiShouldPreload", lookup, missing);
+            lookup_(DoSpawnThread, "SpiShouldSpawnThread", lookup, missing);
+            lookup_(OnAttach, "SpiOnAttach", lookup, missing);
+            lookup_(OnDetach, "SpiOnDetach", lookup, missing);
+        }
+
+        // The whole registration of a freshly loaded plugin: find its procs, take its declaration
+        // and check it against the proxy's SPI version and the running game (as an SPI_GAME_* bit),
+        // then resolve its attach flags. Only a Spi result leaves the plugin attachable.
+        template<typename TLookup, typename TMissing>
+        PluginRegistration Register(TLookup&& lookup, TMissing&& missing, int proxyVer, int gameBit)
+        {
+            SpiSupport = reinterpret_cast<tSupport>(lookup("SpiSupportDecl"));
+            if (!SpiSupport)
+            {
+                MissingProc();
+                return PluginRegistration::Raw;
+            }
+
+            LoadConditionalProcs(lookup, missing);
+            if (!SupportsSPI())
+            {
+                return PluginRegistration::MissingProcs;
+            }
+
+            SpiSupport(&PluginName, &PluginAuthor, &PluginVersion, &SupportedGamesBitset, &MinInterfaceVersion);
+            if (!HasCorrectVersionFor(proxyVer))
+            {
+                return PluginRegistration::BadVersion;
+            }
+            if (!HasCorrectFlagFor(gameBit))
+            {
+                return PluginRegistration::WrongGame;
+            }
+
+            ResolveFlags();
+            return PluginRegistration::Spi;
+        }
+    };
+
+    // Split plugins by attach point, as indices into the list: attached before or after the game's
+    // own startup. Plugins which attach at neither (raw ones) are in neither.
+    template<typename TPlugin>
+    void PartitionPlugins(const std::vector<TPlugin>& plugins, std::vector<size_t>& preload, std::vector<size_t>& postload)
+    {
+        preload.clear();
+        postload.clear();
+
+        for (size_t i = 0; i < plugins.size(); i++)
+        {
+            if (plugins[i].ShouldPreload())        preload.push_back(i);
+            else if (plugins[i].ShouldPostload())  postload.push_back(i);
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cwchar>
+#include <type_traits>
+#include "strtable.h"
+
+
+namespace Utils
+{
+    // One entry of a directory listing, as the plugin scan needs it.
+    struct ScanEntry
+    {
+        const wchar_t* Name;
+        bool Directory;
+        bool ReparsePoint;      // Symlink or junction.
+    };
+
+    enum class ScanSkip
+    {
+        TooDeep = 0,            // A directory below the depth limit.
+        PathTooLong = 1,
+        TableFull = 2,
+    };
+
+    /// <summary>
+    /// Collect plugin files (*.asi, any case) under a root into a StringTable, as paths relative to the
+    /// root with '\' separators ("Sub\Mod.asi"). Dot directories (the hot reload shadow directory
+    /// among them) and links are not descended into, neither is anything deeper than maxDepth.
+    /// The file system is reached through listDir(relativeDir, visit), which calls visit(const ScanEntry&)
+    /// for each entry of the directory and returns false on an error, so the walk is the same with
+    /// FindFirstFileW in the proxy and an in-memory tree in the tests.
+    /// skipped(ScanSkip, relativeDir, name) hears about everything left out.
+    /// Returns false if listing the root failed.
+    /// </summary>
+    template<typename TTable, typename TListDir, typename TSkipped>
+    class PluginScan
+    {
+    public:
+        static const size_t PATH_CHARS = 260;   // MAX_PATH, relative paths included.
+
+    private:
+        TTable& table_;
+        TListDir& listDir_;
+        TSkipped& skipped_;
+        int maxDepth_;
+
+        // Only a failure to list the root counts, subdirectories which can't be listed are passed over.
+        bool scan_(const wchar_t* relativeDir, int depth)
+        {
+            return listDir_(relativeDir, [&](const ScanEntry& entry)
+                {
+                    if (entry.Directory)
+                    {
+                        if (entry.Name[0] == L'.' || entry.ReparsePoint)
+                        {
+                            return;
+                        }
+                        if (depth >= maxDepth_)
+                        {
+                            skipped_(ScanSkip::TooDeep, relativeDir, entry.Name);
+                            return;
+                        }
+
+                        wchar_t subDir[PATH_CHARS];
+                        auto length = swprintf(subDir, PATH_CHARS, L"%ls%ls\\", relativeDir, entry.Name);
+                        if (length < 0 || static_cast<size_t>(length) >= PATH_CHARS)
+                        {
+                            skipped_(ScanSkip::PathTooLong, relativeDir, entry.Name);
+                            return;
+                        }
+                        scan_(subDir, depth + 1);
+                        return;
+                    }
+
+                    if (!EndsWithIgnoreCase(entry.Name, L".asi"))
+                    {
+                        return;
+                    }
+                    if (wcslen(relativeDir) + wcslen(entry.Name) >= PATH_CHARS)
+                    {
+                        skipped_(ScanSkip::PathTooLong, relativeDir, entry.Name);
+                        return;
+                    }
+                    if (!table_.Add(relativeDir, entry.Name))
+                    {
+                        skipped_(ScanSkip::TableFull, relativeDir, entry.Name);
+                    }
+                });
+        }
+
+    public:
+        PluginScan(TTable& table, TListDir& listDir, TSkipped& skipped, int maxDepth)
+            : table_{ table }
+            , listDir_{ listDir }
+            , skipped_{ skipped }
+            , maxDepth_{ maxDepth }
+        {
+        }
+
+        bool Run() { return scan_(L"", 0); }
+    };
+
+    template<typename TTable, typename TListDir, typename TSkipped>
+    bool ScanPlugins(TTable& table, TListDir&& listDir, TSkipped&& skipped, int maxDepth)
+    {
+        PluginScan<TTable, std::remove_reference_t<TListDir>, std::remove_reference_t<TSkipped>> scan{ table, listDir, skipped, maxDepth };
+        return scan.Run();
+    }
+}
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstddef>
+#include <cwchar>
+#ifdef _WIN32
+#include <Windows.h>
+#include "../utils/tickclock.h"
+#endif
+
+
+#define PROFILER_CONCAT_INNER(X, Y) X##Y
+#define PROFILER_CONCAT(X, Y) PROFILER_CONCAT_INNER(X, Y)
+
+/// Record the enclosing scope as one event on the boot timeline.
+/// DETAIL is an optional narrow or wide string copied into the event (file name, hook name...).
+#define PROFILE_SCOPE(CATEGORY, NAME, DETAIL) \
+const Utils::ScopedTrace PROFILER_CONCAT(scopedTrace_, __LINE__){ Utils::TraceCategory::CATEGORY, NAME, DETAIL };
+
+
+namespace Utils
+{
+    enum class TraceCategory : uint8_t
+    {
+        Boot = 0,
+        Module = 1,
+        LoadLibrary = 2,
+        PatternScan = 3,
+        Hook = 4,
+        PluginAttach = 5,
+        Count
+    };
+
+    const char* TraceCategoryToString(TraceCategory category)
+    {
+        switch (category)
+        {
+        case TraceCategory::Boot:          return "boot";
+        case TraceCategory::Module:        return "module";
+        case TraceCategory::LoadLibrary:   return "loadlibrary";
+        case TraceCategory::PatternScan:   return "patternscan";
+        case TraceCategory::Hook:          return "hook";
+        case TraceCategory::PluginAttach:  return "pluginattach";
+        default:                           return "unknown";
+        }
+    }
+
+    struct TraceEvent
+    {
+        int64_t Start;
+        int64_t End;
+        const char* Name;          // must be a literal
+        TraceCategory Category;
+        char Detail[103];          // UTF-8
+    };
+
+    /// <summary>
+    /// Ring of events recorded by a single thread.
+    /// Only the owning thread writes, the exporter reads everything below the published head.
+    /// </summary>
+    struct ThreadTraceBuffer
+    {
+        static const size_t CAPACITY = 512;  // Older events are overwritten.
+
+        uint32_t ThreadId;
+        ThreadTraceBuffer* Next;
+        std::atomic<size_t> Head;
+        TraceEvent Events[CAPACITY];
+
+        // Write the next event and publish it, owning thread only.
+        // fillDetail(char* detail, size_t size) writes the detail, which starts out empty.
+        template<typename TFillDetail>
+        void Push(TraceCategory category, const char* name, int64_t start, int64_t end, TFillDetail&& fillDetail)
+        {
+            auto head = Head.load(std::memory_order_relaxed);
+            auto& event = Events[head % CAPACITY];
+            event.Start = start;
+            event.End = end;
+            event.Name = name;
+            event.Category = category;
+            event.Detail[0] = '\0';
+            fillDetail(event.Detail, sizeof(event.Detail));
+
+            Head.store(head + 1, std::memory_order_release);
+        }
+    };
+
+    inline void WriteJsonString(FILE* file, const char* utf8)
+    {
+        fputc('"', file);
+        for (auto c = utf8; *c != '\0'; c++)
+        {
+            if (*c == '"' || *c == '\\') fprintf(file, "\\%c", *c);
+            else if (static_cast<unsigned char>(*c) < 0x20) fprintf(file, "\\u%04x", *c);
+            else fputc(*c, file);
+        }
+        fputc('"', file);
+    }
+
+    /// <summary>
+    /// Write the events of a list of thread buffers as a Chrome trace-event JSON document, oldest
+    /// first within each thread. Timestamps are ticks of the given frequency, shown relative to origin.
+    /// Returns the number of events written.
+    /// </summary>
+    inline size_t WriteChromeTraceEvents(FILE* file, const ThreadTraceBuffer* buffers, uint32_t pid, int64_t origin, int64_t frequency)
+    {
+        auto toMicroseconds = [origin, frequency](int64_t ticks) { return static_cast<double>(ticks - origin) * 1000000.0 / frequency; };
+        size_t written = 0;
+
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+        for (auto buffer = buffers; buffer; buffer = buffer->Next)
+        {
+            auto head = buffer->Head.load(std::memory_order_acquire);
+            auto tail = head > ThreadTraceBuffer::CAPACITY ? head - ThreadTraceBuffer::CAPACITY : 0;
+            for (auto i = tail; i < head; i++)
+            {
+                const auto& event = buffer->Events[i % ThreadTraceBuffer::CAPACITY];
+                fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,\"tid\":%u,\"args\":{\"detail\":",
+                    written == 0 ? "" : ",", event.Name, TraceCategoryToString(event.Category),
+                    toMicroseconds(event.Start), toMicroseconds(event.End) - toMicroseconds(event.Start), pid, buffer->ThreadId);
+                WriteJsonString(file, event.Detail);
+                fputs("}}", file);
+                written++;
+            }
+        }
+        fputs("\n]}\n", file);
+        return written;
+    }
+
+#ifdef _WIN32
+
+    /// <summary>
+    /// Lock-free boot timeline recorder, exported as Chrome trace-event JSON
+    /// (open in chrome://tracing or https://ui.perfetto.dev).
+    /// </summary>
+    class BootProfiler
+    {
+    private:
+        std::atomic<bool> enabled_;
+        std::atomic<ThreadTraceBuffer*> buffers_;
+        LARGE_INTEGER frequency_;
+        LARGE_INTEGER origin_;
+
+        ThreadTraceBuffer* getThreadBuffer_()
+        {
+            static thread_local ThreadTraceBuffer* threadBuffer = nullptr;
+            if (threadBuffer)
+            {
+                return threadBuffer;
+            }
+
+            // Allocated once per recording thread and never freed, the exporter may read it at any time.
+            auto buffer = reinterpret_cast<ThreadTraceBuffer*>(VirtualAlloc(nullptr, sizeof(ThreadTraceBuffer), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+            if (!buffer)
+            {
+                return nullptr;
+            }
+            buffer->ThreadId = GetCurrentThreadId();
+            buffer->Head.store(0, std::memory_order_relaxed);
+
+            // Push onto the global list.
+            auto head = buffers_.load(std::memory_order_relaxed);
+            do
+            {
+                buffer->Next = head;
+            } while (!buffers_.compare_exchange_weak(head, buffer, std::memory_order_release, std::memory_order_relaxed));
+
+            return threadBuffer = buffer;
+        }
+
+    public:
+        BootProfiler()
+            : enabled_{ false }
+            , buffers_{ nullptr }
+        {
+            QueryPerformanceFrequency(&frequency_);
+            QueryPerformanceCounter(&origin_);
+        }
+
+        void Enable() { enabled_.store(true, std::memory_order_relaxed); }
+        [[nodiscard]] __forceinline bool Enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] __forceinline LONGLONG Now() const noexcept { return TickClock::Now(); }
+
+        template<typename TChar>
+        void Record(TraceCategory category, const char* name, const TChar* detail, LONGLONG start, LONGLONG end)
+        {
+            auto buffer = getThreadBuffer_();
+            if (!buffer)
+            {
+                return;
+            }
+
+            buffer->Push(category, name, start, end, [detail](char* eventDetail, size_t size)
+                {
+                    if constexpr (sizeof(TChar) == sizeof(wchar_t))
+                    {
+                        if (detail && 0 == WideCharToMultiByte(CP_UTF8, 0, detail, -1, eventDetail, static_cast<int>(size), nullptr, nullptr))
+                        {
+                            eventDetail[size - 1] = '\0';
+                        }
+                    }
+                    else if (detail)
+                    {
+                        strncpy_s(eventDetail, size, detail, _TRUNCATE);
+                    }
+                });
+        }
+
+        // Write everything recorded so far as a Chrome trace-event JSON file.
+        bool WriteChromeTrace(const char* fileName)
+        {
+            FILE* file = fopen(fileName, "w");
+            if (!file)
+            {
+                return false;
+            }
+
+            WriteChromeTraceEvents(file, buffers_.load(std::memory_order_acquire), GetCurrentProcessId(), origin_.QuadPart, frequency_.QuadPart);
+
+            fclose(file);
+            return true;
+        }
+    };
+
+    // Global instance.
+    BootProfiler GProfiler;
+
+    /// <summary>
+    /// RAII helper which records its own lifetime, use through PROFILE_SCOPE.
+    /// </summary>
+    class ScopedTrace
+    {
+    private:
+        LONGLONG start_;
+        const char* name_;
+        const void* detail_;
+        bool wideDetail_;
+        TraceCategory category_;
+
+    public:
+        ScopedTrace(const ScopedTrace& other) = delete;
+        ScopedTrace& operator=(const ScopedTrace& other) = delete;
+
+        __forceinline ScopedTrace(TraceCategory category, const char* name, const wchar_t* detail)
+            : start_{ GProfiler.Enabled() ? GProfiler.Now() : 0 }
+            , name_{ name }
+            , detail_{ detail }
+            , wideDetail_{ true }
+            , category_{ category }
+        {
+
+        }
+
+        __forceinline ScopedTrace(TraceCategory category, const char* name, const char* detail)
+            : start_{ GProfiler.Enabled() ? GProfiler.Now() : 0 }
+            , name_{ name }
+            , detail_{ detail }
+            , wideDetail_{ false }
+            , category_{ category }
+        {
+
+        }
+
+        __forceinline ScopedTrace(TraceCategory category, const char* name, std::nullptr_t)
+            : ScopedTrace(category, name, static_cast<const char*>(nullptr))
+        {
+
+        }
+
+        __forceinline ~ScopedTrace()
+        {
+            if (start_ == 0)
+            {
+                return;
+            }
+
+            if (wideDetail_)
+            {
+                GProfiler.Record(category_, name_, static_cast<const wchar_t*>(detail_), start_, GProfiler.Now());
+            }
+            else
+            {
+                GProfiler.Record(category_, name_, static_cast<const char*>(detail_), start_, GProfiler.Now());
+            }
+        }
+    };
+#endif
+}
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+
+namespace Utils
+{
+    /// Rolling log file layout (little endian), shared with LogDecoder:
+    ///   [0, HEADER_SIZE):   RollingLogHeader, then RollingLogSession[SessionSlots]
+    ///   then SessionSlots regions of SegmentsPerSession segments, SegmentSize bytes each:
+    ///     RollingLogSegment, then Used bytes of UTF-8 text (whole lines where possible)
+    /// Each launch takes over the oldest session slot and writes its segments round-robin,
+    /// so the file never grows and the last SessionSlots sessions stay readable.
+    struct RollingLogHeader
+    {
+        char Magic[8];                // "LEBPRLG1"
+        uint32_t SessionSlots;
+        uint32_t SegmentsPerSession;
+        uint32_t SegmentSize;
+        uint32_t Reserved;
+        uint64_t NextSessionId;
+    };
+
+    struct RollingLogSession
+    {
+        uint64_t Id;                  // 0 if the slot was never used
+        uint64_t StartFileTime;       // local FILETIME
+        uint32_t ProcessId;
+        uint32_t Closed;              // 1 if the session shut down cleanly
+    };
+
+    struct RollingLogSegment
+    {
+        uint64_t SessionId;
+        uint64_t Sequence;            // Segment number within its session, from 1.
+        uint32_t Used;                // Bytes of text after this header.
+        uint32_t Reserved;
+    };
+
+    struct RollingLogSessionText
+    {
+        RollingLogSession Session;
+        bool Wrapped;                 // Older segments of this session were overwritten.
+        std::string Text;
+    };
+
+    /// <summary>
+    /// Writer and reader for the rolling log layout, on a block of memory the caller provides
+    /// (a mapped file in the proxy, a file read into memory in LogDecoder).
+    /// Not thread-safe, the logger calls it from its single consumer.
+    /// </summary>
+    class RollingLog
+    {
+    public:
+        static const uint32_t HEADER_SIZE = 4096;
+        static const uint32_t MAX_SESSION_SLOTS = (HEADER_SIZE - sizeof(RollingLogHeader)) / sizeof(RollingLogSession);
+
+    private:
+        uint8_t* base_ = nullptr;
+        RollingLogSession* session_ = nullptr;
+        RollingLogSegment* segment_ = nullptr;
+        uint32_t slot_ = 0;
+        uint32_t segmentsPerSession_ = 0;
+        uint32_t segmentSize_ = 0;
+
+        static RollingLogSegment* segmentAt_(uint8_t* base, const RollingLogHeader* header, uint32_t slot, uint32_t index)
+        {
+            auto offset = HEADER_SIZE + (static_cast<size_t>(slot) * header->SegmentsPerSession + index) * header->SegmentSize;
+            return reinterpret_cast<RollingLogSegment*>(base + offset);
+        }
+
+        void advanceSegment_()
+        {
+            auto sequence = segment_->Sequence + 1;
+            auto header = reinterpret_cast<RollingLogHeader*>(base_);
+            auto next = segmentAt_(base_, header, slot_, static_cast<uint32_t>((sequence - 1) % segmentsPerSession_));
+
+            // Invalidate first, a crash halfway through must not leave old text under the new sequence.
+            next->Used = 0;
+            next->SessionId = 0;
+            next->Sequence = sequence;
+            next->SessionId = session_->Id;
+            segment_ = next;
+        }
+
+    public:
+        [[nodiscard]] static size_t FileSize(uint32_t sessionSlots, uint32_t segmentsPerSession, uint32_t segmentSize)
+        {
+            return HEADER_SIZE + static_cast<size_t>(sessionSlots) * segmentsPerSession * segmentSize;
+        }
+
+        // Check that base holds a rolling log with this geometry.
+        [[nodiscard]] static bool Validate(const uint8_t* base, size_t size, uint32_t sessionSlots, uint32_t segmentsPerSession, uint32_t segmentSize)
+        {
+            auto header = reinterpret_cast<const RollingLogHeader*>(base);
+            return size >= HEADER_SIZE
+                && 0 == memcmp(header->Magic, "LEBPRLG1", 8)
+                && header->SessionSlots == sessionSlots
+                && header->SegmentsPerSession == segmentsPerSession
+                && header->SegmentSize == segmentSize
+                && size >= FileSize(sessionSlots, segmentsPerSession, segmentSize);
+        }
+
+        // Lay out an empty log in base, which must be FileSize() bytes.
+        static void Format(uint8_t* base, uint32_t sessionSlots, uint32_t segmentsPerSession, uint32_t segmentSize)
+        {
+            memset(base, 0, FileSize(sessionSlots, segmentsPerSession, segmentSize));
+
+            auto header = reinterpret_cast<RollingLogHeader*>(base);
+            header->SessionSlots = sessionSlots;
+            header->SegmentsPerSession = segmentsPerSession;
+            header->SegmentSize = segmentSize;
+            header->NextSessionId = 1;
+            memcpy(header->Magic, "LEBPRLG1", 8);
+        }
+
+        // Start a new session in the slot of the oldest one, base must be valid (see Validate / Format).
+        bool Begin(uint8_t* base, uint64_t startFileTime, uint32_t processId)
+        {
+            auto header = reinterpret_cast<RollingLogHeader*>(base);
+            if (header->SessionSlots == 0 || header->SessionSlots > MAX_SESSION_SLOTS
+                || header->SegmentsPerSession == 0 || header->SegmentSize <= sizeof(RollingLogSegment))
+            {
+                return false;
+            }
+
+            auto sessions = reinterpret_cast<RollingLogSession*>(base + sizeof(RollingLogHeader));
+            uint32_t oldest = 0;
+            for (uint32_t i = 1; i < header->SessionSlots; i++)
+            {
+                if (sessions[i].Id < sessions[oldest].Id)
+                {
+                    oldest = i;
+                }
+            }
+
+            base_ = base;
+            slot_ = oldest;
+            segmentsPerSession_ = header->SegmentsPerSession;
+            segmentSize_ = header->SegmentSize;
+
+            session_ = &sessions[oldest];
+            session_->Id = 0;
+            session_->StartFileTime = startFileTime;
+            session_->ProcessId = processId;
+            session_->Closed = 0;
+            session_->Id = header->NextSessionId++;
+
+            // The sentinel makes the first advance land on segment 0 with sequence 1.
+            RollingLogSegment sentinel{};
+            segment_ = &sentinel;
+            advanceSegment_();
+            return true;
+        }
+
+        [[nodiscard]] bool IsOpen() const noexcept { return session_ != nullptr; }
+
+        // Append UTF-8 text, moving to the next segment at a line boundary when the current one is full.
+        void Append(const char* text, size_t length)
+        {
+            if (!session_)
+            {
+                return;
+            }
+
+            auto capacity = segmentSize_ - static_cast<uint32_t>(sizeof(RollingLogSegment));
+            while (length != 0)
+            {
+                auto room = capacity - segment_->Used;
+                size_t chunk = length;
+                if (chunk > room)
+                {
+                    // Cut after the last newline that fits, or mid-line if a single line fills a whole segment.
+                    chunk = 0;
+                    for (size_t i = room; i > 0; i--)
+                    {
+                        if (text[i - 1] == '\n')
+                        {
+                            chunk = i;
+                            break;
+                        }
+                    }
+                    if (chunk == 0 && segment_->Used == 0)
+                    {
+                        chunk = room;
+                    }
+                }
+
+                if (chunk != 0)
+                {
+                    // Text before the length, so a crash never exposes unwritten bytes.
+                    memcpy(reinterpret_cast<uint8_t*>(segment_ + 1) + segment_->Used, text, chunk);
+                    segment_->Used += static_cast<uint32_t>(chunk);
+                    text += chunk;
+                    length -= chunk;
+                }
+                if (length != 0)
+                {
+                    advanceSegment_();
+                }
+            }
+        }
+
+        // Mark the session as cleanly closed and stop writing.
+        void End()
+        {
+            if (session_)
+            {
+                session_->Closed = 1;
+                session_ = nullptr;
+                segment_ = nullptr;
+            }
+        }
+
+        // Collect the text of every session in the log, oldest session first.
+        static bool Read(const uint8_t* base, size_t size, std::vector<RollingLogSessionText>& outSessions)
+        {
+            auto header = reinterpret_cast<const RollingLogHeader*>(base);
+            if (size < HEADER_SIZE || 0 != memcmp(header->Magic, "LEBPRLG1", 8)
+                || header->SessionSlots == 0 || header->SessionSlots > MAX_SESSION_SLOTS
+                || header->SegmentsPerSession == 0 || header->SegmentSize <= sizeof(RollingLogSegment)
+                || size < FileSize(header->SessionSlots, header->SegmentsPerSession, header->SegmentSize))
+            {
+                return false;
+            }
+
+            auto sessions = reinterpret_cast<const RollingLogSession*>(base + sizeof(RollingLogHeader));
+            auto capacity = header->SegmentSize - static_cast<uint32_t>(sizeof(RollingLogSegment));
+            for (uint32_t slot = 0; slot < header->SessionSlots; slot++)
+            {
+                if (sessions[slot].Id == 0)
+                {
+                    continue;
+                }
+
+                std::vector<const RollingLogSegment*> segments;
+                for (uint32_t index = 0; index < header->SegmentsPerSession; index++)
+                {
+                    auto segment = segmentAt_(const_cast<uint8_t*>(base), header, slot, index);
+                    if (segment->SessionId == sessions[slot].Id && segment->Sequence != 0)
+                    {
+                        segments.push_back(segment);
+                    }
+                }
+                std::sort(segments.begin(), segments.end(),
+                    [](const RollingLogSegment* a, const RollingLogSegment* b) { return a->Sequence < b->Sequence; });
+
+                RollingLogSessionText session{ sessions[slot], !segments.empty() && segments.front()->Sequence != 1, {} };
+                for (auto segment : segments)
+                {
+                    session.Text.append(reinterpret_cast<const char*>(segment + 1), (std::min)(segment->Used, capacity));
+                }
+                outSessions.push_back(std::move(session));
+            }
+
+            std::sort(outSessions.begin(), outSessions.end(),
+                [](const RollingLogSessionText& a, const RollingLogSessionText& b) { return a.Session.Id < b.Session.Id; });
+            return true;
+        }
+    };
+
+#ifdef _WIN32
+    /// <summary>
+    /// Rolling log in a preallocated memory-mapped file (-rollinglog).
+    /// Written pages belong to the system as soon as they are copied, so a crash loses nothing
+    /// that reached the file, and the size stays fixed no matter how long the session runs.
+    /// </summary>
+    class RollingLogFile
+    {
+    private:
+        static const uint32_t SESSION_SLOTS = 4;
+        static const uint32_t SEGMENTS_PER_SESSION = 32;
+        static const uint32_t SEGMENT_SIZE = 64 * 1024;   // 8 MB file in total.
+        static const size_t CONVERT_CHARS = 16 * 1024;
+
+        HANDLE file_ = INVALID_HANDLE_VALUE;
+        HANDLE mapping_ = nullptr;
+        uint8_t* view_ = nullptr;
+        RollingLog log_;
+        char utf8_[CONVERT_CHARS * 3];
+
+    public:
+        bool Open(const char* fileName)
+        {
+            auto size = RollingLog::FileSize(SESSION_SLOTS, SEGMENTS_PER_SESSION, SEGMENT_SIZE);
+
+            file_ = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file_ == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+
+            LARGE_INTEGER existingSize{};
+            GetFileSizeEx(file_, &existingSize);
+
+            mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+            if (!mapping_ || nullptr == (view_ = reinterpret_cast<uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, size))))
+            {
+                Close();
+                return false;
+            }
+
+            // Start over if the file is new, foreign or has another geometry.
+            if (static_cast<size_t>(existingSize.QuadPart) != size
+                || !RollingLog::Validate(view_, size, SESSION_SLOTS, SEGMENTS_PER_SESSION, SEGMENT_SIZE))
+            {
+                RollingLog::Format(view_, SESSION_SLOTS, SEGMENTS_PER_SESSION, SEGMENT_SIZE);
+            }
+
+            SYSTEMTIME localTime;
+            FILETIME localFileTime;
+            GetLocalTime(&localTime);
+            SystemTimeToFileTime(&localTime, &localFileTime);
+
+            if (!log_.Begin(view_, (static_cast<uint64_t>(localFileTime.dwHighDateTime) << 32) | localFileTime.dwLowDateTime, GetCurrentProcessId()))
+            {
+                Close();
+                return false;
+            }
+            return true;
+        }
+
+        [[nodiscard]] bool IsOpen() const noexcept { return log_.IsOpen(); }
+
+        void Write(const wchar_t* text, size_t length)
+        {
+            while (length != 0)
+            {
+                // Convert in chunks, never splitting a surrogate pair.
+                auto chunk = min(length, CONVERT_CHARS);
+                if (chunk < length && IS_HIGH_SURROGATE(text[chunk - 1]))
+                {
+                    chunk--;
+                }
+
+                auto bytes = WideCharToMultiByte(CP_UTF8, 0, text, static_cast<int>(chunk), utf8_, sizeof(utf8_), nullptr, nullptr);
+                if (bytes > 0)
+                {
+                    log_.Append(utf8_, bytes);
+                }
+                text += chunk;
+                length -= chunk;
+            }
+        }
+
+        void Close()
+        {
+            log_.End();
+            if (view_)
+            {
+                FlushViewOfFile(view_, 0);
+                UnmapViewOfFile(view_);
+                view_ = nullptr;
+            }
+            if (mapping_)
+            {
+                CloseHandle(mapping_);
+                mapping_ = nullptr;
+            }
+            if (file_ != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(file_);
+                file_ = INVALID_HANDLE_VALUE;
+            }
+        }
+    };
+#endif
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+
+
+namespace Utils
+{
+    // Fold a UTF-16 code unit for case-insensitive ordinal comparison: ASCII and Latin-1 letters
+    // compare the way the file system sees them, other characters compare by code unit.
+    // Portable on purpose, unlike CompareStringOrdinal the result doesn't depend on the OS.
+    [[nodiscard]] inline uint32_t FoldOrdinal(wchar_t c) noexcept
+    {
+        auto unit = static_cast<uint32_t>(c);
+        if ((unit >= L'a' && unit <= L'z') || (unit >= 0xE0 && unit <= 0xFE && unit != 0xF7))
+        {
+            return unit - 0x20;
+        }
+        return unit == 0xFF ? 0x178 : unit;
+    }
+
+    // <0, 0 or >0 like wcscmp, ignoring case as FoldOrdinal does.
+    [[nodiscard]] inline int CompareOrdinalIgnoreCase(const wchar_t* lhs, const wchar_t* rhs) noexcept
+    {
+        for (;; lhs++, rhs++)
+        {
+            auto l = FoldOrdinal(*lhs);
+            auto r = FoldOrdinal(*rhs);
+            if (l != r)
+            {
+                return l < r ? -1 : 1;
+            }
+            if (l == 0)
+            {
+                return 0;
+            }
+        }
+    }
+
+    // True if str ends with suffix, ignoring case.
+    [[nodiscard]] inline bool EndsWithIgnoreCase(const wchar_t* str, const wchar_t* suffix) noexcept
+    {
+        auto strLen = wcslen(str);
+        auto suffixLen = wcslen(suffix);
+        return strLen >= suffixLen && 0 == CompareOrdinalIgnoreCase(str + strLen - suffixLen, suffix);
+    }
+
+    /// <summary>
+    /// Table of wide strings packed back to back into one fixed buffer, with no heap use at all.
+    /// Entries are addressed by their 16-bit offset into the buffer, so the whole table costs
+    /// ARENA_CHARS * 2 + MAX_ENTRIES * 2 bytes and Get() pointers stay valid until Clear().
+    /// The defaults take 64 KB and hold at most 28,672 characters including each entry's terminator,
+    /// about 1400 plugin paths of 20 characters, and never more than 4096 entries. ARENA_CHARS can't
+    /// go past 64K characters.
+    /// </summary>
+    template<size_t ARENA_CHARS = 28 * 1024, size_t MAX_ENTRIES = 4096>
+    class StringTable
+    {
+        static_assert(ARENA_CHARS <= 0x10000, "offsets are 16-bit");
+
+    private:
+        wchar_t arena_[ARENA_CHARS];
+        uint16_t offsets_[MAX_ENTRIES];
+        size_t used_ = 0;
+        size_t count_ = 0;
+
+    public:
+        StringTable() = default;
+        StringTable(const StringTable& other) = delete;
+        StringTable& operator=(const StringTable& other) = delete;
+
+        // Append prefix + str as a single entry, returns false (and adds nothing) if the table is full.
+        bool Add(const wchar_t* prefix, const wchar_t* str)
+        {
+            auto prefixLen = prefix ? wcslen(prefix) : 0;
+            auto strLen = wcslen(str);
+
+            if (count_ == MAX_ENTRIES || used_ + prefixLen + strLen + 1 > ARENA_CHARS)
+            {
+                return false;
+            }
+
+            offsets_[count_++] = static_cast<uint16_t>(used_);
+            std::copy(prefix, prefix + prefixLen, arena_ + used_);
+            std::copy(str, str + strLen + 1, arena_ + used_ + prefixLen);
+            used_ += prefixLen + strLen + 1;
+            return true;
+        }
+
+        // Sort entries case-insensitively the same way the file system compares names (ties broken
+        // by exact code units), so that the order doesn't depend on what the directory listing returns.
+        void Sort()
+        {
+            auto base = arena_;
+            std::sort(offsets_, offsets_ + count_, [base](uint16_t lhs, uint16_t rhs)
+                {
+                    auto rc = CompareOrdinalIgnoreCase(base + lhs, base + rhs);
+                    return rc != 0 ? rc < 0 : wcscmp(base + lhs, base + rhs) < 0;
+                });
+        }
+
+        void Clear() noexcept
+        {
+            used_ = 0;
+            count_ = 0;
+        }
+
+        [[nodiscard]] const wchar_t* Get(size_t index) const noexcept { return arena_ + offsets_[index]; }
+        [[nodiscard]] wchar_t* Get(size_t index) noexcept { return arena_ + offsets_[index]; }
+        [[nodiscard]] size_t Count() const noexcept { return count_; }
+        [[nodiscard]] size_t CharsUsed() const noexcept { return used_; }
+        [[nodiscard]] static constexpr size_t MemoryUsage() noexcept { return sizeof(StringTable); }
+    };
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <chrono>
+#endif
+
+
+namespace Utils
+{
+    struct WallTime
+    {
+        unsigned Hour;
+        unsigned Minute;
+        unsigned Second;
+        unsigned Millisecond;
+        unsigned Microsecond;
+    };
+
+    /// <summary>
+    /// Turns raw monotonic ticks (QPC) into local time of day.
+    /// Anchored by pairing one tick with one wall clock reading, after that
+    /// each conversion is integer arithmetic. Re-anchor now and then to follow clock changes.
+    /// </summary>
+    class TickClock
+    {
+    private:
+        static const int64_t US_PER_SECOND = 1000000;
+        static const int64_t US_PER_DAY = 24ll * 3600 * US_PER_SECOND;
+
+        int64_t ticksPerSecond_ = 1;
+        int64_t anchorTick_ = 0;
+        int64_t anchorUsOfDay_ = 0;
+
+    public:
+        void Anchor(int64_t ticksPerSecond, int64_t anchorTick, int64_t anchorUsOfDay)
+        {
+            ticksPerSecond_ = ticksPerSecond > 0 ? ticksPerSecond : 1;
+            anchorTick_ = anchorTick;
+            anchorUsOfDay_ = anchorUsOfDay;
+        }
+
+        // Microseconds between the anchor and tick, negative for ticks taken before the anchor.
+        [[nodiscard]] int64_t MicrosecondsSinceAnchor(int64_t tick) const noexcept
+        {
+            // Split to stay clear of overflow for long sessions at high tick rates.
+            auto delta = tick - anchorTick_;
+            auto seconds = delta / ticksPerSecond_;
+            auto remainder = delta % ticksPerSecond_;
+            return seconds * US_PER_SECOND + remainder * US_PER_SECOND / ticksPerSecond_;
+        }
+
+        [[nodiscard]] WallTime ToWallTime(int64_t tick) const noexcept
+        {
+            auto usOfDay = (anchorUsOfDay_ + MicrosecondsSinceAnchor(tick)) % US_PER_DAY;
+            if (usOfDay < 0)
+            {
+                usOfDay += US_PER_DAY;
+            }
+
+            WallTime time;
+            time.Microsecond = static_cast<unsigned>(usOfDay % 1000);
+            time.Millisecond = static_cast<unsigned>(usOfDay / 1000 % 1000);
+            time.Second = static_cast<unsigned>(usOfDay / US_PER_SECOND % 60);
+            time.Minute = static_cast<unsigned>(usOfDay / (60 * US_PER_SECOND) % 60);
+            time.Hour = static_cast<unsigned>(usOfDay / (3600 * US_PER_SECOND));
+            return time;
+        }
+
+#ifdef _WIN32
+        [[nodiscard]] static int64_t Now() noexcept
+        {
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            return now.QuadPart;
+        }
+
+        // Anchor to the current local time.
+        void AnchorNow()
+        {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+
+            SYSTEMTIME localTime;
+            GetLocalTime(&localTime);
+            auto tick = Now();
+
+            Anchor(frequency.QuadPart, tick,
+                ((localTime.wHour * 60ll + localTime.wMinute) * 60 + localTime.wSecond) * US_PER_SECOND + localTime.wMilliseconds * 1000ll);
+        }
+#else
+        // steady_clock ticks stand in for QPC elsewhere.
+        [[nodiscard]] static int64_t Now() noexcept
+        {
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+        }
+#endif
+    };
+}
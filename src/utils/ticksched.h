@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Utils
+{
+    /// <summary>
+    /// Per-frame callbacks run by one frame-boundary hook, in ascending priority (ties in registration
+    /// order). Each callback is timed, and running over its budget counts as an overrun which is reported
+    /// the 1st, 2nd, 4th, 8th... time so a callback that is always slow doesn't flood the log.
+    /// Callbacks are registered from any thread. Once Unregister returns, the callback won't run again
+    /// (it waits for a frame in progress), which is what makes unloading a plugin safe; a callback may
+    /// unregister itself or others from inside a frame.
+    /// The clock is passed in (microseconds), so a simulated one can drive it.
+    /// </summary>
+    class TickScheduler
+    {
+    public:
+        struct Stats
+        {
+            uint64_t Calls;
+            uint64_t Overruns;
+            int64_t LastUs;
+            int64_t MaxUs;
+            int64_t AverageUs;      // Moving average over roughly the last 16 frames.
+            int64_t BudgetUs;       // 0 for none.
+        };
+
+    private:
+        struct Entry
+        {
+            uint32_t Id;
+            void* Proc;
+            void* Context;
+            int Priority;
+            int64_t BudgetUs;
+            const void* Owner;
+            std::atomic<bool> Active{ true };
+            std::atomic<uint64_t> Calls{ 0 };
+            std::atomic<uint64_t> Overruns{ 0 };
+            std::atomic<int64_t> LastUs{ 0 };
+            std::atomic<int64_t> MaxUs{ 0 };
+            std::atomic<int64_t> AverageUs16{ 0 };   // Fixed point, 16x.
+        };
+
+        typedef std::vector<std::shared_ptr<Entry>> EntryList;
+
+        std::mutex listMtx_;
+        std::mutex runMtx_;                         // Held while a frame runs.
+        std::shared_ptr<const EntryList> entries_ = std::make_shared<EntryList>();
+        std::atomic<std::thread::id> runningThread_{};
+        uint32_t nextId_ = 1;
+        std::atomic<uint64_t> frame_{ 0 };
+
+        // listMtx_ held.
+        void publish_(EntryList list)
+        {
+            std::stable_sort(list.begin(), list.end(),
+                [](const std::shared_ptr<Entry>& a, const std::shared_ptr<Entry>& b) { return a->Priority < b->Priority; });
+            entries_ = std::make_shared<const EntryList>(std::move(list));
+        }
+
+        // After taking entries out: make sure none of them runs from here on.
+        void waitForFrame_()
+        {
+            if (runningThread_.load() != std::this_thread::get_id())
+            {
+                const std::lock_guard<std::mutex> wait(runMtx_);
+            }
+        }
+
+    public:
+        // Returns the callback's ID, 0 for a null proc.
+        uint32_t Register(void* proc, void* context, int priority, int64_t budgetUs, const void* owner)
+        {
+            if (!proc)
+            {
+                return 0;
+            }
+
+            auto entry = std::make_shared<Entry>();
+            entry->Proc = proc;
+            entry->Context = context;
+            entry->Priority = priority;
+            entry->BudgetUs = budgetUs > 0 ? budgetUs : 0;
+            entry->Owner = owner;
+
+            const std::lock_guard<std::mutex> lock(listMtx_);
+            entry->Id = nextId_++;
+            auto list = *entries_;
+            list.push_back(entry);
+            publish_(std::move(list));
+            return entry->Id;
+        }
+
+        bool Unregister(uint32_t id)
+        {
+            {
+                const std::lock_guard<std::mutex> lock(listMtx_);
+                auto list = *entries_;
+                auto it = std::find_if(list.begin(), list.end(), [id](const std::shared_ptr<Entry>& e) { return e->Id == id; });
+                if (it == list.end())
+                {
+                    return false;
+                }
+                (*it)->Active.store(false);
+                list.erase(it);
+                publish_(std::move(list));
+            }
+            waitForFrame_();
+            return true;
+        }
+
+        // Drop everything a plugin registered.
+        size_t UnregisterOwnedBy(const void* owner)
+        {
+            if (!owner)
+            {
+                return 0;
+            }
+
+            size_t removed = 0;
+            {
+                const std::lock_guard<std::mutex> lock(listMtx_);
+                EntryList list;
+                for (const auto& entry : *entries_)
+                {
+                    if (entry->Owner == owner)
+                    {
+                        entry->Active.store(false);
+                        removed++;
+                    }
+                    else
+                    {
+                        list.push_back(entry);
+                    }
+                }
+                if (removed != 0)
+                {
+                    publish_(std::move(list));
+                }
+            }
+            if (removed != 0)
+            {
+                waitForFrame_();
+            }
+            return removed;
+        }
+
+        // Run one frame's callbacks: call(proc, context) for each, nowUs() -> int64_t around each
+        // of them, overrun(id, costUs, budgetUs, overruns) when a report is due.
+        template<typename TNow, typename TCall, typename TOverrun>
+        void RunFrame(TNow&& nowUs, TCall&& call, TOverrun&& overrun)
+        {
+            const std::lock_guard<std::mutex> running(runMtx_);
+            runningThread_.store(std::this_thread::get_id());
+
+            std::shared_ptr<const EntryList> entries;
+            {
+                const std::lock_guard<std::mutex> lock(listMtx_);
+                entries = entries_;
+            }
+
+            for (const auto& entry : *entries)
+            {
+                if (!entry->Active.load(std::memory_order_relaxed))
+                {
+                    continue;   // Unregistered by an earlier callback of this frame.
+                }
+
+                auto start = nowUs();
+                call(entry->Proc, entry->Context);
+                auto cost = nowUs() - start;
+
+                entry->Calls.fetch_add(1, std::memory_order_relaxed);
+                entry->LastUs.store(cost, std::memory_order_relaxed);
+                if (cost > entry->MaxUs.load(std::memory_order_relaxed))
+                {
+                    entry->MaxUs.store(cost, std::memory_order_relaxed);
+                }
+                auto average16 = entry->AverageUs16.load(std::memory_order_relaxed);
+                entry->AverageUs16.store(average16 + cost - average16 / 16, std::memory_order_relaxed);
+
+                if (entry->BudgetUs != 0 && cost > entry->BudgetUs)
+                {
+                    auto overruns = entry->Overruns.fetch_add(1, std::memory_order_relaxed) + 1;
+                    if ((overruns & (overruns - 1)) == 0)
+                    {
+                        overrun(entry->Id, cost, entry->BudgetUs, overruns);
+                    }
+                }
+            }
+
+            frame_.fetch_add(1, std::memory_order_relaxed);
+            runningThread_.store(std::thread::id{});
+        }
+
+        bool GetStats(uint32_t id, Stats& outStats)
+        {
+            const std::lock_guard<std::mutex> lock(listMtx_);
+            for (const auto& entry : *entries_)
+            {
+                if (entry->Id == id)
+                {
+                    outStats = Stats{
+                        entry->Calls.load(std::memory_order_relaxed),
+                        entry->Overruns.load(std::memory_order_relaxed),
+                        entry->LastUs.load(std::memory_order_relaxed),
+                        entry->MaxUs.load(std::memory_order_relaxed),
+                        entry->AverageUs16.load(std::memory_order_relaxed) / 16,
+                        entry->BudgetUs };
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        [[nodiscard]] uint64_t Frame() const noexcept { return frame_.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] size_t Count()
+        {
+            const std::lock_guard<std::mutex> lock(listMtx_);
+            return entries_->size();
+        }
+    };
+
+
+    // Run by the frame-boundary hook (see FrameTickModule), plugins register through SPI.
+    TickScheduler GTickScheduler;
+}
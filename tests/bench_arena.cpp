@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/arena.h"
+
+
+// The SPI allocators against malloc/free, the way plugins use them: per-frame temporaries from the
+// scratch arena (dropped at the frame boundary, not one by one), and small long-lived objects from
+// the size-class pools, on one thread and with several threads allocating and freeing at once.
+//
+// Run by hand: bench_arena [frames]
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t PER_FRAME = 2000;                  // Allocations per frame.
+    const size_t SIZES[] = { 24, 40, 64, 100, 160, 256, 48, 520 };
+    const size_t SIZE_COUNT = sizeof(SIZES) / sizeof(SIZES[0]);
+
+    Utils::SizeClassPools pools;
+
+    template<typename TFunc>
+    double nsPerAllocation(size_t frames, TFunc&& frame)
+    {
+        auto start = Clock::now();
+        for (size_t f = 0; f < frames; f++)
+        {
+            frame(f);
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (frames * PER_FRAME);
+    }
+
+    // Allocate a frame's worth, touch each block, free them all at the end of the frame.
+    double mallocFrames(size_t frames)
+    {
+        std::vector<void*> blocks(PER_FRAME);
+        return nsPerAllocation(frames, [&blocks](size_t f)
+            {
+                for (size_t i = 0; i < PER_FRAME; i++)
+                {
+                    blocks[i] = malloc(SIZES[(i + f) % SIZE_COUNT]);
+                    *static_cast<uint8_t*>(blocks[i]) = 1;
+                }
+                for (auto block : blocks)
+                {
+                    free(block);
+                }
+            });
+    }
+
+    double scratchFrames(size_t frames)
+    {
+        Utils::FrameArenas arenas;
+        return nsPerAllocation(frames, [&arenas](size_t f)
+            {
+                for (size_t i = 0; i < PER_FRAME; i++)
+                {
+                    *static_cast<uint8_t*>(arenas.Allocate(SIZES[(i + f) % SIZE_COUNT])) = 1;
+                }
+                arenas.AdvanceFrame();
+            });
+    }
+
+    double pooledFrames(size_t frames)
+    {
+        std::vector<void*> blocks(PER_FRAME);
+        return nsPerAllocation(frames, [&blocks](size_t f)
+            {
+                for (size_t i = 0; i < PER_FRAME; i++)
+                {
+                    blocks[i] = pools.Allocate(SIZES[(i + f) % SIZE_COUNT]);
+                    *static_cast<uint8_t*>(blocks[i]) = 1;
+                }
+                for (auto block : blocks)
+                {
+                    pools.Free(block);
+                }
+            });
+    }
+
+    // The same on several threads at once, per allocation as seen by each thread.
+    template<typename TRun>
+    double threaded(unsigned threadCount, size_t frames, TRun&& run)
+    {
+        std::vector<std::thread> threads;
+        std::vector<double> results(threadCount);
+        for (unsigned t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&run, &results, frames, t]() { results[t] = run(frames); });
+        }
+        double total = 0;
+        for (unsigned t = 0; t < threadCount; t++)
+        {
+            threads[t].join();
+            total += results[t];
+        }
+        return total / threadCount;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t frames = argc > 1 ? std::stoul(argv[1]) : 2000;
+    printf("%zu frames of %zu allocations, 24 to 520 bytes\n", frames, PER_FRAME);
+
+    printf("%-32s %8.1f ns\n", "malloc + free", mallocFrames(frames));
+    printf("%-32s %8.1f ns\n", "AllocScratch (frame reset)", scratchFrames(frames));
+    printf("%-32s %8.1f ns\n", "AllocPooled + FreePooled", pooledFrames(frames));
+
+    const unsigned threadCount = 4;
+    printf("%u threads:\n", threadCount);
+    printf("%-32s %8.1f ns\n", "malloc + free", threaded(threadCount, frames / threadCount, mallocFrames));
+    printf("%-32s %8.1f ns\n", "AllocPooled + FreePooled", threaded(threadCount, frames / threadCount, pooledFrames));
+
+    printf("(pool slabs %zu KB)\n", pools.SlabBytes() / 1024);
+    return 0;
+}
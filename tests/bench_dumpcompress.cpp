@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "utils/dumpcompress.h"
+
+
+// Dump compression (.dmpz) on a synthetic dump: mostly zero pages (reserved but untouched memory,
+// cleared buffers), heap pages of pointers and small integers, and some incompressible pages standing
+// for textures and compressed assets. Reports throughput and ratio per worker count, the way
+// CompressDumpFile runs it, with reading and writing in memory so only the compression is timed.
+//
+// Run by hand: bench_dumpcompress [dump size in MB]
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Utils::DumpCompressor;
+
+    const size_t PAGE_SIZE = 4096;
+
+    std::vector<uint8_t> dumpLike(size_t size)
+    {
+        std::vector<uint8_t> data(size, 0);
+        std::mt19937_64 random(42);
+        for (size_t page = 0; page < size / PAGE_SIZE; page++)
+        {
+            auto bytes = data.data() + page * PAGE_SIZE;
+            auto kind = random() % 100;
+            if (kind < 60)
+            {
+                continue;                                       // Zero page.
+            }
+            if (kind < 85)
+            {
+                // Heap: 8-byte words, pointers into a few regions, small counts and flags, gaps.
+                for (size_t offset = 0; offset < PAGE_SIZE; offset += 8)
+                {
+                    uint64_t word = 0;
+                    auto pick = random() % 8;
+                    if (pick < 3)
+                    {
+                        word = 0x00007FF600000000ull + ((random() % 4) << 28) + (random() & 0xFFFFFF8);
+                    }
+                    else if (pick < 5)
+                    {
+                        word = random() % 256;
+                    }
+                    else if (pick == 5)
+                    {
+                        word = random();
+                    }
+                    memcpy(bytes + offset, &word, 8);
+                }
+                continue;
+            }
+            for (size_t offset = 0; offset < PAGE_SIZE; offset += 8)
+            {
+                auto word = random();                           // Incompressible.
+                memcpy(bytes + offset, &word, 8);
+            }
+        }
+        return data;
+    }
+
+    // Compress in memory, return the output size and the seconds it took.
+    bool compress(const std::vector<uint8_t>& data, unsigned threadCount, std::vector<uint8_t>& file, double& seconds)
+    {
+        file.clear();
+        size_t readAt = 0;
+        auto read = [&data, &readAt](void* buffer, size_t size)
+        {
+            auto count = std::min(size, data.size() - readAt);
+            if (count != 0)
+            {
+                memcpy(buffer, data.data() + readAt, count);
+            }
+            readAt += count;
+            return count;
+        };
+        auto write = [&file](const void* bytes, size_t size)
+        {
+            file.insert(file.end(), static_cast<const uint8_t*>(bytes), static_cast<const uint8_t*>(bytes) + size);
+            return true;
+        };
+
+        auto start = Clock::now();
+        auto compressed = DumpCompressor::Compress(read, write, threadCount);
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return compressed;
+    }
+
+    // What LogDecoder does, to make sure the numbers are for a file that unpacks.
+    bool roundTrips(const std::vector<uint8_t>& file, const std::vector<uint8_t>& data)
+    {
+        Utils::DumpzTrailer trailer;
+        std::vector<Utils::DumpzChunk> index;
+        if (!DumpCompressor::ReadIndex(file.data(), file.size(), trailer, index) || trailer.RawSize != data.size())
+        {
+            return false;
+        }
+        std::vector<uint8_t> out(trailer.RawSize);
+        for (const auto& chunk : index)
+        {
+            if (!DumpCompressor::ReadChunk(file.data(), chunk, out.data() + chunk.RawOffset))
+            {
+                return false;
+            }
+        }
+        return out == data;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 256;
+    auto data = dumpLike(megabytes * 1024 * 1024);
+    printf("%zu MB synthetic dump, %u MB chunks (60%% zero pages, 25%% heap, 15%% incompressible)\n",
+        megabytes, DumpCompressor::CHUNK_SIZE / (1024 * 1024));
+
+    std::vector<uint8_t> file;
+    for (unsigned threadCount : { 1u, 2u, 4u, 8u })
+    {
+        double seconds = 0;
+        if (!compress(data, threadCount, file, seconds))
+        {
+            printf("%u worker(s): compression failed\n", threadCount);
+            return 1;
+        }
+        printf("%u worker(s): %8.1f MB/s, %6.2f:1 (%zu MB)\n", threadCount, megabytes / seconds,
+            static_cast<double>(data.size()) / file.size(), file.size() / (1024 * 1024));
+    }
+
+    if (!roundTrips(file, data))
+    {
+        printf("the last file doesn't decompress to the input\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/eventdispatch.h"
+
+
+// ProcessEvent dispatch (SPI SubscribeEvent) with a few hundred subscribed functions among many
+// more that aren't: the cost a call pays before the original, with and without handlers, alone and
+// with other threads dispatching too, and what changing subscriptions costs now that old handler
+// lists are freed once no dispatch can see them (they used to be kept until exit).
+//
+// Run by hand: bench_eventdispatch [subscribed function count]
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Utils::EventDispatchTable;
+
+    std::atomic<uint64_t> handled{ 0 };
+
+    bool handler(void*, void*)
+    {
+        handled.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // HookedProcessEvent without the original.
+    void dispatch(const EventDispatchTable& table, const void* function)
+    {
+        typedef bool (*tHandler)(void* object, void* context);
+
+        if (!table.Find(function))
+        {
+            return;
+        }
+        {
+            const EventDispatchTable::Reader reader(table);
+            if (auto handlers = table.Find(function))
+            {
+                for (const auto& entry : handlers->Pre)
+                {
+                    reinterpret_cast<tHandler>(entry.Proc)(nullptr, entry.Context);
+                }
+            }
+        }
+        const EventDispatchTable::Reader reader(table);
+        if (auto handlers = table.Find(function))
+        {
+            for (const auto& entry : handlers->Post)
+            {
+                reinterpret_cast<tHandler>(entry.Proc)(nullptr, entry.Context);
+            }
+        }
+    }
+
+    template<typename TFunc>
+    double nsPer(size_t count, TFunc&& func)
+    {
+        auto start = Clock::now();
+        for (size_t i = 0; i < count; i++)
+        {
+            func(i);
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t subscribed = argc > 1 ? std::stoul(argv[1]) : 300;
+    const size_t functionCount = 50000;     // Roughly the UFunctions of a loaded game.
+    std::vector<uint64_t> functions(functionCount);
+    auto table = std::make_unique<EventDispatchTable>();
+    auto proc = reinterpret_cast<void*>(&handler);
+
+    // Every 17th function, a pre- and a post-call handler each.
+    for (size_t i = 0; i < subscribed; i++)
+    {
+        table->Subscribe(&functions[i * 17 % functionCount], 0, proc, nullptr, 0, nullptr);
+        table->Subscribe(&functions[i * 17 % functionCount], 0, proc, nullptr, EventDispatchTable::FLAG_POST, nullptr);
+    }
+
+    printf("%zu of %zu functions subscribed\n", subscribed, functionCount);
+    printf("%-40s %10.1f ns\n", "dispatch, miss", nsPer(10000000, [&](size_t i) {
+        dispatch(*table, &functions[(i * 17 + 1) % functionCount]); }));
+    printf("%-40s %10.1f ns\n", "dispatch, hit (2 handlers)", nsPer(10000000, [&](size_t i) {
+        dispatch(*table, &functions[i % subscribed * 17 % functionCount]); }));
+
+    // The game binds every function it loads, OnBind sees them all (others than the subscribed
+    // ones here, binding those again would drop their subscriptions).
+    std::vector<uint64_t> loaded(functionCount);
+    auto bind = [&](size_t i) { auto index = i * 17 % functionCount; table->OnBind(&loaded[index], index % 1000); };
+    printf("%-40s %10.1f ns\n", "bind, no name subscriptions", nsPer(1000000, bind));
+    auto byName = table->Subscribe(nullptr, 0xFFFF, proc, nullptr, 0, nullptr);
+    printf("%-40s %10.1f ns\n", "bind, names tracked", nsPer(1000000, bind));
+    table->Unsubscribe(byName);
+
+    // Other threads dispatching too share the reader counts.
+    const unsigned threadCount = 4;
+    std::atomic<bool> stop{ false };
+    std::vector<std::thread> others;
+    for (unsigned t = 1; t < threadCount; t++)
+    {
+        others.emplace_back([&table, &functions, &stop, subscribed, functionCount, t]()
+            {
+                for (size_t i = t; !stop.load(std::memory_order_relaxed); i++)
+                {
+                    dispatch(*table, &functions[i % subscribed * 17 % functionCount]);
+                }
+            });
+    }
+    printf("%-40s %10.1f ns\n", "dispatch, hit, 4 threads dispatching", nsPer(2000000, [&](size_t i) {
+        dispatch(*table, &functions[i % subscribed * 17 % functionCount]); }));
+
+    // A plugin subscribing and unsubscribing while the others dispatch: each change waits for the
+    // dispatches that could see the old list.
+    auto extra = &functions[1];
+    printf("%-40s %10.1f us\n", "subscribe + unsubscribe, under load", nsPer(2000, [&](size_t) {
+        table->Unsubscribe(table->Subscribe(extra, 0, proc, nullptr, 0, nullptr)); }) / 1000);
+    stop.store(true);
+    for (auto& other : others)
+    {
+        other.join();
+    }
+
+    const size_t changes = 100000;
+    printf("%-40s %10.1f us\n", "subscribe + unsubscribe, alone", nsPer(changes, [&](size_t) {
+        table->Unsubscribe(table->Subscribe(extra, 0, proc, nullptr, 0, nullptr)); }) / 1000);
+    printf("handler lists after %zu more changes: %zu (before: %zu more, kept until exit)\n",
+        changes + 2000, table->ListCount(), 2 * (changes + 2000));
+    printf("(%llu handler calls)\n", static_cast<unsigned long long>(handled.load()));
+    return 0;
+}
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/logring.h"
+#include "utils/tickclock.h"
+
+
+// Lines/sec and caller-side latency of GLogger.writeln, many threads logging at once.
+//   synchronous:  the logger before the writer thread: one mutex around local time, format,
+//                 write and fflush of every line
+//   async:        RuntimeLogger's path, with its ring and tick clock: callers format into a ring slot,
+//                 a writer thread turns ticks into wall time and writes batches with one flush each
+// The Windows calls are swapped for their closest equivalents (localtime_r for GetLocalTime, a
+// condition variable for the wake event); output goes to a temporary file.
+//
+// Run by hand: bench_logger [lines per thread]
+
+namespace
+{
+    const size_t MAX_CHARS = 1024;
+
+    class SyncLogger
+    {
+        FILE* out_;
+        std::mutex mtx_;
+
+    public:
+        explicit SyncLogger(FILE* out) : out_{ out } { }
+
+        int writeln(const wchar_t* fmt, ...)
+        {
+            const std::lock_guard<std::mutex> lock(mtx_);
+
+            wchar_t buffer[MAX_CHARS];
+            va_list args;
+            va_start(args, fmt);
+            auto rc = vswprintf(buffer, MAX_CHARS, fmt, args);
+            va_end(args);
+
+            auto now = std::chrono::system_clock::now();
+            auto seconds = std::chrono::system_clock::to_time_t(now);
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+            tm local;
+            localtime_r(&seconds, &local);
+
+            fwprintf(out_, L"%02d:%02d:%02d.%03d  %ls\n", local.tm_hour, local.tm_min, local.tm_sec, static_cast<int>(ms), buffer);
+            fflush(out_);
+            return rc;
+        }
+
+        void Stop() { }
+        size_t Dropped() const { return 0; }
+    };
+
+    class AsyncLogger
+    {
+        struct LogRecord
+        {
+            int64_t Tick;
+            int Length;
+            wchar_t Text[MAX_CHARS];
+        };
+
+        static const size_t RING_CAPACITY = 2048;
+        static const size_t BATCH_CHARS = 64 * 1024;
+        static const int PUSH_RETRIES = 64;
+
+        FILE* out_;
+        Utils::MpscRing<LogRecord, RING_CAPACITY> ring_;
+        std::mutex drainMtx_;
+        std::mutex wakeMtx_;
+        std::condition_variable wake_;
+        std::atomic<bool> stopping_{ false };
+        std::atomic<size_t> dropped_{ 0 };
+        Utils::TickClock clock_;
+        std::vector<wchar_t> batch_;
+        std::thread writer_;
+
+        void signal()
+        {
+            wake_.notify_one();
+        }
+
+        void drainLocked_()
+        {
+            size_t length = 0;
+            auto appendRecord = [this, &length](const LogRecord& record)
+            {
+                if (length + 16 + record.Length >= BATCH_CHARS)
+                {
+                    batch_[length] = L'\0';
+                    fputws(batch_.data(), out_);
+                    length = 0;
+                }
+
+                auto time = clock_.ToWallTime(record.Tick);
+                auto written = swprintf(batch_.data() + length, BATCH_CHARS - length, L"%02u:%02u:%02u.%03u  %ls\n",
+                    time.Hour, time.Minute, time.Second, time.Millisecond, record.Text);
+                length += written > 0 ? written : 0;
+            };
+
+            bool any = false;
+            while (ring_.TryPop(appendRecord))
+            {
+                any = true;
+            }
+            if (any)
+            {
+                batch_[length] = L'\0';
+                fputws(batch_.data(), out_);
+                fflush(out_);
+            }
+        }
+
+        void writerLoop_()
+        {
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(wakeMtx_);
+                    wake_.wait_for(lock, std::chrono::milliseconds(50));
+                }
+                const std::lock_guard<std::mutex> lock(drainMtx_);
+                if (stopping_.load(std::memory_order_relaxed))
+                {
+                    return;
+                }
+                drainLocked_();
+            }
+        }
+
+    public:
+        explicit AsyncLogger(FILE* out)
+            : out_{ out }
+            , batch_(BATCH_CHARS)
+        {
+            clock_.Anchor(std::chrono::steady_clock::period::den, Utils::TickClock::Now(), 0);
+            writer_ = std::thread([this]() { writerLoop_(); });
+        }
+
+        int writeln(const wchar_t* fmt, ...)
+        {
+            int rc = 0;
+            va_list args;
+            va_start(args, fmt);
+            bool pushed = false;
+            for (int attempt = 0; attempt < PUSH_RETRIES && !pushed; attempt++)
+            {
+                pushed = ring_.TryPush([&rc, fmt, &args](LogRecord& record)
+                    {
+                        record.Tick = Utils::TickClock::Now();
+                        va_list copy;
+                        va_copy(copy, args);
+                        rc = vswprintf(record.Text, MAX_CHARS, fmt, copy);
+                        va_end(copy);
+                        record.Length = rc > 0 ? rc : 0;
+                    });
+                if (!pushed)
+                {
+                    signal();
+                    std::this_thread::yield();
+                }
+            }
+            va_end(args);
+
+            if (!pushed)
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return -1;
+            }
+            if (ring_.ApproxSize() >= RING_CAPACITY / 2)
+            {
+                signal();
+            }
+            return rc;
+        }
+
+        // As Shutdown(): stop the writer, then drain the rest under the lock.
+        void Stop()
+        {
+            stopping_.store(true);
+            signal();
+            writer_.join();
+            const std::lock_guard<std::mutex> lock(drainMtx_);
+            drainLocked_();
+        }
+
+        size_t Dropped() const { return dropped_.load(); }
+    };
+
+    struct Result
+    {
+        double LinesPerSecond;
+        double P50Ns;
+        double P99Ns;
+        double MaxNs;
+        size_t Dropped;
+    };
+
+    template<typename TLogger>
+    Result run(size_t threads, size_t lines)
+    {
+        auto out = tmpfile();
+        TLogger logger{ out };
+        std::vector<std::vector<int64_t>> latencies(threads);
+        std::vector<std::thread> callers;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; t++)
+        {
+            callers.emplace_back([&logger, &latencies, t, lines]()
+                {
+                    auto& mine = latencies[t];
+                    mine.reserve(lines);
+                    for (size_t i = 0; i < lines; i++)
+                    {
+                        auto before = std::chrono::steady_clock::now();
+                        logger.writeln(L"ProcessEvent: thread %zu dispatched %ls (%zu) to 0x%p", t, L"BioWorldInfo.EventTick", i, &mine);
+                        mine.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count());
+                    }
+                });
+        }
+        for (auto& caller : callers)
+        {
+            caller.join();
+        }
+        logger.Stop();
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fclose(out);
+
+        std::vector<int64_t> all;
+        for (const auto& mine : latencies)
+        {
+            all.insert(all.end(), mine.begin(), mine.end());
+        }
+        std::sort(all.begin(), all.end());
+        auto at = [&all](double q) { return static_cast<double>(all[std::min(all.size() - 1, static_cast<size_t>(q * all.size()))]); };
+
+        return Result{ static_cast<double>(threads * lines) / seconds, at(0.50), at(0.99), static_cast<double>(all.back()), logger.Dropped() };
+    }
+
+    void print(const char* name, size_t threads, const Result& result)
+    {
+        printf("%-12s %8zu %14.0f %10.0f %10.0f %12.0f %8zu\n", name, threads, result.LinesPerSecond, result.P50Ns, result.P99Ns, result.MaxNs, result.Dropped);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t lines = argc > 1 ? std::stoul(argv[1]) : 100000;
+
+    printf("%zu lines per thread, to a temporary file; latencies are of one writeln call\n", lines);
+    printf("%-12s %8s %14s %10s %10s %12s %8s\n", "logger", "threads", "lines/s", "p50 ns", "p99 ns", "max ns", "dropped");
+    for (size_t threads : { 1, 2, 4, 8 })
+    {
+        print("synchronous", threads, run<SyncLogger>(threads, lines));
+        print("async", threads, run<AsyncLogger>(threads, lines));
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "utils/objindex.h"
+
+
+// Object lookup (SPI FindObject) over a synthetic GObjects: packages holding classes holding functions,
+// the shape and size of a loaded game. Measures the index build, the per-call catch-up sweep, hits,
+// and misses: before, every miss re-swept the whole array; now a miss re-sweeps at most once a second,
+// so a plugin probing for absent objects only pays the lookup.
+//
+// Run by hand: bench_objindex [object count]
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Utils::ObjectPathIndex;
+
+    struct Object
+    {
+        size_t Index;
+        const Object* Outer;
+        std::wstring Name;
+        uint64_t NameKey;   // Stands in for the FName value.
+    };
+
+    struct World
+    {
+        std::vector<std::unique_ptr<Object>> Storage;
+        std::vector<const void*> Array;
+        std::vector<std::wstring> Paths;
+
+        explicit World(size_t count)
+        {
+            const Object* package = nullptr;
+            const Object* owner = nullptr;
+            std::wstring packagePath, ownerPath;
+            for (size_t i = 0; i < count; i++)
+            {
+                std::wstring name;
+                const Object* outer;
+                std::wstring path;
+                if (i % 5000 == 0)
+                {
+                    name = L"Package" + std::to_wstring(i / 5000);
+                    outer = nullptr;
+                    path = name;
+                }
+                else if (i % 50 == 1)
+                {
+                    name = L"Class" + std::to_wstring(i);
+                    outer = package;
+                    path = packagePath + L"." + name;
+                }
+                else
+                {
+                    name = L"Function" + std::to_wstring(i);
+                    outer = owner ? owner : package;
+                    path = (owner ? ownerPath : packagePath) + L"." + name;
+                }
+                Storage.push_back(std::make_unique<Object>(Object{ i, outer, name, std::hash<std::wstring>()(name) }));
+                Array.push_back(Storage.back().get());
+                Paths.push_back(path);
+                if (i % 5000 == 0)
+                {
+                    package = Storage.back().get();
+                    packagePath = path;
+                    owner = nullptr;
+                }
+                else if (i % 50 == 1)
+                {
+                    owner = Storage.back().get();
+                    ownerPath = path;
+                }
+            }
+        }
+
+        size_t Update(ObjectPathIndex& index) const
+        {
+            return index.Update(Array.size(),
+                [this](size_t i) { return Array[i]; },
+                [](const void* object) -> const void* { return static_cast<const Object*>(object)->Outer; },
+                [](const void* object) { return static_cast<const Object*>(object)->Index; },
+                [](const void* object) { return static_cast<const Object*>(object)->Name.c_str(); },
+                [](const void* object) { return static_cast<const Object*>(object)->NameKey; });
+        }
+
+        const void* Find(const ObjectPathIndex& index, const wchar_t* path) const
+        {
+            return index.Find(path,
+                [this](size_t i) { return i < Array.size() ? Array[i] : nullptr; },
+                [](const void* object) -> const void* { return static_cast<const Object*>(object)->Outer; },
+                [](const void* object) { return static_cast<const Object*>(object)->Name.c_str(); });
+        }
+    };
+
+    template<typename TFunc>
+    double nsPer(size_t count, TFunc&& func)
+    {
+        auto start = Clock::now();
+        for (size_t i = 0; i < count; i++)
+        {
+            func(i);
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 500000;
+    World world(count);
+    ObjectPathIndex index;
+    size_t found = 0;
+
+    printf("%zu objects\n", count);
+    printf("%-36s %14.0f us\n", "build the index", nsPer(1, [&](size_t) { world.Update(index); }) / 1000);
+    printf("%-36s %14.0f us\n", "sweep without changes", nsPer(20, [&](size_t) { world.Update(index); }) / 1000);
+    printf("%-36s %14.0f ns\n", "find, hit", nsPer(200000, [&](size_t i) {
+        found += world.Find(index, world.Paths[(i * 7919) % count].c_str()) != nullptr; }));
+
+    std::vector<std::wstring> absent;
+    for (size_t i = 0; i < 1000; i++)
+    {
+        absent.push_back(world.Paths[(i * 104729) % count] + L"_Missing");
+    }
+    printf("%-36s %14.0f ns\n", "find, miss", nsPer(200000, [&](size_t i) {
+        found += world.Find(index, absent[i % absent.size()].c_str()) != nullptr; }));
+
+    // 1000 plugin probes for absent objects within a second.
+    printf("%-36s %14.0f ns\n", "miss, re-sweep on every miss (old)", nsPer(1000, [&](size_t i) {
+        if (!world.Find(index, absent[i].c_str())) { world.Update(index); found += world.Find(index, absent[i].c_str()) != nullptr; } }));
+    auto lastSweep = Clock::now() - std::chrono::seconds(2);
+    printf("%-36s %14.0f ns\n", "miss, re-sweep once a second (new)", nsPer(1000, [&](size_t i) {
+        if (!world.Find(index, absent[i].c_str()) && Clock::now() - lastSweep >= std::chrono::seconds(1))
+        {
+            world.Update(index);
+            lastSweep = Clock::now();
+            found += world.Find(index, absent[i].c_str()) != nullptr;
+        } }));
+
+    printf("(%zu found, index %zu KB)\n", found, index.TableBytes() / 1024);
+    return 0;
+}
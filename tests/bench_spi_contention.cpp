@@ -0,0 +1,179 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Contention of the SPI's lock layout, with many plugin threads calling in at once.
+// SharedProxyInterface needs MinHook and the game image, so both layouts are modelled with the same
+// work inside each call: version/game reads, pattern scans over a shared read-only image, and hook
+// install/lookup/uninstall on a name map.
+//   per-method:  one std::mutex per method, as before: scans queue up behind each other, and even
+//                immutable reads lock (install and uninstall share one here, the original raced)
+//   registry:    immutable reads without locks, concurrent scans, one reader-writer registry lock
+//
+// Run by hand: bench_spi_contention [ops per thread]
+
+namespace
+{
+    const size_t IMAGE_BYTES = 8 << 20;
+
+    struct Image
+    {
+        std::vector<uint8_t> Bytes;
+        uint8_t Pattern[16];
+        char Mask[17];
+
+        Image()
+            : Bytes(IMAGE_BYTES)
+        {
+            std::mt19937 random{ 1234 };
+            for (auto& byte : Bytes)
+            {
+                byte = static_cast<uint8_t>(random() & 0x7F);
+            }
+            for (size_t i = 0; i < sizeof(Pattern); i++)
+            {
+                Pattern[i] = static_cast<uint8_t>(0x80 | i);
+                Mask[i] = (i % 5 == 3) ? '?' : 'x';
+            }
+            Mask[sizeof(Pattern)] = '\0';
+            std::copy(Pattern, Pattern + sizeof(Pattern), Bytes.end() - 4096);
+        }
+
+        // Same shape as ScanProcess: first match of a masked pattern.
+        const uint8_t* Scan() const
+        {
+            auto end = Bytes.data() + Bytes.size() - sizeof(Pattern);
+            for (auto p = Bytes.data(); p < end; p++)
+            {
+                size_t i = 0;
+                while (i < sizeof(Pattern) && (Mask[i] == '?' || p[i] == Pattern[i]))
+                {
+                    i++;
+                }
+                if (i == sizeof(Pattern))
+                {
+                    return p;
+                }
+            }
+            return nullptr;
+        }
+    };
+
+    struct Hook
+    {
+        uintptr_t Target;
+        uintptr_t Owner;
+    };
+
+    class PerMethodLayout
+    {
+        const Image& image_;
+        unsigned long version_ = 4;
+        int game_ = 1;
+        std::mutex mtxVersion_;
+        std::mutex mtxGame_;
+        std::mutex mtxFindPattern_;
+        std::mutex mtxHooks_;
+        std::map<std::string, Hook> hooks_;
+
+    public:
+        explicit PerMethodLayout(const Image& image) : image_{ image } { }
+
+        unsigned long GetVersion() { std::lock_guard<std::mutex> lock(mtxVersion_); return version_; }
+        int GetHostGame() { std::lock_guard<std::mutex> lock(mtxGame_); return game_; }
+        const uint8_t* FindPattern() { std::lock_guard<std::mutex> lock(mtxFindPattern_); return image_.Scan(); }
+        bool HookExists(const std::string& name) { std::lock_guard<std::mutex> lock(mtxHooks_); return hooks_.count(name) != 0; }
+        bool Install(const std::string& name, uintptr_t owner) { std::lock_guard<std::mutex> lock(mtxHooks_); return hooks_.emplace(name, Hook{ owner, owner }).second; }
+        bool Uninstall(const std::string& name) { std::lock_guard<std::mutex> lock(mtxHooks_); return hooks_.erase(name) != 0; }
+    };
+
+    class RegistryLayout
+    {
+        const Image& image_;
+        const unsigned long version_ = 4;
+        const int game_ = 1;
+        std::shared_mutex registryMtx_;
+        std::map<std::string, Hook> hooks_;
+
+    public:
+        explicit RegistryLayout(const Image& image) : image_{ image } { }
+
+        unsigned long GetVersion() const { return version_; }
+        int GetHostGame() const { return game_; }
+        const uint8_t* FindPattern() const { return image_.Scan(); }
+        bool HookExists(const std::string& name) { std::shared_lock<std::shared_mutex> lock(registryMtx_); return hooks_.count(name) != 0; }
+        bool Install(const std::string& name, uintptr_t owner) { std::unique_lock<std::shared_mutex> lock(registryMtx_); return hooks_.emplace(name, Hook{ owner, owner }).second; }
+        bool Uninstall(const std::string& name) { std::unique_lock<std::shared_mutex> lock(registryMtx_); return hooks_.erase(name) != 0; }
+    };
+
+    // A plugin's calls: mostly cheap queries and lookups, a scan now and then, a hook pair more rarely.
+    template<typename TLayout>
+    uint64_t plugin(TLayout& spi, size_t threadIndex, size_t ops)
+    {
+        uint64_t sink = 0;
+        std::string name = "hook." + std::to_string(threadIndex);
+        for (size_t op = 0; op < ops; op++)
+        {
+            sink += spi.GetVersion() + static_cast<uint64_t>(spi.GetHostGame());
+            if (op % 8 == 0)         sink += spi.HookExists(name) ? 1 : 0;
+            if (op % 256 == 0)       sink += spi.Install(name, threadIndex + 1) && spi.Uninstall(name) ? 1 : 0;
+            if (op % 20000 == 0)     sink += reinterpret_cast<uintptr_t>(spi.FindPattern()) & 1;
+        }
+        return sink;
+    }
+
+    template<typename TLayout>
+    double run(const Image& image, size_t threads, size_t ops)
+    {
+        TLayout spi{ image };
+        std::atomic<uint64_t> sink{ 0 };
+        std::vector<std::thread> workers;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&spi, &sink, t, ops]() { sink += plugin(spi, t, ops); });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (sink.load() == 42)
+        {
+            printf(" ");
+        }
+        return static_cast<double>(threads * ops) / seconds;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t ops = argc > 1 ? std::stoul(argv[1]) : 100000;
+    Image image;
+    if (image.Scan() != image.Bytes.data() + image.Bytes.size() - 4096)
+    {
+        fprintf(stderr, "pattern not found where planted\n");
+        return 1;
+    }
+
+    printf("%zu ops per thread, scan every 20000 ops over %zu MB\n", ops, IMAGE_BYTES >> 20);
+    printf("%8s %18s %18s %8s\n", "threads", "per-method ops/s", "registry ops/s", "speedup");
+    for (size_t threads : { 1, 2, 4, 8, 16 })
+    {
+        auto perMethod = run<PerMethodLayout>(image, threads, ops);
+        auto registry = run<RegistryLayout>(image, threads, ops);
+        printf("%8zu %18.0f %18.0f %7.2fx\n", threads, perMethod, registry, registry / perMethod);
+    }
+    return 0;
+}
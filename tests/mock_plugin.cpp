@@ -0,0 +1,44 @@
+#include <chrono>
+#include <thread>
+#include "mock_plugin.h"
+
+
+// A plugin in the shape of an SPI ASI, for the dlopen-based lifecycle tests. Built twice: with
+// MOCK_ASYNC it asks for its attach point to run on a thread of its own.
+// Each loaded copy has its own attach count, which shows whether a reload got a fresh copy.
+
+namespace
+{
+    int GAttachCount = 0;
+}
+
+extern "C" bool SpiOnAttach(MockHost* host)
+{
+    while (host->HoldAttach.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    GAttachCount++;
+    host->Attached++;
+    return true;
+}
+
+extern "C" bool SpiOnDetach(MockHost* host)
+{
+    host->Detached++;
+    return true;
+}
+
+extern "C" bool SpiShouldSpawnThread()
+{
+#ifdef MOCK_ASYNC
+    return true;
+#else
+    return false;
+#endif
+}
+
+extern "C" int MockAttachCount()
+{
+    return GAttachCount;
+}
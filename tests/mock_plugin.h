@@ -0,0 +1,17 @@
+#pragma once
+
+#include <atomic>
+
+
+// What a mock plugin (mock_plugin.cpp, built as a shared library) and the test driving it share.
+struct MockHost
+{
+    std::atomic<int> Attached{ 0 };
+    std::atomic<int> Detached{ 0 };
+    std::atomic<bool> HoldAttach{ false };   // Keeps OnAttach from returning while set.
+};
+
+typedef bool (*tMockOnAttach)(MockHost* host);
+typedef bool (*tMockOnDetach)(MockHost* host);
+typedef bool (*tMockShouldSpawnThread)();
+typedef int (*tMockAttachCount)();
@@ -0,0 +1,159 @@
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+#include "testing.h"
+#include "utils/arena.h"
+
+
+namespace
+{
+    using Utils::FrameArenas;
+    using Utils::ScratchArena;
+    using Utils::SizeClassPools;
+
+    bool aligned(const void* pointer, size_t alignment)
+    {
+        return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+    }
+
+    // Threads' free lists are per thread, not per instance, so the tests share one like the proxy does.
+    SizeClassPools pools;
+}
+
+
+TEST_CASE(BumpsAlignedBlocksAndReusesChunks)
+{
+    ScratchArena arena;
+    CHECK(arena.Allocate(8, 0) == nullptr);
+    CHECK(arena.Allocate(8, 24) == nullptr);
+
+    auto a = static_cast<uint8_t*>(arena.Allocate(3, 1));
+    auto b = static_cast<uint8_t*>(arena.Allocate(8, 64));
+    CHECK(a != nullptr && aligned(b, 64));
+    CHECK(b > a && b - a < 64 + 3);
+    CHECK(arena.Bytes() == 11);
+
+    for (int i = 0; i < 100; i++)
+    {
+        memset(arena.Allocate(1000), i, 1000);
+    }
+    auto capacity = arena.Capacity();
+    CHECK(capacity >= 100 * 1000);
+
+    arena.Reset();
+    CHECK(arena.Bytes() == 0);
+    for (int i = 0; i < 100; i++)
+    {
+        arena.Allocate(1000);
+    }
+    CHECK(arena.Capacity() == capacity);   // The same chunks again.
+}
+
+TEST_CASE(GivesLargeBlocksTheirOwnMemory)
+{
+    ScratchArena arena;
+    auto large = arena.Allocate(ScratchArena::CHUNK_SIZE * 2, 4096);
+    CHECK(large != nullptr && aligned(large, 4096));
+    memset(large, 1, ScratchArena::CHUNK_SIZE * 2);
+    CHECK(arena.Capacity() == 0);
+
+    // An alignment past the oversize limit on its own.
+    CHECK(aligned(arena.Allocate(8, ScratchArena::CHUNK_SIZE), ScratchArena::CHUNK_SIZE));
+}
+
+TEST_CASE(RefusesSizesThatWouldWrapAround)
+{
+    // Regression: size + alignment wrapped to a small number and took the chunk path.
+    ScratchArena arena;
+    CHECK(arena.Allocate(SIZE_MAX, 16) == nullptr);
+    CHECK(arena.Allocate(SIZE_MAX - 8, 16) == nullptr);
+    CHECK(arena.Allocate(SIZE_MAX - 15, 16) == nullptr);
+    CHECK(arena.Bytes() == 0);
+    CHECK(arena.Allocate(16, 16) != nullptr);
+}
+
+TEST_CASE(ResetsOnlyTheFrameThreadAtFrameBoundaries)
+{
+    FrameArenas arenas;
+    std::thread([&arenas]()
+        {
+            // The frame thread: its scratch is reused after each boundary.
+            auto first = arenas.Allocate(64);
+            arenas.AdvanceFrame();
+            CHECK(arenas.Allocate(64) == first);
+        }).join();
+
+    std::thread([&arenas]()
+        {
+            // A worker allocating across frame boundaries keeps what it has.
+            auto kept = static_cast<uint8_t*>(arenas.Allocate(64));
+            memset(kept, 7, 64);
+            std::thread([&arenas]() { arenas.AdvanceFrame(); }).join();
+            auto next = static_cast<uint8_t*>(arenas.Allocate(64));
+            CHECK(next != kept);
+            CHECK(kept[63] == 7);
+
+            arenas.ResetThread();
+            CHECK(arenas.Allocate(64) == kept);
+        }).join();
+    CHECK(arenas.Frame() == 2);
+}
+
+TEST_CASE(PoolsBlocksBySizeClass)
+{
+    CHECK(SizeClassPools::ClassSize(1) == 16);
+    CHECK(SizeClassPools::ClassSize(65) == 96);
+    CHECK(SizeClassPools::ClassSize(2048) == 2048);
+    CHECK(SizeClassPools::ClassSize(5000) == 5000);
+
+    std::set<void*> blocks;
+    for (int i = 0; i < 1000; i++)
+    {
+        auto block = pools.Allocate(100);
+        CHECK(aligned(block, 16));
+        blocks.insert(block);
+    }
+    CHECK(blocks.size() == 1000);
+    auto slabBytes = pools.SlabBytes();
+    for (auto block : blocks)
+    {
+        pools.Free(block);
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        pools.Allocate(100);
+    }
+    CHECK(pools.SlabBytes() == slabBytes);      // Served from the freed blocks.
+
+    auto large = pools.Allocate(5000);
+    CHECK(pools.HeapBlocks() == 1);
+    pools.Free(large);
+    pools.Free(nullptr);
+    CHECK(pools.HeapBlocks() == 0);
+}
+
+TEST_CASE(FreesPooledBlocksOnAnyThread)
+{
+    std::vector<void*> blocks;
+    for (int i = 0; i < 5000; i++)
+    {
+        blocks.push_back(pools.Allocate(48));
+    }
+    std::thread([&blocks]()
+        {
+            for (auto block : blocks)
+            {
+                pools.Free(block);
+            }
+        }).join();
+
+    // The freeing thread's blocks went to the depot, this one takes them from there.
+    auto slabBytes = pools.SlabBytes();
+    for (int i = 0; i < 5000; i++)
+    {
+        pools.Allocate(48);
+    }
+    CHECK(pools.SlabBytes() == slabBytes);
+}
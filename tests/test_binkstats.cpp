@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "utils/binkstats.h"
+
+
+namespace
+{
+    using Utils::BinkStats;
+    using Utils::LatencyHistogram;
+
+    // The exact p-th percentile of sorted values, ranked the way the histogram ranks them.
+    int64_t exact(const std::vector<int64_t>& sorted, double p)
+    {
+        auto rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.5);
+        rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+        return sorted[rank - 1];
+    }
+
+    int movieA, movieB;
+}
+
+
+TEST_CASE(BucketsByQuarterOctaves)
+{
+    for (int64_t us = 0; us < 4; us++)
+    {
+        CHECK(LatencyHistogram::BucketOf(us) == static_cast<size_t>(us));
+        CHECK(LatencyHistogram::BucketLimit(us) == us + 1);
+    }
+    CHECK(LatencyHistogram::BucketOf(-5) == 0);
+    CHECK(LatencyHistogram::BucketOf(4) == 4 && LatencyHistogram::BucketLimit(4) == 5);
+    CHECK(LatencyHistogram::BucketOf(8) == 8 && LatencyHistogram::BucketOf(9) == 8);
+    CHECK(LatencyHistogram::BucketLimit(8) == 10);
+
+    // Every value lands in a bucket whose range holds it, no wider than a quarter of its octave.
+    for (int64_t us = 4; us < (int64_t(1) << 22); us += us / 7 + 1)
+    {
+        auto bucket = LatencyHistogram::BucketOf(us);
+        auto limit = LatencyHistogram::BucketLimit(bucket);
+        auto below = bucket == 0 ? 0 : LatencyHistogram::BucketLimit(bucket - 1);
+        if (!(below <= us && us < limit && limit - below <= (us + 3) / 4))
+        {
+            fprintf(stderr, "%lld us: bucket %zu [%lld, %lld)\n", static_cast<long long>(us), bucket,
+                static_cast<long long>(below), static_cast<long long>(limit));
+            CHECK(false);
+        }
+    }
+
+    // Past the last octave (about 4 seconds) everything shares the last bucket.
+    CHECK(LatencyHistogram::BucketOf((int64_t(1) << 22) - 1) == LatencyHistogram::BUCKETS - 2);
+    CHECK(LatencyHistogram::BucketOf(int64_t(1) << 22) == LatencyHistogram::BUCKETS - 1);
+    CHECK(LatencyHistogram::BucketOf(INT64_MAX) == LatencyHistogram::BUCKETS - 1);
+    CHECK(LatencyHistogram::BucketLimit(LatencyHistogram::BUCKETS - 1) == INT64_MAX);
+}
+
+TEST_CASE(BoundsPercentilesWithinAQuarter)
+{
+    LatencyHistogram histogram;
+    CHECK(histogram.PercentileUs(50) == 0 && histogram.MeanUs() == 0);
+
+    // A decode-like spread: mostly 2-6 ms, a slow tail up to 40 ms.
+    std::vector<int64_t> values;
+    uint32_t seed = 12345;
+    for (int i = 0; i < 10000; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        auto us = 2000 + static_cast<int64_t>(seed >> 8) % 4000;
+        values.push_back(i % 100 == 0 ? us * 10 : us);
+    }
+    for (auto us : values)
+    {
+        histogram.Add(us);
+    }
+    std::sort(values.begin(), values.end());
+
+    CHECK(histogram.Count() == values.size());
+    CHECK(histogram.MinUs() == values.front() && histogram.MaxUs() == values.back());
+    for (double p : { 1.0, 10.0, 50.0, 90.0, 99.0, 99.9, 100.0 })
+    {
+        auto expected = exact(values, p);
+        auto reported = histogram.PercentileUs(p);
+        if (!(reported >= expected && reported <= expected + expected / 4))
+        {
+            fprintf(stderr, "p%g: %lld reported, %lld exact\n", p, static_cast<long long>(reported),
+                static_cast<long long>(expected));
+            CHECK(false);
+        }
+    }
+    CHECK(histogram.PercentileUs(100) == values.back());
+}
+
+TEST_CASE(CapsPercentilesByTheMaximum)
+{
+    LatencyHistogram histogram;
+    for (int64_t us = 1; us <= 100; us++)
+    {
+        histogram.Add(us);
+    }
+    CHECK(histogram.PercentileUs(50) == 55);       // 50 is in [48, 56).
+    CHECK(histogram.PercentileUs(99) == 100);      // 99 is in [96, 112), but nothing was over 100.
+    CHECK(histogram.MeanUs() == 50);
+
+    LatencyHistogram one;
+    one.Add(-3);                                   // A clock step backwards counts as 0.
+    CHECK(one.MinUs() == 0 && one.MaxUs() == 0 && one.PercentileUs(50) == 0);
+    one.Add(int64_t(10) << 22);                    // Past the last octave.
+    CHECK(one.PercentileUs(100) == int64_t(10) << 22);
+}
+
+TEST_CASE(MergesHistograms)
+{
+    LatencyHistogram fast, slow, merged;
+    for (int i = 0; i < 90; i++)
+    {
+        fast.Add(1000);
+    }
+    for (int i = 0; i < 10; i++)
+    {
+        slow.Add(20000);
+    }
+    merged.Merge(LatencyHistogram());
+    CHECK(merged.Count() == 0);
+    merged.Merge(slow);
+    merged.Merge(fast);
+    CHECK(merged.Count() == 100);
+    CHECK(merged.MinUs() == 1000 && merged.MaxUs() == 20000);
+    CHECK(merged.MeanUs() == 2900);
+    CHECK(merged.PercentileUs(90) < 1250 && merged.PercentileUs(91) >= 20000);
+    CHECK(merged.CountIn(LatencyHistogram::BucketOf(1000)) == 90);
+    CHECK(merged.CountIn(LatencyHistogram::BUCKETS) == 0);
+}
+
+TEST_CASE(CountsEachMovieFromOpenToClose)
+{
+    BinkStats stats;
+    stats.OnOpen(nullptr, "Failed.bk2");
+    CHECK(stats.OpenCount() == 0);
+
+    stats.OnOpen(&movieA, "Intro.bk2");
+    stats.OnDecoded(&movieA, 4000);
+    stats.OnDecoded(&movieA, 6000);
+    stats.OnSkipped(&movieA);
+    stats.OnAdvanced(&movieA);
+    stats.OnAdvanced(&movieA);
+
+    // Async: timed from the start to the wait that reports it done, not the ones before.
+    stats.OnAsyncWaited(&movieA, true, 100);       // Nothing in flight.
+    stats.OnAsyncStarted(&movieA, 10000);
+    stats.OnAsyncWaited(&movieA, false, 11000);
+    stats.OnAsyncWaited(&movieA, true, 15000);
+
+    BinkStats::Movie movie;
+    REQUIRE(stats.Get(&movieA, movie));
+    CHECK(movie.Serial == 1 && movie.Name == "Intro.bk2");
+    CHECK(movie.Decoded == 3 && movie.Skipped == 1 && movie.Advanced == 2);
+    CHECK(movie.Decode.MinUs() == 4000 && movie.Decode.MaxUs() == 6000);
+    CHECK(movie.AsyncStartUs == -1);
+
+    // A handle never seen opened, e.g. opened before the proxy's stats were on.
+    stats.OnDecoded(&movieB, 100);
+    REQUIRE(stats.Get(&movieB, movie));
+    CHECK(movie.Serial == 2 && movie.Name.empty() && movie.Decoded == 1);
+    CHECK(stats.OpenCount() == 2);
+
+    uint64_t reported = 0;
+    stats.OnClose(&movieA, [&reported](const BinkStats::Movie& closed) { reported = closed.Decoded; });
+    stats.OnClose(&movieA, [&reported](const BinkStats::Movie&) { reported = 99; });   // Already closed.
+    CHECK(reported == 3);
+    CHECK(!stats.Get(&movieA, movie));
+
+    uint64_t closedMovies = 0;
+    auto closed = stats.Closed(&closedMovies);
+    CHECK(closedMovies == 1 && closed.Count() == 3);
+
+    // The handle reused for the next movie starts over.
+    stats.OnOpen(&movieA, "Credits.bk2");
+    REQUIRE(stats.Get(&movieA, movie));
+    CHECK(movie.Serial == 3 && movie.Decoded == 0 && movie.Name == "Credits.bk2");
+}
@@ -0,0 +1,173 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "binkthunks.h"
+
+
+namespace
+{
+    using BinkThunks::Originals;
+
+    // Stand-ins for bink2w64_original's exports, recording what reached them.
+    struct Calls
+    {
+        std::vector<std::string> Names;
+        const void* Bink = nullptr;
+        uint32_t Flags = 0;
+        uint32_t Thread = 0;
+        uint32_t SecondThread = 0;
+        int32_t Us = 0;
+    };
+    Calls calls;
+    int movie;
+
+    void* BinkOpen(const char* name, uint32_t flags) { calls.Names.push_back(name); calls.Flags = flags; return &movie; }
+    void* BinkOpenWithOptions(const char* name, const void* options, uint32_t flags)
+    {
+        calls.Names.push_back(name);
+        calls.Bink = options;
+        calls.Flags = flags;
+        return &movie;
+    }
+    void BinkClose(void* bink) { calls.Bink = bink; }
+    int32_t BinkDoFrame(void* bink) { calls.Bink = bink; return 0; }
+    int32_t BinkDoFrameAsync(void* bink, uint32_t threadIndex, uint32_t secondThreadIndex)
+    {
+        calls.Bink = bink;
+        calls.Thread = threadIndex;
+        calls.SecondThread = secondThreadIndex;
+        return 1;
+    }
+    int32_t BinkDoFrameAsyncWait(void* bink, int32_t us) { calls.Bink = bink; calls.Us = us; return 1; }
+    void BinkNextFrame(void* bink) { calls.Bink = bink; }
+    int32_t BinkShouldSkip(void*) { return 1; }
+
+    // GetProcAddress over the stand-ins, with some exports taken out.
+    std::map<std::string, void*> exports(const std::set<std::string>& missing = {})
+    {
+        std::map<std::string, void*> table;
+        #define BINK_THUNK_EXPORT(NAME, RET, PARAMS, ARGS) \
+            if (!missing.count(#NAME)) table[#NAME] = reinterpret_cast<void*>(static_cast<BinkThunks::t##NAME>(&NAME));
+        BINK_THUNKED_EXPORTS(BINK_THUNK_EXPORT)
+        #undef BINK_THUNK_EXPORT
+        return table;
+    }
+
+    size_t resolve(Originals& originals, const std::map<std::string, void*>& table, std::vector<std::string>& missed)
+    {
+        return BinkThunks::Resolve(originals,
+            [&table](const char* name) { auto it = table.find(name); return it == table.end() ? nullptr : it->second; },
+            [&missed](const char* name) { missed.push_back(name); });
+    }
+}
+
+
+TEST_CASE(ListsEachThunkedExportOnce)
+{
+    CHECK(BinkThunks::COUNT == 8);
+    std::set<std::string> names(BinkThunks::NAMES, BinkThunks::NAMES + BinkThunks::COUNT);
+    CHECK(names.size() == BinkThunks::COUNT);
+    CHECK(std::string(BinkThunks::NAMES[0]) == "BinkOpen");
+    CHECK(std::string(BinkThunks::NAMES[BinkThunks::COUNT - 1]) == "BinkShouldSkip");
+    CHECK(names.count("BinkDoFrameAsyncWait") == 1);
+    CHECK(names.count("BinkDoFrameAsyncMulti") == 0);      // Takes an array of movies, forwarded.
+}
+
+TEST_CASE(DoesNotAlsoForwardThunkedExports)
+{
+    // Two definitions of an export: the linker takes one of them, maybe the forward.
+    std::ifstream file(DLLEXPORTS_PATH);
+    REQUIRE(file.good());
+    std::stringstream text;
+    text << file.rdbuf();
+    auto forwards = text.str();
+    CHECK(forwards.find("/export:BinkGetError=bink2w64_original.BinkGetError") != std::string::npos);
+    for (size_t i = 0; i < BinkThunks::COUNT; i++)
+    {
+        auto forward = std::string("/export:") + BinkThunks::NAMES[i] + "=";
+        if (forwards.find(forward) != std::string::npos)
+        {
+            fprintf(stderr, "forwarded too: %s\n", BinkThunks::NAMES[i]);
+            CHECK(false);
+        }
+    }
+}
+
+TEST_CASE(ResolvesTheOriginalsWithTheirSignatures)
+{
+    Originals originals;
+    std::vector<std::string> missed;
+    REQUIRE(resolve(originals, exports(), missed) == BinkThunks::COUNT);
+    CHECK(missed.empty());
+
+    // Arguments reach the originals in order and results come back.
+    calls = Calls{};
+    CHECK(originals.BinkOpen("Intro.bk2", 0x100) == &movie);
+    CHECK(calls.Names.back() == "Intro.bk2" && calls.Flags == 0x100);
+    int options = 0;
+    CHECK(originals.BinkOpenWithOptions("Credits.bk2", &options, 0x200) == &movie);
+    CHECK(calls.Names.back() == "Credits.bk2" && calls.Bink == &options && calls.Flags == 0x200);
+    CHECK(originals.BinkDoFrameAsync(&movie, 3, 7) == 1);
+    CHECK(calls.Bink == &movie && calls.Thread == 3 && calls.SecondThread == 7);
+    CHECK(originals.BinkDoFrameAsyncWait(&movie, -1) == 1);
+    CHECK(calls.Us == -1);
+    CHECK(originals.BinkDoFrame(&movie) == 0);
+    CHECK(originals.BinkShouldSkip(&movie) == 1);
+    calls.Bink = nullptr;
+    originals.BinkNextFrame(&movie);
+    CHECK(calls.Bink == &movie);
+    calls.Bink = nullptr;
+    originals.BinkClose(&movie);
+    CHECK(calls.Bink == &movie);
+}
+
+// Regression: an export the original lacks stayed nullptr, and its thunk called it.
+TEST_CASE(ReportsExportsTheOriginalLacks)
+{
+    static std::vector<std::string> called;
+    BinkThunks::GMissingCalled = [](const char* name) { called.push_back(name); };
+
+    Originals originals;
+    std::vector<std::string> missed;
+    CHECK(resolve(originals, exports({ "BinkOpenWithOptions", "BinkShouldSkip" }), missed) == BinkThunks::COUNT - 2);
+    CHECK(missed == (std::vector<std::string>{ "BinkOpenWithOptions", "BinkShouldSkip" }));
+    REQUIRE(originals.BinkOpenWithOptions != nullptr && originals.BinkShouldSkip != nullptr);
+    calls = Calls{};
+    CHECK(originals.BinkOpenWithOptions("Credits.bk2", nullptr, 0) == nullptr);
+    CHECK(originals.BinkShouldSkip(&movie) == 0);
+    CHECK(originals.BinkShouldSkip(&movie) == 0);
+    CHECK(calls.Names.empty());
+    CHECK(called == (std::vector<std::string>{ "BinkOpenWithOptions", "BinkShouldSkip" }));   // Once each.
+    CHECK(originals.BinkOpen("Intro.bk2", 0) == &movie);
+
+    // No original DLL at all.
+    missed.clear();
+    called.clear();
+    calls = Calls{};
+    CHECK(resolve(originals, {}, missed) == 0);
+    CHECK(missed.size() == BinkThunks::COUNT);
+    CHECK(originals.BinkOpen("Intro.bk2", 0) == nullptr);
+    originals.BinkClose(nullptr);
+    CHECK(originals.BinkDoFrameAsyncWait(nullptr, 0) == 0);
+    CHECK(called == (std::vector<std::string>{ "BinkOpen", "BinkClose", "BinkDoFrameAsyncWait" }));
+    CHECK(calls.Names.empty());
+    BinkThunks::GMissingCalled = nullptr;
+}
+
+TEST_CASE(NamesMoviesOnlyWhenOpenedFromFiles)
+{
+    CHECK(strcmp(BinkThunks::MovieName("Movies/Intro.bk2", 0, 100), "Movies/Intro.bk2") == 0);
+    CHECK(strcmp(BinkThunks::MovieName("Movies/Intro.bk2", 0, 9), "Intro.bk2") == 0);     // The tail.
+    CHECK(strcmp(BinkThunks::MovieName("Intro.bk2", 0, 9), "Intro.bk2") == 0);
+    CHECK(strcmp(BinkThunks::MovieName(nullptr, 0, 100), "") == 0);
+
+    // A handle or a buffer passed as the name isn't text.
+    CHECK(strcmp(BinkThunks::MovieName("\x01\x02", BinkThunks::BINK_FILE_HANDLE, 100), "") == 0);
+    CHECK(strcmp(BinkThunks::MovieName("\x01\x02", BinkThunks::BINK_FROM_MEMORY | 0x100, 100), "") == 0);
+}
@@ -0,0 +1,297 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cwchar>
+#include <memory>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "utils/binlog.h"
+
+
+namespace
+{
+    using Utils::BinaryLog;
+    using Utils::BinLogContents;
+    using Utils::BinLogReader;
+
+    const char* FILE_NAME = "test_binlog.bin";
+
+    // Two formats with the same FNV-1a ID.
+    const wchar_t* COLLIDING_A = L"site 2232789: %d";
+    const wchar_t* COLLIDING_B = L"site 2429192: %d";
+    static_assert(BinaryLog::MakeId(L"site 2232789: %d") == BinaryLog::MakeId(L"site 2429192: %d"), "not a collision");
+    static_assert(BinaryLog::MakeId(L"a") != BinaryLog::MakeId(L"b"), "IDs depend on the text");
+
+    enum class Game { LE1 = 1, LE2 = 2 };
+
+    std::vector<uint8_t> readFile(const char* fileName)
+    {
+        std::vector<uint8_t> data;
+        auto file = fopen(fileName, "rb");
+        if (!file)
+        {
+            return data;
+        }
+        uint8_t chunk[4096];
+        size_t size;
+        while ((size = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            data.insert(data.end(), chunk, chunk + size);
+        }
+        fclose(file);
+        return data;
+    }
+
+    // Drain and close a log, then read the file back the way LogDecoder does.
+    bool decode(BinaryLog& log, BinLogContents& out, std::vector<uint8_t>* outData = nullptr)
+    {
+        log.DrainLocked();
+        log.Close();
+        auto data = readFile(FILE_NAME);
+        remove(FILE_NAME);
+        if (outData)
+        {
+            *outData = data;
+        }
+        return BinLogReader::Read(data.data(), data.size(), out);
+    }
+
+    // What GLOG_FAST needs of GLogger, text lines kept instead of written.
+    struct FakeLogger
+    {
+        BinaryLog Binary;
+        std::vector<std::wstring> Lines;
+
+        bool RegisterFastSite(uint32_t id, const wchar_t* format) { return Binary.Register(id, format); }
+
+        void writeln(const wchar_t* format, ...)
+        {
+            wchar_t line[256];
+            va_list args;
+            va_start(args, format);
+            vswprintf(line, 256, format, args);
+            va_end(args);
+            Lines.push_back(line);
+        }
+    };
+    FakeLogger GLogger;
+
+    std::vector<std::string> lines(const BinLogContents& contents)
+    {
+        std::vector<std::string> text;
+        for (const auto& event : contents.Events)
+        {
+            text.push_back(BinLogReader::FormatLine(contents, event));
+        }
+        return text;
+    }
+}
+
+
+TEST_CASE(RoundTripsEveryArgumentKind)
+{
+    auto log = std::make_unique<BinaryLog>();
+    REQUIRE(log->Open(FILE_NAME));
+    CHECK(log->Enabled());
+
+    const wchar_t* format = L"int %d uint %u hex %08X dbl %.2f ptr %p game %d ws [%s] ns [%S] null [%s]";
+    auto id = BinaryLog::MakeId(format);
+    REQUIRE(log->Register(id, format));
+    const char* nullText = nullptr;
+    log->Write(id, -42, 7u, 0xBEEFu, 2.5, reinterpret_cast<void*>(0x1234), Game::LE2, L"Shepard é世", "narrow", nullText);
+
+    const wchar_t* plain = L"no arguments";
+    REQUIRE(log->Register(BinaryLog::MakeId(plain), plain));
+    log->Write(BinaryLog::MakeId(plain));
+
+    BinLogContents contents;
+    REQUIRE(decode(*log, contents));
+    CHECK(!log->Enabled());
+    CHECK(!contents.Truncated);
+    CHECK(contents.Header.TicksPerSecond != 0);
+    CHECK(contents.Formats.size() == 2);
+    CHECK(contents.Collisions.empty());
+    REQUIRE(contents.Events.size() == 2);
+    CHECK(contents.Events[0].Id == id);
+    CHECK(contents.Events[0].Tick >= contents.Header.OriginTick);
+    CHECK(contents.Events[1].Tick >= contents.Events[0].Tick);
+
+    auto text = lines(contents);
+    CHECK(text[0] == "int -42 uint 7 hex 0000BEEF dbl 2.50 ptr 0000000000001234 game 2 ws [Shepard \xC3\xA9\xE4\xB8\x96] ns [narrow] null [(null)]");
+    CHECK(text[1] == "no arguments");
+}
+
+TEST_CASE(TruncatesStringsToTheRecord)
+{
+    auto log = std::make_unique<BinaryLog>();
+    REQUIRE(log->Open(FILE_NAME));
+
+    const wchar_t* format = L"%d %s";
+    auto id = BinaryLog::MakeId(format);
+    log->Register(id, format);
+    std::wstring longText(500, L'x');
+    log->Write(id, 1, longText.c_str());
+
+    BinLogContents contents;
+    REQUIRE(decode(*log, contents));
+    REQUIRE(contents.Events.size() == 1);
+    CHECK(contents.Events[0].Payload.size() <= Utils::BinLogRecord::MAX_PAYLOAD);
+
+    // Tag and value of the int, then tag and length of the string: the rest is UTF-16 text.
+    auto fits = (Utils::BinLogRecord::MAX_PAYLOAD - 9 - 3) / 2;
+    CHECK(BinLogReader::FormatLine(contents, contents.Events[0]) == "1 " + std::string(fits, 'x'));
+}
+
+TEST_CASE(RecordsDroppedEventsWhenTheRingIsFull)
+{
+    auto log = std::make_unique<BinaryLog>();
+    REQUIRE(log->Open(FILE_NAME));
+
+    const wchar_t* format = L"event %u";
+    auto id = BinaryLog::MakeId(format);
+    log->Register(id, format);
+    const unsigned total = 4096 + 10;
+    for (unsigned i = 0; i < total; i++)
+    {
+        log->Write(id, i);
+    }
+
+    BinLogContents contents;
+    REQUIRE(decode(*log, contents));
+    REQUIRE(contents.Events.size() == 4096 + 1);
+    auto text = lines(contents);
+    CHECK(text.front() == "event 0");
+    CHECK(text[4095] == "event 4095");
+    CHECK(contents.Events.back().DroppedCount == 10);
+    CHECK(text.back() == "<10 event(s) dropped, the log ring was full>");
+}
+
+TEST_CASE(RegistersEachFormatOnce)
+{
+    auto log = std::make_unique<BinaryLog>();
+    REQUIRE(log->Open(FILE_NAME));
+
+    // The same format from two sites, e.g. an inline function in several units.
+    const wchar_t* format = L"shared %d";
+    auto id = BinaryLog::MakeId(format);
+    std::wstring copy = format;
+    CHECK(log->Register(id, format));
+    CHECK(log->Register(id, copy.c_str()));
+    log->Write(id, 5);
+
+    BinLogContents contents;
+    std::vector<uint8_t> data;
+    REQUIRE(decode(*log, contents, &data));
+
+    // One FORMAT block: kind, ID, length and the text.
+    const size_t formatBlock = 1 + 4 + 2 + 2 * std::wstring(format).size();
+    const size_t eventBlock = 1 + 4 + 8 + 2 + 9;
+    CHECK(data.size() == 8 + sizeof(Utils::BinLogHeader) + formatBlock + eventBlock);
+    CHECK(lines(contents) == (std::vector<std::string>{ "shared 5" }));
+}
+
+TEST_CASE(RefusesAFormatWhoseIdIsTaken)
+{
+    auto log = std::make_unique<BinaryLog>();
+    REQUIRE(log->Open(FILE_NAME));
+
+    auto id = BinaryLog::MakeId(COLLIDING_A);
+    const wchar_t* taken = nullptr;
+    CHECK(log->Register(id, COLLIDING_A, &taken));
+    CHECK(taken == nullptr);
+    CHECK(!log->Register(BinaryLog::MakeId(COLLIDING_B), COLLIDING_B, &taken));
+    CHECK(taken == COLLIDING_A);
+    log->Write(id, 1);
+
+    // Only the first format reached the file, so its events still decode.
+    BinLogContents contents;
+    REQUIRE(decode(*log, contents));
+    CHECK(contents.Formats.size() == 1);
+    CHECK(contents.Collisions.empty());
+    CHECK(lines(contents) == (std::vector<std::string>{ "site 2232789: 1" }));
+}
+
+TEST_CASE(FlagsCollisionsInTheFile)
+{
+    // A file with two formats under one ID, as a proxy without the check could write.
+    std::vector<uint8_t> data{ 'L', 'E', 'B', 'P', 'B', 'I', 'N', '1' };
+    uint64_t header[3] = { 1000, 0, 0 };
+    data.insert(data.end(), reinterpret_cast<uint8_t*>(header), reinterpret_cast<uint8_t*>(header + 3));
+    auto appendFormat = [&data](const wchar_t* format)
+    {
+        auto id = BinaryLog::MakeId(format);
+        auto length = static_cast<uint16_t>(std::wstring(format).size());
+        data.push_back(Utils::BLK_FORMAT);
+        data.insert(data.end(), reinterpret_cast<uint8_t*>(&id), reinterpret_cast<uint8_t*>(&id + 1));
+        data.insert(data.end(), reinterpret_cast<uint8_t*>(&length), reinterpret_cast<uint8_t*>(&length + 1));
+        for (uint16_t i = 0; i < length; i++)
+        {
+            auto unit = Utils::ToUtf16Unit(format[i]);
+            data.insert(data.end(), reinterpret_cast<uint8_t*>(&unit), reinterpret_cast<uint8_t*>(&unit + 1));
+        }
+    };
+    appendFormat(COLLIDING_A);
+    appendFormat(COLLIDING_B);
+    appendFormat(COLLIDING_A);
+
+    BinLogContents contents;
+    REQUIRE(BinLogReader::Read(data.data(), data.size(), contents));
+    auto id = BinaryLog::MakeId(COLLIDING_A);
+    CHECK(contents.Collisions.count(id) == 1);
+    CHECK(contents.Formats.at(id) == "site 2232789: %d");
+
+    Utils::BinLogEvent event{};
+    event.Id = id;
+    CHECK(BinLogReader::FormatLine(contents, event).rfind("<ID 36E08CD0 has several formats", 0) == 0);
+}
+
+TEST_CASE(KeepsWhatPrecedesATruncatedTail)
+{
+    auto log = std::make_unique<BinaryLog>();
+    REQUIRE(log->Open(FILE_NAME));
+
+    const wchar_t* format = L"%s";
+    auto id = BinaryLog::MakeId(format);
+    log->Register(id, format);
+    log->Write(id, "first");
+    log->Write(id, "second");
+
+    BinLogContents contents;
+    std::vector<uint8_t> data;
+    REQUIRE(decode(*log, contents, &data));
+    CHECK(lines(contents) == (std::vector<std::string>{ "first", "second" }));
+
+    data.resize(data.size() - 3);
+    REQUIRE(BinLogReader::Read(data.data(), data.size(), contents));
+    CHECK(contents.Truncated);
+    CHECK(lines(contents) == (std::vector<std::string>{ "first" }));
+
+    data.push_back(0x7F);  // Not a record kind.
+    REQUIRE(BinLogReader::Read(data.data(), data.size(), contents));
+    CHECK(contents.Truncated);
+
+    CHECK(!BinLogReader::Read(data.data(), 20, contents));
+    data[0] = 'X';
+    CHECK(!BinLogReader::Read(data.data(), data.size(), contents));
+}
+
+TEST_CASE(LogsSitesWithAndWithoutArguments)
+{
+    // Regression: without arguments the macro expanded to Write(id, ), which only MSVC's old
+    // preprocessor accepted.
+    auto site = [](int value)
+    {
+        GLOG_FAST(L"no arguments");
+        GLOG_FAST(L"value %d", value);
+    };
+
+    site(1);
+    CHECK(GLogger.Lines == (std::vector<std::wstring>{ L"no arguments", L"value 1" }));
+
+    REQUIRE(GLogger.Binary.Open(FILE_NAME));
+    site(2);
+    CHECK(GLogger.Lines.size() == 2);
+    BinLogContents contents;
+    REQUIRE(decode(GLogger.Binary, contents));
+    CHECK(lines(contents) == (std::vector<std::string>{ "no arguments", "value 2" }));
+}
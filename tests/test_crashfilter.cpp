@@ -0,0 +1,145 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "testing.h"
+#include "utils/crashfilter.h"
+
+
+namespace
+{
+    using Utils::CrashFilter;
+
+    const uint32_t ACCESS_VIOLATION = 0xC0000005;
+    const uint32_t STACK_OVERFLOW = 0xC00000FD;
+    const uint32_t CPP_EXCEPTION = 0xE06D7363;   // What MSVC's throw raises, the engine catches these itself.
+}
+
+
+TEST_CASE(PassesOnlyCrashCodes)
+{
+    CHECK(CrashFilter::IsCrashCode(ACCESS_VIOLATION));
+    CHECK(CrashFilter::IsCrashCode(STACK_OVERFLOW));
+    CHECK(CrashFilter::IsCrashCode(0xC0000409));
+    CHECK(!CrashFilter::IsCrashCode(CPP_EXCEPTION));
+    CHECK(!CrashFilter::IsCrashCode(0x406D1388));   // SetThreadName.
+    CHECK(!CrashFilter::IsCrashCode(0x80000003));   // Breakpoint.
+    CHECK(!CrashFilter::IsCrashCode(0));
+
+    CrashFilter filter;
+    CHECK(!filter.ShouldDump(CPP_EXCEPTION, 0x1000, 10000));
+    CHECK(filter.DumpCount() == 0);
+    CHECK(filter.SuppressedCount() == 0);   // Noise isn't counted as a suppressed crash.
+}
+
+TEST_CASE(DumpsEachSiteOnce)
+{
+    CrashFilter filter;
+    CHECK(filter.ShouldDump(ACCESS_VIOLATION, 0x1000, 10000));
+    CHECK(!filter.ShouldDump(ACCESS_VIOLATION, 0x1000, 60000));
+    CHECK(filter.ShouldDump(STACK_OVERFLOW, 0x1000, 70000));      // Same address, other code.
+    CHECK(filter.ShouldDump(ACCESS_VIOLATION, 0x2000, 80000));    // Same code, other address.
+    CHECK(filter.DumpCount() == 3);
+    CHECK(filter.SuppressedCount() == 1);
+}
+
+TEST_CASE(SpacesDumpsOut)
+{
+    CrashFilter filter;
+    CHECK(filter.ShouldDump(ACCESS_VIOLATION, 0x1000, 10000));
+    CHECK(!filter.ShouldDump(ACCESS_VIOLATION, 0x2000, 10000 + CrashFilter::MIN_INTERVAL_MS - 1));
+    CHECK(filter.ShouldDump(ACCESS_VIOLATION, 0x2000, 10000 + CrashFilter::MIN_INTERVAL_MS));
+    CHECK(filter.DumpCount() == 2);
+    CHECK(filter.SuppressedCount() == 1);
+
+    // A clock reading of 0 still counts as a dump time.
+    CrashFilter early;
+    CHECK(early.ShouldDump(ACCESS_VIOLATION, 0x1000, 0));
+    CHECK(!early.ShouldDump(ACCESS_VIOLATION, 0x2000, 1000));
+}
+
+TEST_CASE(StopsAtTheSessionCap)
+{
+    CrashFilter filter;
+    uint64_t now = 10000;
+    for (uint32_t i = 0; i < CrashFilter::MAX_DUMPS; i++)
+    {
+        CHECK(filter.ShouldDump(ACCESS_VIOLATION, 0x1000 + i, now));
+        now += CrashFilter::MIN_INTERVAL_MS;
+    }
+    CHECK(!filter.ShouldDump(ACCESS_VIOLATION, 0x9000, now));
+    CHECK(!filter.ShouldDump(STACK_OVERFLOW, 0x9000, now + 3600000));
+    CHECK(filter.DumpCount() == CrashFilter::MAX_DUMPS);
+    CHECK(filter.SuppressedCount() == 2);
+}
+
+TEST_CASE(KeepsADumpForTheUnhandledCrash)
+{
+    // Regression: first-chance faults the engine recovers from used up every dump of the session.
+    CrashFilter filter;
+    uint64_t now = 10000;
+    for (uint32_t i = 0; i < CrashFilter::MAX_DUMPS; i++)
+    {
+        CHECK(filter.ShouldDump(ACCESS_VIOLATION, 0x1000 + i, now, false));
+        now += CrashFilter::MIN_INTERVAL_MS;
+    }
+    CHECK(!filter.ShouldDump(ACCESS_VIOLATION, 0x9000, now));
+
+    // The fatal one still dumps, right away, once.
+    CHECK(filter.ShouldDump(ACCESS_VIOLATION, 0x9000, now + 1, true));
+    CHECK(!filter.ShouldDump(STACK_OVERFLOW, 0xA000, now + 60000, true));
+    CHECK(!filter.ShouldDump(CPP_EXCEPTION, 0xA000, now + 60000, true));
+    CHECK(filter.DumpCount() == CrashFilter::MAX_DUMPS + CrashFilter::MAX_UNHANDLED_DUMPS);
+    CHECK(filter.SuppressedCount() == 2);
+}
+
+TEST_CASE(DoesNotDumpAnUnhandledCrashTwice)
+{
+    // The vectored handler saw it first and dumped it: the unhandled filter has nothing to add.
+    CrashFilter filter;
+    CHECK(filter.ShouldDump(ACCESS_VIOLATION, 0x1000, 10000));
+    CHECK(!filter.ShouldDump(ACCESS_VIOLATION, 0x1000, 10001, true));
+    CHECK(filter.DumpCount() == 1);
+
+    // Its slot is still there for another site, inside the first-chance interval.
+    CHECK(filter.ShouldDump(STACK_OVERFLOW, 0x2000, 10002, true));
+    CHECK(filter.DumpCount() == 2);
+
+    // And a first-chance crash at the site it dumped is a repeat.
+    CHECK(!filter.ShouldDump(STACK_OVERFLOW, 0x2000, 60000));
+}
+
+TEST_CASE(LetsOneOfSeveralCrashingThreadsDump)
+{
+    // Threads crash at once, e.g. all workers touching the same freed object.
+    for (int round = 0; round < 200; round++)
+    {
+        auto filter = std::make_unique<CrashFilter>();
+        std::atomic<bool> go{ false };
+        std::atomic<int> dumps{ 0 };
+        std::vector<std::thread> threads;
+        for (uint64_t t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&filter, &go, &dumps, t]()
+                {
+                    while (!go.load(std::memory_order_acquire))
+                    {
+                        std::this_thread::yield();
+                    }
+                    if (filter->ShouldDump(ACCESS_VIOLATION, 0x1000 + t, 10000))
+                    {
+                        dumps++;
+                    }
+                });
+        }
+        go.store(true, std::memory_order_release);
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        CHECK(dumps == 1);
+        CHECK(filter->DumpCount() == 1);
+        CHECK(filter->SuppressedCount() == 3);
+    }
+}
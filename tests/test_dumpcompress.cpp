@@ -0,0 +1,241 @@
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "utils/dumpcompress.h"
+
+
+namespace
+{
+    using Utils::DumpCompressor;
+    using Utils::DumpzChunk;
+    using Utils::DumpzTrailer;
+    using Utils::Lz4Block;
+
+    std::vector<uint8_t> randomBytes(size_t size, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::vector<uint8_t> data(size);
+        for (auto& byte : data)
+        {
+            byte = static_cast<uint8_t>(random());
+        }
+        return data;
+    }
+
+    // Something like a dump: zero pages, repeated structures and noise.
+    std::vector<uint8_t> dumpLike(size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        auto noise = randomBytes(size, 7);
+        for (size_t i = 0; i < size; i++)
+        {
+            auto page = i / 4096;
+            data[i] = page % 3 == 0 ? 0 : page % 3 == 1 ? static_cast<uint8_t>(i % 56) : noise[i];
+        }
+        return data;
+    }
+
+    bool lz4RoundTrips(const std::vector<uint8_t>& data, size_t* outPackedSize = nullptr)
+    {
+        std::vector<uint32_t> table(1 << 16);
+        std::vector<uint8_t> packed(Lz4Block::Bound(data.size()));
+        auto packedSize = Lz4Block::Compress(data.data(), data.size(), packed.data(), packed.size(), table.data());
+        if (outPackedSize)
+        {
+            *outPackedSize = packedSize;
+        }
+        std::vector<uint8_t> unpacked(data.size());
+        return packedSize != 0
+            && Lz4Block::Decompress(packed.data(), packedSize, unpacked.data(), unpacked.size()) == static_cast<long long>(data.size())
+            && unpacked == data;
+    }
+
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data, unsigned threadCount)
+    {
+        std::vector<uint8_t> file;
+        size_t readAt = 0;
+        auto read = [&data, &readAt](void* buffer, size_t size)
+        {
+            auto count = std::min(size, data.size() - readAt);
+            if (count != 0)
+            {
+                memcpy(buffer, data.data() + readAt, count);
+            }
+            readAt += count;
+            return count;
+        };
+        auto write = [&file](const void* bytes, size_t size)
+        {
+            file.insert(file.end(), static_cast<const uint8_t*>(bytes), static_cast<const uint8_t*>(bytes) + size);
+            return true;
+        };
+
+        uint64_t packedSize = 0;
+        CHECK(DumpCompressor::Compress(read, write, threadCount, &packedSize));
+        CHECK(packedSize == file.size());
+        return file;
+    }
+
+    // What LogDecoder does with a .dmpz.
+    bool decompress(const std::vector<uint8_t>& file, std::vector<uint8_t>& out, std::vector<DumpzChunk>* outIndex = nullptr)
+    {
+        DumpzTrailer trailer;
+        std::vector<DumpzChunk> index;
+        if (!DumpCompressor::ReadIndex(file.data(), file.size(), trailer, index))
+        {
+            return false;
+        }
+        out.assign(trailer.RawSize, 0);
+        for (const auto& chunk : index)
+        {
+            if (!DumpCompressor::ReadChunk(file.data(), chunk, out.data() + chunk.RawOffset))
+            {
+                return false;
+            }
+        }
+        if (outIndex)
+        {
+            *outIndex = index;
+        }
+        return true;
+    }
+}
+
+
+TEST_CASE(Lz4RoundTripsBlocks)
+{
+    CHECK(lz4RoundTrips({}));
+    CHECK(lz4RoundTrips({ 42 }));
+    CHECK(lz4RoundTrips(std::vector<uint8_t>(12, 1)));             // Below the match limit.
+    CHECK(lz4RoundTrips(std::vector<uint8_t>(13, 1)));
+    CHECK(lz4RoundTrips(randomBytes(100000, 1)));                   // Nothing to match.
+    CHECK(lz4RoundTrips(dumpLike(300000)));
+
+    std::string text;
+    for (int i = 0; i < 2000; i++)
+    {
+        text += "LogTemp: frame " + std::to_string(i) + " took " + std::to_string(i % 17) + " ms\n";
+    }
+    CHECK(lz4RoundTrips(std::vector<uint8_t>(text.begin(), text.end())));
+
+    // Long runs: a match overlapping its own output, and lengths spilling into several 255 bytes.
+    size_t packedSize = 0;
+    std::vector<uint8_t> zeros(1000000, 0);
+    CHECK(lz4RoundTrips(zeros, &packedSize));
+    CHECK(packedSize < 5000);
+}
+
+TEST_CASE(Lz4RejectsMalformedBlocks)
+{
+    auto data = dumpLike(50000);
+    std::vector<uint32_t> table(1 << 16);
+    std::vector<uint8_t> packed(Lz4Block::Bound(data.size()));
+    auto packedSize = Lz4Block::Compress(data.data(), data.size(), packed.data(), packed.size(), table.data());
+    REQUIRE(packedSize != 0);
+
+    std::vector<uint8_t> out(data.size());
+    CHECK(Lz4Block::Decompress(packed.data(), packedSize, out.data(), out.size() - 1) == -1);   // Too small.
+    CHECK(Lz4Block::Decompress(packed.data(), packedSize - 1, out.data(), out.size()) != static_cast<long long>(data.size()));
+
+    const uint8_t offsetZero[] = { 0x10, 'a', 0x00, 0x00 };
+    CHECK(Lz4Block::Decompress(offsetZero, sizeof(offsetZero), out.data(), out.size()) == -1);
+    const uint8_t beforeStart[] = { 0x10, 'a', 0x05, 0x00 };
+    CHECK(Lz4Block::Decompress(beforeStart, sizeof(beforeStart), out.data(), out.size()) == -1);
+    const uint8_t cutLength[] = { 0xF0, 0xFF };
+    CHECK(Lz4Block::Decompress(cutLength, sizeof(cutLength), out.data(), out.size()) == -1);
+
+    // Doesn't fit: the caller stores the data instead.
+    auto noise = randomBytes(1000, 3);
+    CHECK(Lz4Block::Compress(noise.data(), noise.size(), packed.data(), 500, table.data()) == 0);
+}
+
+TEST_CASE(RoundTripsADumpAcrossChunksAndThreads)
+{
+    // Three and a bit chunks, so batches end short with any thread count.
+    auto data = dumpLike(3 * DumpCompressor::CHUNK_SIZE + 12345);
+    for (unsigned threads : { 0u, 1u, 2u, 8u })
+    {
+        auto file = compress(data, threads);
+        CHECK(file.size() < data.size());
+
+        std::vector<uint8_t> unpacked;
+        std::vector<DumpzChunk> index;
+        REQUIRE(decompress(file, unpacked, &index));
+        CHECK(unpacked == data);
+        REQUIRE(index.size() == 4);
+        CHECK(index[3].RawOffset == 3ull * DumpCompressor::CHUNK_SIZE);
+        CHECK(index[3].RawSize == 12345);
+    }
+}
+
+TEST_CASE(StoresChunksThatDoNotShrink)
+{
+    auto data = randomBytes(DumpCompressor::CHUNK_SIZE + 100, 11);
+    auto file = compress(data, 2);
+
+    std::vector<uint8_t> unpacked;
+    std::vector<DumpzChunk> index;
+    REQUIRE(decompress(file, unpacked, &index));
+    CHECK(unpacked == data);
+    REQUIRE(index.size() == 2);
+    CHECK(index[0].Codec == Utils::DZC_STORED && index[1].Codec == Utils::DZC_STORED);
+}
+
+TEST_CASE(RoundTripsEmptyAndExactChunkDumps)
+{
+    auto empty = compress({}, 4);
+    std::vector<uint8_t> unpacked{ 1, 2, 3 };
+    std::vector<DumpzChunk> index;
+    REQUIRE(decompress(empty, unpacked, &index));
+    CHECK(unpacked.empty());
+    CHECK(index.empty());
+
+    auto exact = dumpLike(DumpCompressor::CHUNK_SIZE);
+    REQUIRE(decompress(compress(exact, 1), unpacked, &index));
+    CHECK(unpacked == exact);
+    CHECK(index.size() == 1);
+
+    // An empty stored chunk, as a writer could leave at the end.
+    DumpzChunk chunk{ 0, 0, 0, 0, Utils::DZC_STORED, 0 };
+    CHECK(DumpCompressor::ReadChunk(nullptr, chunk, nullptr));
+}
+
+TEST_CASE(RejectsBrokenFiles)
+{
+    auto data = dumpLike(100000);
+    auto file = compress(data, 1);
+    std::vector<uint8_t> unpacked;
+    REQUIRE(decompress(file, unpacked));
+
+    auto badMagic = file;
+    badMagic[0] = 'X';
+    CHECK(!decompress(badMagic, unpacked));
+
+    auto cut = file;
+    cut.pop_back();
+    CHECK(!decompress(cut, unpacked));
+
+    // The index claims more chunks than fit. The trailer isn't aligned in the file, edit a copy.
+    DumpzTrailer trailer;
+    memcpy(&trailer, file.data() + file.size() - sizeof(trailer), sizeof(trailer));
+    auto tooMany = file;
+    auto changedTrailer = trailer;
+    changedTrailer.ChunkCount = 1000;
+    memcpy(tooMany.data() + tooMany.size() - sizeof(trailer), &changedTrailer, sizeof(trailer));
+    CHECK(!decompress(tooMany, unpacked));
+
+    // A chunk pointing past its raw range.
+    auto outside = file;
+    DumpzChunk chunk;
+    memcpy(&chunk, file.data() + trailer.IndexOffset, sizeof(chunk));
+    chunk.RawSize = 200000;
+    memcpy(outside.data() + trailer.IndexOffset, &chunk, sizeof(chunk));
+    CHECK(!decompress(outside, unpacked));
+
+    // Corrupt packed bytes don't decode to the stated size.
+    auto corrupt = file;
+    memset(corrupt.data() + sizeof(Utils::DumpzHeader), 0xFF, 64);
+    CHECK(!decompress(corrupt, unpacked));
+}
@@ -0,0 +1,178 @@
+#include <atomic>
+#include <cwchar>
+#include <memory>
+#include <thread>
+#include "testing.h"
+#include "utils/dumpipc.h"
+
+
+namespace
+{
+    using Utils::DumpIpc;
+    using Utils::DumpIpcBlock;
+
+    const uint32_t STATES[] = { Utils::DHS_STARTING, Utils::DHS_READY, Utils::DHS_REQUESTED,
+        Utils::DHS_WRITING, Utils::DHS_DONE, Utils::DHS_FAILED };
+
+    // Stands in for the request and done events.
+    struct Signal
+    {
+        std::atomic<int> Count{ 0 };
+
+        void Set() { Count.fetch_add(1, std::memory_order_release); }
+
+        void WaitFor(int count) const
+        {
+            while (Count.load(std::memory_order_acquire) < count)
+            {
+                std::this_thread::yield();
+            }
+        }
+    };
+}
+
+
+TEST_CASE(AllowsOnlyTheProtocolsTransitions)
+{
+    int allowed = 0;
+    for (auto from : STATES)
+    {
+        for (auto to : STATES)
+        {
+            allowed += DumpIpc::CanTransition(from, to) ? 1 : 0;
+        }
+        CHECK(!DumpIpc::CanTransition(from, from));
+        CHECK(!DumpIpc::CanTransition(from, 77));
+    }
+    CHECK(allowed == 8);
+
+    CHECK(DumpIpc::CanTransition(Utils::DHS_STARTING, Utils::DHS_READY));
+    CHECK(DumpIpc::CanTransition(Utils::DHS_READY, Utils::DHS_REQUESTED));
+    CHECK(DumpIpc::CanTransition(Utils::DHS_REQUESTED, Utils::DHS_WRITING));
+    CHECK(DumpIpc::CanTransition(Utils::DHS_REQUESTED, Utils::DHS_FAILED));
+    CHECK(DumpIpc::CanTransition(Utils::DHS_WRITING, Utils::DHS_DONE));
+    CHECK(DumpIpc::CanTransition(Utils::DHS_WRITING, Utils::DHS_FAILED));
+    CHECK(DumpIpc::CanTransition(Utils::DHS_DONE, Utils::DHS_READY));
+    CHECK(DumpIpc::CanTransition(Utils::DHS_FAILED, Utils::DHS_READY));
+
+    // The proxy must never skip the helper, nor request before it's attached.
+    CHECK(!DumpIpc::CanTransition(Utils::DHS_STARTING, Utils::DHS_REQUESTED));
+    CHECK(!DumpIpc::CanTransition(Utils::DHS_READY, Utils::DHS_DONE));
+    CHECK(!DumpIpc::CanTransition(Utils::DHS_DONE, Utils::DHS_REQUESTED));
+    CHECK(!DumpIpc::CanTransition(77, Utils::DHS_READY));
+}
+
+TEST_CASE(TransitionsOnlyFromTheExpectedState)
+{
+    std::atomic<uint32_t> state{ Utils::DHS_STARTING };
+    CHECK(!DumpIpc::TryTransition(state, Utils::DHS_READY, Utils::DHS_REQUESTED));
+    CHECK(state == Utils::DHS_STARTING);
+    CHECK(!DumpIpc::TryTransition(state, Utils::DHS_STARTING, Utils::DHS_DONE));   // Not a protocol step.
+    CHECK(state == Utils::DHS_STARTING);
+
+    CHECK(DumpIpc::TryTransition(state, Utils::DHS_STARTING, Utils::DHS_READY));
+    CHECK(!DumpIpc::TryTransition(state, Utils::DHS_STARTING, Utils::DHS_READY));  // A second helper.
+    CHECK(DumpIpc::TryTransition(state, Utils::DHS_READY, Utils::DHS_REQUESTED));
+    CHECK(!DumpIpc::TryTransition(state, Utils::DHS_READY, Utils::DHS_REQUESTED)); // A second crash.
+    CHECK(DumpIpc::TryTransition(state, Utils::DHS_REQUESTED, Utils::DHS_WRITING));
+    CHECK(DumpIpc::TryTransition(state, Utils::DHS_WRITING, Utils::DHS_FAILED));
+    CHECK(DumpIpc::TryTransition(state, Utils::DHS_FAILED, Utils::DHS_READY));
+    CHECK(state == Utils::DHS_READY);
+}
+
+TEST_CASE(NamesObjectsPerProcess)
+{
+    wchar_t name[64];
+    DumpIpc::Name(name, 64, L"Block", 4242);
+    CHECK(wcscmp(name, L"Local\\LEBinkProxyDumpBlock_4242") == 0);
+    DumpIpc::Name(name, 64, L"Request", 4294967295u);
+    CHECK(wcscmp(name, L"Local\\LEBinkProxyDumpRequest_4294967295") == 0);
+}
+
+TEST_CASE(LetsOneOfSeveralCrashingThreadsRequest)
+{
+    for (int round = 0; round < 200; round++)
+    {
+        std::atomic<uint32_t> state{ Utils::DHS_READY };
+        std::atomic<bool> go{ false };
+        std::atomic<int> requests{ 0 };
+        std::thread threads[4];
+        for (auto& thread : threads)
+        {
+            thread = std::thread([&state, &go, &requests]()
+                {
+                    while (!go.load(std::memory_order_acquire))
+                    {
+                        std::this_thread::yield();
+                    }
+                    if (DumpIpc::TryTransition(state, Utils::DHS_READY, Utils::DHS_REQUESTED))
+                    {
+                        requests++;
+                    }
+                });
+        }
+        go.store(true, std::memory_order_release);
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        CHECK(requests == 1);
+        CHECK(state == Utils::DHS_REQUESTED);
+    }
+}
+
+TEST_CASE(ServesRequestsLikeTheHelper)
+{
+    // The proxy and the helper over a shared block, the way crashdump.h and DumpHelper.cpp drive it:
+    // one dump that fails, one that works, then the proxy re-arms for the next crash.
+    auto block = std::make_unique<DumpIpcBlock>();
+    block->State.store(Utils::DHS_STARTING);
+    Signal request;
+    Signal done;
+    std::atomic<bool> exiting{ false };
+
+    std::thread helper([&]()
+        {
+            CHECK(DumpIpc::TryTransition(block->State, Utils::DHS_STARTING, Utils::DHS_READY));
+            for (int served = 0; ; served++)
+            {
+                request.WaitFor(served + 1);
+                if (exiting.load())
+                {
+                    return;
+                }
+                CHECK(DumpIpc::TryTransition(block->State, Utils::DHS_REQUESTED, Utils::DHS_WRITING));
+                block->Result = block->ClientThreadId == 1 ? 5 : 0;   // ERROR_ACCESS_DENIED for the first.
+                DumpIpc::TryTransition(block->State, Utils::DHS_WRITING, block->Result == 0 ? Utils::DHS_DONE : Utils::DHS_FAILED);
+                done.Set();
+            }
+        });
+
+    auto requestDump = [&](uint32_t threadId, int serial)
+    {
+        if (!DumpIpc::TryTransition(block->State, Utils::DHS_READY, Utils::DHS_REQUESTED))
+        {
+            return -1;   // No helper yet, the proxy dumps in-process.
+        }
+        block->ClientThreadId = threadId;
+        block->Result = 0;
+        request.Set();
+        done.WaitFor(serial);
+        auto state = block->State.load();
+        CHECK(DumpIpc::TryTransition(block->State, state, Utils::DHS_READY));
+        return state == Utils::DHS_DONE ? 0 : static_cast<int>(block->Result);
+    };
+    while (block->State.load() == Utils::DHS_STARTING)
+    {
+        CHECK(requestDump(0, 0) == -1);
+        std::this_thread::yield();
+    }
+
+    CHECK(requestDump(1, 1) == 5);
+    CHECK(requestDump(2, 2) == 0);
+    CHECK(block->State.load() == Utils::DHS_READY);
+
+    exiting.store(true);
+    request.Set();
+    helper.join();
+}
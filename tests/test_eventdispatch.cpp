@@ -0,0 +1,351 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "testing.h"
+#include "utils/eventdispatch.h"
+
+
+namespace
+{
+    using Utils::EventDispatchTable;
+
+    struct Calls
+    {
+        std::vector<int> Order;
+    };
+
+    // Handlers push their context (an int) into the Calls passed as the object.
+    bool record(void* object, void* context)
+    {
+        static_cast<Calls*>(object)->Order.push_back(static_cast<int>(reinterpret_cast<intptr_t>(context)));
+        return false;
+    }
+
+    void* tag(int value)
+    {
+        return reinterpret_cast<void*>(static_cast<intptr_t>(value));
+    }
+
+    void* recordProc()
+    {
+        return reinterpret_cast<void*>(&record);
+    }
+
+    // The shape of HookedProcessEvent: handlers inside a Reader, the original outside of it.
+    // Returns whether a pre-call handler skipped the original.
+    template<typename TOriginal>
+    bool dispatch(const EventDispatchTable& table, const void* function, void* object, TOriginal&& original)
+    {
+        typedef bool (*tHandler)(void* object, void* context);
+
+        if (!table.Find(function))
+        {
+            original();
+            return false;
+        }
+
+        bool skip = false;
+        {
+            const EventDispatchTable::Reader reader(table);
+            if (auto handlers = table.Find(function))
+            {
+                for (const auto& handler : handlers->Pre)
+                {
+                    skip |= reinterpret_cast<tHandler>(handler.Proc)(object, handler.Context);
+                }
+            }
+        }
+        if (!skip)
+        {
+            original();
+        }
+
+        const EventDispatchTable::Reader reader(table);
+        if (auto handlers = table.Find(function))
+        {
+            for (const auto& handler : handlers->Post)
+            {
+                reinterpret_cast<tHandler>(handler.Proc)(object, handler.Context);
+            }
+        }
+        return skip;
+    }
+
+    bool dispatch(const EventDispatchTable& table, const void* function, Calls& calls)
+    {
+        return dispatch(table, function, &calls, [&calls]() { calls.Order.push_back(0); });
+    }
+
+    // Functions are only compared by address.
+    int functions[8];
+    const int owners[2] = {};
+}
+
+
+TEST_CASE(RunsPreAndPostHandlersAroundTheOriginal)
+{
+    auto table = std::make_unique<EventDispatchTable>();
+    CHECK(table->Subscribe(&functions[0], 0, nullptr, nullptr, 0, nullptr) == 0);
+    auto pre = table->Subscribe(&functions[0], 0, recordProc(), tag(1), 0, &owners[0]);
+    auto post = table->Subscribe(&functions[0], 0, recordProc(), tag(2), EventDispatchTable::FLAG_POST, &owners[0]);
+    CHECK(table->Subscribe(&functions[0], 0, recordProc(), tag(3), 0, &owners[1]) != 0);
+    CHECK(pre != 0 && post != 0 && pre != post);
+    CHECK(table->SubscriptionCount() == 3);
+
+    Calls calls;
+    CHECK(!dispatch(*table, &functions[0], calls));
+    CHECK(calls.Order == (std::vector<int>{ 1, 3, 0, 2 }));
+
+    Calls missed;
+    CHECK(table->Find(&functions[1]) == nullptr);
+    dispatch(*table, &functions[1], missed);
+    CHECK(missed.Order == (std::vector<int>{ 0 }));
+
+    CHECK(table->Unsubscribe(pre));
+    CHECK(!table->Unsubscribe(pre));
+    CHECK(table->UnsubscribeOwnedBy(&owners[1]) == 1);
+    Calls after;
+    dispatch(*table, &functions[0], after);
+    CHECK(after.Order == (std::vector<int>{ 0, 2 }));
+
+    CHECK(table->Unsubscribe(post));
+    CHECK(table->Find(&functions[0]) == nullptr);
+}
+
+TEST_CASE(SkipsTheOriginalWhenAPreHandlerSaysSo)
+{
+    auto table = std::make_unique<EventDispatchTable>();
+    auto skipper = [](void*, void*) { return true; };
+    bool (*skipProc)(void*, void*) = skipper;
+    table->Subscribe(&functions[0], 0, reinterpret_cast<void*>(skipProc), nullptr, 0, nullptr);
+    table->Subscribe(&functions[0], 0, recordProc(), tag(2), EventDispatchTable::FLAG_POST, nullptr);
+
+    Calls calls;
+    CHECK(dispatch(*table, &functions[0], calls));
+    CHECK(calls.Order == (std::vector<int>{ 2 }));   // Post-call handlers still run.
+}
+
+TEST_CASE(ResolvesNameSubscriptionsThroughBind)
+{
+    auto table = std::make_unique<EventDispatchTable>();
+    const uint64_t tick = 0x1234, other = 0x5678;
+
+    table->OnBind(&functions[0], tick);
+    table->OnBind(&functions[3], other);
+    auto byName = table->Subscribe(nullptr, tick, recordProc(), tag(1), 0, nullptr,
+        [](uint64_t nameKey, auto&& visit) { if (nameKey == 0x1234) visit(&functions[0]); });
+    CHECK(byName != 0);
+    CHECK(table->Find(&functions[0]) != nullptr);   // Bound before the subscription, looked up.
+
+    table->OnBind(&functions[1], tick);
+    table->OnBind(&functions[2], other);
+    CHECK(table->Find(&functions[1]) != nullptr);   // And after it.
+    CHECK(table->Find(&functions[2]) == nullptr);
+
+    // Bound again at the same address, it's another function: pointer subscriptions go,
+    // name subscriptions follow the new name.
+    table->Subscribe(&functions[1], 0, recordProc(), tag(2), 0, nullptr);
+    table->OnBind(&functions[1], other);
+    CHECK(table->Find(&functions[1]) == nullptr);
+    CHECK(table->SubscriptionCount() == 1);
+
+    CHECK(table->Unsubscribe(byName));
+    CHECK(table->Find(&functions[0]) == nullptr);
+    CHECK(table->ListCount() == 0);
+}
+
+// Regression: every bind took the write lock and recorded the function's name, with no
+// name subscription to use it.
+TEST_CASE(TracksBindsOnlyWhileThereAreNameSubscriptions)
+{
+    auto table = std::make_unique<EventDispatchTable>();
+    const uint64_t tick = 0x1234;
+    for (auto& function : functions)
+    {
+        table->OnBind(&function, tick);
+    }
+    CHECK(table->TrackedCount() == 0);
+
+    size_t lookups = 0;
+    auto lookup = [&lookups](uint64_t, auto&& visit) { lookups++; visit(&functions[0]); visit(&functions[1]); };
+    auto first = table->Subscribe(nullptr, tick, recordProc(), tag(1), 0, nullptr, lookup);
+    auto second = table->Subscribe(nullptr, tick, recordProc(), tag(2), 0, nullptr, lookup);
+    CHECK(lookups == 1);                            // Once per name.
+    CHECK(table->TrackedCount() == 2);
+    CHECK(table->Find(&functions[1]) != nullptr);
+    table->OnBind(&functions[2], tick);
+    CHECK(table->TrackedCount() == 3);
+    CHECK(table->Find(&functions[2]) != nullptr);
+
+    // Pointer subscriptions don't need names.
+    auto byPointer = table->Subscribe(&functions[4], 0, recordProc(), tag(3), 0, nullptr);
+    CHECK(table->Unsubscribe(first));
+    CHECK(table->Unsubscribe(second));
+    CHECK(table->TrackedCount() == 0);
+    CHECK(table->Find(&functions[2]) == nullptr);
+    table->OnBind(&functions[2], tick);
+    CHECK(table->TrackedCount() == 0);
+
+    // Looked up again once names are tracked again.
+    table->Subscribe(nullptr, tick, recordProc(), tag(1), 0, nullptr, lookup);
+    CHECK(lookups == 2);
+    CHECK(table->Find(&functions[4]) != nullptr);
+    CHECK(table->Unsubscribe(byPointer));
+}
+
+TEST_CASE(FreesReplacedListsInsteadOfKeepingThem)
+{
+    // Regression: every change used to keep its old list until the table went away.
+    auto table = std::make_unique<EventDispatchTable>();
+    auto kept = table->Subscribe(&functions[0], 0, recordProc(), tag(1), 0, nullptr);
+    for (int i = 0; i < 1000; i++)
+    {
+        auto id = table->Subscribe(&functions[i % 4], 0, recordProc(), tag(2), 0, nullptr);
+        table->Unsubscribe(id);
+    }
+    CHECK(table->ListCount() == 1);
+    CHECK(table->Unsubscribe(kept));
+    CHECK(table->ListCount() == 0);
+}
+
+TEST_CASE(UnsubscribeWaitsForDispatchesInProgress)
+{
+    auto table = std::make_unique<EventDispatchTable>();
+    static std::atomic<bool> entered, release;
+    entered = false;
+    release = false;
+    auto blocking = [](void*, void*)
+    {
+        entered.store(true);
+        while (!release.load())
+        {
+            std::this_thread::yield();
+        }
+        return false;
+    };
+    bool (*blockingProc)(void*, void*) = blocking;
+    table->Subscribe(&functions[0], 0, reinterpret_cast<void*>(blockingProc), nullptr, 0, &owners[0]);
+
+    std::thread game([&table]()
+        {
+            Calls calls;
+            dispatch(*table, &functions[0], calls);
+        });
+    while (!entered.load())
+    {
+        std::this_thread::yield();
+    }
+
+    // The plugin is being unloaded while its handler runs on the game thread.
+    std::atomic<bool> released{ false };
+    std::thread unloader([&table, &released]()
+        {
+            CHECK(table->UnsubscribeOwnedBy(&owners[0]) == 1);
+            released.store(true);
+        });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!released.load());
+    CHECK(table->Find(&functions[0]) == nullptr);   // New dispatches already miss.
+
+    release.store(true);
+    unloader.join();
+    game.join();
+    CHECK(released.load());
+    CHECK(table->ListCount() == 0);
+}
+
+TEST_CASE(HandlersCanUnsubscribeThemselves)
+{
+    // Waiting for the dispatch a handler runs in would never end, the list is freed later instead.
+    static EventDispatchTable* table;
+    static uint32_t id;
+    auto owned = std::make_unique<EventDispatchTable>();
+    table = owned.get();
+    auto once = [](void* object, void* context)
+    {
+        table->Unsubscribe(id);
+        return record(object, context);
+    };
+    bool (*onceProc)(void*, void*) = once;
+    id = table->Subscribe(&functions[0], 0, reinterpret_cast<void*>(onceProc), tag(1), 0, nullptr);
+    table->Subscribe(&functions[0], 0, recordProc(), tag(2), 0, nullptr);
+
+    Calls first, second;
+    dispatch(*table, &functions[0], first);
+    dispatch(*table, &functions[0], second);
+    CHECK(first.Order == (std::vector<int>{ 1, 2, 0 }));
+    CHECK(second.Order == (std::vector<int>{ 2, 0 }));
+    CHECK(table->ListCount() == 2);                 // The one in use then, and its replacement.
+
+    table->Subscribe(&functions[1], 0, recordProc(), tag(3), 0, nullptr);
+    CHECK(table->ListCount() == 2);
+}
+
+TEST_CASE(DispatchesWhileSubscriptionsChange)
+{
+    // Handlers check that their list is intact; under ASan a freed list would be reported.
+    auto table = std::make_unique<EventDispatchTable>();
+    static const int MAGIC = 0x5EED;
+    static std::atomic<int> broken;
+    broken = 0;
+    auto checked = [](void*, void* context)
+    {
+        if (static_cast<int>(reinterpret_cast<intptr_t>(context)) != MAGIC)
+        {
+            broken.fetch_add(1);
+        }
+        return false;
+    };
+    bool (*checkedProc)(void*, void*) = checked;
+    table->Subscribe(&functions[0], 0, reinterpret_cast<void*>(checkedProc), tag(MAGIC), 0, nullptr);
+
+    std::atomic<bool> stop{ false };
+    std::atomic<uint64_t> dispatched{ 0 };
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; t++)
+    {
+        readers.emplace_back([&table, &stop, &dispatched]()
+            {
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    for (int i = 0; i < 4; i++)
+                    {
+                        dispatch(*table, &functions[i], nullptr, []() {});
+                    }
+                    dispatched.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+    }
+
+    while (dispatched.load() == 0)
+    {
+        std::this_thread::yield();
+    }
+    for (int i = 0; i < 2000; i++)
+    {
+        if (i % 100 == 0)
+        {
+            std::this_thread::yield();
+        }
+        auto id = table->Subscribe(&functions[i % 4], 0, reinterpret_cast<void*>(checkedProc), tag(MAGIC),
+            i % 2 ? EventDispatchTable::FLAG_POST : 0, &owners[i % 2]);
+        if (i % 3 == 0)
+        {
+            table->UnsubscribeOwnedBy(&owners[i % 2]);
+        }
+        else
+        {
+            table->Unsubscribe(id);
+        }
+    }
+    stop.store(true);
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    CHECK(broken.load() == 0);
+    CHECK(table->ListCount() <= 4);
+}
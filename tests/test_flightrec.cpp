@@ -0,0 +1,184 @@
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "testing.h"
+#include "utils/flightrec.h"
+
+
+namespace
+{
+    using Utils::FlightEntry;
+    using Utils::FlightRecorder;
+    using Utils::FlightSnapshotHeader;
+
+    struct Snapshot
+    {
+        std::vector<uint8_t> Buffer = std::vector<uint8_t>(FlightRecorder::SNAPSHOT_SIZE);
+        size_t Size = 0;
+
+        const FlightSnapshotHeader& Header() const { return *reinterpret_cast<const FlightSnapshotHeader*>(Buffer.data()); }
+        const FlightEntry& Entry(size_t i) const { return reinterpret_cast<const FlightEntry*>(Buffer.data() + sizeof(FlightSnapshotHeader))[i]; }
+        std::string Text(size_t i) const { return std::string(Entry(i).Text, strnlen(Entry(i).Text, Utils::FLIGHT_TEXT_CHARS)); }
+    };
+
+    Snapshot take(FlightRecorder& recorder, uint32_t crashThreadId = 7)
+    {
+        Snapshot snapshot;
+        snapshot.Size = recorder.Snapshot(snapshot.Buffer.data(), crashThreadId);
+        return snapshot;
+    }
+}
+
+
+TEST_CASE(SnapshotsEntriesOldestFirst)
+{
+    auto recorder = std::make_unique<FlightRecorder>();
+    recorder->Record(Utils::FE_PLUGIN_LOADED, 0x1000, 0, "first.asi");
+    recorder->Record(Utils::FE_HOOK_INSTALLED, 0x2000, 0x3000, "ProcessEvent");
+    recorder->Record(Utils::FE_NOTE, 3, 4, static_cast<const char*>(nullptr));
+
+    auto snapshot = take(*recorder, 99);
+    auto& header = snapshot.Header();
+    CHECK(memcmp(header.Magic, "LEBPFLT1", 8) == 0);
+    CHECK(header.TicksPerSecond != 0);
+    CHECK(header.CrashThreadId == 99);
+    CHECK(header.EntrySize == sizeof(FlightEntry));
+    REQUIRE(header.EntryCount == 3);
+    CHECK(snapshot.Size == sizeof(FlightSnapshotHeader) + 3 * sizeof(FlightEntry));
+
+    CHECK(snapshot.Entry(0).Kind == Utils::FE_PLUGIN_LOADED && snapshot.Text(0) == "first.asi");
+    CHECK(snapshot.Entry(1).A == 0x2000 && snapshot.Entry(1).B == 0x3000 && snapshot.Text(1) == "ProcessEvent");
+    CHECK(snapshot.Entry(2).Kind == Utils::FE_NOTE && snapshot.Text(2).empty());
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        CHECK(snapshot.Entry(i).Sequence == i + 1);
+        CHECK(snapshot.Entry(i).Tick <= header.SnapshotTick);
+    }
+    CHECK(snapshot.Entry(0).ThreadId == snapshot.Entry(2).ThreadId);
+}
+
+TEST_CASE(KeepsTheNewestEntriesWhenFull)
+{
+    auto recorder = std::make_unique<FlightRecorder>();
+    const uint64_t total = FlightRecorder::CAPACITY + 10;
+    for (uint64_t i = 0; i < total; i++)
+    {
+        recorder->Record(Utils::FE_NOTE, i, 0, "");
+    }
+
+    auto snapshot = take(*recorder);
+    REQUIRE(snapshot.Header().EntryCount == FlightRecorder::CAPACITY);
+    CHECK(snapshot.Entry(0).A == 10);
+    CHECK(snapshot.Entry(FlightRecorder::CAPACITY - 1).A == total - 1);
+}
+
+TEST_CASE(TrimsText)
+{
+    auto recorder = std::make_unique<FlightRecorder>();
+    recorder->Record(Utils::FE_PLUGIN_LOADED, 0, 0, L"C:\\Games\\Mass Effect Legendary Edition\\ASI\\Plugin\u00e9.asi");
+    recorder->Record(Utils::FE_NOTE, 0, 0, "this text is longer than the twenty-four characters");
+
+    const uint8_t pattern[] = { 0x48, 0x8B, 0x00, 0xC4 };
+    const uint8_t mask[] = "xx?x";
+    uint8_t found = 0;
+    recorder->RecordPattern(&found, pattern, mask);
+    recorder->RecordPattern(nullptr, pattern, mask);
+
+    auto snapshot = take(*recorder);
+    REQUIRE(snapshot.Header().EntryCount == 4);
+    CHECK(snapshot.Text(0) == " Edition\\ASI\\Plugin?.asi");   // The file name end of a path.
+    CHECK(snapshot.Text(1) == "this text is longer than");
+    CHECK(snapshot.Entry(2).Kind == Utils::FE_PATTERN_FOUND && snapshot.Entry(2).A == reinterpret_cast<uintptr_t>(&found));
+    CHECK(snapshot.Text(2) == "488B??C4");
+    CHECK(snapshot.Entry(3).Kind == Utils::FE_PATTERN_MISSED && snapshot.Entry(3).A == 0);
+}
+
+TEST_CASE(NeverPublishesSequenceZero)
+{
+    CHECK(Utils::FlightSequence(0) == 1);
+    CHECK(Utils::FlightSequence(0xFFFFFFFEull) == 0xFFFFFFFFu);
+    CHECK(Utils::FlightSequence(0xFFFFFFFFull) == 1);
+
+    // Regression: at the 2^32nd event, position + 1 published 0 ("being written") and the entry
+    // was left out of every snapshot.
+    auto recorder = std::make_unique<FlightRecorder>(0xFFFFFFFFull - 3);
+    for (uint64_t i = 0; i < 8; i++)
+    {
+        recorder->Record(Utils::FE_NOTE, i, 0, "");
+    }
+
+    auto snapshot = take(*recorder);
+    REQUIRE(snapshot.Header().EntryCount == 8);
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        CHECK(snapshot.Entry(i).A == i);
+        CHECK(snapshot.Entry(i).Sequence != 0);
+    }
+}
+
+TEST_CASE(DropsEntriesRewrittenDuringTheSnapshot)
+{
+    // Writers keep A, B and the text consistent with each other, a torn copy would mix two events.
+    auto recorder = std::make_unique<FlightRecorder>();
+    std::atomic<bool> stop{ false };
+    std::vector<std::thread> writers;
+    for (uint64_t t = 0; t < 4; t++)
+    {
+        writers.emplace_back([&recorder, &stop, t]()
+            {
+                char text[32];
+                for (uint64_t i = 0; !stop.load(std::memory_order_relaxed); i++)
+                {
+                    auto value = (t << 48) | i;
+                    snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(value));
+                    recorder->Record(Utils::FE_NOTE, value, ~value, text);
+                }
+            });
+    }
+
+    // Entries rewritten during a copy may be left out, but what is in a snapshot must be whole.
+    int torn = 0;
+    int outOfOrder = 0;
+    auto check = [&torn, &outOfOrder](const Snapshot& snapshot)
+    {
+        for (uint32_t i = 0; i < snapshot.Header().EntryCount; i++)
+        {
+            const auto& entry = snapshot.Entry(i);
+            char text[32];
+            snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(entry.A));
+            if (entry.B != ~entry.A || snapshot.Text(i) != text)
+            {
+                torn++;
+            }
+            if (i != 0 && entry.Sequence <= snapshot.Entry(i - 1).Sequence)
+            {
+                outOfOrder++;
+            }
+        }
+    };
+    for (int round = 0; round < 2000; round++)
+    {
+        check(take(*recorder));
+    }
+    stop.store(true);
+    for (auto& writer : writers)
+    {
+        writer.join();
+    }
+
+    // A writer stalled for a whole lap publishes into a slot that has been reused since, which leaves
+    // that slot out until it's written again. One more lap of entries brings every slot back.
+    for (uint64_t i = 0; i < FlightRecorder::CAPACITY; i++)
+    {
+        recorder->Record(Utils::FE_NOTE, i, ~i, std::to_string(i).c_str());
+    }
+    auto quiet = take(*recorder);
+    check(quiet);
+    CHECK(quiet.Header().EntryCount == FlightRecorder::CAPACITY);
+    CHECK(quiet.Entry(0).A == 0);
+    CHECK(torn == 0);
+    CHECK(outOfOrder == 0);
+}
@@ -0,0 +1,159 @@
+#include <cstdarg>
+#include <cwchar>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "utils/binlog.h"
+#include "utils/logfilter.h"
+
+
+namespace
+{
+    using Utils::LogCategory;
+    using Utils::LogFilter;
+    using Utils::LogLevel;
+
+    const LogCategory ALL[] = { LogCategory::General, LogCategory::Loader, LogCategory::Hooks,
+        LogCategory::Spi, LogCategory::Ue, LogCategory::Launcher };
+
+    // What the GLOG macros need of GLogger, text lines kept instead of written.
+    struct FakeLogger
+    {
+        LogFilter Filter;
+        Utils::BinaryLog Binary;
+        std::vector<std::wstring> Lines;
+
+        bool RegisterFastSite(uint32_t id, const wchar_t* format) { return Binary.Register(id, format); }
+
+        void writeln(const wchar_t* format, ...)
+        {
+            wchar_t line[256];
+            va_list args;
+            va_start(args, format);
+            vswprintf(line, 256, format, args);
+            va_end(args);
+            Lines.push_back(line);
+        }
+    };
+    FakeLogger GLogger;
+
+    bool allAt(const LogFilter& filter, LogLevel level)
+    {
+        for (auto category : ALL)
+        {
+            if (filter.Get(category) != level)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+TEST_CASE(DefaultsToDebugWithoutTheSwitch)
+{
+    LogFilter filter;
+    CHECK(allAt(filter, LogFilter::DEFAULT_LEVEL));
+    CHECK(filter.Configure(L"MassEffect1.exe -nostartupmovies"));
+    CHECK(filter.Configure(nullptr));
+    CHECK(allAt(filter, LogLevel::Debug));
+
+    CHECK(!filter.IsEnabled(LogLevel::Trace, LogCategory::Hooks));
+    CHECK(filter.IsEnabled(LogLevel::Debug, LogCategory::Hooks));
+    CHECK(filter.IsEnabled(LogLevel::Error, LogCategory::Hooks));
+}
+
+TEST_CASE(AppliesTheBareLevelToEveryCategory)
+{
+    LogFilter filter;
+    CHECK(filter.Configure(L"game.exe -loglevel=WARN -other"));
+    CHECK(allAt(filter, LogLevel::Warn));
+    CHECK(!filter.IsEnabled(LogLevel::Info, LogCategory::Spi));
+    CHECK(filter.IsEnabled(LogLevel::Warn, LogCategory::Spi));
+
+    LogFilter off;
+    CHECK(off.Configure(L"game.exe -loglevel=off"));
+    CHECK(!off.IsEnabled(LogLevel::Error, LogCategory::General));
+}
+
+TEST_CASE(LetsCategoriesOverrideTheBareLevelInAnyOrder)
+{
+    LogFilter before;
+    CHECK(before.Configure(L"game.exe -loglevel=info,hooks:trace,spi:error"));
+
+    // Regression: a bare level after the category items used to reset them.
+    LogFilter after;
+    CHECK(after.Configure(L"game.exe -loglevel=hooks:trace,spi:error,info"));
+
+    for (auto filter : { &before, &after })
+    {
+        CHECK(filter->Get(LogCategory::Hooks) == LogLevel::Trace);
+        CHECK(filter->Get(LogCategory::Spi) == LogLevel::Error);
+        CHECK(filter->Get(LogCategory::General) == LogLevel::Info);
+        CHECK(filter->Get(LogCategory::Launcher) == LogLevel::Info);
+    }
+}
+
+TEST_CASE(LetsTheLastItemWinAmongItsKind)
+{
+    LogFilter filter;
+    CHECK(filter.Configure(L"game.exe -loglevel=error,ue:info,trace,ue:warn"));
+    CHECK(filter.Get(LogCategory::Ue) == LogLevel::Warn);
+    CHECK(filter.Get(LogCategory::Loader) == LogLevel::Trace);
+}
+
+TEST_CASE(AppliesValidItemsAndReportsTheRest)
+{
+    LogFilter filter;
+    CHECK(!filter.Configure(L"game.exe -loglevel=loud,hooks:trace,nosuch:info,spi:verbose,loader:error"));
+    CHECK(filter.Get(LogCategory::Hooks) == LogLevel::Trace);
+    CHECK(filter.Get(LogCategory::Loader) == LogLevel::Error);
+    CHECK(filter.Get(LogCategory::Spi) == LogFilter::DEFAULT_LEVEL);
+    CHECK(filter.Get(LogCategory::General) == LogFilter::DEFAULT_LEVEL);
+
+    LogFilter empty;
+    CHECK(!empty.Configure(L"game.exe -loglevel=info,,hooks:"));
+    CHECK(allAt(empty, LogLevel::Info));
+}
+
+TEST_CASE(StopsAtTheEndOfTheSwitch)
+{
+    LogFilter spaced;
+    CHECK(spaced.Configure(L"game.exe -loglevel=info -hooks:trace"));
+    CHECK(allAt(spaced, LogLevel::Info));
+
+    LogFilter quoted;
+    CHECK(quoted.Configure(L"\"game.exe\" -loglevel=warn,ue:trace\" rest"));
+    CHECK(quoted.Get(LogCategory::Ue) == LogLevel::Trace);
+    CHECK(quoted.Get(LogCategory::Hooks) == LogLevel::Warn);
+
+    // Only as its own switch, not inside another one.
+    LogFilter embedded;
+    CHECK(embedded.Configure(L"game.exe -xloglevel=error"));
+    CHECK(allAt(embedded, LogFilter::DEFAULT_LEVEL));
+}
+
+TEST_CASE(ParsesNamesCaseInsensitively)
+{
+    LogLevel level;
+    LogCategory category;
+    CHECK(LogFilter::ParseLevel(L"Trace", 5, &level) && level == LogLevel::Trace);
+    CHECK(LogFilter::ParseLevel(L"infox", 4, &level) && level == LogLevel::Info);
+    CHECK(!LogFilter::ParseLevel(L"inf", 3, &level));
+    CHECK(LogFilter::ParseCategory(L"LAUNCHER", 8, &category) && category == LogCategory::Launcher);
+    CHECK(!LogFilter::ParseCategory(L"hook", 4, &category));
+}
+
+TEST_CASE(FiltersLinesWithAndWithoutArguments)
+{
+    // Regression: GLOG_* without arguments expanded to GLOG_FAST(FMT, ), which only MSVC's old
+    // preprocessor accepted.
+    GLogger.Filter.Configure(L"game.exe -loglevel=warn,hooks:debug");
+    GLOG_INFO(Loader, L"filtered out");
+    GLOG_WARN(Loader, L"no arguments");
+    GLOG_DEBUG(Hooks, L"hook %d of %d", 1, 2);
+    GLOG_TRACE(Hooks, L"filtered out %d", 3);
+    GLOG(Error, Spi, L"leveled");
+    CHECK(GLogger.Lines == (std::vector<std::wstring>{ L"no arguments", L"hook 1 of 2", L"leveled" }));
+}
@@ -0,0 +1,178 @@
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "testing.h"
+#include "utils/namecache.h"
+
+
+namespace
+{
+    using Utils::NameCache;
+    using Utils::NameView;
+
+    // The text the game would decode for a value, unique per key.
+    std::wstring nameOf(uint64_t key)
+    {
+        return L"Name_" + std::to_wstring(static_cast<uint32_t>(key)) + L"_" + std::to_wstring(key >> 32);
+    }
+
+    bool holds(const NameView& view, uint64_t key)
+    {
+        auto expected = nameOf(key);
+        std::string narrow(expected.begin(), expected.end());
+        return view.Wide && expected == view.Wide && view.Length == expected.size()
+            && view.Narrow && narrow == view.Narrow;
+    }
+
+    struct Decoder
+    {
+        std::wstring Text;
+        size_t Calls = 0;
+
+        const wchar_t* operator()(uint64_t key)
+        {
+            Calls++;
+            Text = nameOf(key);
+            return Text.c_str();
+        }
+    };
+}
+
+
+TEST_CASE(DecodesEachNameOnce)
+{
+    NameCache cache;
+    Decoder decoder;
+    NameView first{}, again{}, found{};
+    CHECK(!cache.Find(5, found));
+    CHECK(cache.Get(5, decoder, first));
+    CHECK(cache.Get(5, decoder, again));
+    CHECK(decoder.Calls == 1);
+    CHECK(holds(first, 5));
+    CHECK(again.Wide == first.Wide && again.Narrow == first.Narrow);   // Interned, stable.
+    CHECK(cache.Find(5, found) && found.Wide == first.Wide);
+    CHECK(cache.Count() == 1);
+}
+
+TEST_CASE(KeepsUtf8AndLongNames)
+{
+    NameCache cache;
+    NameView view{};
+    const wchar_t* accented = L"Château_世";
+    CHECK(cache.Get(1, [accented](uint64_t) { return accented; }, view));
+    CHECK(std::string(view.Narrow) == "Ch\xC3\xA2teau_\xE4\xB8\x96");
+    CHECK(view.Length == 9);
+
+    // Bigger than a quarter chunk: allocated on its own.
+    std::wstring huge(NameCache::ARENA_CHUNK / 2, L'x');
+    CHECK(cache.Get(2, [&huge](uint64_t) { return huge.c_str(); }, view));
+    CHECK(view.Length == huge.size() && huge == view.Wide);
+    CHECK(cache.Get(1, [](uint64_t) { return L"not decoded again"; }, view));
+    CHECK(std::wstring(view.Wide) == accented);
+    CHECK(cache.ArenaBytes() >= huge.size() * sizeof(wchar_t));
+}
+
+TEST_CASE(DoesNotCacheFailuresOrTheReservedKey)
+{
+    NameCache cache;
+    NameView view{};
+    CHECK(!cache.Get(7, [](uint64_t) -> const wchar_t* { return nullptr; }, view));
+    CHECK(view.Wide == nullptr && view.Length == 0);
+    CHECK(cache.Count() == 0);
+
+    // ~0 marks empty slots, looking it up must not find one.
+    CHECK(!cache.Find(~0ull, view));
+    CHECK(!cache.Get(~0ull, [](uint64_t) { return L"Reserved"; }, view));
+    CHECK(std::wstring(view.Wide) == L"Reserved" && view.Narrow == nullptr);
+    CHECK(cache.Count() == 0);
+}
+
+TEST_CASE(HandsOutDecodedTextWhenFull)
+{
+    auto cache = std::make_unique<NameCache>();
+    Decoder decoder;
+    int wrong = 0;
+    size_t uncached = 0;
+    for (uint64_t key = 0; key < NameCache::KEY_SLOTS + 1000; key++)
+    {
+        NameView view{};
+        if (!cache->Get(key, decoder, view))
+        {
+            uncached++;
+            wrong += view.Narrow == nullptr && nameOf(key) == view.Wide ? 0 : 1;
+        }
+        else
+        {
+            wrong += holds(view, key) ? 0 : 1;
+        }
+    }
+    CHECK(wrong == 0);
+    CHECK(uncached >= 1000);
+    CHECK(cache->Count() + uncached == NameCache::KEY_SLOTS + 1000);
+}
+
+TEST_CASE(ServesLockFreeReadersWhileNamesArrive)
+{
+    // Game threads resolve overlapping sets of names, others only look them up: every view must be
+    // complete, and one value must always give the same interned strings.
+    auto cache = std::make_unique<NameCache>();
+    const uint64_t KEYS = 20000;
+    std::vector<std::atomic<const wchar_t*>> interned(KEYS);
+    std::atomic<int> wrong{ 0 };
+    std::atomic<int> writersDone{ 0 };
+    std::vector<std::thread> threads;
+
+    for (uint64_t t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&, t]()
+            {
+                Decoder decoder;
+                for (uint64_t i = 0; i < KEYS; i++)
+                {
+                    auto index = (i * (2 * t + 1) + t * 5003) % KEYS;   // A different order per thread.
+                    auto key = (index % 7) << 32 | index;
+                    NameView view{};
+                    if (!cache->Get(key, decoder, view) || !holds(view, key))
+                    {
+                        wrong++;
+                        continue;
+                    }
+                    const wchar_t* none = nullptr;
+                    if (!interned[index].compare_exchange_strong(none, view.Wide) && none != view.Wide)
+                    {
+                        wrong++;
+                    }
+                }
+                writersDone++;
+            });
+    }
+    for (uint64_t t = 0; t < 2; t++)
+    {
+        threads.emplace_back([&, t]()
+            {
+                for (uint64_t i = t; writersDone.load() < 4; i = (i + 7919) % KEYS)
+                {
+                    auto key = (i % 7) << 32 | i;
+                    NameView view{};
+                    if (cache->Find(key, view) && !holds(view, key))
+                    {
+                        wrong++;
+                    }
+                }
+            });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK(wrong == 0);
+    CHECK(cache->Count() == KEYS);
+    for (uint64_t index = 0; index < KEYS; index += 997)
+    {
+        NameView view{};
+        CHECK(cache->Find((index % 7) << 32 | index, view) && view.Wide == interned[index].load());
+    }
+}
@@ -0,0 +1,185 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "utils/namematch.h"
+
+
+namespace
+{
+    using Utils::NameIndexMatcher;
+
+    // A name table the way FName values address it: the index in the low half, the instance number
+    // (0 = none, N = "_N-1") in the high half.
+    struct NameTable
+    {
+        std::vector<std::wstring> Names;
+        std::wstring Decoded;
+        size_t Decodes = 0;
+
+        NameTable()
+        {
+            for (int i = 0; i < 5000; i++)
+            {
+                Names.push_back(L"Function_" + std::to_wstring(i));
+            }
+            Names[10] = L"ProcessEvent";
+            Names[20] = L"Tick";
+            Names[30] = L"PostRender";
+        }
+
+        static uint64_t Key(uint32_t index, uint32_t number = 0) { return (static_cast<uint64_t>(number) << 32) | index; }
+
+        const wchar_t* operator()(uint64_t key)
+        {
+            Decodes++;
+            auto index = static_cast<uint32_t>(key);
+            auto number = static_cast<uint32_t>(key >> 32);
+            if (index >= Names.size())
+            {
+                return nullptr;   // Not a valid name, e.g. a torn read.
+            }
+            Decoded = Names[index];
+            if (number != 0)
+            {
+                Decoded += L"_" + std::to_wstring(number - 1);
+            }
+            return Decoded.c_str();
+        }
+    };
+
+    int match(NameIndexMatcher& matcher, NameTable& table, uint64_t key)
+    {
+        return matcher.Match(key, [&table](uint64_t k) { return table(k); });
+    }
+}
+
+
+TEST_CASE(NumbersTargetsOnce)
+{
+    auto matcher = std::make_unique<NameIndexMatcher>();
+    CHECK(matcher->AddTarget(L"ProcessEvent") == 0);
+    CHECK(matcher->AddTarget(L"Tick") == 1);
+    CHECK(matcher->AddTarget(L"ProcessEvent") == 0);
+    CHECK(matcher->TargetCount() == 2);
+    CHECK(matcher->FindTarget(L"Tick") == 1);
+    CHECK(matcher->FindTarget(L"tick") == NameIndexMatcher::NO_MATCH);   // Names compare exactly.
+}
+
+TEST_CASE(DecodesEachValueOnce)
+{
+    auto matcher = std::make_unique<NameIndexMatcher>();
+    NameTable table;
+    matcher->AddTarget(L"ProcessEvent");
+    matcher->AddTarget(L"Tick");
+    matcher->AddTarget(L"Function_5_2");   // Only the value with that instance number.
+
+    // Calls cycle through a working set, as a hooked ProcessEvent sees them.
+    for (int round = 0; round < 50; round++)
+    {
+        for (uint32_t index = 0; index < 40; index++)
+        {
+            auto verdict = match(*matcher, table, NameTable::Key(index));
+            CHECK(verdict == (index == 10 ? 0 : index == 20 ? 1 : NameIndexMatcher::NO_MATCH));
+        }
+        CHECK(match(*matcher, table, NameTable::Key(5, 3)) == 2);
+        CHECK(match(*matcher, table, NameTable::Key(5, 2)) == NameIndexMatcher::NO_MATCH);
+    }
+    // 40 + 1, "Function_5_1" comes after the last target was seen and is never decoded.
+    CHECK(table.Decodes == 41);
+    CHECK(matcher->DecodeCount() == 41);
+    CHECK(matcher->AllResolved());
+}
+
+TEST_CASE(MissesWithoutDecodingOnceAllTargetsAreSeen)
+{
+    auto matcher = std::make_unique<NameIndexMatcher>();
+    NameTable table;
+    matcher->AddTarget(L"Tick");
+    matcher->AddTarget(L"PostRender");
+
+    CHECK(match(*matcher, table, NameTable::Key(1)) == NameIndexMatcher::NO_MATCH);
+    CHECK(match(*matcher, table, NameTable::Key(20)) == 0);
+    CHECK(!matcher->AllResolved());
+    CHECK(matcher->ResolvedCount() == 1);
+    CHECK(match(*matcher, table, NameTable::Key(30)) == 1);
+    CHECK(matcher->AllResolved());
+
+    // The early miss: values never seen before are not decoded any more.
+    auto decodes = table.Decodes;
+    for (uint32_t index = 100; index < 4000; index++)
+    {
+        CHECK(match(*matcher, table, NameTable::Key(index)) == NameIndexMatcher::NO_MATCH);
+    }
+    CHECK(table.Decodes == decodes);
+    CHECK(match(*matcher, table, NameTable::Key(20)) == 0);   // Known values still match.
+    CHECK(match(*matcher, table, NameTable::Key(30)) == 1);
+
+    // No targets at all: everything misses right away.
+    auto empty = std::make_unique<NameIndexMatcher>();
+    CHECK(empty->AllResolved());
+    CHECK(match(*empty, table, NameTable::Key(20)) == NameIndexMatcher::NO_MATCH);
+    CHECK(table.Decodes == decodes);
+}
+
+TEST_CASE(ReconsidersEveryValueForANewTarget)
+{
+    auto matcher = std::make_unique<NameIndexMatcher>();
+    NameTable table;
+    matcher->AddTarget(L"Tick");
+    CHECK(match(*matcher, table, NameTable::Key(20)) == 0);
+    CHECK(match(*matcher, table, NameTable::Key(10)) == NameIndexMatcher::NO_MATCH);   // Never decoded, all seen.
+    CHECK(table.Decodes == 1);
+
+    // A value that missed before can be the new target.
+    CHECK(matcher->AddTarget(L"ProcessEvent") == 1);
+    CHECK(!matcher->AllResolved());
+    CHECK(match(*matcher, table, NameTable::Key(10)) == 1);
+    CHECK(match(*matcher, table, NameTable::Key(20)) == 0);
+    CHECK(table.Decodes == 3);
+
+    // Adding an existing target keeps the verdicts.
+    matcher->AddTarget(L"Tick");
+    CHECK(matcher->AllResolved());
+    CHECK(match(*matcher, table, NameTable::Key(10)) == 1);
+    CHECK(table.Decodes == 3);
+}
+
+TEST_CASE(TreatsUnreadableNamesAsMisses)
+{
+    auto matcher = std::make_unique<NameIndexMatcher>();
+    NameTable table;
+    matcher->AddTarget(L"Tick");
+
+    CHECK(match(*matcher, table, NameTable::Key(999999)) == NameIndexMatcher::NO_MATCH);
+    CHECK(match(*matcher, table, NameTable::Key(999999)) == NameIndexMatcher::NO_MATCH);
+    CHECK(table.Decodes == 1);
+
+    // The reserved key (it marks empty slots) is never remembered, just decoded each time.
+    CHECK(match(*matcher, table, ~0ull) == NameIndexMatcher::NO_MATCH);
+    CHECK(match(*matcher, table, ~0ull) == NameIndexMatcher::NO_MATCH);
+    CHECK(table.Decodes == 3);
+    CHECK(matcher->ResolvedCount() == 0);
+}
+
+TEST_CASE(StaysCorrectWhenTheTableOverflows)
+{
+    // More distinct values than slots: the ones that don't fit are decoded again, never mismatched.
+    auto matcher = std::make_unique<NameIndexMatcher>();
+    NameTable table;
+    table.Names.assign(NameIndexMatcher::KEY_SLOTS + 20000, L"Filler");
+    table.Names.back() = L"Tick";
+    matcher->AddTarget(L"Tick");
+
+    int wrong = 0;
+    for (int round = 0; round < 2; round++)
+    {
+        for (uint32_t index = 0; index < table.Names.size(); index++)
+        {
+            auto expected = index == table.Names.size() - 1 ? 0 : NameIndexMatcher::NO_MATCH;
+            wrong += match(*matcher, table, NameTable::Key(index)) != expected ? 1 : 0;
+        }
+    }
+    CHECK(wrong == 0);
+    CHECK(table.Decodes > table.Names.size());
+}
@@ -0,0 +1,249 @@
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "testing.h"
+#include "utils/nativeregistry.h"
+
+
+namespace
+{
+    using Utils::NativeOverrideRegistry;
+
+    // Function names by FName value, as the Bind hook would decode them.
+    const wchar_t* NAMES[] = { L"None", L"Tick", L"PostRender", L"ProcessEvent", L"Activate" };
+    const size_t NAME_COUNT = sizeof(NAMES) / sizeof(NAMES[0]);
+
+    int nativeA, nativeB, nativeC, nativePlain;
+    void* const A = &nativeA;
+    void* const B = &nativeB;
+    void* const C = &nativeC;
+    void* const PLAIN = &nativePlain;
+    const int pluginOne = 1, pluginTwo = 2;
+
+    struct Binder
+    {
+        size_t NameDecodes = 0;
+        size_t OuterDecodes = 0;
+
+        void* Find(NativeOverrideRegistry& registry, uint64_t nameKey, const wchar_t* outer)
+        {
+            return registry.Find(nameKey,
+                [this](uint64_t key) -> const wchar_t* { NameDecodes++; return key < NAME_COUNT ? NAMES[key] : nullptr; },
+                [this, outer]() { OuterDecodes++; return outer; });
+        }
+
+        // What the Bind hook does: the original Bind has just set the engine's native.
+        void* Bind(NativeOverrideRegistry& registry, uint64_t nameKey, const wchar_t* outer, void*& func, void* engineNative)
+        {
+            func = engineNative;
+            return registry.Apply(nameKey,
+                [this](uint64_t key) -> const wchar_t* { NameDecodes++; return key < NAME_COUNT ? NAMES[key] : nullptr; },
+                [this, outer]() { OuterDecodes++; return outer; }, &func);
+        }
+    };
+
+    int engineTick, engineRender;
+    void* const ENGINE_TICK = &engineTick;
+    void* const ENGINE_RENDER = &engineRender;
+}
+
+
+TEST_CASE(RefusesIllFormedPathsAndDuplicates)
+{
+    auto registry = std::make_unique<NativeOverrideRegistry>();
+    CHECK(!registry->Register(nullptr, A, nullptr));
+    CHECK(!registry->Register(L"", A, nullptr));
+    CHECK(!registry->Register(L".Tick", A, nullptr));
+    CHECK(!registry->Register(L"Actor.", A, nullptr));
+    CHECK(!registry->Register(L"Tick", nullptr, nullptr));
+    CHECK(registry->Count() == 0);
+
+    CHECK(registry->Register(L"Tick", PLAIN, nullptr));
+    CHECK(registry->Register(L"Actor.Tick", A, &pluginOne));
+    CHECK(registry->Register(L"Pawn.Tick", B, &pluginOne));
+    CHECK(registry->Register(L"Engine.Pawn.Tick", C, &pluginTwo));   // The outer is everything up to the last dot.
+    CHECK(!registry->Register(L"Tick", B, &pluginTwo));
+    CHECK(!registry->Register(L"Actor.Tick", B, &pluginTwo));
+    CHECK(registry->Count() == 4);
+}
+
+TEST_CASE(PrefersAnOverrideForTheExactOuter)
+{
+    auto registry = std::make_unique<NativeOverrideRegistry>();
+    CHECK(registry->Register(L"Actor.Tick", A, nullptr));
+    CHECK(registry->Register(L"Tick", PLAIN, nullptr));
+    CHECK(registry->Register(L"Pawn.Tick", B, nullptr));
+    CHECK(registry->Register(L"Pawn.PostRender", C, nullptr));
+
+    Binder binder;
+    CHECK(binder.Find(*registry, 1, L"Actor") == A);
+    CHECK(binder.Find(*registry, 1, L"Pawn") == B);
+    CHECK(binder.Find(*registry, 1, L"Controller") == PLAIN);
+    CHECK(binder.Find(*registry, 1, nullptr) == PLAIN);   // Outer unreadable.
+    CHECK(binder.Find(*registry, 1, L"actor") == PLAIN);  // Outers compare exactly.
+    CHECK(binder.Find(*registry, 2, L"Pawn") == C);
+    CHECK(binder.Find(*registry, 2, L"Actor") == nullptr);
+    CHECK(binder.Find(*registry, 3, L"Actor") == nullptr);
+    CHECK(binder.NameDecodes == 2);   // Once per name value, and ProcessEvent not at all: every target was seen.
+}
+
+TEST_CASE(DecodesTheOuterOnlyWhenAnOverrideNeedsIt)
+{
+    auto registry = std::make_unique<NativeOverrideRegistry>();
+    CHECK(registry->Register(L"Tick", PLAIN, nullptr));
+    CHECK(registry->Register(L"Pawn.PostRender", C, nullptr));
+    CHECK(registry->Register(L"Actor.PostRender", A, nullptr));
+
+    Binder binder;
+    CHECK(binder.Find(*registry, 1, L"Pawn") == PLAIN);
+    CHECK(binder.Find(*registry, 3, L"Pawn") == nullptr);
+    CHECK(binder.OuterDecodes == 0);
+    CHECK(binder.Find(*registry, 2, L"Actor") == A);
+    CHECK(binder.OuterDecodes == 1);   // Once, though two overrides are tied to an outer.
+}
+
+TEST_CASE(UnregistersByPathAndByOwner)
+{
+    auto registry = std::make_unique<NativeOverrideRegistry>();
+    CHECK(registry->Register(L"Tick", PLAIN, nullptr));
+    CHECK(registry->Register(L"Actor.Tick", A, &pluginOne));
+    CHECK(registry->Register(L"Pawn.Tick", B, &pluginTwo));
+    CHECK(registry->Register(L"PostRender", C, &pluginOne));
+
+    Binder binder;
+    CHECK(registry->Unregister(L"Pawn.Tick"));
+    CHECK(!registry->Unregister(L"Pawn.Tick"));
+    CHECK(!registry->Unregister(L"Activate"));   // Never registered.
+    CHECK(!registry->Unregister(L"."));
+    CHECK(binder.Find(*registry, 1, L"Pawn") == PLAIN);
+    CHECK(registry->Count() == 3);
+
+    // A plugin going away takes its overrides along, the proxy's stay.
+    CHECK(registry->UnregisterOwnedBy(nullptr) == 0);
+    CHECK(registry->UnregisterOwnedBy(&pluginTwo) == 0);
+    CHECK(registry->UnregisterOwnedBy(&pluginOne) == 2);
+    CHECK(registry->Count() == 1);
+    CHECK(binder.Find(*registry, 1, L"Actor") == PLAIN);
+    CHECK(binder.Find(*registry, 2, L"Actor") == nullptr);
+
+    // The path can be taken again.
+    CHECK(registry->Register(L"Actor.Tick", B, &pluginTwo));
+    CHECK(binder.Find(*registry, 1, L"Actor") == B);
+}
+
+TEST_CASE(FindsNamesRegisteredAfterBinding)
+{
+    // The game binds before plugins load: names that missed then must be matched again.
+    auto registry = std::make_unique<NativeOverrideRegistry>();
+    CHECK(registry->Register(L"Tick", PLAIN, nullptr));
+
+    Binder binder;
+    CHECK(binder.Find(*registry, 1, L"Actor") == PLAIN);
+    CHECK(binder.Find(*registry, 4, L"Actor") == nullptr);   // All targets seen: not even decoded.
+    CHECK(binder.NameDecodes == 1);
+
+    CHECK(registry->Register(L"Activate", A, &pluginOne));
+    CHECK(binder.Find(*registry, 4, L"Actor") == A);
+    CHECK(binder.Find(*registry, 1, L"Actor") == PLAIN);
+    CHECK(binder.NameDecodes == 3);
+
+    // Registering a name that is already a target keeps the verdicts.
+    CHECK(registry->Register(L"Actor.Tick", B, &pluginOne));
+    CHECK(binder.Find(*registry, 1, L"Actor") == B);
+    CHECK(binder.NameDecodes == 3);
+}
+
+TEST_CASE(RegistersWhileTheGameBinds)
+{
+    auto registry = std::make_unique<NativeOverrideRegistry>();
+    CHECK(registry->Register(L"Tick", PLAIN, nullptr));
+
+    std::atomic<bool> stop{ false };
+    std::atomic<int> wrong{ 0 };
+    std::thread game([&registry, &stop, &wrong]()
+        {
+            Binder binder;
+            while (!stop.load())
+            {
+                auto native = binder.Find(*registry, 1, L"Actor");
+                if (native != PLAIN && native != A)
+                {
+                    wrong++;
+                }
+                if (binder.Find(*registry, 3, L"Actor") != nullptr)
+                {
+                    wrong++;
+                }
+            }
+        });
+
+    for (int i = 0; i < 2000; i++)
+    {
+        CHECK(registry->Register(L"Actor.Tick", A, &pluginOne));
+        CHECK(registry->Register(L"Pawn.PostRender", C, &pluginOne));
+        CHECK(registry->UnregisterOwnedBy(&pluginOne) == 2);
+    }
+    stop.store(true);
+    game.join();
+    CHECK(wrong == 0);
+    CHECK(registry->Count() == 1);
+}
+
+TEST_CASE(RestoresBoundFunctionsWhenOverridesGoAway)
+{
+    // Regression: functions bound to a plugin's native kept calling it after the plugin was unloaded.
+    auto registry = std::make_unique<NativeOverrideRegistry>();
+    CHECK(registry->Register(L"Tick", PLAIN, nullptr));
+    CHECK(registry->Register(L"Actor.Tick", A, &pluginOne));
+    CHECK(registry->Register(L"PostRender", C, &pluginOne));
+
+    Binder binder;
+    void* actorTick = nullptr;
+    void* pawnTick = nullptr;
+    void* actorRender = nullptr;
+    void* actorActivate = nullptr;
+    CHECK(binder.Bind(*registry, 1, L"Actor", actorTick, ENGINE_TICK) == A && actorTick == A);
+    CHECK(binder.Bind(*registry, 1, L"Pawn", pawnTick, ENGINE_TICK) == PLAIN && pawnTick == PLAIN);
+    CHECK(binder.Bind(*registry, 2, L"Actor", actorRender, ENGINE_RENDER) == C);
+    CHECK(binder.Bind(*registry, 4, L"Actor", actorActivate, ENGINE_TICK) == nullptr && actorActivate == ENGINE_TICK);
+    CHECK(registry->AppliedCount() == 3);
+
+    CHECK(registry->UnregisterOwnedBy(&pluginOne) == 2);
+    CHECK(actorTick == ENGINE_TICK && actorRender == ENGINE_RENDER);
+    CHECK(pawnTick == PLAIN);   // The proxy's own stays.
+    CHECK(registry->AppliedCount() == 1);
+
+    // Unregistering by path restores too.
+    CHECK(registry->Unregister(L"Tick"));
+    CHECK(pawnTick == ENGINE_TICK);
+    CHECK(registry->AppliedCount() == 0);
+}
+
+TEST_CASE(LeavesSlotsChangedSinceAlone)
+{
+    auto registry = std::make_unique<NativeOverrideRegistry>();
+    CHECK(registry->Register(L"Tick", A, &pluginOne));
+
+    Binder binder;
+    void* rebound = nullptr;
+    void* replaced = nullptr;
+    binder.Bind(*registry, 1, L"Actor", rebound, ENGINE_TICK);
+    binder.Bind(*registry, 1, L"Pawn", replaced, ENGINE_TICK);
+
+    // Rebound after the override went and came back under another plugin: that one's record counts.
+    CHECK(registry->Unregister(L"Tick"));
+    CHECK(registry->Register(L"Tick", B, &pluginTwo));
+    CHECK(binder.Bind(*registry, 1, L"Actor", rebound, ENGINE_TICK) == B);
+
+    // Something else wrote the slot (or the function's memory was reused): not ours to put back.
+    replaced = C;
+    binder.Bind(*registry, 1, L"Pawn", replaced, ENGINE_TICK);
+    replaced = C;
+    CHECK(registry->UnregisterOwnedBy(&pluginOne) == 0);
+    CHECK(registry->UnregisterOwnedBy(&pluginTwo) == 1);
+    CHECK(rebound == ENGINE_TICK);
+    CHECK(replaced == C);
+    CHECK(registry->AppliedCount() == 0);
+}
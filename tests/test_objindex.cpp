@@ -0,0 +1,208 @@
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "utils/objindex.h"
+
+
+namespace
+{
+    using Utils::ObjectPathIndex;
+
+    struct Object
+    {
+        size_t Index;
+        const Object* Outer;
+        std::wstring Name;
+        uint64_t NameKey;   // Stands in for the FName value.
+    };
+
+    // A synthetic GObjects: packages with classes and functions, slots freed and reused like after GC.
+    struct World
+    {
+        std::vector<std::unique_ptr<Object>> Storage;
+        std::vector<const void*> Array;
+
+        const Object* Add(const Object* outer, const std::wstring& name)
+        {
+            Storage.push_back(std::make_unique<Object>(Object{ Array.size(), outer, name, std::hash<std::wstring>()(name) }));
+            Array.push_back(Storage.back().get());
+            return Storage.back().get();
+        }
+
+        const Object* Replace(size_t index, const Object* outer, const std::wstring& name)
+        {
+            Storage.push_back(std::make_unique<Object>(Object{ index, outer, name, std::hash<std::wstring>()(name) }));
+            Array[index] = Storage.back().get();
+            return Storage.back().get();
+        }
+
+        size_t Update(ObjectPathIndex& index) const
+        {
+            return index.Update(Array.size(),
+                [this](size_t i) { return Array[i]; },
+                [](const void* object) -> const void* { return static_cast<const Object*>(object)->Outer; },
+                [](const void* object) { return static_cast<const Object*>(object)->Index; },
+                [](const void* object) { return static_cast<const Object*>(object)->Name.c_str(); },
+                [](const void* object) { return static_cast<const Object*>(object)->NameKey; });
+        }
+
+        const void* Find(const ObjectPathIndex& index, const wchar_t* path) const
+        {
+            return index.Find(path,
+                [this](size_t i) { return i < Array.size() ? Array[i] : nullptr; },
+                [](const void* object) -> const void* { return static_cast<const Object*>(object)->Outer; },
+                [](const void* object) { return static_cast<const Object*>(object)->Name.c_str(); });
+        }
+
+        bool Validate(size_t count, size_t minObjects = 8) const
+        {
+            return ObjectPathIndex::ValidateObjectArray(Array.data(), count, sizeof(Object),
+                [](const void*, size_t) { return true; },
+                [](const void* object) { return static_cast<const Object*>(object)->Index; }, 32, minObjects);
+        }
+    };
+}
+
+
+TEST_CASE(FindsObjectsByPathIgnoringCase)
+{
+    World world;
+    auto engine = world.Add(nullptr, L"Engine");
+    auto actor = world.Add(engine, L"Actor");
+    auto tick = world.Add(actor, L"Tick");
+    world.Add(nullptr, L"BioGame");
+
+    ObjectPathIndex index;
+    CHECK(world.Update(index) == 4);
+    CHECK(world.Find(index, L"Engine.Actor.Tick") == tick);
+    CHECK(world.Find(index, L"engine.ACTOR.tick") == tick);
+    CHECK(world.Find(index, L"Engine.Actor") == actor);
+    CHECK(world.Find(index, L"Actor.Tick") == nullptr);        // Full paths only.
+    CHECK(world.Find(index, L"Engine.Actor.Tick.") == nullptr);
+    CHECK(world.Find(index, nullptr) == nullptr);
+    CHECK(world.Update(index) == 0);
+}
+
+TEST_CASE(FollowsAppendedAndReusedSlots)
+{
+    World world;
+    auto package = world.Add(nullptr, L"Pkg");
+    auto old = world.Add(package, L"Old");
+    ObjectPathIndex index;
+    world.Update(index);
+    CHECK(world.Find(index, L"Pkg.Old") == old);
+
+    // Collected, and its slot reused.
+    auto reused = world.Replace(old->Index, package, L"New");
+    auto appended = world.Add(package, L"Later");
+    CHECK(world.Update(index) == 2);
+    CHECK(world.Find(index, L"Pkg.Old") == nullptr);
+    CHECK(world.Find(index, L"Pkg.New") == reused);
+    CHECK(world.Find(index, L"Pkg.Later") == appended);
+
+    // Emptied slots and a shrunk array.
+    world.Array[reused->Index] = nullptr;
+    world.Array.pop_back();
+    CHECK(world.Update(index) == 2);
+    CHECK(world.Find(index, L"Pkg.New") == nullptr);
+    CHECK(world.Find(index, L"Pkg.Later") == nullptr);
+    CHECK(world.Find(index, L"Pkg") == package);
+}
+
+// Regression: Find compared paths of indexed objects the array no longer held, reading freed memory.
+TEST_CASE(DoesNotReadObjectsCollectedSinceTheLastUpdate)
+{
+    World world;
+    auto package = world.Add(nullptr, L"Pkg");
+    auto old = world.Add(package, L"Old");
+    ObjectPathIndex index;
+    world.Update(index);
+
+    auto slot = old->Index;
+    auto reused = world.Replace(slot, package, L"New");
+    for (auto& object : world.Storage)
+    {
+        if (object.get() == old) object.reset();   // Freed, a read shows up under ASan.
+    }
+    CHECK(world.Find(index, L"Pkg.Old") == nullptr);
+    CHECK(world.Find(index, L"Pkg.New") == nullptr);   // Not indexed yet.
+
+    world.Array.pop_back();                            // Gone with the array shrinking, too.
+    CHECK(world.Find(index, L"Pkg.Old") == nullptr);
+    world.Array.push_back(reused);
+    CHECK(world.Update(index) == 1);
+    CHECK(world.Find(index, L"Pkg.New") == reused);
+}
+
+// Regression: a slot whose pointer didn't change was skipped, an object reallocated at the same
+// address kept the previous one's path.
+TEST_CASE(ReindexesObjectsReallocatedInPlace)
+{
+    World world;
+    auto engine = world.Add(nullptr, L"Engine");
+    auto core = world.Add(nullptr, L"Core");
+    auto object = const_cast<Object*>(world.Add(engine, L"Actor"));
+    ObjectPathIndex index;
+    world.Update(index);
+
+    object->Name = L"Pawn";
+    object->NameKey = std::hash<std::wstring>()(object->Name);
+    CHECK(world.Update(index) == 1);
+    CHECK(world.Find(index, L"Engine.Actor") == nullptr);
+    CHECK(world.Find(index, L"Engine.Pawn") == object);
+
+    object->Outer = core;
+    CHECK(world.Update(index) == 1);
+    CHECK(world.Find(index, L"Engine.Pawn") == nullptr);
+    CHECK(world.Find(index, L"Core.Pawn") == object);
+    CHECK(world.Update(index) == 0);
+}
+
+TEST_CASE(AcceptsOnlyArraysOfObjectsAtTheirOwnIndex)
+{
+    World world;
+    auto package = world.Add(nullptr, L"Core");
+    for (int i = 0; i < 1000; i++)
+    {
+        world.Add(package, L"Object" + std::to_wstring(i));
+    }
+    CHECK(world.Validate(world.Array.size()));
+
+    // Holes are fine, engines free slots.
+    for (size_t i = 0; i < world.Array.size(); i += 3)
+    {
+        world.Array[i] = nullptr;
+    }
+    CHECK(world.Validate(world.Array.size()));
+
+    // One object elsewhere than it says, or too few objects, is not an object array.
+    std::swap(world.Array[0], world.Array[1000]);   // Both probed, 1000 is the last slot.
+    CHECK(!world.Validate(world.Array.size()));
+    std::swap(world.Array[0], world.Array[1000]);
+    CHECK(!world.Validate(0));
+    CHECK(!world.Validate(4));   // Only four slots to probe.
+    CHECK(world.Validate(4, 2));
+
+    std::vector<const void*> pointers(1000, &world);   // Anything else that's pointer-shaped.
+    CHECK(!ObjectPathIndex::ValidateObjectArray(pointers.data(), pointers.size(), sizeof(Object),
+        [](const void*, size_t) { return true; },
+        [](const void* object) { return static_cast<const Object*>(object)->Index; }));
+}
+
+TEST_CASE(NeverReadsWhatIsNotReadable)
+{
+    World world;
+    for (int i = 0; i < 100; i++)
+    {
+        world.Add(nullptr, L"Package" + std::to_wstring(i));
+    }
+    auto unreadable = world.Array[50];
+    size_t reads = 0;
+    auto accepted = ObjectPathIndex::ValidateObjectArray(world.Array.data(), world.Array.size(), sizeof(Object),
+        [unreadable](const void* pointer, size_t) { return pointer != unreadable; },
+        [&reads](const void* object) { reads++; return static_cast<const Object*>(object)->Index; });
+    CHECK(!accepted);
+    CHECK(reads == 16);   // Probes 0 to 15 (slots 0 to 46), probe 16 is slot 50.
+}
@@ -0,0 +1,258 @@
+#include <chrono>
+#include <dlfcn.h>
+#include <fstream>
+#include <future>
+#include <string>
+#include "mock_plugin.h"
+#include "testing.h"
+#include "utils/pluginlife.h"
+
+
+namespace
+{
+    using Utils::PluginState;
+    using Utils::ReloadResult;
+
+    // A plugin record as the ASI loader keeps it, over dlopen instead of LoadLibrary.
+    struct MockPlugin
+    {
+        std::string Path;
+        PluginState State = PluginState::Unloaded;
+        int Generation = 0;
+
+        void* Library = nullptr;
+        tMockOnAttach OnAttach = nullptr;
+        tMockOnDetach OnDetach = nullptr;
+        tMockShouldSpawnThread ShouldSpawnThread = nullptr;
+        tMockAttachCount AttachCount = nullptr;
+        std::future<bool> AttachThread;
+    };
+
+    // The loader side: shadow copies per generation like the hot reload, async attach on a std::thread.
+    struct DlopenHost
+    {
+        MockHost Mock;
+        bool FailLoad = false;
+        bool FailRegister = false;
+        bool FailRelease = false;
+        int Releases = 0;
+        int Unloads = 0;
+
+        bool AttachRunning(MockPlugin& plugin, uint32_t waitMs)
+        {
+            if (!plugin.AttachThread.valid())
+            {
+                return false;
+            }
+            if (plugin.AttachThread.wait_for(std::chrono::milliseconds(waitMs)) == std::future_status::timeout)
+            {
+                return true;
+            }
+            plugin.AttachThread.get();
+            return false;
+        }
+
+        bool Detach(MockPlugin& plugin) { return plugin.OnDetach(&Mock); }
+        bool Release(MockPlugin&)
+        {
+            Releases++;
+            return !FailRelease;
+        }
+
+        bool Unload(MockPlugin& plugin)
+        {
+            Unloads++;
+            auto rc = dlclose(plugin.Library);
+            plugin.Library = nullptr;
+            return rc == 0;
+        }
+
+        bool Load(MockPlugin& plugin, int generation)
+        {
+            if (FailLoad)
+            {
+                return false;
+            }
+            auto shadow = std::string(MOCK_SHADOW_DIR) + "/mock_shadow." + std::to_string(generation) + "."
+                + std::to_string(reinterpret_cast<uintptr_t>(&plugin)) + ".so";
+            {
+                std::ifstream from(plugin.Path, std::ios::binary);
+                std::ofstream to(shadow, std::ios::binary | std::ios::trunc);
+                to << from.rdbuf();
+            }
+            plugin.Library = dlopen(shadow.c_str(), RTLD_NOW | RTLD_LOCAL);
+            plugin.OnAttach = nullptr;
+            plugin.OnDetach = nullptr;
+            plugin.ShouldSpawnThread = nullptr;
+            plugin.AttachCount = nullptr;
+            return plugin.Library != nullptr;
+        }
+
+        bool Register(MockPlugin& plugin)
+        {
+            plugin.OnAttach = reinterpret_cast<tMockOnAttach>(dlsym(plugin.Library, "SpiOnAttach"));
+            plugin.OnDetach = reinterpret_cast<tMockOnDetach>(dlsym(plugin.Library, "SpiOnDetach"));
+            plugin.ShouldSpawnThread = reinterpret_cast<tMockShouldSpawnThread>(dlsym(plugin.Library, "SpiShouldSpawnThread"));
+            plugin.AttachCount = reinterpret_cast<tMockAttachCount>(dlsym(plugin.Library, "MockAttachCount"));
+            return !FailRegister && plugin.OnAttach && plugin.OnDetach && plugin.ShouldSpawnThread && plugin.AttachCount;
+        }
+
+        bool Attach(MockPlugin& plugin)
+        {
+            if (plugin.ShouldSpawnThread())
+            {
+                plugin.AttachThread = std::async(std::launch::async, plugin.OnAttach, &Mock);
+                return true;
+            }
+            return plugin.OnAttach(&Mock);
+        }
+    };
+
+    void waitForAttach(DlopenHost& host, MockPlugin& plugin)
+    {
+        CHECK(!host.AttachRunning(plugin, 5000));
+    }
+}
+
+
+TEST_CASE(ReloadsSyncPluginIntoAFreshCopy)
+{
+    DlopenHost host;
+    MockPlugin plugin;
+    plugin.Path = MOCK_SYNC_PATH;
+
+    REQUIRE(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::Reloaded);   // First load, from Unloaded.
+    CHECK(plugin.State == PluginState::Attached && plugin.Generation == 1);
+    CHECK(host.Unloads == 0 && host.Mock.Attached == 1);
+    CHECK(plugin.AttachCount() == 1);
+
+    REQUIRE(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::Reloaded);
+    CHECK(plugin.State == PluginState::Attached && plugin.Generation == 2);
+    CHECK(host.Mock.Detached == 1 && host.Releases == 1 && host.Unloads == 1);
+    CHECK(host.Mock.Attached == 2);
+    CHECK(plugin.AttachCount() == 1);   // The new copy only saw its own attach.
+
+    bool detached = false;
+    CHECK(Utils::DetachPlugin(plugin, host, 0, &detached) && detached);
+    CHECK(plugin.State == PluginState::Detached && host.Mock.Detached == 2);
+    CHECK(!Utils::DetachPlugin(plugin, host, 0));   // Only once.
+    dlclose(plugin.Library);
+}
+
+TEST_CASE(RefusesToUnloadAPluginWhileItsAsyncAttachRuns)
+{
+    DlopenHost host;
+    MockPlugin plugin;
+    plugin.Path = MOCK_ASYNC_PATH;
+
+    host.Mock.HoldAttach = true;
+    REQUIRE(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::Reloaded);
+    CHECK(plugin.State == PluginState::Attached && plugin.AttachThread.valid());
+
+    auto library = plugin.Library;
+    CHECK(Utils::ReloadPlugin(plugin, host, 20) == ReloadResult::AttachRunning);
+    CHECK(plugin.Library == library && plugin.Generation == 1);
+    CHECK(host.Unloads == 0 && host.Releases == 0 && host.Mock.Detached == 0);
+
+    // Shutdown doesn't detach it either.
+    CHECK(!Utils::DetachPlugin(plugin, host, 0));
+    CHECK(host.Mock.Detached == 0 && plugin.State == PluginState::Attached);
+
+    // Once attach returns, the reload goes through.
+    host.Mock.HoldAttach = false;
+    REQUIRE(Utils::ReloadPlugin(plugin, host, 5000) == ReloadResult::Reloaded);
+    CHECK(host.Mock.Detached == 1 && host.Unloads == 1 && plugin.Generation == 2);
+    waitForAttach(host, plugin);
+    CHECK(host.Mock.Attached == 2 && plugin.AttachCount() == 1);
+
+    CHECK(Utils::DetachPlugin(plugin, host, 1000));
+    dlclose(plugin.Library);
+}
+
+TEST_CASE(RecoversFromALoadFailure)
+{
+    DlopenHost host;
+    MockPlugin plugin;
+    plugin.Path = MOCK_SYNC_PATH;
+    REQUIRE(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::Reloaded);
+
+    host.FailLoad = true;
+    CHECK(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::LoadFailed);
+    CHECK(plugin.State == PluginState::Unloaded && plugin.Generation == 1);
+    CHECK(host.Unloads == 1 && host.Mock.Detached == 1);
+    CHECK(!Utils::DetachPlugin(plugin, host, 0));   // Nothing left to detach.
+
+    // The next attempt starts from Unloaded: nothing is released or unloaded twice.
+    host.FailLoad = false;
+    CHECK(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::Reloaded);
+    CHECK(host.Unloads == 1 && host.Releases == 1 && plugin.Generation == 2);
+    CHECK(host.Mock.Attached == 2);
+
+    Utils::DetachPlugin(plugin, host, 0);
+    dlclose(plugin.Library);
+}
+
+TEST_CASE(KeepsAPluginWhichFailsToRegisterLoadedButNotAttached)
+{
+    DlopenHost host;
+    MockPlugin plugin;
+    plugin.Path = MOCK_SYNC_PATH;
+
+    host.FailRegister = true;
+    CHECK(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::RegisterFailed);
+    CHECK(plugin.State == PluginState::Loaded && plugin.Library != nullptr);
+    CHECK(host.Mock.Attached == 0);
+
+    // Never attached, so never detached.
+    CHECK(!Utils::DetachPlugin(plugin, host, 0));
+    CHECK(host.Mock.Detached == 0);
+
+    // A later reload still unloads it.
+    host.FailRegister = false;
+    CHECK(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::Reloaded);
+    CHECK(host.Unloads == 1 && host.Releases == 1 && host.Mock.Detached == 0);
+
+    Utils::DetachPlugin(plugin, host, 0);
+    dlclose(plugin.Library);
+}
+
+TEST_CASE(KeepsAPluginLoadedWhileTheHostStillHoldsItsHooks)
+{
+    DlopenHost host;
+    MockPlugin plugin;
+    plugin.Path = MOCK_SYNC_PATH;
+    REQUIRE(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::Reloaded);
+    auto library = plugin.Library;
+
+    // Regression: the library was freed with detours into it still installed.
+    host.FailRelease = true;
+    CHECK(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::ReleaseFailed);
+    CHECK(plugin.State == PluginState::Detached && plugin.Library == library);
+    CHECK(host.Unloads == 0 && host.Mock.Detached == 1 && plugin.Generation == 1);
+
+    // The next reload releases it without detaching it again.
+    host.FailRelease = false;
+    CHECK(Utils::ReloadPlugin(plugin, host, 0) == ReloadResult::Reloaded);
+    CHECK(host.Releases == 2 && host.Unloads == 1 && host.Mock.Detached == 1);
+    CHECK(plugin.Generation == 2 && host.Mock.Attached == 2);
+
+    Utils::DetachPlugin(plugin, host, 0);
+    dlclose(plugin.Library);
+}
+
+TEST_CASE(BatchesPluginChanges)
+{
+    Utils::ReloadBatch batch;
+    CHECK(batch.Empty());
+    CHECK(batch.Add(L"Mod.asi"));
+    CHECK(!batch.Add(L"Mod.asi"));
+    CHECK(batch.Add(L"Sub\\Other.ASI"));
+    CHECK(!batch.Add(L".shadow\\Mod.1.asi"));
+    CHECK(!batch.Add(L"Mod.asi.tmp"));
+    CHECK(!batch.Add(L"asi"));
+
+    auto paths = batch.Take();
+    CHECK(paths == (std::vector<std::wstring>{ L"Mod.asi", L"Sub\\Other.ASI" }));
+    CHECK(batch.Empty());
+    CHECK(batch.Add(L"Mod.asi"));
+}
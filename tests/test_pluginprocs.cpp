@@ -0,0 +1,173 @@
+#include <map>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "utils/pluginprocs.h"
+
+
+namespace
+{
+    struct MockInterface
+    {
+    };
+
+    typedef Utils::PluginProcs<MockInterface> MockProcs;
+    using Utils::PluginRegistration;
+
+    const int PROXY_VERSION = 4;
+    const int GAME_LE1 = 1 << 1;
+    const int GAME_LE2 = 1 << 2;
+
+    int GPreloadCalls = 0;
+    int GDeclaredMinVersion = 2;
+    int GDeclaredGames = GAME_LE1;
+
+    wchar_t GName[] = L"Mock";
+    void supportDecl(wchar_t** name, wchar_t** author, wchar_t** version, int* gameIndex, int* spiMinVersion)
+    {
+        *name = GName;
+        *author = GName;
+        *version = GName;
+        *gameIndex = GDeclaredGames;
+        *spiMinVersion = GDeclaredMinVersion;
+    }
+
+    bool yes() { GPreloadCalls++; return true; }
+    bool no() { GPreloadCalls++; return false; }
+    bool attach(MockInterface*) { return true; }
+
+    // An export table, as GetProcAddress would see it.
+    struct Exports
+    {
+        std::map<std::string, void*> Procs;
+        std::vector<std::string> Missing;
+
+        static Exports Spi(bool (*preload)(), bool (*spawnThread)())
+        {
+            Exports exports;
+            exports.Procs["SpiSupportDecl"] = reinterpret_cast<void*>(&supportDecl);
+            exports.Procs["SpiShouldPreload"] = reinterpret_cast<void*>(preload);
+            exports.Procs["SpiShouldSpawnThread"] = reinterpret_cast<void*>(spawnThread);
+            exports.Procs["SpiOnAttach"] = reinterpret_cast<void*>(&attach);
+            exports.Procs["SpiOnDetach"] = reinterpret_cast<void*>(&attach);
+            return exports;
+        }
+
+        PluginRegistration Register(MockProcs& procs, int gameBit = GAME_LE1)
+        {
+            return procs.Register(
+                [this](const char* name) { auto it = Procs.find(name); return it == Procs.end() ? nullptr : it->second; },
+                [this](const char* name) { Missing.emplace_back(name); },
+                PROXY_VERSION, gameBit);
+        }
+    };
+
+    void resetDeclaration()
+    {
+        GPreloadCalls = 0;
+        GDeclaredMinVersion = 2;
+        GDeclaredGames = GAME_LE1;
+    }
+}
+
+
+TEST_CASE(LeavesPluginsWithoutSpiSupportDeclRaw)
+{
+    resetDeclaration();
+    Exports exports;
+    exports.Procs["SpiOnAttach"] = reinterpret_cast<void*>(&attach);
+
+    MockProcs procs;
+    CHECK(exports.Register(procs) == PluginRegistration::Raw);
+    CHECK(!procs.SupportsSPI());
+    CHECK(!procs.ShouldPreload() && !procs.ShouldPostload() && !procs.ShouldSpawnThread());
+    CHECK(exports.Missing.empty());   // Not an error, nothing else is looked up.
+    CHECK(procs.OnAttach == nullptr);
+}
+
+TEST_CASE(RejectsPluginsMissingSomeSpiProcs)
+{
+    resetDeclaration();
+    auto exports = Exports::Spi(&yes, &no);
+    exports.Procs.erase("SpiShouldSpawnThread");
+    exports.Procs.erase("SpiOnDetach");
+
+    MockProcs procs;
+    CHECK(exports.Register(procs) == PluginRegistration::MissingProcs);
+    CHECK(exports.Missing == (std::vector<std::string>{ "SpiShouldSpawnThread", "SpiOnDetach" }));
+    CHECK(!procs.SupportsSPI());
+    CHECK(procs.PluginName == nullptr);   // SpiSupportDecl wasn't called.
+    CHECK(GPreloadCalls == 0);
+}
+
+TEST_CASE(ChecksTheDeclaredVersionAndGame)
+{
+    resetDeclaration();
+    auto exports = Exports::Spi(&yes, &no);
+
+    GDeclaredMinVersion = 1;   // Pre-SPI versions aren't valid.
+    MockProcs tooOld;
+    CHECK(exports.Register(tooOld) == PluginRegistration::BadVersion);
+
+    GDeclaredMinVersion = PROXY_VERSION + 1;
+    MockProcs tooNew;
+    CHECK(exports.Register(tooNew) == PluginRegistration::BadVersion);
+
+    GDeclaredMinVersion = PROXY_VERSION;
+    MockProcs otherGame;
+    CHECK(exports.Register(otherGame, GAME_LE2) == PluginRegistration::WrongGame);
+    MockProcs unknownGame;
+    CHECK(exports.Register(unknownGame, 0) == PluginRegistration::WrongGame);
+    CHECK(GPreloadCalls == 0);   // Flags aren't asked from filtered out plugins.
+
+    GDeclaredGames = GAME_LE1 | GAME_LE2;
+    MockProcs accepted;
+    CHECK(exports.Register(accepted, GAME_LE2) == PluginRegistration::Spi);
+    CHECK(accepted.SupportsSPI() && accepted.MinInterfaceVersion == PROXY_VERSION);
+    CHECK(std::wstring(accepted.PluginName) == L"Mock");
+}
+
+TEST_CASE(ResolvesFlagsOncePerPlugin)
+{
+    resetDeclaration();
+    auto preloadAsync = Exports::Spi(&yes, &yes);
+    auto postloadSync = Exports::Spi(&no, &no);
+
+    // Regression: the answers used to be cached in a static shared by every plugin.
+    MockProcs first;
+    MockProcs second;
+    CHECK(preloadAsync.Register(first) == PluginRegistration::Spi);
+    CHECK(postloadSync.Register(second) == PluginRegistration::Spi);
+    CHECK(GPreloadCalls == 4);
+
+    CHECK(first.ShouldPreload() && !first.ShouldPostload() && first.ShouldSpawnThread());
+    CHECK(!second.ShouldPreload() && second.ShouldPostload() && !second.ShouldSpawnThread());
+
+    first.ResolveFlags();
+    second.ResolveFlags();
+    CHECK(GPreloadCalls == 4);   // Only the first call reaches the plugin.
+}
+
+TEST_CASE(PartitionsPluginsByAttachPoint)
+{
+    resetDeclaration();
+    auto preload = Exports::Spi(&yes, &no);
+    auto postload = Exports::Spi(&no, &yes);
+    auto missing = Exports::Spi(&yes, &no);
+    missing.Procs.erase("SpiOnAttach");
+    Exports raw;
+
+    std::vector<MockProcs> plugins(6);
+    postload.Register(plugins[0]);
+    raw.Register(plugins[1]);
+    preload.Register(plugins[2]);
+    missing.Register(plugins[3]);
+    preload.Register(plugins[4]);
+    postload.Register(plugins[5]);
+
+    std::vector<size_t> pre{ 99 };
+    std::vector<size_t> post{ 99 };
+    Utils::PartitionPlugins(plugins, pre, post);
+    CHECK(pre == (std::vector<size_t>{ 2, 4 }));
+    CHECK(post == (std::vector<size_t>{ 0, 5 }));
+}
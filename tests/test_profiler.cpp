@@ -0,0 +1,139 @@
+#include <cstring>
+#include <memory>
+#include <string>
+#include "testing.h"
+#include "utils/profiler.h"
+
+
+namespace
+{
+    using Utils::ThreadTraceBuffer;
+    using Utils::TraceCategory;
+
+    std::unique_ptr<ThreadTraceBuffer> makeBuffer(uint32_t threadId, ThreadTraceBuffer* next = nullptr)
+    {
+        auto buffer = std::make_unique<ThreadTraceBuffer>();
+        buffer->ThreadId = threadId;
+        buffer->Next = next;
+        return buffer;
+    }
+
+    void push(ThreadTraceBuffer& buffer, TraceCategory category, const char* name, int64_t start, int64_t end, const char* detail = "")
+    {
+        buffer.Push(category, name, start, end, [detail](char* eventDetail, size_t size)
+            {
+                strncpy(eventDetail, detail, size - 1);
+                eventDetail[size - 1] = '\0';
+            });
+    }
+
+    // Export through a temporary file, the way the proxy writes its trace.
+    std::string exportTrace(const ThreadTraceBuffer* buffers, size_t* outWritten = nullptr, int64_t origin = 0, int64_t frequency = 1000000)
+    {
+        auto file = tmpfile();
+        auto written = Utils::WriteChromeTraceEvents(file, buffers, 42, origin, frequency);
+        if (outWritten)
+        {
+            *outWritten = written;
+        }
+
+        std::string text(static_cast<size_t>(ftell(file)), '\0');
+        rewind(file);
+        auto read = fread(&text[0], 1, text.size(), file);
+        fclose(file);
+        text.resize(read);
+        return text;
+    }
+
+    size_t occurrences(const std::string& text, const std::string& needle)
+    {
+        size_t count = 0;
+        for (auto at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1))
+        {
+            count++;
+        }
+        return count;
+    }
+}
+
+
+TEST_CASE(WritesAnEmptyTraceAsAValidDocument)
+{
+    size_t written = 1;
+    auto text = exportTrace(nullptr, &written);
+    CHECK(written == 0);
+    CHECK(text == "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n]}\n");
+}
+
+TEST_CASE(WritesCompleteEventsRelativeToTheOrigin)
+{
+    auto buffer = makeBuffer(7);
+    push(*buffer, TraceCategory::Module, "AsiLoader.Activate", 10500, 13000, "x");
+    push(*buffer, TraceCategory::LoadLibrary, "LoadLibraryW", 11000, 11250, "Mod.asi");
+
+    // 10 MHz ticks, origin at tick 500: the first event starts at 1000 us and lasts 250 us.
+    size_t written = 0;
+    auto text = exportTrace(buffer.get(), &written, 500, 10000000);
+    CHECK(written == 2);
+    CHECK(text ==
+        "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["
+        "\n{\"name\":\"AsiLoader.Activate\",\"cat\":\"module\",\"ph\":\"X\",\"ts\":1000.000,\"dur\":250.000,\"pid\":42,\"tid\":7,\"args\":{\"detail\":\"x\"}},"
+        "\n{\"name\":\"LoadLibraryW\",\"cat\":\"loadlibrary\",\"ph\":\"X\",\"ts\":1050.000,\"dur\":25.000,\"pid\":42,\"tid\":7,\"args\":{\"detail\":\"Mod.asi\"}}"
+        "\n]}\n");
+}
+
+TEST_CASE(EscapesDetailsForJson)
+{
+    auto buffer = makeBuffer(1);
+    push(*buffer, TraceCategory::Hook, "Install", 0, 1, "C:\\Game\\\"quoted\"\n\ttab");
+    auto text = exportTrace(buffer.get());
+    CHECK(text.find("\"detail\":\"C:\\\\Game\\\\\\\"quoted\\\"\\u000a\\u0009tab\"") != std::string::npos);
+}
+
+TEST_CASE(ExportsOnlyTheNewestCapacityEventsInOrder)
+{
+    auto buffer = makeBuffer(3);
+    const size_t total = ThreadTraceBuffer::CAPACITY + 100;
+    for (size_t i = 0; i < total; i++)
+    {
+        push(*buffer, TraceCategory::PatternScan, "Scan", static_cast<int64_t>(i), static_cast<int64_t>(i) + 1);
+    }
+
+    size_t written = 0;
+    auto text = exportTrace(buffer.get(), &written);
+    CHECK(written == ThreadTraceBuffer::CAPACITY);
+    CHECK(text.find("\"ts\":99.000,") == std::string::npos);    // Overwritten.
+
+    auto first = text.find("\"ts\":100.000,");
+    auto last = text.find("\"ts\":611.000,");
+    REQUIRE(first != std::string::npos && last != std::string::npos);
+    CHECK(first < last);
+    CHECK(text.find("\"ts\":101.000,") > first);
+}
+
+TEST_CASE(WritesEveryThreadWithItsOwnTid)
+{
+    auto main = makeBuffer(100);
+    auto worker = makeBuffer(200, main.get());
+    push(*main, TraceCategory::Boot, "OnAttach", 0, 50);
+    push(*worker, TraceCategory::PluginAttach, "OnAttach", 10, 20, "Async.asi");
+    push(*worker, TraceCategory::PluginAttach, "OnAttach", 20, 30, "Other.asi");
+
+    size_t written = 0;
+    auto text = exportTrace(worker.get(), &written);
+    CHECK(written == 3);
+    CHECK(occurrences(text, "\"tid\":200,") == 2);
+    CHECK(occurrences(text, "\"tid\":100,") == 1);
+    CHECK(occurrences(text, "},\n{") == 2);           // Comma separated, no trailing comma.
+    CHECK(text.find("\"cat\":\"boot\"") != std::string::npos);
+    CHECK(text.find("\"cat\":\"pluginattach\"") != std::string::npos);
+}
+
+TEST_CASE(NamesEveryCategory)
+{
+    for (int i = 0; i < static_cast<int>(TraceCategory::Count); i++)
+    {
+        CHECK(0 != strcmp(Utils::TraceCategoryToString(static_cast<TraceCategory>(i)), "unknown"));
+    }
+    CHECK(0 == strcmp(Utils::TraceCategoryToString(TraceCategory::Count), "unknown"));
+}
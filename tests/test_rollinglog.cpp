@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "utils/rollinglog.h"
+
+
+namespace
+{
+    using Utils::RollingLog;
+    using Utils::RollingLogSegment;
+    using Utils::RollingLogSessionText;
+
+    // Small geometry: 64 bytes of text per segment.
+    const uint32_t SLOTS = 3;
+    const uint32_t SEGMENTS = 4;
+    const uint32_t SEGMENT_SIZE = sizeof(RollingLogSegment) + 64;
+    const uint32_t CAPACITY = SEGMENT_SIZE - sizeof(RollingLogSegment);
+
+    struct File
+    {
+        std::vector<uint8_t> Bytes;
+
+        File() : Bytes(RollingLog::FileSize(SLOTS, SEGMENTS, SEGMENT_SIZE))
+        {
+            RollingLog::Format(Bytes.data(), SLOTS, SEGMENTS, SEGMENT_SIZE);
+        }
+
+        const RollingLogSegment* Segment(uint32_t slot, uint32_t index) const
+        {
+            return reinterpret_cast<const RollingLogSegment*>(Bytes.data() + RollingLog::HEADER_SIZE + (slot * SEGMENTS + index) * SEGMENT_SIZE);
+        }
+
+        std::vector<RollingLogSessionText> Read() const
+        {
+            std::vector<RollingLogSessionText> sessions;
+            CHECK(RollingLog::Read(Bytes.data(), Bytes.size(), sessions));
+            return sessions;
+        }
+    };
+
+    void append(RollingLog& log, const std::string& text)
+    {
+        log.Append(text.data(), text.size());
+    }
+
+    std::string numberedLines(int first, int count)
+    {
+        std::string text;
+        for (int i = first; i < first + count; i++)
+        {
+            text += "line " + std::to_string(i) + " of the session\n";
+        }
+        return text;
+    }
+}
+
+
+TEST_CASE(FormatsAndValidatesTheGeometry)
+{
+    File file;
+    CHECK(RollingLog::Validate(file.Bytes.data(), file.Bytes.size(), SLOTS, SEGMENTS, SEGMENT_SIZE));
+    CHECK(!RollingLog::Validate(file.Bytes.data(), file.Bytes.size(), SLOTS + 1, SEGMENTS, SEGMENT_SIZE));
+    CHECK(!RollingLog::Validate(file.Bytes.data(), file.Bytes.size(), SLOTS, SEGMENTS, SEGMENT_SIZE * 2));
+    CHECK(!RollingLog::Validate(file.Bytes.data(), file.Bytes.size() - 1, SLOTS, SEGMENTS, SEGMENT_SIZE));
+    CHECK(file.Read().empty());
+
+    file.Bytes[0] = 'X';
+    CHECK(!RollingLog::Validate(file.Bytes.data(), file.Bytes.size(), SLOTS, SEGMENTS, SEGMENT_SIZE));
+    std::vector<RollingLogSessionText> sessions;
+    CHECK(!RollingLog::Read(file.Bytes.data(), file.Bytes.size(), sessions));
+}
+
+TEST_CASE(ReadsBackASession)
+{
+    File file;
+    RollingLog log;
+    CHECK(!log.IsOpen());
+    REQUIRE(log.Begin(file.Bytes.data(), 133000000000000000ull, 4242));
+    CHECK(log.IsOpen());
+    append(log, "first line\n");
+    append(log, "second ");
+    append(log, "line\n");
+
+    auto open = file.Read();
+    REQUIRE(open.size() == 1);
+    CHECK(open[0].Session.Id == 1);
+    CHECK(open[0].Session.ProcessId == 4242);
+    CHECK(open[0].Session.StartFileTime == 133000000000000000ull);
+    CHECK(open[0].Session.Closed == 0);   // A crash looks like this.
+    CHECK(!open[0].Wrapped);
+    CHECK(open[0].Text == "first line\nsecond line\n");
+
+    log.End();
+    CHECK(!log.IsOpen());
+    append(log, "after the end\n");
+    auto closed = file.Read();
+    REQUIRE(closed.size() == 1);
+    CHECK(closed[0].Session.Closed == 1);
+    CHECK(closed[0].Text == "first line\nsecond line\n");
+}
+
+TEST_CASE(MovesToTheNextSegmentAtALineBoundary)
+{
+    File file;
+    RollingLog log;
+    REQUIRE(log.Begin(file.Bytes.data(), 0, 1));
+
+    // 40 + 40 bytes: the second line doesn't fit behind the first and must not be split.
+    std::string line(39, 'a');
+    line += '\n';
+    append(log, line + line);
+
+    CHECK(file.Segment(0, 0)->Used == 40);
+    CHECK(file.Segment(0, 1)->Used == 40);
+    CHECK(file.Segment(0, 1)->Sequence == 2);
+    CHECK(file.Read()[0].Text == line + line);
+}
+
+TEST_CASE(SplitsLinesLongerThanASegment)
+{
+    File file;
+    RollingLog log;
+    REQUIRE(log.Begin(file.Bytes.data(), 0, 1));
+
+    append(log, "short\n");
+    std::string longLine(CAPACITY * 2 - 10, 'x');
+    longLine += '\n';
+    append(log, longLine);
+
+    CHECK(file.Segment(0, 0)->Used == 6);         // The long line starts in a fresh segment...
+    CHECK(file.Segment(0, 1)->Used == CAPACITY);  // ...and is cut where that one is full.
+    CHECK(file.Read()[0].Text == "short\n" + longLine);
+}
+
+TEST_CASE(WrapsWithinTheSessionKeepingTheNewestLines)
+{
+    File file;
+    RollingLog log;
+    REQUIRE(log.Begin(file.Bytes.data(), 0, 1));
+
+    auto text = numberedLines(0, 100);
+    append(log, text);
+
+    auto sessions = file.Read();
+    REQUIRE(sessions.size() == 1);
+    CHECK(sessions[0].Wrapped);
+    auto& kept = sessions[0].Text;
+    CHECK(kept.size() <= SEGMENTS * CAPACITY);
+    CHECK(kept.size() > (SEGMENTS - 1) * CAPACITY / 2);
+    CHECK(text.compare(text.size() - kept.size(), kept.size(), kept) == 0);
+    CHECK(kept.rfind("line ", 0) == 0);           // Starts on a whole line.
+
+    // Segments are numbered across the wrap, the reader orders them by sequence.
+    uint64_t highest = 0;
+    for (uint32_t i = 0; i < SEGMENTS; i++)
+    {
+        highest = std::max<uint64_t>(highest, file.Segment(0, i)->Sequence);
+    }
+    CHECK(highest > SEGMENTS);
+}
+
+TEST_CASE(TakesOverTheOldestSessionSlot)
+{
+    File file;
+    for (uint32_t session = 1; session <= SLOTS + 2; session++)
+    {
+        RollingLog log;
+        REQUIRE(log.Begin(file.Bytes.data(), session * 1000ull, session));
+        append(log, "session " + std::to_string(session) + "\n");
+        if (session != SLOTS + 2)
+        {
+            log.End();
+        }
+    }
+
+    auto sessions = file.Read();
+    REQUIRE(sessions.size() == SLOTS);
+    for (uint32_t i = 0; i < SLOTS; i++)
+    {
+        auto id = 3 + i;   // 1 and 2 were overwritten.
+        CHECK(sessions[i].Session.Id == id);
+        CHECK(sessions[i].Session.ProcessId == id);
+        CHECK(sessions[i].Text == "session " + std::to_string(id) + "\n");
+        CHECK(!sessions[i].Wrapped);
+    }
+    CHECK(sessions[0].Session.Closed == 1);
+    CHECK(sessions[SLOTS - 1].Session.Closed == 0);
+}
+
+TEST_CASE(IgnoresSegmentsOfOtherOrInterruptedWrites)
+{
+    File file;
+    {
+        RollingLog log;
+        REQUIRE(log.Begin(file.Bytes.data(), 0, 1));
+        append(log, numberedLines(0, 6));
+        log.End();
+    }
+
+    // A crash in the middle of moving to another segment leaves it without a session.
+    auto segment = const_cast<RollingLogSegment*>(file.Segment(0, 1));
+    REQUIRE(segment->SessionId == 1);
+    segment->SessionId = 0;
+
+    auto sessions = file.Read();
+    REQUIRE(sessions.size() == 1);
+    CHECK(sessions[0].Text.find("line 0 of") == 0);
+    CHECK(sessions[0].Text.size() < numberedLines(0, 6).size());
+}
+
+TEST_CASE(RefusesBrokenHeaders)
+{
+    File file;
+    auto header = reinterpret_cast<Utils::RollingLogHeader*>(file.Bytes.data());
+    RollingLog log;
+
+    header->SegmentSize = sizeof(RollingLogSegment);
+    CHECK(!log.Begin(file.Bytes.data(), 0, 1));
+    header->SegmentSize = SEGMENT_SIZE;
+    header->SessionSlots = RollingLog::MAX_SESSION_SLOTS + 1;
+    CHECK(!log.Begin(file.Bytes.data(), 0, 1));
+    CHECK(!log.IsOpen());
+
+    std::vector<RollingLogSessionText> sessions;
+    CHECK(!RollingLog::Read(file.Bytes.data(), file.Bytes.size(), sessions));
+    header->SessionSlots = SLOTS;
+    CHECK(!RollingLog::Read(file.Bytes.data(), RollingLog::HEADER_SIZE, sessions));
+    CHECK(RollingLog::Read(file.Bytes.data(), file.Bytes.size(), sessions));
+}
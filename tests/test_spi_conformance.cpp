@@ -0,0 +1,231 @@
+// The SPI headers are written for MSVC, these are no-ops elsewhere.
+#define __cdecl
+#define __declspec(x)
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "spi/conformance.h"
+#include "spi/interface.h"
+
+
+namespace
+{
+    SPIReturn __cdecl hostGame(SPIGameVersion* outGameVersion)
+    {
+        *outGameVersion = SPIGameVersion::LE2;
+        return SPIReturn::Success;
+    }
+
+    void placeholder() { }
+
+    // A host table with every entry filled, as a current host builds it.
+    SharedProxyInterfaceV4 fullTable()
+    {
+        SharedProxyInterfaceV4 table;
+        memset(&table, 0, sizeof(table));
+        table.StructSize = sizeof(SharedProxyInterfaceV4);
+        table.Version = 4;
+        table.Capabilities = SPI::V4_KNOWN_CAPABILITIES;
+
+        auto proc = &placeholder;
+        for (const auto& entry : SPI::V4_ENTRIES)
+        {
+            memcpy(reinterpret_cast<unsigned char*>(&table) + entry.Offset, &proc, sizeof(proc));
+        }
+        table.GetHostGame = hostGame;
+        return table;
+    }
+
+    // A host as plugins see it, reporting some SPI version and maybe handing out a v4 table.
+    class MockHost
+        : public ISharedProxyInterface
+    {
+    public:
+        unsigned long Version;
+        SPIReturn VersionResult = SPIReturn::Success;
+        const SharedProxyInterfaceV4* Table = nullptr;
+        int Queries = 0;
+
+        explicit MockHost(unsigned long version, const SharedProxyInterfaceV4* table = nullptr)
+            : Version{ version }
+            , Table{ table }
+        {
+        }
+
+        SPIDEFN GetVersion(unsigned long* outVersionPtr) override
+        {
+            *outVersionPtr = Version;
+            return VersionResult;
+        }
+        SPIDEFN GetBuildMode(bool* outIsRelease) override { *outIsRelease = true; return SPIReturn::Success; }
+        SPIDEFN GetHostGame(SPIGameVersion* outGameVersion) override { return hostGame(outGameVersion); }
+        SPIDEFN FindPattern(void**, char*) override { return SPIReturn::FailureGeneric; }
+        SPIDEFN InstallHook(const char*, void*, void*, void**) override { return SPIReturn::FailureHooking; }
+        SPIDEFN UninstallHook(const char*) override { return SPIReturn::FailureHooking; }
+
+        SPIDEFN QueryInterface(unsigned long version, const void** outTable) override
+        {
+            Queries++;
+            *outTable = nullptr;
+            if (version != 4 || !Table)
+            {
+                return SPIReturn::FailureUnsupportedYet;
+            }
+            *outTable = Table;
+            return SPIReturn::Success;
+        }
+    };
+
+    std::vector<std::string> problems(const SharedProxyInterfaceV4* table)
+    {
+        std::vector<std::string> found;
+        SPI::CheckV4Table(table, [&found](const char* name, const char*) { found.emplace_back(name); });
+        return found;
+    }
+}
+
+
+TEST_CASE(ListsEveryTableEntryWithoutGaps)
+{
+    // Append-only C layout: the entries follow the header back to back and fill the struct.
+    auto expected = offsetof(SharedProxyInterfaceV4, GetHostGame);
+    for (const auto& entry : SPI::V4_ENTRIES)
+    {
+        CHECK(entry.Offset == expected);
+        CHECK(entry.Size == sizeof(void*));
+        expected = entry.Offset + entry.Size;
+    }
+    CHECK(expected == sizeof(SharedProxyInterfaceV4));
+    CHECK(offsetof(SharedProxyInterfaceV4, StructSize) == 0);
+}
+
+TEST_CASE(GivesEveryCapabilityItsOwnBitAndEntries)
+{
+    unsigned long long seen = 0;
+    for (int bit = 0; bit < 64; bit++)
+    {
+        auto capability = 1ull << bit;
+        if ((SPI::V4_KNOWN_CAPABILITIES & capability) == 0)
+        {
+            continue;
+        }
+        size_t entries = 0;
+        for (const auto& entry : SPI::V4_ENTRIES)
+        {
+            entries += entry.Capability == capability ? 1 : 0;
+            seen |= entry.Capability;
+        }
+        CHECK(entries > 0);
+    }
+    CHECK(seen == SPI::V4_KNOWN_CAPABILITIES);
+    CHECK(SPI::V4_KNOWN_CAPABILITIES == 0x3FF);
+}
+
+TEST_CASE(QueriesV4OnlyFromHostsWhichHaveIt)
+{
+    CHECK(SPI_QueryV4(nullptr) == nullptr);
+
+    MockHost v3{ 3 };
+    CHECK(SPI_QueryV4(&v3) == nullptr);
+    CHECK(v3.Queries == 0);   // QueryInterface isn't in a v3 vtable, it must not be called.
+
+    auto table = fullTable();
+    MockHost failing{ 4, &table };
+    failing.VersionResult = SPIReturn::FailureGeneric;
+    CHECK(SPI_QueryV4(&failing) == nullptr);
+    CHECK(failing.Queries == 0);
+
+    MockHost refusing{ 4 };
+    CHECK(SPI_QueryV4(&refusing) == nullptr);
+    CHECK(refusing.Queries == 1);
+
+    MockHost v4{ 4, &table };
+    auto queried = SPI_QueryV4(&v4);
+    REQUIRE(queried == &table);
+    SPIGameVersion game = SPIGameVersion::Launcher;
+    CHECK(queried->GetHostGame(&game) == SPIReturn::Success && game == SPIGameVersion::LE2);
+
+    MockHost v5{ 5, &table };   // Newer hosts still hand out v4.
+    CHECK(SPI_QueryV4(&v5) == &table);
+}
+
+TEST_CASE(ChecksEntriesAgainstTheHostsStructSize)
+{
+    auto table = fullTable();
+    const SharedProxyInterfaceV4* full = &table;
+    CHECK(SPI_V4_HAS(full, GetHostGame));
+    CHECK(SPI_V4_HAS(full, GetTickStats));
+
+    // A host built before SubmitJob was appended.
+    auto older = fullTable();
+    older.StructSize = offsetof(SharedProxyInterfaceV4, SubmitJob);
+    const SharedProxyInterfaceV4* olderPtr = &older;
+    CHECK(SPI_V4_HAS(olderPtr, FindPatternCached));
+    CHECK(!SPI_V4_HAS(olderPtr, SubmitJob));
+    CHECK(!SPI_V4_HAS(olderPtr, GetTickStats));
+
+    auto holey = fullTable();
+    holey.GetNameText = nullptr;
+    const SharedProxyInterfaceV4* holeyPtr = &holey;
+    CHECK(!SPI_V4_HAS(holeyPtr, GetNameText));
+
+    const SharedProxyInterfaceV4* none = nullptr;
+    CHECK(!SPI_V4_HAS(none, GetHostGame));
+}
+
+TEST_CASE(AcceptsConformingTables)
+{
+    auto table = fullTable();
+    CHECK(problems(&table).empty());
+
+    // An older host which doesn't advertise what it doesn't have.
+    auto older = fullTable();
+    older.StructSize = offsetof(SharedProxyInterfaceV4, SubmitJob);
+    older.Capabilities = SPI_CAP_BATCHED_HOOKS | SPI_CAP_MULTI_PATTERN | SPI_CAP_CACHED_OFFSETS;
+    CHECK(problems(&older).empty());
+
+    // Entries of capabilities which aren't advertised may be NULL.
+    auto partial = fullTable();
+    partial.Capabilities &= ~SPI_CAP_EVENT_DISPATCH;
+    partial.SubscribeEvent = nullptr;
+    partial.UnsubscribeEvent = nullptr;
+    CHECK(problems(&partial).empty());
+}
+
+TEST_CASE(ReportsNonConformingTables)
+{
+    CHECK(problems(nullptr) == (std::vector<std::string>{ "table" }));
+
+    auto truncated = fullTable();
+    truncated.StructSize = offsetof(SharedProxyInterfaceV4, SubmitJob);
+    truncated.Capabilities = SPI_CAP_BATCHED_HOOKS | SPI_CAP_JOBS;
+    CHECK(problems(&truncated) == (std::vector<std::string>{ "SubmitJob" }));
+
+    auto null = fullTable();
+    null.UnregisterTick = nullptr;
+    null.GetHostGame = nullptr;
+    CHECK(problems(&null) == (std::vector<std::string>{ "GetHostGame", "UnregisterTick" }));
+
+    auto future = fullTable();
+    future.Capabilities |= 1ull << 40;
+    future.Version = 3;
+    CHECK(problems(&future) == (std::vector<std::string>{ "Version", "Capabilities" }));
+
+    auto header = fullTable();
+    header.StructSize = 4;
+    CHECK(problems(&header) == (std::vector<std::string>{ "StructSize" }));
+}
+
+TEST_CASE(DescribesEveryReturnCode)
+{
+    const SPIReturn codes[] = { SPIReturn::Undefined, SPIReturn::Success, SPIReturn::FailureGeneric, SPIReturn::FailureDuplicacy,
+        SPIReturn::FailureHooking, SPIReturn::FailureInvalidParam, SPIReturn::FailureUnsupportedYet, SPIReturn::FailureDeprecated,
+        SPIReturn::FailurePatternInvalid, SPIReturn::FailurePatternTooLong, SPIReturn::ErrorFatal, SPIReturn::ErrorWinApi };
+    auto unknown = std::wstring(SPIReturnToString(static_cast<SPIReturn>(99)));
+    for (auto code : codes)
+    {
+        CHECK(std::wstring(SPIReturnToString(code)) != unknown);
+    }
+}
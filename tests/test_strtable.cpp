@@ -0,0 +1,218 @@
+#include <map>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "utils/pluginscan.h"
+#include "utils/strtable.h"
+
+
+namespace
+{
+    // An in-memory directory tree: relative directory ("" for the root, "Sub\" below it) to its entries.
+    struct FakeTree
+    {
+        struct Node
+        {
+            std::wstring Name;
+            bool Directory;
+            bool ReparsePoint;
+        };
+
+        std::map<std::wstring, std::vector<Node>> Dirs;
+        std::vector<std::wstring> Listed;
+
+        void File(const std::wstring& dir, const std::wstring& name) { Dirs[dir].push_back(Node{ name, false, false }); }
+        void Dir(const std::wstring& dir, const std::wstring& name, bool reparse = false) { Dirs[dir].push_back(Node{ name, true, reparse }); }
+
+        template<typename TVisit>
+        bool operator()(const wchar_t* relativeDir, TVisit&& visit)
+        {
+            Listed.emplace_back(relativeDir);
+            auto it = Dirs.find(relativeDir);
+            if (it == Dirs.end())
+            {
+                return false;
+            }
+            for (const auto& node : it->second)
+            {
+                visit(Utils::ScanEntry{ node.Name.c_str(), node.Directory, node.ReparsePoint });
+            }
+            return true;
+        }
+    };
+
+    struct Skip
+    {
+        Utils::ScanSkip Reason;
+        std::wstring Path;
+    };
+
+    template<typename TTable>
+    std::vector<std::wstring> entries(const TTable& table)
+    {
+        std::vector<std::wstring> result;
+        for (size_t i = 0; i < table.Count(); i++)
+        {
+            result.emplace_back(table.Get(i));
+        }
+        return result;
+    }
+}
+
+
+TEST_CASE(FoldsAsciiAndLatin1Only)
+{
+    CHECK(Utils::FoldOrdinal(L'a') == L'A');
+    CHECK(Utils::FoldOrdinal(L'Z') == L'Z');
+    CHECK(Utils::FoldOrdinal(L'_') == L'_');
+    CHECK(Utils::FoldOrdinal(L'é') == L'É');
+    CHECK(Utils::FoldOrdinal(L'÷') == L'÷');    // Division sign has no case.
+    CHECK(Utils::FoldOrdinal(L'ÿ') == 0x178);
+    CHECK(Utils::FoldOrdinal(L'д') == 0x434);        // Outside Latin-1, by code unit.
+
+    CHECK(Utils::CompareOrdinalIgnoreCase(L"Mod.ASI", L"mod.asi") == 0);
+    CHECK(Utils::CompareOrdinalIgnoreCase(L"a", L"B") < 0);
+    CHECK(Utils::CompareOrdinalIgnoreCase(L"b", L"A") > 0);
+    CHECK(Utils::CompareOrdinalIgnoreCase(L"ab", L"a") > 0);
+    CHECK(Utils::EndsWithIgnoreCase(L"x.AsI", L".asi"));
+    CHECK(!Utils::EndsWithIgnoreCase(L"asi", L".asi"));
+}
+
+TEST_CASE(SortsCaseInsensitivelyWithStableTies)
+{
+    Utils::StringTable<256, 16> table;
+    CHECK(table.Add(nullptr, L"zeta.asi"));
+    CHECK(table.Add(nullptr, L"Beta.asi"));
+    CHECK(table.Add(L"Sub\\", L"alpha.asi"));
+    CHECK(table.Add(nullptr, L"beta.asi"));
+    CHECK(table.Add(nullptr, L"Alpha.asi"));
+    table.Sort();
+
+    auto sorted = entries(table);
+    std::vector<std::wstring> expected{ L"Alpha.asi", L"Beta.asi", L"beta.asi", L"Sub\\alpha.asi", L"zeta.asi" };
+    CHECK(sorted == expected);
+}
+
+TEST_CASE(RefusesEntriesPastTheArenaOrSlotCount)
+{
+    Utils::StringTable<16, 2> table;
+    CHECK(table.Add(L"ab", L"cd"));                  // 5 chars
+    CHECK(!table.Add(nullptr, L"0123456789ab"));     // 13 more would need 18
+    CHECK(table.Count() == 1 && table.CharsUsed() == 5);
+    CHECK(table.Add(nullptr, L"efghijklm"));        // 10 more, exactly full
+    CHECK(table.CharsUsed() == 15);
+    CHECK(!table.Add(nullptr, L""));                 // Out of slots.
+    CHECK(entries(table) == (std::vector<std::wstring>{ L"abcd", L"efghijklm" }));
+
+    table.Clear();
+    CHECK(table.Count() == 0 && table.Add(nullptr, L"x"));
+}
+
+TEST_CASE(DefaultTableFitsThousandsOfPathsInLessThanTheOldArray)
+{
+    // 64 KB with Windows' 2-byte wchar_t, under the old wchar_t[260][128] array.
+    CHECK(Utils::StringTable<>::MemoryUsage() == 28 * 1024 * sizeof(wchar_t) + 4096 * sizeof(uint16_t) + 2 * sizeof(size_t));
+
+    auto table = new Utils::StringTable<>();
+    wchar_t name[32];
+    size_t added = 0;
+    for (int i = 0; i < 3000; i++)
+    {
+        swprintf(name, 32, L"Mod%04d.asi", 2999 - i);
+        added += table->Add(nullptr, name) ? 1 : 0;
+    }
+    CHECK(added == 28 * 1024 / 12);   // 12 chars each, the rest is refused.
+    table->Sort();
+    CHECK(std::wstring(table->Get(0)) == L"Mod0611.asi");
+    CHECK(std::wstring(table->Get(added - 1)) == L"Mod2999.asi");
+    delete table;
+}
+
+TEST_CASE(ScansNestedFoldersWithinTheDepthLimit)
+{
+    FakeTree tree;
+    tree.File(L"", L"Root.asi");
+    tree.File(L"", L"readme.txt");
+    tree.File(L"", L"UPPER.ASI");
+    tree.Dir(L"", L"A");
+    tree.File(L"A\\", L"a.asi");
+    tree.Dir(L"A\\", L"B");
+    tree.File(L"A\\B\\", L"b.asi");
+    tree.Dir(L"A\\B\\", L"C");
+    tree.File(L"A\\B\\C\\", L"c.asi");
+
+    Utils::StringTable<1024, 64> table;
+    std::vector<Skip> skips;
+    auto ok = Utils::ScanPlugins(table, tree,
+        [&skips](Utils::ScanSkip reason, const wchar_t* dir, const wchar_t* name) { skips.push_back(Skip{ reason, std::wstring(dir) + name }); },
+        2);
+    table.Sort();
+
+    CHECK(ok);
+    CHECK(entries(table) == (std::vector<std::wstring>{ L"A\\a.asi", L"A\\B\\b.asi", L"Root.asi", L"UPPER.ASI" }));
+    REQUIRE(skips.size() == 1);
+    CHECK(skips[0].Reason == Utils::ScanSkip::TooDeep && skips[0].Path == L"A\\B\\C");
+}
+
+TEST_CASE(SkipsDotDirectoriesAndReparsePoints)
+{
+    FakeTree tree;
+    tree.Dir(L"", L".");
+    tree.Dir(L"", L"..");
+    tree.Dir(L"", L".shadow");
+    tree.File(L".shadow\\", L"Mod.1.asi");
+    tree.Dir(L"", L"Loop", true);
+    tree.File(L"Loop\\", L"looped.asi");
+    tree.File(L"", L"Mod.asi");
+
+    Utils::StringTable<1024, 64> table;
+    size_t skipCount = 0;
+    CHECK(Utils::ScanPlugins(table, tree, [&skipCount](Utils::ScanSkip, const wchar_t*, const wchar_t*) { skipCount++; }, 8));
+
+    CHECK(entries(table) == (std::vector<std::wstring>{ L"Mod.asi" }));
+    CHECK(skipCount == 0);
+    CHECK(tree.Listed == (std::vector<std::wstring>{ L"" }));   // Nothing but the root was listed.
+}
+
+TEST_CASE(ReportsRootFailuresAndFullTables)
+{
+    FakeTree missing;
+    Utils::StringTable<64, 4> table;
+    CHECK(!Utils::ScanPlugins(table, missing, [](Utils::ScanSkip, const wchar_t*, const wchar_t*) { }, 8));
+
+    // A subdirectory which can't be listed doesn't fail the scan.
+    FakeTree tree;
+    tree.Dir(L"", L"Gone");
+    tree.File(L"", L"one.asi");
+    tree.File(L"", L"two.asi");
+    tree.File(L"", L"three.asi");
+    std::vector<Skip> skips;
+    Utils::StringTable<16, 4> small;
+    CHECK(Utils::ScanPlugins(small, tree,
+        [&skips](Utils::ScanSkip reason, const wchar_t* dir, const wchar_t* name) { skips.push_back(Skip{ reason, std::wstring(dir) + name }); }, 8));
+    CHECK(small.Count() == 2);
+    REQUIRE(skips.size() == 1);
+    CHECK(skips[0].Reason == Utils::ScanSkip::TableFull && skips[0].Path == L"three.asi");
+}
+
+TEST_CASE(SkipsPathsPastMaxPath)
+{
+    FakeTree tree;
+    std::wstring longDir(250, L'd');
+    tree.Dir(L"", longDir);
+    tree.File(longDir + L"\\", L"fits.asi");              // 259 chars
+    tree.File(longDir + L"\\", L"doesnotfit.asi");        // 265 chars
+    tree.Dir(L"", std::wstring(259, L'e'));                // 260 chars with the separator
+    tree.File(L"", L"ok.asi");
+
+    Utils::StringTable<1024, 8> table;
+    std::vector<Skip> skips;
+    CHECK(Utils::ScanPlugins(table, tree,
+        [&skips](Utils::ScanSkip reason, const wchar_t* dir, const wchar_t* name) { skips.push_back(Skip{ reason, std::wstring(dir) + name }); }, 8));
+    table.Sort();
+
+    CHECK(entries(table) == (std::vector<std::wstring>{ longDir + L"\\fits.asi", L"ok.asi" }));
+    REQUIRE(skips.size() == 2);
+    CHECK(skips[0].Reason == Utils::ScanSkip::PathTooLong && skips[0].Path == longDir + L"\\doesnotfit.asi");
+    CHECK(skips[1].Reason == Utils::ScanSkip::PathTooLong && skips[1].Path == std::wstring(259, L'e'));
+}
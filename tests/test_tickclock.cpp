@@ -0,0 +1,121 @@
+#include <cstdint>
+#include "testing.h"
+#include "utils/tickclock.h"
+
+
+namespace
+{
+    using Utils::TickClock;
+    using Utils::WallTime;
+
+    const int64_t QPC_FREQUENCY = 10000000;  // What Windows 10+ reports on most machines.
+    const int64_t US_PER_SECOND = 1000000;
+
+    int64_t usOfDay(unsigned hour, unsigned minute, unsigned second, unsigned ms = 0, unsigned us = 0)
+    {
+        return ((hour * 60ll + minute) * 60 + second) * US_PER_SECOND + ms * 1000ll + us;
+    }
+
+    bool is(const WallTime& time, unsigned hour, unsigned minute, unsigned second, unsigned ms, unsigned us = 0)
+    {
+        return time.Hour == hour && time.Minute == minute && time.Second == second && time.Millisecond == ms && time.Microsecond == us;
+    }
+}
+
+
+TEST_CASE(ConvertsTicksAfterTheAnchor)
+{
+    TickClock clock;
+    clock.Anchor(QPC_FREQUENCY, 5000, usOfDay(13, 45, 10, 250));
+
+    CHECK(clock.MicrosecondsSinceAnchor(5000) == 0);
+    CHECK(is(clock.ToWallTime(5000), 13, 45, 10, 250));
+    CHECK(is(clock.ToWallTime(5000 + 10), 13, 45, 10, 250, 1));
+    CHECK(is(clock.ToWallTime(5000 + 9), 13, 45, 10, 250, 0));  // Truncated, never rounded up.
+    CHECK(is(clock.ToWallTime(5000 + QPC_FREQUENCY * 50), 13, 46, 0, 250));
+    CHECK(is(clock.ToWallTime(5000 + QPC_FREQUENCY * 3600 + 12345), 14, 45, 10, 251, 234));
+}
+
+TEST_CASE(ConvertsTicksTakenBeforeTheAnchor)
+{
+    // A producer stamps a record, the writer anchors later in the same batch.
+    TickClock clock;
+    clock.Anchor(QPC_FREQUENCY, 1000000, usOfDay(8, 0, 0));
+
+    CHECK(clock.MicrosecondsSinceAnchor(1000000 - 10) == -1);
+    CHECK(is(clock.ToWallTime(1000000 - QPC_FREQUENCY / 1000), 7, 59, 59, 999));
+    CHECK(is(clock.ToWallTime(1000000 - QPC_FREQUENCY * 60), 7, 59, 0, 0));
+}
+
+TEST_CASE(WrapsAroundMidnight)
+{
+    TickClock clock;
+    clock.Anchor(QPC_FREQUENCY, 0, usOfDay(23, 59, 59, 900));
+
+    CHECK(is(clock.ToWallTime(QPC_FREQUENCY / 10), 0, 0, 0, 0));
+    CHECK(is(clock.ToWallTime(QPC_FREQUENCY * 2), 0, 0, 1, 900));
+    CHECK(is(clock.ToWallTime(QPC_FREQUENCY * 86400 * 3), 23, 59, 59, 900));
+
+    TickClock early;
+    early.Anchor(QPC_FREQUENCY, QPC_FREQUENCY, usOfDay(0, 0, 0, 100));
+    CHECK(is(early.ToWallTime(0), 23, 59, 59, 100));
+}
+
+TEST_CASE(StaysExactForLongSessionsAtHighTickRates)
+{
+    // 1 GHz ticks (steady_clock), 200 days in: delta * 1000000 alone would overflow int64.
+    const int64_t frequency = 1000000000;
+    const int64_t anchor = 123456789;
+    TickClock clock;
+    clock.Anchor(frequency, anchor, 0);
+
+    auto tick = anchor + 200ll * 86400 * frequency + 3 * frequency + 456789123;
+    CHECK(clock.MicrosecondsSinceAnchor(tick) == (200ll * 86400 + 3) * US_PER_SECOND + 456789);
+    CHECK(is(clock.ToWallTime(tick), 0, 0, 3, 456, 789));
+}
+
+TEST_CASE(ConvertsABatchLikeOneReadingPerRecord)
+{
+    // The writer anchors once and converts every record of a batch with arithmetic only.
+    // Each result must equal an independent conversion of that record, with an odd frequency
+    // where remainders matter.
+    const int64_t frequency = 3579545;  // The old ACPI PM timer rate.
+    const int64_t anchorTick = 987654321;
+    const int64_t anchorUs = usOfDay(17, 30, 0, 5, 7);
+    TickClock clock;
+    clock.Anchor(frequency, anchorTick, anchorUs);
+
+    const int64_t usPerDay = 86400 * US_PER_SECOND;
+    int mismatches = 0;
+    for (int64_t i = -5000; i < 5000; i++)
+    {
+        auto tick = anchorTick + i * 7919;
+        auto expectedUs = static_cast<int64_t>(static_cast<long double>(tick - anchorTick) * US_PER_SECOND / frequency);
+        auto expectedOfDay = ((anchorUs + expectedUs) % usPerDay + usPerDay) % usPerDay;
+
+        auto time = clock.ToWallTime(tick);
+        if (clock.MicrosecondsSinceAnchor(tick) != expectedUs
+            || usOfDay(time.Hour, time.Minute, time.Second, time.Millisecond, time.Microsecond) != expectedOfDay)
+        {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE(IgnoresABrokenFrequency)
+{
+    TickClock clock;
+    clock.Anchor(0, 10, usOfDay(1, 0, 0));
+    CHECK(clock.MicrosecondsSinceAnchor(11) == US_PER_SECOND);
+
+    clock.Anchor(-5, 10, usOfDay(1, 0, 0));
+    CHECK(is(clock.ToWallTime(12), 1, 0, 2, 0));
+}
+
+TEST_CASE(ReadsAMonotonicClock)
+{
+    auto first = TickClock::Now();
+    auto second = TickClock::Now();
+    CHECK(second >= first);
+}
@@ -0,0 +1,231 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "testing.h"
+#include "utils/ticksched.h"
+
+
+namespace
+{
+    using Utils::TickScheduler;
+
+    // A simulated clock: callbacks advance it by the cost they are meant to have.
+    struct Clock
+    {
+        int64_t NowUs = 1000;
+    };
+
+    struct Callback
+    {
+        Clock* Time;
+        int64_t CostUs;
+        int Tag;
+        std::vector<int>* Order;
+    };
+
+    void run(void* context)
+    {
+        auto callback = static_cast<Callback*>(context);
+        callback->Time->NowUs += callback->CostUs;
+        if (callback->Order)
+        {
+            callback->Order->push_back(callback->Tag);
+        }
+    }
+
+    void* runProc()
+    {
+        return reinterpret_cast<void*>(&run);
+    }
+
+    struct Overrun
+    {
+        uint32_t Id;
+        int64_t CostUs;
+        uint64_t Overruns;
+    };
+
+    // Run one frame the way FrameTickModule does, on the simulated clock.
+    void frame(TickScheduler& scheduler, Clock& clock, std::vector<Overrun>* overruns = nullptr)
+    {
+        scheduler.RunFrame([&clock]() { return clock.NowUs; },
+            [](void* proc, void* context) { reinterpret_cast<void (*)(void*)>(proc)(context); },
+            [overruns](uint32_t id, int64_t costUs, int64_t, uint64_t count)
+            {
+                if (overruns)
+                {
+                    overruns->push_back(Overrun{ id, costUs, count });
+                }
+            });
+    }
+}
+
+
+TEST_CASE(RunsCallbacksByPriorityThenRegistration)
+{
+    TickScheduler scheduler;
+    Clock clock;
+    std::vector<int> order;
+    Callback a{ &clock, 0, 1, &order }, b{ &clock, 0, 2, &order }, c{ &clock, 0, 3, &order }, d{ &clock, 0, 4, &order };
+
+    CHECK(scheduler.Register(nullptr, &a, 0, 0, nullptr) == 0);
+    scheduler.Register(runProc(), &a, 10, 0, nullptr);
+    scheduler.Register(runProc(), &b, -5, 0, nullptr);
+    scheduler.Register(runProc(), &c, 10, 0, nullptr);
+    scheduler.Register(runProc(), &d, 0, 0, nullptr);
+    CHECK(scheduler.Count() == 4);
+
+    frame(scheduler, clock);
+    CHECK(order == (std::vector<int>{ 2, 4, 1, 3 }));
+    CHECK(scheduler.Frame() == 1);
+}
+
+TEST_CASE(MeasuresEachCallback)
+{
+    TickScheduler scheduler;
+    Clock clock;
+    Callback callback{ &clock, 300, 0, nullptr };
+    auto id = scheduler.Register(runProc(), &callback, 0, 0, nullptr);
+
+    frame(scheduler, clock);
+    callback.CostUs = 900;
+    frame(scheduler, clock);
+    callback.CostUs = 100;
+    frame(scheduler, clock);
+
+    TickScheduler::Stats stats{};
+    REQUIRE(scheduler.GetStats(id, stats));
+    CHECK(stats.Calls == 3);
+    CHECK(stats.LastUs == 100);
+    CHECK(stats.MaxUs == 900);
+    CHECK(stats.BudgetUs == 0);
+    CHECK(stats.Overruns == 0);
+    CHECK(!scheduler.GetStats(id + 1, stats));
+
+    // The average settles on a steady cost over about 16 frames.
+    callback.CostUs = 500;
+    for (int i = 0; i < 200; i++)
+    {
+        frame(scheduler, clock);
+    }
+    REQUIRE(scheduler.GetStats(id, stats));
+    CHECK(stats.AverageUs >= 490 && stats.AverageUs <= 500);
+}
+
+TEST_CASE(ReportsOverrunsAtPowersOfTwo)
+{
+    TickScheduler scheduler;
+    Clock clock;
+    Callback slow{ &clock, 2500, 0, nullptr };
+    Callback fast{ &clock, 10, 0, nullptr };
+    auto slowId = scheduler.Register(runProc(), &slow, 0, 2000, nullptr);
+    scheduler.Register(runProc(), &fast, 0, 2000, nullptr);
+    CHECK(scheduler.Register(runProc(), &fast, 0, -5, nullptr) != 0);   // No budget.
+
+    std::vector<Overrun> overruns;
+    for (int i = 0; i < 20; i++)
+    {
+        frame(scheduler, clock, &overruns);
+    }
+
+    REQUIRE(overruns.size() == 5);                  // The 1st, 2nd, 4th, 8th and 16th.
+    uint64_t expected[] = { 1, 2, 4, 8, 16 };
+    for (size_t i = 0; i < overruns.size(); i++)
+    {
+        CHECK(overruns[i].Id == slowId);
+        CHECK(overruns[i].CostUs == 2500);
+        CHECK(overruns[i].Overruns == expected[i]);
+    }
+    TickScheduler::Stats stats{};
+    REQUIRE(scheduler.GetStats(slowId, stats));
+    CHECK(stats.Overruns == 20 && stats.BudgetUs == 2000);
+
+    // Exactly on budget isn't over it.
+    slow.CostUs = 2000;
+    overruns.clear();
+    frame(scheduler, clock, &overruns);
+    REQUIRE(scheduler.GetStats(slowId, stats));
+    CHECK(stats.Overruns == 20);
+}
+
+TEST_CASE(UnregistersFromInsideAFrame)
+{
+    static TickScheduler* scheduler;
+    static uint32_t laterId;
+    static std::vector<int> order;
+    TickScheduler owned;
+    scheduler = &owned;
+    order.clear();
+
+    auto first = [](void*)
+    {
+        order.push_back(1);
+        scheduler->Unregister(laterId);             // Later in this same frame.
+    };
+    auto later = [](void*) { order.push_back(2); };
+    auto self = [](void*)
+    {
+        order.push_back(3);
+        scheduler->UnregisterOwnedBy(&order);       // Itself, owned by &order.
+    };
+    void (*firstProc)(void*) = first;
+    void (*laterProc)(void*) = later;
+    void (*selfProc)(void*) = self;
+    scheduler->Register(reinterpret_cast<void*>(firstProc), nullptr, 0, 0, nullptr);
+    laterId = scheduler->Register(reinterpret_cast<void*>(laterProc), nullptr, 1, 0, nullptr);
+    scheduler->Register(reinterpret_cast<void*>(selfProc), nullptr, 2, 0, &order);
+
+    Clock clock;
+    frame(*scheduler, clock);
+    frame(*scheduler, clock);
+    CHECK(order == (std::vector<int>{ 1, 3, 1 }));
+    CHECK(scheduler->Count() == 1);
+    CHECK(!scheduler->Unregister(laterId));
+    CHECK(scheduler->UnregisterOwnedBy(nullptr) == 0);
+}
+
+TEST_CASE(UnregisterWaitsForTheFrameInProgress)
+{
+    TickScheduler scheduler;
+    static std::atomic<bool> entered, release;
+    entered = false;
+    release = false;
+    auto blocking = [](void*)
+    {
+        entered.store(true);
+        while (!release.load())
+        {
+            std::this_thread::yield();
+        }
+    };
+    void (*blockingProc)(void*) = blocking;
+    const int plugin = 0;
+    scheduler.Register(reinterpret_cast<void*>(blockingProc), nullptr, 0, 0, &plugin);
+
+    std::thread game([&scheduler]()
+        {
+            Clock clock;
+            frame(scheduler, clock);
+        });
+    while (!entered.load())
+    {
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> released{ false };
+    std::thread unloader([&scheduler, &released, &plugin]()
+        {
+            CHECK(scheduler.UnregisterOwnedBy(&plugin) == 1);
+            released.store(true);
+        });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!released.load());
+
+    release.store(true);
+    unloader.join();
+    game.join();
+    CHECK(released.load());
+    CHECK(scheduler.Count() == 0);
+}
@@ -0,0 +1,279 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "ue_containers.h"
+
+
+namespace
+{
+    using UE::FString;
+    using UE::FStringView;
+    using UE::GameAllocator;
+    using UE::TArray;
+    using UE::TArrayView;
+
+    // An FMalloc with the game's slot layout, over the C heap. FailAfter makes it refuse
+    // the allocations past a number of them.
+    struct FakeMalloc
+    {
+        void** VTable;
+        size_t Reallocs = 0;
+        size_t Frees = 0;
+        size_t FailAfter = SIZE_MAX;
+        uint32_t LastAlignment = ~0u;
+
+        static FakeMalloc& self(void* object) { return *static_cast<FakeMalloc*>(object); }
+
+        static void* malloc_(void* object, size_t count, uint32_t alignment)
+        {
+            self(object).LastAlignment = alignment;
+            return malloc(count);
+        }
+
+        static void* realloc_(void* object, void* original, size_t count, uint32_t alignment)
+        {
+            auto& fake = self(object);
+            fake.LastAlignment = alignment;
+            if (fake.Reallocs == fake.FailAfter)
+            {
+                return nullptr;
+            }
+            fake.Reallocs++;
+            return realloc(original, count);
+        }
+
+        static void free_(void* object, void* original)
+        {
+            self(object).Frees++;
+            free(original);
+        }
+
+        static void unused_() { }
+
+        void* Slots[5] = {
+            reinterpret_cast<void*>(&unused_),      // FExec's destructor.
+            reinterpret_cast<void*>(&unused_),      // Exec.
+            reinterpret_cast<void*>(&malloc_),
+            reinterpret_cast<void*>(&realloc_),
+            reinterpret_cast<void*>(&free_) };
+
+        FakeMalloc() : VTable{ Slots } { }
+        FakeMalloc(const FakeMalloc&) = delete;
+    };
+
+    // What a plugin hands over: the address of the GMalloc global, which points at the FMalloc.
+    struct Game
+    {
+        FakeMalloc Malloc;
+        void* GMalloc = &Malloc;
+        GameAllocator Allocator{ &GMalloc };
+    };
+
+    std::wstring text(const FString& string)
+    {
+        return std::wstring(FStringView(string).View());
+    }
+}
+
+
+TEST_CASE(MatchesTheEngineLayout)
+{
+    TArray<int> array{};
+    CHECK(sizeof(array) == 16);
+    CHECK(reinterpret_cast<char*>(&array.Count) - reinterpret_cast<char*>(&array) == 8);
+    CHECK(reinterpret_cast<char*>(&array.Max) - reinterpret_cast<char*>(&array) == 12);
+
+    // The engine's packing: a TArray inside a struct doesn't get padded to 8 after it.
+    struct Holder { TArray<int> Array; uint32_t After; };
+    CHECK(offsetof(Holder, After) == 16);
+
+    wchar_t buffer[] = L"Shepard";
+    FString string{};
+    string.Data = buffer;
+    string.Count = 8;
+    string.Max = 8;
+    CHECK(string.GetStr() == buffer);
+}
+
+TEST_CASE(ViewsArraysWithoutCopying)
+{
+    int items[] = { 1, 2, 3, 4, 5 };
+    TArray<int> array{ items, 5, 8 };
+    TArrayView<int> view(array);
+    CHECK(view.data() == items);
+    CHECK(view.size() == 5);
+
+    int sum = 0;
+    for (auto item : view)
+    {
+        sum += item;
+    }
+    CHECK(sum == 15);
+    view[0] = 10;
+    CHECK(items[0] == 10);
+
+    TArrayView<const int> constView(array);
+    CHECK(constView.size() == 5 && constView[4] == 5);
+
+    CHECK(view.subview(1, 2).size() == 2 && view.subview(1, 2)[0] == 2);
+    CHECK(view.subview(3).size() == 2);
+    CHECK(view.subview(4, 100).size() == 1);
+    CHECK(view.subview(7).empty() && view.subview(7).data() == items + 5);
+
+    // An array the engine never allocated: no data whatever the count says.
+    TArray<int> unallocated{ nullptr, 3, 0 };
+    CHECK(TArrayView<int>(unallocated).empty());
+    CHECK(TArrayView<int>().begin() == TArrayView<int>().end());
+}
+
+TEST_CASE(ViewsStringsWithoutTheTerminator)
+{
+    wchar_t buffer[] = L"Normandy\0garbage";
+    FString string{};
+    string.Data = buffer;
+    string.Count = 9;
+    string.Max = 17;
+
+    FStringView view(string);
+    CHECK(view.size() == 8);
+    CHECK(view == L"Normandy");
+    CHECK(view != L"Normandy SR-2");
+    CHECK(view.c_str() == buffer);
+
+    FString empty{};
+    CHECK(FStringView(empty).empty());
+    CHECK(FStringView(empty).c_str()[0] == L'\0');
+
+    // Count 0 with a buffer left over from earlier text is still empty.
+    string.Count = 0;
+    CHECK(FStringView(string).empty());
+}
+
+TEST_CASE(DoesNothingWithoutAnAllocator)
+{
+    GameAllocator none;
+    CHECK(!none.Ready());
+    void* gmalloc = nullptr;
+    GameAllocator early(&gmalloc);   // The global exists but the engine hasn't set it yet.
+    CHECK(!early.Ready());
+    CHECK(early.Malloc(16) == nullptr);
+    CHECK(early.Realloc(nullptr, 16) == nullptr);
+    early.Free(nullptr);
+
+    int item = 7;
+    TArray<int> array{};
+    CHECK(!UE::ArrayAppend(array, &item, 1, early));
+    CHECK(array.Data == nullptr && array.Count == 0 && array.Max == 0);
+    CHECK(UE::ArrayAppend(array, &item, 0, early));   // Nothing to do.
+
+    FString string{};
+    CHECK(!UE::StringAssign(string, L"text", early));
+    CHECK(string.Count == 0);
+}
+
+TEST_CASE(CallsTheAllocatorBySlot)
+{
+    Game game;
+    CHECK(game.Allocator.Ready());
+    auto block = game.Allocator.Malloc(32, 16);
+    CHECK(block != nullptr);
+    CHECK(game.Malloc.LastAlignment == 16);
+    block = game.Allocator.Realloc(block, 64);
+    CHECK(game.Malloc.Reallocs == 1);
+    CHECK(game.Malloc.LastAlignment == GameAllocator::DEFAULT_ALIGNMENT);
+    game.Allocator.Free(block);
+    game.Allocator.Free(nullptr);
+    CHECK(game.Malloc.Frees == 1);
+}
+
+TEST_CASE(GrowsArraysWithSlack)
+{
+    Game game;
+    TArray<uint32_t> array{};
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        REQUIRE(UE::ArrayAppend(array, &i, 1, game.Allocator));
+    }
+    CHECK(array.Count == 1000);
+    CHECK(array.Max >= 1000);
+    CHECK(game.Malloc.Reallocs == 10);     // Not one per append.
+
+    bool intact = true;
+    for (uint32_t i = 0; i < array.Count; i++)
+    {
+        intact &= array.Data[i] == i;
+    }
+    CHECK(intact);
+
+    // Room reserved up front is used without another Realloc.
+    TArray<uint32_t> reserved{};
+    REQUIRE(UE::ArrayReserve(reserved, 64, game.Allocator));
+    auto reallocs = game.Malloc.Reallocs;
+    std::vector<uint32_t> items(64, 5);
+    CHECK(UE::ArrayAppend(reserved, items.data(), 64, game.Allocator));
+    CHECK(game.Malloc.Reallocs == reallocs);
+    CHECK(UE::ArrayReserve(reserved, 10, game.Allocator));   // Never shrinks.
+    CHECK(reserved.Max == 64);
+
+    UE::ArrayFree(array, game.Allocator);
+    UE::ArrayFree(reserved, game.Allocator);
+    CHECK(array.Data == nullptr && array.Count == 0 && array.Max == 0);
+    CHECK(game.Malloc.Frees == 2);
+}
+
+TEST_CASE(LeavesTheArrayAloneWhenTheAllocatorFails)
+{
+    Game game;
+    TArray<int> array{};
+    std::vector<int> items(16, 3);
+    REQUIRE(UE::ArrayAppend(array, items.data(), 16, game.Allocator));
+    auto data = array.Data;
+    auto max = array.Max;
+
+    game.Malloc.FailAfter = game.Malloc.Reallocs;
+    std::vector<int> more(max, 4);
+    CHECK(!UE::ArrayAppend(array, more.data(), max, game.Allocator));
+    CHECK(array.Data == data && array.Count == 16 && array.Max == max);
+    CHECK(array.Data[15] == 3);
+
+    FString string{};
+    CHECK(!UE::StringAppend(string, L"text", game.Allocator));
+    CHECK(string.Data == nullptr && string.Count == 0);
+    UE::ArrayFree(array, game.Allocator);
+}
+
+TEST_CASE(AssignsAndAppendsStrings)
+{
+    Game game;
+    FString string{};
+    REQUIRE(UE::StringAssign(string, L"Garrus", game.Allocator));
+    CHECK(text(string) == L"Garrus");
+    CHECK(string.Count == 7 && string.Data[6] == L'\0');
+
+    // Shorter text reuses the buffer.
+    auto data = string.Data;
+    REQUIRE(UE::StringAssign(string, L"Tali", game.Allocator));
+    CHECK(string.Data == data);
+    CHECK(text(string) == L"Tali" && string.Count == 5);
+
+    REQUIRE(UE::StringAppend(string, L"'Zorah", game.Allocator));
+    REQUIRE(UE::StringAppend(string, L"", game.Allocator));
+    CHECK(text(string) == L"Tali'Zorah");
+    CHECK(string.Count == 11 && string.Data[10] == L'\0');
+
+    std::wstring expected = L"Tali'Zorah";
+    for (int i = 0; i < 100; i++)
+    {
+        REQUIRE(UE::StringAppend(string, L" vas Normandy", game.Allocator));
+        expected += L" vas Normandy";
+    }
+    CHECK(text(string) == expected);
+    CHECK(string.Max >= string.Count);
+
+    REQUIRE(UE::StringAssign(string, L"", game.Allocator));
+    CHECK(FStringView(string).empty());
+    REQUIRE(UE::StringAppend(string, L"Wrex", game.Allocator));   // Appending to an empty string.
+    CHECK(text(string) == L"Wrex");
+    UE::ArrayFree(string, game.Allocator);
+}
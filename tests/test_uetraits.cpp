@@ -0,0 +1,113 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "testing.h"
+#include "ue_traits.h"
+
+
+namespace
+{
+    using UE::GameLayout;
+    using UE::LE1Traits;
+    using UE::LE2Traits;
+    using UE::LE3Traits;
+
+    // Engine objects as zeroed memory, big enough for any game's fields.
+    struct Memory
+    {
+        alignas(8) uint8_t Bytes[0x200] = {};
+
+        template<typename T>
+        T Read(size_t offset) const
+        {
+            T value;
+            memcpy(&value, Bytes + offset, sizeof(T));
+            return value;
+        }
+
+        bool ZeroExcept(size_t offset, size_t size) const
+        {
+            for (size_t i = 0; i < sizeof(Bytes); i++)
+            {
+                if ((i < offset || i >= offset + size) && Bytes[i] != 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    template<typename TGame>
+    bool accessesTheGamesFields()
+    {
+        Memory frame, function;
+        uint8_t script[4] = { 0x16, 0x04, 0x0B, 0x53 };   // EX_EndFunctionParms, EX_Return, EX_Nothing, EX_EndOfScript
+        int native = 0;
+
+        GameLayout<TGame>::FrameCode(frame.Bytes) = script;
+        GameLayout<TGame>::FunctionFunc(function.Bytes) = &native;
+        return frame.template Read<uint8_t*>(TGame::FrameCodeOffset) == script
+            && frame.ZeroExcept(TGame::FrameCodeOffset, sizeof(void*))
+            && function.template Read<void*>(TGame::FunctionFuncOffset) == &native
+            && function.ZeroExcept(TGame::FunctionFuncOffset, sizeof(void*))
+            && GameLayout<TGame>::FrameCode(frame.Bytes) == script;
+    }
+
+    template<typename TGame>
+    bool nativesStepPastTheParameters()
+    {
+        Memory frame;
+        uint8_t script[2] = { 0x16, 0x04 };
+        GameLayout<TGame>::FrameCode(frame.Bytes) = script;
+
+        long long result = -1;
+        UE::AlwaysPositiveNative<TGame>(nullptr, frame.Bytes, &result);
+        if (result != 1 || GameLayout<TGame>::FrameCode(frame.Bytes) != script + 1)
+        {
+            return false;
+        }
+        UE::AlwaysNegativeNative<TGame>(nullptr, frame.Bytes, &result);
+        return result == 0 && GameLayout<TGame>::FrameCode(frame.Bytes) == script + 2;
+    }
+}
+
+
+TEST_CASE(KnowsEachGamesLayout)
+{
+    // From the games' executables: FFrame::Code and UFunction::Func.
+    CHECK(LE1Traits::FrameCodeOffset == 0x24 && LE1Traits::FunctionFuncOffset == 0xF8);
+    CHECK(LE2Traits::FrameCodeOffset == 0x24 && LE2Traits::FunctionFuncOffset == 0xF0);
+    CHECK(LE3Traits::FrameCodeOffset == 0x28 && LE3Traits::FunctionFuncOffset == 0xD8);
+    CHECK(LE1Traits::LegacyGetName && !LE2Traits::LegacyGetName && !LE3Traits::LegacyGetName);
+
+    CHECK(UE::OBJECT_INDEX_OFFSET < UE::OBJECT_OUTER_OFFSET && UE::OBJECT_OUTER_OFFSET < UE::OBJECT_NAME_OFFSET);
+    CHECK(UE::OBJECT_NAME_OFFSET + 8 <= UE::OBJECT_HEADER_SIZE);
+}
+
+TEST_CASE(AccessesFieldsAtTheGamesOffsets)
+{
+    CHECK(accessesTheGamesFields<LE1Traits>());
+    CHECK(accessesTheGamesFields<LE2Traits>());
+    CHECK(accessesTheGamesFields<LE3Traits>());
+}
+
+TEST_CASE(ConstantNativesStepPastTheParameters)
+{
+    CHECK(nativesStepPastTheParameters<LE1Traits>());
+    CHECK(nativesStepPastTheParameters<LE2Traits>());
+    CHECK(nativesStepPastTheParameters<LE3Traits>());
+}
+
+TEST_CASE(PicksTheTraitsOfTheRunningGame)
+{
+    std::vector<LEGameVersion> seen;
+    auto record = [&seen](auto traits) { seen.push_back(decltype(traits)::Game); };
+
+    CHECK(UE::WithGameTraits(LEGameVersion::LE1, record));
+    CHECK(UE::WithGameTraits(LEGameVersion::LE2, record));
+    CHECK(UE::WithGameTraits(LEGameVersion::LE3, record));
+    CHECK(!UE::WithGameTraits(LEGameVersion::Launcher, record));
+    CHECK(!UE::WithGameTraits(LEGameVersion::Unsupported, record));
+    CHECK(seen == (std::vector<LEGameVersion>{ LEGameVersion::LE1, LEGameVersion::LE2, LEGameVersion::LE3 }));
+}
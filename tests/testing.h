@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+// Minimal test runner for the portable parts of the proxy, built on Linux (see CMakeLists.txt).
+// Each test file is its own executable: TEST_CASE(Name) { ... CHECK(...); }, main comes from here.
+
+namespace Testing
+{
+    struct Case
+    {
+        const char* Name;
+        void (*Proc)();
+    };
+
+    inline std::vector<Case>& Cases()
+    {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    inline int& Failures()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    struct Registrar
+    {
+        Registrar(const char* name, void (*proc)()) { Cases().push_back(Case{ name, proc }); }
+    };
+
+    inline void Fail(const char* file, int line, const char* expression)
+    {
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", file, line, expression);
+        Failures()++;
+    }
+}
+
+#define TEST_CASE(NAME) \
+    static void NAME(); \
+    static Testing::Registrar NAME##_registrar{ #NAME, &NAME }; \
+    static void NAME()
+
+#define CHECK(EXPRESSION) \
+    do { if (!(EXPRESSION)) Testing::Fail(__FILE__, __LINE__, #EXPRESSION); } while (false)
+
+// Stops the test case, for checks the rest of it depends on.
+#define REQUIRE(EXPRESSION) \
+    do { if (!(EXPRESSION)) { Testing::Fail(__FILE__, __LINE__, #EXPRESSION); return; } } while (false)
+
+int main()
+{
+    for (const auto& testCase : Testing::Cases())
+    {
+        auto before = Testing::Failures();
+        testCase.Proc();
+        printf("%s %s\n", Testing::Failures() == before ? "[ ok ]" : "[FAIL]", testCase.Name);
+    }
+    printf("%zu case(s), %d failed check(s)\n", Testing::Cases().size(), Testing::Failures());
+    return Testing::Failures() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}